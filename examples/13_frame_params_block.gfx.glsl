@@ -0,0 +1,31 @@
+﻿#version 430	/* version ディレクティブが必要な場合は必ず 1 行目に書くこと */
+
+/*
+	フレームパラメータ uniform block のサンプルコード。
+
+	フレーム単位のパラメータは、全パスとサウンドシェーダで共有される
+	uniform block FrameParams（binding = 0）からまとめて参照できる。
+	個別の layout(location) uniform 変数も互換のため引き続き利用できる。
+
+	エクスポートされた実行ファイル上ではこの uniform block は利用できない。
+*/
+layout(std140, binding = 0) uniform FrameParams {
+	mat4 cameraInWorld;
+	mat4 prevCameraInWorld;
+	vec2 resolution;
+	vec2 mouse;
+	ivec3 mouseButtons;
+	int waveOutPos;
+	int frameCount;
+	float time;
+	float tanFovY;
+};
+
+out vec4 outColor;
+
+void main(){
+	vec2 uv = gl_FragCoord.xy / resolution;
+	vec3 color = .5 + .5 * cos(time + uv.xyx + vec3(0, 2, 4));
+	if (mouseButtons.x != 0) color *= step(distance(uv, mouse), .1);
+	outColor = vec4(color, 1);
+}
@@ -32,6 +32,12 @@
 #include "tiny_vmath.h"
 #include "app.h"
 #include "pipeline_description.h"
+#include "gl_state_cache.h"
+#include "profiler.h"
+#include "shader_cache.h"
+#include "file_watcher.h"
+#include "shader_include_cache.h"
+#include "shader_source_job.h"
 
 #include "resource/resource.h"
 
@@ -44,12 +50,15 @@ static int s_xReso = DEFAULT_SCREEN_XRESO;
 static int s_yReso = DEFAULT_SCREEN_YRESO;
 static int32_t s_waveOutSampleOffset = 0;
 static int32_t s_frameCount = 0;
+static char s_traceFileName[MAX_PATH] = {0};
 static struct ImGuiStatus {
 	bool displayCurrentStatus;
 	bool displayCameraSettings;
+	bool displayProfiler;
 } s_imGuiStatus = {
 	true,
-	true
+	true,
+	false
 };
 static struct Mouse {
 	int x;
@@ -91,11 +100,18 @@ static RenderSettings s_renderSettings = {
 	/* bool enableSwapIntervalControl; */	true,
 	/* SwapInterval swapInterval; */		DEFAULT_SWAP_INTERVAL,
 };
+static DynamicResolutionSettings s_dynamicResolutionSettings = {
+	/* bool enable; */							false,
+	/* float targetFrameTimeInMilliseconds; */	DEFAULT_DYNAMIC_RESOLUTION_TARGET_FRAME_TIME_IN_MILLISECONDS,
+	/* float minScale; */						DEFAULT_DYNAMIC_RESOLUTION_MIN_SCALE,
+};
 static PipelineDescription s_pipelineDescriptionForProject = {{0}};
 static bool s_pipelineDescriptionIsValid = false;
 static char s_pipelineLastFileName[MAX_PATH] = {0};
 static struct stat s_pipelineFileStat;
 static void AppPipelineSetLastFileNameInternal(const char *fileName);
+static void AppPipelineSetBaseDirectoryNameInternal(const char *directoryName);
+static void AppReloadPipelinePassShaders();
 static bool AppPrepareShaderSource(
  const char *fileName,
  const char *fallbackSource,
@@ -160,30 +176,62 @@ static struct stat s_projectFileStat;
 /*=============================================================================
 ▼	シェーダソースファイル関連
 -----------------------------------------------------------------------------*/
+/*
+	シェーダは非同期に作成され、コンパイル中およびコンパイル失敗時は、直前に
+	作成に成功したプログラムで実行を続ける。
+	*CreateShaderSucceeded は最新のソースのコンパイルに成功したか、
+	*ShaderInstalled は実行可能なプログラムが設定されているかを表す。
+	*ShaderSourceHash はコンパイル中または最後にコンパイルしたソースのハッシュ値
+	（未コンパイルなら 0）。
+	ソースの準備は *ShaderSourceJob でワーカースレッドが行う。
+*/
 static char s_soundShaderFileName[MAX_PATH] = "";
 static char *s_soundShaderCode = NULL;
-static struct stat s_soundShaderFileStat;
 static bool s_soundCreateShaderSucceeded = false;
+static bool s_soundShaderInstalled = false;
+static uint64_t s_soundShaderSourceHash = 0;
+static ShaderSourceJob s_soundShaderSourceJob;
+static ShaderCompileTask s_soundShaderCompileTask;
 
 static char s_graphicsShaderFileName[MAX_PATH] = "";
 static char *s_graphicsShaderCode = NULL;
-static struct stat s_graphicsShaderFileStat;
 static bool s_graphicsCreateShaderSucceeded = false;
+static bool s_graphicsShaderInstalled = false;
+static uint64_t s_graphicsShaderSourceHash = 0;
+static ShaderSourceJob s_graphicsShaderSourceJob;
+static ShaderCompileTask s_graphicsShaderCompileTask;
 
 static char s_computeShaderFileName[MAX_PATH] = "";
 static char *s_computeShaderCode = NULL;
-static struct stat s_computeShaderFileStat;
 static bool s_computeCreateShaderSucceeded = false;
+static bool s_computeShaderInstalled = false;
+static uint64_t s_computeShaderSourceHash = 0;
+static ShaderSourceJob s_computeShaderSourceJob;
+static ShaderCompileTask s_computeShaderCompileTask;
 
 struct ShaderIncludeDependency {
-	std::string fileName;
-	struct stat fileStat;
+	std::string fileName;	/* 正規化されたパス */
 };
 
 static std::vector<ShaderIncludeDependency> s_graphicsShaderIncludeDependencies;
 static std::vector<ShaderIncludeDependency> s_computeShaderIncludeDependencies;
 static std::vector<ShaderIncludeDependency> s_soundShaderIncludeDependencies;
 
+/*=============================================================================
+▼	パイプラインパスのシェーダ関連
+-----------------------------------------------------------------------------*/
+static char s_pipelineBaseDirectoryName[MAX_PATH] = "";
+static struct PipelinePassShader {
+	char fileName[MAX_PATH];
+	bool initialLoadPending;	/* パイプライン読み込み直後の読み込み待ち（自動リスタートしない）*/
+	bool createShaderSucceeded;
+	bool restartWhenCompiled;
+	uint64_t sourceHash;
+	ShaderSourceJob sourceJob;
+	ShaderCompileTask compileTask;
+	std::vector<ShaderIncludeDependency> includeDependencies;
+} s_pipelinePassShaders[PIPELINE_MAX_PASSES];
+
 static std::string AppNormalizePath(const char *path){
 	if (path == NULL || path[0] == '\0') {
 		return std::string();
@@ -222,8 +270,6 @@ static void AppSetShaderIncludeDependencies(
 		}
 		ShaderIncludeDependency dependency;
 		dependency.fileName = path;
-		std::memset(&dependency.fileStat, 0, sizeof(dependency.fileStat));
-		stat(path.c_str(), &dependency.fileStat);
 		dependencies.push_back(std::move(dependency));
 	}
 }
@@ -232,27 +278,6 @@ static void AppClearShaderIncludeDependencies(std::vector<ShaderIncludeDependenc
 	dependencies.clear();
 }
 
-static bool AppHaveShaderIncludeDependenciesUpdated(std::vector<ShaderIncludeDependency> &dependencies){
-	bool updated = false;
-	for (ShaderIncludeDependency &dependency : dependencies) {
-		struct stat currentStat;
-		if (stat(dependency.fileName.c_str(), &currentStat) != 0) {
-			if (dependency.fileStat.st_mtime != 0
-		||	dependency.fileStat.st_size != 0
-		) {
-				updated = true;
-			}
-			std::memset(&dependency.fileStat, 0, sizeof(dependency.fileStat));
-			continue;
-		}
-		if (dependency.fileStat.st_mtime != currentStat.st_mtime) {
-			updated = true;
-		}
-		dependency.fileStat = currentStat;
-	}
-	return updated;
-}
-
 static const char s_defaultGraphicsShaderCode[] =
 	"#version 430\n"
 
@@ -660,6 +685,14 @@ bool AppImGuiGetDisplayCameraSettingsFlag(){
 	return s_imGuiStatus.displayCameraSettings;
 }
 
+void AppImGuiSetDisplayProfilerFlag(bool flag){
+	s_imGuiStatus.displayProfiler = flag;
+}
+
+bool AppImGuiGetDisplayProfilerFlag(){
+	return s_imGuiStatus.displayProfiler;
+}
+
 /*=============================================================================
 ▼	プリファレンス設定関連
 -----------------------------------------------------------------------------*/
@@ -1120,10 +1153,47 @@ void AppExportExecutable(){
 			return;
 		}
 
+		/* パイプラインパス個別のシェーダ（個別シェーダを持たないパスは NULL）*/
+		std::string expandedPipelinePassShaders[PIPELINE_MAX_PASSES];
+		const char *pipelinePassShaderSources[PIPELINE_MAX_PASSES] = {NULL};
+		for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+			const PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+			if (passShader->fileName[0] == '\0') continue;
+			if (passShader->createShaderSucceeded == false) {
+				AppErrorMessageBox(APP_NAME, "Please fix shader compile errors before export.");
+				return;
+			}
+			const char *passShaderSource = NULL;
+			if (AppPrepareShaderSource(
+					passShader->fileName,
+					NULL,
+					expandedPipelinePassShaders[passIndex],
+					&passShaderSource,
+					errorMessage,
+					NULL
+				) == false
+			) {
+				if (errorMessage.empty()) {
+					errorMessage = "Failed to prepare pipeline pass shader source.";
+				}
+				AppErrorMessageBox(APP_NAME, "%s", errorMessage.c_str());
+				return;
+			}
+			pipelinePassShaderSources[passIndex] = passShaderSource;
+		}
+		/* downsample/upsample パスは組み込みシェーダを個別シェーダとして書き出す */
+		for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+			const char *builtinShaderSource = GraphicsGetPipelineBuiltinPassShaderSource(passIndex);
+			if (builtinShaderSource != NULL) {
+				pipelinePassShaderSources[passIndex] = builtinShaderSource;
+			}
+		}
+
 		(void) ExportExecutable(
 			graphicsShaderSource,
 			computeShaderSource,
 			soundShaderSource,
+			pipelinePassShaderSources,
 			&s_renderSettings,
 			&s_executableExportSettings
 		);
@@ -1192,6 +1262,23 @@ void AppRecordImageSequence(){
 	}
 }
 
+/*=============================================================================
+▼	トレース記録関連
+-----------------------------------------------------------------------------*/
+bool AppRecordTrace(const char *fileName){
+	if (ProfilerIsTraceRecording()) {
+		AppErrorMessageBox(APP_NAME, "Trace recording is already in progress.");
+		return false;
+	}
+	strcpy_s(s_traceFileName, sizeof(s_traceFileName), fileName);
+	if (ProfilerStartTrace(fileName, DEFAULT_TRACE_NUM_FRAMES) == false) {
+		AppErrorMessageBox(APP_NAME, "Failed to start trace recording.");
+		return false;
+	}
+	printf("record trace (%d frames).\n", DEFAULT_TRACE_NUM_FRAMES);
+	return true;
+}
+
 /*=============================================================================
 ▼	JSON ユーティリティ関連
 -----------------------------------------------------------------------------*/
@@ -1328,7 +1415,7 @@ static bool AppProjectDeserializeFromJson(cJSON *jsonRoot, const char *projectBa
 				AppOpenDefaultComputeShader();
 				result = false;
 			} else {
-				s_computeShaderFileStat.st_mtime = 0;
+				FileWatcherRequestRead(s_computeShaderFileName);
 			}
 		}
 
@@ -1402,6 +1489,11 @@ static bool AppProjectDeserializeFromJson(cJSON *jsonRoot, const char *projectBa
 		JsonGetAsBool(jsonRoot, "/renderSettings/enableSwapIntervalControl",   &s_renderSettings.enableSwapIntervalControl, true);
 		JsonGetAsInt (jsonRoot, "/renderSettings/swapInterval",                (int *)&s_renderSettings.swapInterval, DEFAULT_SWAP_INTERVAL);
 	}
+	{
+		JsonGetAsBool (jsonRoot, "/dynamicResolution/enable",                        &s_dynamicResolutionSettings.enable, false);
+		JsonGetAsFloat(jsonRoot, "/dynamicResolution/targetFrameTimeInMilliseconds", &s_dynamicResolutionSettings.targetFrameTimeInMilliseconds, DEFAULT_DYNAMIC_RESOLUTION_TARGET_FRAME_TIME_IN_MILLISECONDS);
+		JsonGetAsFloat(jsonRoot, "/dynamicResolution/minScale",                      &s_dynamicResolutionSettings.minScale, DEFAULT_DYNAMIC_RESOLUTION_MIN_SCALE);
+	}
 	{
 		cJSON *jsonPipeline = cJSONUtils_GetPointer(jsonRoot, "/pipeline");
 		if (jsonPipeline != NULL && cJSON_IsObject(jsonPipeline)) {
@@ -1418,11 +1510,15 @@ static bool AppProjectDeserializeFromJson(cJSON *jsonRoot, const char *projectBa
 				s_pipelineDescriptionForProject = pipelineDescription;
 				s_pipelineDescriptionIsValid = true;
 				AppPipelineSetLastFileNameInternal(NULL);
+				AppPipelineSetBaseDirectoryNameInternal(projectBasePath);
 				GraphicsApplyPipelineDescription(&s_pipelineDescriptionForProject);
+				AppReloadPipelinePassShaders();
 			} else {
 				s_pipelineDescriptionIsValid = false;
 				AppPipelineSetLastFileNameInternal(NULL);
+				AppPipelineSetBaseDirectoryNameInternal(NULL);
 				GraphicsApplyPipelineDescription(NULL);
+				AppReloadPipelinePassShaders();
 				if (errorMessage[0] != '\0') {
 					AppErrorMessageBox(APP_NAME, "Failed to load pipeline: %s", errorMessage);
 				} else {
@@ -1433,7 +1529,9 @@ static bool AppProjectDeserializeFromJson(cJSON *jsonRoot, const char *projectBa
 		} else {
 			s_pipelineDescriptionIsValid = false;
 			AppPipelineSetLastFileNameInternal(NULL);
+			AppPipelineSetBaseDirectoryNameInternal(NULL);
 			GraphicsApplyPipelineDescription(NULL);
+			AppReloadPipelinePassShaders();
 		}
 	}
 	{
@@ -1516,6 +1614,7 @@ static bool AppProjectDeserializeFromJson(cJSON *jsonRoot, const char *projectBa
 	{
 		JsonGetAsBool(jsonRoot, "/imGuiStatus/displayCurrentStatus",  &s_imGuiStatus.displayCurrentStatus, true);
 		JsonGetAsBool(jsonRoot, "/imGuiStatus/displayCameraSettings", &s_imGuiStatus.displayCameraSettings, true);
+		JsonGetAsBool(jsonRoot, "/imGuiStatus/displayProfiler",       &s_imGuiStatus.displayProfiler, false);
 	}
 	{
 		for (int i = 0; i < NUM_USER_TEXTURES; i++) {
@@ -1648,6 +1747,12 @@ static void AppProjectSerializeToJson(cJSON *jsonRoot, const char *projectBasePa
 		cJSON_AddBoolToObject  (jsonSettings, "enableSwapIntervalControl",  s_renderSettings.enableSwapIntervalControl);
 		cJSON_AddNumberToObject(jsonSettings, "swapInterval",               s_renderSettings.swapInterval);
 	}
+	{
+		cJSON *jsonSettings = cJSON_AddObjectToObject(jsonRoot, "dynamicResolution");
+		cJSON_AddBoolToObject  (jsonSettings, "enable",                        s_dynamicResolutionSettings.enable);
+		cJSON_AddNumberToObject(jsonSettings, "targetFrameTimeInMilliseconds", s_dynamicResolutionSettings.targetFrameTimeInMilliseconds);
+		cJSON_AddNumberToObject(jsonSettings, "minScale",                      s_dynamicResolutionSettings.minScale);
+	}
 	if (s_pipelineDescriptionIsValid) {
 		cJSON *jsonPipeline = PipelineDescriptionSerializeToJson(&s_pipelineDescriptionForProject);
 		if (jsonPipeline != NULL) {
@@ -1739,6 +1844,7 @@ static void AppProjectSerializeToJson(cJSON *jsonRoot, const char *projectBasePa
 		cJSON *jsonImGuiStatus = cJSON_AddObjectToObject(jsonRoot, "imGuiStatus");
 		cJSON_AddBoolToObject(jsonImGuiStatus, "displayCurrentStatus",  s_imGuiStatus.displayCurrentStatus);
 		cJSON_AddBoolToObject(jsonImGuiStatus, "displayCameraSettings", s_imGuiStatus.displayCameraSettings);
+		cJSON_AddBoolToObject(jsonImGuiStatus, "displayProfiler",       s_imGuiStatus.displayProfiler);
 	}
 	{
 		cJSON *jsonUserTextures = cJSON_AddArrayToObject(jsonRoot, "userTextures");
@@ -1768,18 +1874,12 @@ const char *AppProjectGetCurrentFileName(){
 	return s_projectFileName;
 }
 
-bool AppProjectImport(const char *fileName){
+/* 読み込み済みのプロジェクトファイルの内容からインポート */
+static bool AppProjectImportFromText(const char *fileName, const char *text){
 	/* プロジェクトのベースパス抽出 */
 	char projectBasePath[MAX_PATH] = {0};
 	SplitDirectoryPathFromFilePath(projectBasePath, sizeof(projectBasePath), fileName);
 
-	/* シリアライズされたプロジェクトの読み込み */
-	char *text = MallocReadTextFile(fileName);
-	if (text == NULL) {
-		AppErrorMessageBox(APP_NAME, "Failed to import project %s.", fileName);
-		return false;
-	}
-
 	/* プロジェクトのデシリアライズ */
 	cJSON *jsonRoot = cJSON_Parse(text);
 	bool result = AppProjectDeserializeFromJson(jsonRoot, projectBasePath);
@@ -1806,11 +1906,22 @@ bool AppProjectImport(const char *fileName){
 	AppUpdateWindowTitleBar();
 
 	/* シェーダは強制的に再読み込み */
-	s_soundShaderFileStat.st_mtime = 0;
-	s_graphicsShaderFileStat.st_mtime = 0;
+	FileWatcherRequestRead(s_soundShaderFileName);
+	FileWatcherRequestRead(s_graphicsShaderFileName);
 
 	/* リソース解放して終了 */
 	cJSON_Delete(jsonRoot);
+	return result;
+}
+
+bool AppProjectImport(const char *fileName){
+	/* シリアライズされたプロジェクトの読み込み */
+	char *text = MallocReadTextFile(fileName);
+	if (text == NULL) {
+		AppErrorMessageBox(APP_NAME, "Failed to import project %s.", fileName);
+		return false;
+	}
+	bool result = AppProjectImportFromText(fileName, text);
 	free(text);
 	return result;
 }
@@ -1965,153 +2076,219 @@ static bool AppPrepareShaderSource(
 	return true;
 }
 
+/*
+	シェーダのリロード
+	ソースの準備（#include 展開とハッシュ値の計算）をワーカースレッドで開始するだけで、
+	実行中のプログラムはそのまま使い続ける。準備が完了したら
+	AppUpdateShaderSourceJobs() でコンパイルを開始する。展開後のソースが前回と
+	同一ならコンパイルしない。
+	コンパイル結果は AppUpdateShaderCompileTasks() でフレームの境界に反映される。
+*/
 static bool AppReloadGraphicsShader(){
-	GraphicsDeleteShaderPipeline();
-	GraphicsDeleteFragmentShader();
 	if (s_graphicsShaderCode == NULL) {
+		ShaderSourceJobCancel(&s_graphicsShaderSourceJob);
+		ShaderCompileTaskCancel(&s_graphicsShaderCompileTask);
 		s_graphicsCreateShaderSucceeded = false;
+		s_graphicsShaderSourceHash = 0;
 		return false;
 	}
-	const char *sourceToCompile = s_graphicsShaderCode;
-	std::string expandedSource;
-	std::string errorMessage;
-	std::vector<std::string> includedFiles;
-	if (AppPrepareShaderSource(
-			s_graphicsShaderFileName,
-			s_graphicsShaderCode,
-			expandedSource,
-			&sourceToCompile,
-			errorMessage,
-			&includedFiles
-		) == false
-	) {
-		if (errorMessage.empty()) {
-			errorMessage = "Failed to prepare graphics shader source.";
-		}
-		AppErrorMessageBox(APP_NAME, "%s", errorMessage.c_str());
-		s_graphicsCreateShaderSucceeded = false;
-		return false;
-	}
-
-	if (s_graphicsShaderFileName[0] != '\0') {
-		AppSetShaderIncludeDependencies(
-			s_graphicsShaderIncludeDependencies,
-			includedFiles,
-			s_graphicsShaderFileName
-		);
-	} else {
-		AppClearShaderIncludeDependencies(s_graphicsShaderIncludeDependencies);
-	}
-
-	s_graphicsCreateShaderSucceeded = GraphicsCreateFragmentShader(sourceToCompile);
-	if (s_graphicsCreateShaderSucceeded) {
-		GraphicsCreateShaderPipeline();
-		if (s_preferenceSettings.enableAutoRestartByGraphicsShader) {
-			AppRestart();
-		}
-	}
-	return s_graphicsCreateShaderSucceeded;
+	ShaderSourceJobStart(&s_graphicsShaderSourceJob, s_graphicsShaderFileName, s_graphicsShaderCode);
+	return true;
 }
 
 static bool AppReloadComputeShader(){
-	GraphicsDeleteComputeShader();
 	if (s_computeShaderCode == NULL) {
+		ShaderSourceJobCancel(&s_computeShaderSourceJob);
+		ShaderCompileTaskCancel(&s_computeShaderCompileTask);
 		s_computeCreateShaderSucceeded = false;
+		s_computeShaderSourceHash = 0;
 		return false;
 	}
-	const char *sourceToCompile = s_computeShaderCode;
-	std::string expandedSource;
-	std::string errorMessage;
-	std::vector<std::string> includedFiles;
-	if (AppPrepareShaderSource(
-			s_computeShaderFileName,
-			s_computeShaderCode,
-			expandedSource,
-			&sourceToCompile,
-			errorMessage,
-			&includedFiles
-		) == false
-	) {
-		if (errorMessage.empty()) {
-			errorMessage = "Failed to prepare compute shader source.";
-		}
-		AppErrorMessageBox(APP_NAME, "%s", errorMessage.c_str());
-		s_computeCreateShaderSucceeded = false;
-		return false;
-	}
-	if (s_computeShaderFileName[0] != '\0') {
-		AppSetShaderIncludeDependencies(
-			s_computeShaderIncludeDependencies,
-			includedFiles,
-			s_computeShaderFileName
-		);
-	} else {
-		AppClearShaderIncludeDependencies(s_computeShaderIncludeDependencies);
-	}
-	s_computeCreateShaderSucceeded = GraphicsCreateComputeShader(sourceToCompile);
-	if (s_computeCreateShaderSucceeded
-	&&	s_preferenceSettings.enableAutoRestartByGraphicsShader
-	) {
-		AppRestart();
-	}
-	return s_computeCreateShaderSucceeded;
+	ShaderSourceJobStart(&s_computeShaderSourceJob, s_computeShaderFileName, s_computeShaderCode);
+	return true;
 }
 
 static bool AppReloadSoundShader(){
-	/*
-		シェーダリロード時のサウンド周りのリセットは厄介な問題。
-		シェーダコンパイル中にも再生位置は進んでしまう。
-		一時停止して先頭にシーク、サウンド生成が完了したのち再生する。
-	*/
-
-	SoundDeleteShader();
 	if (s_soundShaderCode == NULL) {
+		ShaderSourceJobCancel(&s_soundShaderSourceJob);
+		ShaderCompileTaskCancel(&s_soundShaderCompileTask);
 		s_soundCreateShaderSucceeded = false;
+		s_soundShaderSourceHash = 0;
 		return false;
 	}
-	const char *sourceToCompile = s_soundShaderCode;
-	std::string expandedSource;
-	std::string errorMessage;
-	std::vector<std::string> includedFiles;
-	if (AppPrepareShaderSource(
-			s_soundShaderFileName,
-			s_soundShaderCode,
-			expandedSource,
-			&sourceToCompile,
-			errorMessage,
-			&includedFiles
-		) == false
-	) {
-		if (errorMessage.empty()) {
-			errorMessage = "Failed to prepare sound shader source.";
+	ShaderSourceJobStart(&s_soundShaderSourceJob, s_soundShaderFileName, s_soundShaderCode);
+	return true;
+}
+
+/* 準備が完了したソースのコンパイル開始 */
+static void AppUpdateShaderSourceJobs(){
+	const struct {
+		const char *name;
+		GLenum type;
+		const char *fileName;
+		ShaderSourceJob *sourceJob;
+		ShaderCompileTask *compileTask;
+		std::vector<ShaderIncludeDependency> *includeDependencies;
+		uint64_t *sourceHash;
+		bool *createShaderSucceeded;
+	} shaders[] = {
+		{"graphics",	GL_FRAGMENT_SHADER,	s_graphicsShaderFileName,	&s_graphicsShaderSourceJob,	&s_graphicsShaderCompileTask,	&s_graphicsShaderIncludeDependencies,	&s_graphicsShaderSourceHash,	&s_graphicsCreateShaderSucceeded},
+		{"compute",		GL_COMPUTE_SHADER,	s_computeShaderFileName,	&s_computeShaderSourceJob,	&s_computeShaderCompileTask,	&s_computeShaderIncludeDependencies,	&s_computeShaderSourceHash,		&s_computeCreateShaderSucceeded},
+		{"sound",		GL_COMPUTE_SHADER,	s_soundShaderFileName,		&s_soundShaderSourceJob,	&s_soundShaderCompileTask,		&s_soundShaderIncludeDependencies,		&s_soundShaderSourceHash,		&s_soundCreateShaderSucceeded},
+	};
+	for (int shaderIndex = 0; shaderIndex < SIZE_OF_ARRAY(shaders); shaderIndex++) {
+		ShaderSourceJobResult result;
+		switch (ShaderSourceJobPoll(shaders[shaderIndex].sourceJob, &result)) {
+			case ShaderSourceJobStatusSucceeded: {
+				if (shaders[shaderIndex].fileName[0] != '\0') {
+					AppSetShaderIncludeDependencies(
+						*shaders[shaderIndex].includeDependencies,
+						result.includedFiles,
+						shaders[shaderIndex].fileName
+					);
+				} else {
+					AppClearShaderIncludeDependencies(*shaders[shaderIndex].includeDependencies);
+				}
+
+				/* 展開後のソースが前回と同一なら何もしない（自動リスタートも行わない）*/
+				if (result.sourceHash == *shaders[shaderIndex].sourceHash) {
+					printf("the %s shader source is unchanged, skip compilation.\n", shaders[shaderIndex].name);
+					break;
+				}
+				*shaders[shaderIndex].sourceHash = result.sourceHash;
+
+				printf("compile the %s shader ...\n", shaders[shaderIndex].name);
+				*shaders[shaderIndex].createShaderSucceeded = false;
+				ShaderCompileTaskStart(shaders[shaderIndex].compileTask, shaders[shaderIndex].type, result.source.c_str());
+			} break;
+			case ShaderSourceJobStatusFailed: {
+				AppErrorMessageBox(APP_NAME, "%s", result.errorMessage.c_str());
+				ShaderCompileTaskCancel(shaders[shaderIndex].compileTask);
+				*shaders[shaderIndex].createShaderSucceeded = false;
+				*shaders[shaderIndex].sourceHash = 0;
+			} break;
+			default: {
+			} break;
 		}
-		AppErrorMessageBox(APP_NAME, "%s", errorMessage.c_str());
-		s_soundCreateShaderSucceeded = false;
-		return false;
-	}
-	if (s_soundShaderFileName[0] != '\0') {
-		AppSetShaderIncludeDependencies(
-			s_soundShaderIncludeDependencies,
-			includedFiles,
-			s_soundShaderFileName
-		);
-	} else {
-		AppClearShaderIncludeDependencies(s_soundShaderIncludeDependencies);
 	}
+}
 
-	s_soundCreateShaderSucceeded = SoundCreateShader(sourceToCompile);
-	if (s_soundCreateShaderSucceeded) {
-		if (s_preferenceSettings.enableAutoRestartBySoundShader) {
-			SoundPauseWaveOut();
-			SoundSeekWaveOut(0);
-		}
-		SoundClearOutputBuffer();
-		SoundUpdate(s_frameCount);
-		if (s_preferenceSettings.enableAutoRestartBySoundShader) {
-			AppRestart();
+static void AppUpdateShaderCompileTasks(){
+	GLuint programId;
+
+	switch (ShaderCompileTaskPoll(&s_graphicsShaderCompileTask, &programId)) {
+		case ShaderCompileStatusSucceeded: {
+			s_graphicsCreateShaderSucceeded = GraphicsSetFragmentShader(programId);
+			s_graphicsShaderInstalled = s_graphicsCreateShaderSucceeded;
+			if (s_graphicsCreateShaderSucceeded
+			&&	s_preferenceSettings.enableAutoRestartByGraphicsShader
+			) {
+				AppRestart();
+			}
+		} break;
+		case ShaderCompileStatusFailed: {
+			printf("compile the graphics shader ... failed.%s\n", s_graphicsShaderInstalled? " the previous program is kept.": "");
+		} break;
+		default: {
+		} break;
+	}
+
+	switch (ShaderCompileTaskPoll(&s_computeShaderCompileTask, &programId)) {
+		case ShaderCompileStatusSucceeded: {
+			s_computeCreateShaderSucceeded = GraphicsSetComputeShader(programId);
+			s_computeShaderInstalled = s_computeCreateShaderSucceeded;
+			if (s_computeCreateShaderSucceeded
+			&&	s_preferenceSettings.enableAutoRestartByGraphicsShader
+			) {
+				AppRestart();
+			}
+		} break;
+		case ShaderCompileStatusFailed: {
+			printf("compile the compute shader ... failed.%s\n", s_computeShaderInstalled? " the previous program is kept.": "");
+		} break;
+		default: {
+		} break;
+	}
+
+	switch (ShaderCompileTaskPoll(&s_soundShaderCompileTask, &programId)) {
+		case ShaderCompileStatusSucceeded: {
+			s_soundCreateShaderSucceeded = SoundSetShader(programId);
+			s_soundShaderInstalled = s_soundCreateShaderSucceeded;
+			if (s_soundCreateShaderSucceeded) {
+				/*
+					シェーダリロード時のサウンド周りのリセットは厄介な問題。
+					シェーダコンパイル中にも再生位置は進んでしまう。
+					一時停止して先頭にシーク、サウンド生成が完了したのち再生する。
+				*/
+				if (s_preferenceSettings.enableAutoRestartBySoundShader) {
+					SoundPauseWaveOut();
+					SoundSeekWaveOut(0);
+				}
+				SoundClearOutputBuffer();
+				SoundUpdate(s_frameCount);
+				if (s_preferenceSettings.enableAutoRestartBySoundShader) {
+					AppRestart();
+				}
+			}
+		} break;
+		case ShaderCompileStatusFailed: {
+			printf("compile the sound shader ... failed.%s\n", s_soundShaderInstalled? " the previous program is kept.": "");
+		} break;
+		default: {
+		} break;
+	}
+
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+		switch (ShaderCompileTaskPoll(&passShader->compileTask, &programId)) {
+			case ShaderCompileStatusSucceeded: {
+				passShader->createShaderSucceeded = GraphicsSetPipelinePassShader(passIndex, programId);
+				if (passShader->createShaderSucceeded
+				&&	passShader->restartWhenCompiled
+				&&	s_preferenceSettings.enableAutoRestartByGraphicsShader
+				) {
+					AppRestart();
+				}
+			} break;
+			case ShaderCompileStatusFailed: {
+				printf("compile the pipeline pass shader %d ... failed.\n", passIndex);
+			} break;
+			default: {
+			} break;
 		}
 	}
-	return s_soundCreateShaderSucceeded;
+}
+
+static void AppCancelShaderCompileTasks(){
+	ShaderSourceJobCancel(&s_graphicsShaderSourceJob);
+	ShaderSourceJobCancel(&s_computeShaderSourceJob);
+	ShaderSourceJobCancel(&s_soundShaderSourceJob);
+	ShaderCompileTaskCancel(&s_graphicsShaderCompileTask);
+	ShaderCompileTaskCancel(&s_computeShaderCompileTask);
+	ShaderCompileTaskCancel(&s_soundShaderCompileTask);
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		ShaderSourceJobCancel(&s_pipelinePassShaders[passIndex].sourceJob);
+		ShaderCompileTaskCancel(&s_pipelinePassShaders[passIndex].compileTask);
+	}
+}
+
+/* コンパイル状態の表示 */
+static void AppImGuiShowShaderCompileStatus(
+	const char *name,
+	const ShaderSourceJob *sourceJob,
+	const ShaderCompileTask *task,
+	bool createShaderSucceeded,
+	bool installed
+){
+	if (ShaderSourceJobIsActive(sourceJob)) {
+		ImGui::Text("preparing %s ...", name);
+	} else
+	if (ShaderCompileTaskIsActive(task)) {
+		ImGui::Text("compiling %s ... %.1f s", name, ShaderCompileTaskGetElapsedTimeInSeconds(task));
+	} else
+	if (createShaderSucceeded == false && installed) {
+		ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s : compile error (previous program kept)", name);
+	}
 }
 
 /*=============================================================================
@@ -2147,6 +2324,163 @@ static void AppPipelineSetLastFileNameInternal(const char *fileName){
 	strlcpy(s_pipelineLastFileName, fileName, sizeof(s_pipelineLastFileName));
 }
 
+static void AppPipelineSetBaseDirectoryNameInternal(const char *directoryName){
+	if (directoryName == NULL) {
+		s_pipelineBaseDirectoryName[0] = '\0';
+		return;
+	}
+	strlcpy(s_pipelineBaseDirectoryName, directoryName, sizeof(s_pipelineBaseDirectoryName));
+}
+
+static bool AppPipelineResolvePassShaderFileName(
+	const char *shaderPath,
+	char *resolvedFileName,
+	size_t resolvedFileNameSizeInBytes
+){
+	resolvedFileName[0] = '\0';
+	if (shaderPath == NULL || shaderPath[0] == '\0') {
+		return false;
+	}
+
+	/*
+		相対パスは、パイプライン記述の読み込み元ディレクトリ、
+		実行ファイルのディレクトリ、カレントディレクトリの順に探す。
+	*/
+	char moduleDirectoryName[MAX_PATH] = {0};
+	{
+		char modulePath[MAX_PATH] = {0};
+		if (GetModuleFileName(NULL, modulePath, sizeof(modulePath)) != 0) {
+			SplitDirectoryPathFromFilePath(moduleDirectoryName, sizeof(moduleDirectoryName), modulePath);
+		}
+	}
+	const char *baseDirectoryNames[] = {
+		s_pipelineBaseDirectoryName,
+		moduleDirectoryName
+	};
+	for (int baseIndex = 0; baseIndex < (int)SIZE_OF_ARRAY(baseDirectoryNames); baseIndex++) {
+		if (baseDirectoryNames[baseIndex][0] == '\0') continue;
+		char combinedPath[MAX_PATH] = {0};
+		GenerateCombinedPath(combinedPath, sizeof(combinedPath), baseDirectoryNames[baseIndex], shaderPath);
+		if (IsValidFileName(combinedPath)) {
+			strlcpy(resolvedFileName, combinedPath, resolvedFileNameSizeInBytes);
+			return true;
+		}
+	}
+	if (IsValidFileName(shaderPath)) {
+		strlcpy(resolvedFileName, shaderPath, resolvedFileNameSizeInBytes);
+		return true;
+	}
+	return false;
+}
+
+/* 準備中、コンパイル中のタスクを破棄し、次のリロードで必ずコンパイルされる状態にする */
+static void AppInvalidatePipelinePassShader(PipelinePassShader *passShader){
+	ShaderSourceJobCancel(&passShader->sourceJob);
+	ShaderCompileTaskCancel(&passShader->compileTask);
+	passShader->createShaderSucceeded = false;
+	passShader->restartWhenCompiled = false;
+	passShader->sourceHash = 0;
+}
+
+/*
+	shaderCode はファイル監視スレッドで読み込まれたパスのシェーダファイルの内容
+	（内容は #include 展開用キャッシュに反映済みなので、読み込みの成否だけを見る）
+*/
+static bool AppReloadPipelinePassShader(int passIndex, const char *shaderCode){
+	PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+	GLenum shaderType = GraphicsGetPipelinePassShaderType(passIndex);
+	if (shaderType == 0) {
+		AppInvalidatePipelinePassShader(passShader);
+		return false;
+	}
+	if (shaderCode == NULL) {
+		AppErrorMessageBox(APP_NAME, "Failed to read %s.\n", passShader->fileName);
+		AppInvalidatePipelinePassShader(passShader);
+		return false;
+	}
+	ShaderSourceJobStart(&passShader->sourceJob, passShader->fileName, NULL);
+	return true;
+}
+
+/* 準備が完了したパスのシェーダソースのコンパイル開始 */
+static void AppUpdatePipelinePassShaderSourceJobs(){
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+		ShaderSourceJobResult result;
+		switch (ShaderSourceJobPoll(&passShader->sourceJob, &result)) {
+			case ShaderSourceJobStatusSucceeded: {
+				GLenum shaderType = GraphicsGetPipelinePassShaderType(passIndex);
+				if (shaderType == 0) {
+					AppInvalidatePipelinePassShader(passShader);
+					break;
+				}
+				AppSetShaderIncludeDependencies(
+					passShader->includeDependencies,
+					result.includedFiles,
+					passShader->fileName
+				);
+
+				/* 展開後のソースが前回と同一なら何もしない（自動リスタートも行わない）*/
+				if (result.sourceHash == passShader->sourceHash) {
+					printf("the pipeline pass shader %d source is unchanged, skip compilation.\n", passIndex);
+					passShader->restartWhenCompiled = false;
+					break;
+				}
+				passShader->sourceHash = result.sourceHash;
+				passShader->createShaderSucceeded = false;
+
+				printf("compile the pipeline pass shader %d ...\n", passIndex);
+				ShaderCompileTaskStart(&passShader->compileTask, shaderType, result.source.c_str());
+			} break;
+			case ShaderSourceJobStatusFailed: {
+				AppErrorMessageBox(APP_NAME, "%s", result.errorMessage.c_str());
+				AppInvalidatePipelinePassShader(passShader);
+			} break;
+			default: {
+			} break;
+		}
+	}
+}
+
+static void AppReloadPipelinePassShaders(){
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+		passShader->fileName[0] = '\0';
+		passShader->initialLoadPending = false;
+		AppInvalidatePipelinePassShader(passShader);
+		AppClearShaderIncludeDependencies(passShader->includeDependencies);
+	}
+	if (s_pipelineDescriptionIsValid == false) {
+		return;
+	}
+
+	for (int passIndex = 0; passIndex < s_pipelineDescriptionForProject.numPasses; passIndex++) {
+		const PipelinePass *pass = &s_pipelineDescriptionForProject.passes[passIndex];
+		PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+
+		/* シェーダ指定の無いパスは共通のシェーダを使う */
+		if (pass->shaderPath[0] == '\0') continue;
+		if (pass->type != PipelinePassTypeFragment
+		&&	pass->type != PipelinePassTypeCompute
+		) {
+			continue;
+		}
+
+		if (AppPipelineResolvePassShaderFileName(
+				pass->shaderPath,
+				passShader->fileName,
+				sizeof(passShader->fileName)
+			) == false
+		) {
+			printf("[Pipeline Warning] pass '%s': shader '%s' not found, the shared shader is used.\n", pass->name, pass->shaderPath);
+			continue;
+		}
+		/* ファイルの読み込みはファイル監視スレッドで行い、読み込み完了後にコンパイルする */
+		passShader->initialLoadPending = true;
+		FileWatcherRequestRead(passShader->fileName);
+	}
+}
+
 bool AppPipelineHasCustomDescription(){
 	return s_pipelineDescriptionIsValid;
 }
@@ -2162,39 +2496,19 @@ void AppPipelineClearDescription(){
 	PipelineDescriptionInit(&s_pipelineDescriptionForProject);
 	s_pipelineDescriptionIsValid = false;
 	AppPipelineSetLastFileNameInternal(NULL);
+	AppPipelineSetBaseDirectoryNameInternal(NULL);
 	GraphicsApplyPipelineDescription(NULL);
+	AppReloadPipelinePassShaders();
 }
 
-bool AppPipelineLoadFromFile(
+/* 読み込み済みのパイプラインファイルの内容から読み込んで適用 */
+static bool AppPipelineLoadFromText(
 	const char *fileName,
+	const char *text,
 	char *errorMessage,
 	size_t errorMessageSizeInBytes
 ){
-	if (errorMessage != NULL && errorMessageSizeInBytes > 0) {
-		errorMessage[0] = '\0';
-	}
-
-	if (fileName == NULL || fileName[0] == '\0') {
-		AppPipelineSetErrorMessage(
-			errorMessage,
-			errorMessageSizeInBytes,
-			"Invalid file name."
-		);
-		return false;
-	}
-
 	bool result = false;
-	char *text = MallocReadTextFile(fileName);
-	if (text == NULL) {
-		AppPipelineSetErrorMessage(
-			errorMessage,
-			errorMessageSizeInBytes,
-			"Failed to read %s.",
-			fileName
-		);
-		return false;
-	}
-
 	cJSON *jsonRoot = cJSON_Parse(text);
 	PipelineDescription pipeline;
 	char pipelineError[512];
@@ -2243,13 +2557,51 @@ bool AppPipelineLoadFromFile(
 	if (stat(fileName, &s_pipelineFileStat) != 0) {
 		memset(&s_pipelineFileStat, 0, sizeof(s_pipelineFileStat));
 	}
+	{
+		char pipelineBaseDirectoryName[MAX_PATH] = {0};
+		SplitDirectoryPathFromFilePath(pipelineBaseDirectoryName, sizeof(pipelineBaseDirectoryName), fileName);
+		AppPipelineSetBaseDirectoryNameInternal(pipelineBaseDirectoryName);
+	}
 	GraphicsApplyPipelineDescription(&s_pipelineDescriptionForProject);
+	AppReloadPipelinePassShaders();
 	result = true;
 
 Cleanup:
 	if (jsonRoot != NULL) {
 		cJSON_Delete(jsonRoot);
 	}
+	return result;
+}
+
+bool AppPipelineLoadFromFile(
+	const char *fileName,
+	char *errorMessage,
+	size_t errorMessageSizeInBytes
+){
+	if (errorMessage != NULL && errorMessageSizeInBytes > 0) {
+		errorMessage[0] = '\0';
+	}
+
+	if (fileName == NULL || fileName[0] == '\0') {
+		AppPipelineSetErrorMessage(
+			errorMessage,
+			errorMessageSizeInBytes,
+			"Invalid file name."
+		);
+		return false;
+	}
+
+	char *text = MallocReadTextFile(fileName);
+	if (text == NULL) {
+		AppPipelineSetErrorMessage(
+			errorMessage,
+			errorMessageSizeInBytes,
+			"Failed to read %s.",
+			fileName
+		);
+		return false;
+	}
+	bool result = AppPipelineLoadFromText(fileName, text, errorMessage, errorMessageSizeInBytes);
 	free(text);
 	return result;
 }
@@ -2413,7 +2765,7 @@ bool AppOpenGraphicsShaderFile(const char *fileName){
 	printf("open a graphics shader file %s.\n", fileName);
 	strcpy_s(s_graphicsShaderFileName, sizeof(s_graphicsShaderFileName), fileName);
 	AppUpdateWindowTitleBar();
-	s_graphicsShaderFileStat.st_mtime = 0;	/* 強制的に再読み込み */
+	FileWatcherRequestRead(s_graphicsShaderFileName);	/* 強制的に再読み込み */
 	AppClearShaderIncludeDependencies(s_graphicsShaderIncludeDependencies);
 
 	return true;
@@ -2427,7 +2779,7 @@ bool AppOpenComputeShaderFile(const char *fileName){
 	printf("open a compute shader file %s.\n", fileName);
 	strcpy_s(s_computeShaderFileName, sizeof(s_computeShaderFileName), fileName);
 	AppUpdateWindowTitleBar();
-	s_computeShaderFileStat.st_mtime = 0;	/* 強制的に再読み込み */
+	FileWatcherRequestRead(s_computeShaderFileName);	/* 強制的に再読み込み */
 	AppClearShaderIncludeDependencies(s_computeShaderIncludeDependencies);
 
 	return true;
@@ -2441,7 +2793,7 @@ bool AppOpenSoundShaderFile(const char *fileName){
 	printf("open a sound shader file %s.\n", fileName);
 	strcpy_s(s_soundShaderFileName, sizeof(s_soundShaderFileName), fileName);
 	AppUpdateWindowTitleBar();
-	s_soundShaderFileStat.st_mtime = 0;		/* 強制的に再読み込み */
+	FileWatcherRequestRead(s_soundShaderFileName);		/* 強制的に再読み込み */
 	AppClearShaderIncludeDependencies(s_soundShaderIncludeDependencies);
 
 	return true;
@@ -2582,7 +2934,228 @@ void AppFastBackward(){
 }
 
 
+/* プロファイラの計測結果を ImGui で表示 */
+static void AppImGuiDrawProfiler(){
+	static const char *s_domainNames[] = {"CPU", "GPU"};
+	static const float s_columnWidths[] = {160.0f, 48.0f, 56.0f, 56.0f, 56.0f, 56.0f};
+
+	ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoSavedSettings;
+	ImGui::SetNextWindowPos(ImVec2(0, 240), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowSize(ImVec2(720, 360), ImGuiCond_FirstUseEver);
+	if (ImGui::Begin("Profiler", &s_imGuiStatus.displayProfiler, window_flags)) {
+		/* 計測区間ごとの内訳（単位はミリ秒、子区間の時間を含まない）*/
+		for (int domain = ProfilerDomainCpu; domain <= ProfilerDomainGpu; ++domain) {
+			ImGui::Columns(7, s_domainNames[domain]);
+			for (int columnIndex = 0; columnIndex < (int)SIZE_OF_ARRAY(s_columnWidths); ++columnIndex) {
+				ImGui::SetColumnWidth(columnIndex, s_columnWidths[columnIndex]);
+			}
+			ImGui::Separator();
+			ImGui::Text("%s", s_domainNames[domain]);	ImGui::NextColumn();
+			ImGui::Text("calls");						ImGui::NextColumn();
+			ImGui::Text("last");						ImGui::NextColumn();
+			ImGui::Text("min");							ImGui::NextColumn();
+			ImGui::Text("avg");							ImGui::NextColumn();
+			ImGui::Text("p99");							ImGui::NextColumn();
+			ImGui::Text("history");						ImGui::NextColumn();
+			ImGui::Separator();
+
+			for (int sectionIndex = 0; sectionIndex < ProfilerGetNumSections(); ++sectionIndex) {
+				ProfilerSectionStatistics statistics;
+				if (ProfilerGetSectionStatistics(sectionIndex, &statistics) == false) continue;
+				if (statistics.domain != domain) continue;
+
+				ImGui::Text("%s", statistics.name);						ImGui::NextColumn();
+				ImGui::Text("%d", statistics.numCalls);					ImGui::NextColumn();
+				ImGui::Text("%.3f", statistics.lastInMilliseconds);	ImGui::NextColumn();
+				ImGui::Text("%.3f", statistics.minInMilliseconds);		ImGui::NextColumn();
+				ImGui::Text("%.3f", statistics.avgInMilliseconds);		ImGui::NextColumn();
+				ImGui::Text("%.3f", statistics.p99InMilliseconds);		ImGui::NextColumn();
+				ImGui::PushID(sectionIndex);
+				ImGui::PlotLines(
+					"##history",
+					statistics.history,
+					statistics.numHistorySamples,
+					statistics.historyOffset,
+					NULL,
+					0.0f,
+					FLT_MAX,
+					ImVec2(ImGui::GetColumnWidth() - ImGui::GetStyle().ItemSpacing.x * 2, ImGui::GetTextLineHeight())
+				);
+				ImGui::PopID();
+				ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+		}
+		ImGui::Separator();
+	}
+	ImGui::End();
+}
+
+/*=============================================================================
+▼	ファイル監視
+-----------------------------------------------------------------------------*/
+static bool AppIsSameFileName(const std::string &normalizedFileName, const char *fileName){
+	if (fileName == NULL || fileName[0] == '\0') return false;
+	return normalizedFileName == AppNormalizePath(fileName);
+}
+
+/* 監視対象ファイルの一覧をファイル監視スレッドに渡す（変化が無ければ何もしない）*/
+static void AppUpdateWatchedFiles(){
+	static std::vector<std::string> s_fileNames;
+	s_fileNames.clear();
+	if (s_projectFileName[0] != '\0') s_fileNames.push_back(s_projectFileName);
+	const char *pipelineFileName = AppPipelineGetLastFileName();
+	if (pipelineFileName != NULL && pipelineFileName[0] != '\0') s_fileNames.push_back(pipelineFileName);
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		const PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+		if (passShader->fileName[0] == '\0') continue;
+		s_fileNames.push_back(passShader->fileName);
+		for (const ShaderIncludeDependency &dependency : passShader->includeDependencies) {
+			s_fileNames.push_back(dependency.fileName);
+		}
+	}
+	const struct {
+		const char *fileName;
+		const std::vector<ShaderIncludeDependency> *includeDependencies;
+	} shaders[] = {
+		{s_soundShaderFileName,		&s_soundShaderIncludeDependencies},
+		{s_computeShaderFileName,	&s_computeShaderIncludeDependencies},
+		{s_graphicsShaderFileName,	&s_graphicsShaderIncludeDependencies},
+	};
+	for (int shaderIndex = 0; shaderIndex < SIZE_OF_ARRAY(shaders); shaderIndex++) {
+		if (shaders[shaderIndex].fileName[0] == '\0') continue;
+		s_fileNames.push_back(shaders[shaderIndex].fileName);
+		for (const ShaderIncludeDependency &dependency : *shaders[shaderIndex].includeDependencies) {
+			s_fileNames.push_back(dependency.fileName);
+		}
+	}
+	FileWatcherSetWatchedFiles(s_fileNames);
+}
+
+/* 変更されたファイルの反映 */
+static void AppProcessFileWatcherEvent(const FileWatcherEvent *event){
+	const std::string &fileName = event->fileName;
+
+	/*
+		シェーダの #include 展開用キャッシュに読み込み済みの内容を反映し、
+		このファイルを（間接的にでも）#include しているファイルを求める。
+	*/
+	std::unordered_set<std::string> dependents;
+	if (AppIsSameFileName(fileName, s_projectFileName) == false
+	&&	AppIsSameFileName(fileName, AppPipelineGetLastFileName()) == false
+	) {
+		ShaderIncludeCacheUpdateFile(fileName.c_str(), event->content);
+		ShaderIncludeCacheCollectDependents(fileName.c_str(), dependents);
+	}
+
+	/*
+		プロジェクトファイルの更新（自身の書き出しによる変更は無視する）
+		内容はファイル監視スレッドで読み込み済みなので、ここでは読み直さない。
+	*/
+	if (AppIsSameFileName(fileName, s_projectFileName)) {
+		if (IsFileUpdated(s_projectFileName, &s_projectFileStat)) {
+			printf("update the project file.\n");
+			if (event->content == NULL) {
+				AppErrorMessageBox(APP_NAME, "Failed to read %s.\n", s_projectFileName);
+			} else {
+				ProfilerCpuBegin("shader reload");
+				AppProjectImportFromText(s_projectFileName, event->content);
+				ProfilerCpuEnd();
+			}
+		}
+	}
+
+	/* パイプラインファイルの更新 */
+	const char *pipelineFileName = AppPipelineGetLastFileName();
+	if (AppIsSameFileName(fileName, pipelineFileName)) {
+		if (IsFileUpdated(pipelineFileName, &s_pipelineFileStat)) {
+			printf("update the pipeline file.\n");
+			char errorMessage[512] = {0};
+			bool loaded = false;
+			if (event->content == NULL) {
+				snprintf(errorMessage, sizeof(errorMessage), "Failed to read %s.", pipelineFileName);
+			} else {
+				ProfilerCpuBegin("shader reload");
+				loaded = AppPipelineLoadFromText(pipelineFileName, event->content, errorMessage, sizeof(errorMessage));
+				ProfilerCpuEnd();
+			}
+			if (loaded == false) {
+				if (errorMessage[0] != '\0') {
+					AppErrorMessageBox(APP_NAME, "%s", errorMessage);
+				} else {
+					AppErrorMessageBox(APP_NAME, "Failed to reload pipeline %s.", pipelineFileName);
+				}
+			}
+		}
+	}
+
+	/* パイプラインパスのシェーダの更新 */
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+		if (passShader->fileName[0] == '\0') continue;
+		if (AppIsSameFileName(fileName, passShader->fileName)) {
+			bool restart = (passShader->initialLoadPending == false);
+			passShader->initialLoadPending = false;
+			printf("update the pipeline pass shader %d.\n", passIndex);
+			ProfilerCpuBegin("shader reload");
+			if (AppReloadPipelinePassShader(passIndex, event->content)) {
+				passShader->restartWhenCompiled = restart;
+			}
+			ProfilerCpuEnd();
+		} else
+		if (dependents.find(AppNormalizePath(passShader->fileName)) != dependents.end()) {
+			/* パスのシェーダファイルもファイル監視スレッドで読み直す */
+			printf("update the pipeline pass shader %d (include).\n", passIndex);
+			FileWatcherRequestRead(passShader->fileName);
+		}
+	}
+
+	/* サウンド、コンピュート、グラフィクスシェーダの更新 */
+	const struct {
+		const char *name;
+		const char *fileName;
+		char **shaderCode;
+		bool (*reload)();
+	} shaders[] = {
+		{"sound",		s_soundShaderFileName,		&s_soundShaderCode,		AppReloadSoundShader},
+		{"compute",		s_computeShaderFileName,	&s_computeShaderCode,	AppReloadComputeShader},
+		{"graphics",	s_graphicsShaderFileName,	&s_graphicsShaderCode,	AppReloadGraphicsShader},
+	};
+	for (int shaderIndex = 0; shaderIndex < SIZE_OF_ARRAY(shaders); shaderIndex++) {
+		if (AppIsSameFileName(fileName, shaders[shaderIndex].fileName)) {
+			printf("update the %s shader.\n", shaders[shaderIndex].name);
+			if (event->content == NULL) {
+				AppErrorMessageBox(APP_NAME, "Failed to read %s.\n", shaders[shaderIndex].fileName);
+				continue;
+			}
+			if (*shaders[shaderIndex].shaderCode != NULL) free(*shaders[shaderIndex].shaderCode);
+			*shaders[shaderIndex].shaderCode = MallocCopyString(event->content);
+		} else
+		if (shaders[shaderIndex].fileName[0] != '\0'
+		&&	dependents.find(AppNormalizePath(shaders[shaderIndex].fileName)) != dependents.end()
+		) {
+			printf("update the %s shader (include).\n", shaders[shaderIndex].name);
+		} else {
+			continue;
+		}
+		ProfilerCpuBegin("shader reload");
+		shaders[shaderIndex].reload();
+		ProfilerCpuEnd();
+	}
+}
+
 bool AppUpdate(){
+	PROFILER_CPU_SCOPE("AppUpdate");
+
+	/* 記録が完了したトレースの書き出し */
+	if (ProfilerIsTraceFinished()) {
+		if (ProfilerWriteTrace()) {
+			printf("write the trace to %s.\n", s_traceFileName);
+		} else {
+			AppErrorMessageBox(APP_NAME, "Failed to write trace %s.", s_traceFileName);
+		}
+	}
+
 	/* 経過時間を取得 */
 	double fp64CurrentTime;
 	if (s_paused) {
@@ -2592,23 +3165,28 @@ bool AppUpdate(){
 	}
 
 	/* FPS 算出 */
-	if (s_graphicsCreateShaderSucceeded
-	&&	s_soundCreateShaderSucceeded
-	&&	s_computeCreateShaderSucceeded
+	if (s_graphicsShaderInstalled
+	&&	s_soundShaderInstalled
+	&&	s_computeShaderInstalled
 	) {
 		static int s_frameSkip = 0;
 		static double s_fp64PrevTime = 0.0;
 		static double s_fp64Fps = 60.0;
+		static GlStateCacheStatistics s_glStateCacheStatistics = {0};
 		++s_frameSkip;
 
 		/* pause 中でなければ 1 秒ごとに FPS を求める */
 		if (s_paused == false) {
 			if (floor(fp64CurrentTime) > floor(s_fp64PrevTime)) {
-				if (s_graphicsCreateShaderSucceeded) {
+				if (s_graphicsShaderInstalled) {
 					s_fp64Fps = (double)s_frameSkip / (fp64CurrentTime - s_fp64PrevTime);
 				}
 				s_fp64PrevTime = fp64CurrentTime;
 				s_frameSkip = 0;
+
+				/* GL ステートキャッシュの統計も 1 秒単位で集計 */
+				GlStateCacheGetStatistics(&s_glStateCacheStatistics);
+				GlStateCacheResetStatistics();
 			}
 		}
 
@@ -2619,6 +3197,7 @@ bool AppUpdate(){
 
 		/* ステートを ImGui で表示 */
 		if (s_imGuiStatus.displayCurrentStatus) {
+			ProfilerCpuBegin("imgui");
 			ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoSavedSettings;
 			ImGui::SetNextWindowPos(ImVec2(0, 0), ImGuiCond_FirstUseEver);
 			if (ImGui::Begin("Current Status", NULL, window_flags)) {
@@ -2627,20 +3206,60 @@ bool AppUpdate(){
 					"FPS        %.2f\n"
 					"frameCount %d\n"
 					"waveOutPos 0x%08x\n"
+					"GL binds   %d/%d skipped (%.1f%%)\n"
+					"%s"
 					,
 					fp64CurrentTime,
 					s_fp64Fps,
 					s_frameCount,
-					SoundGetWaveOutPos()
+					SoundGetWaveOutPos(),
+					s_glStateCacheStatistics.numSkippedCalls,
+					s_glStateCacheStatistics.numCalls,
+					(s_glStateCacheStatistics.numCalls > 0)?
+						100.0 * s_glStateCacheStatistics.numSkippedCalls / s_glStateCacheStatistics.numCalls
+					:	0.0,
+					ProfilerIsTraceRecording()? "recording trace ...\n": ""
 				);
+
+				/* シェーダのコンパイル状態 */
+				AppImGuiShowShaderCompileStatus("graphics shader", &s_graphicsShaderSourceJob, &s_graphicsShaderCompileTask, s_graphicsCreateShaderSucceeded, s_graphicsShaderInstalled);
+				AppImGuiShowShaderCompileStatus("compute shader", &s_computeShaderSourceJob, &s_computeShaderCompileTask, s_computeCreateShaderSucceeded, s_computeShaderInstalled);
+				AppImGuiShowShaderCompileStatus("sound shader", &s_soundShaderSourceJob, &s_soundShaderCompileTask, s_soundCreateShaderSucceeded, s_soundShaderInstalled);
+				for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+					const PipelinePassShader *passShader = &s_pipelinePassShaders[passIndex];
+					if (passShader->fileName[0] == '\0') continue;
+					char name[64];
+					snprintf(name, sizeof(name), "pass %d shader", passIndex);
+					AppImGuiShowShaderCompileStatus(name, &passShader->sourceJob, &passShader->compileTask, passShader->createShaderSucceeded, true);
+				}
+
+				/* 動的解像度（キャプチャ時は常に等倍）*/
+				ImGui::Checkbox("dynamic resolution", &s_dynamicResolutionSettings.enable);
+				if (s_dynamicResolutionSettings.enable) {
+					DynamicResolutionStatus dynamicResolutionStatus;
+					GraphicsGetDynamicResolutionStatus(&dynamicResolutionStatus);
+					ImGui::SliderFloat("target GPU ms", &s_dynamicResolutionSettings.targetFrameTimeInMilliseconds, 4.0f, 100.0f, "%.1f");
+					ImGui::SliderFloat("min scale", &s_dynamicResolutionSettings.minScale, 0.25f, 1.0f, "%.2f");
+					ImGui::Text(
+						"render scale %.2f (%dx%d)\n"
+						"GPU time   %.2f ms\n"
+						,
+						dynamicResolutionStatus.scale,
+						(int)(s_xReso * dynamicResolutionStatus.scale + 0.5f),
+						(int)(s_yReso * dynamicResolutionStatus.scale + 0.5f),
+						dynamicResolutionStatus.gpuFrameTimeInMilliseconds
+					);
+				}
 			}
 			ImGui::End();
+			ProfilerCpuEnd();
 		}
 	}
 
 	/* カメラコントロールを要求するシェーダでは、カメラの設定を ImGui で表示 */
 	if (GraphicsShaderRequiresCameraControlUniforms()) {
 		if (s_imGuiStatus.displayCameraSettings) {
+			ProfilerCpuBegin("imgui");
 			ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoSavedSettings;
 			ImGui::SetNextWindowPos(ImVec2(200, 0), ImGuiCond_FirstUseEver);
 			if (ImGui::Begin("Camera Settings", NULL, window_flags)) {
@@ -2657,100 +3276,39 @@ bool AppUpdate(){
 				ImGui::PopItemWidth();
 			}
 			ImGui::End();
+			ProfilerCpuEnd();
 		}
 	}
 
-/* プロジェクトファイルの更新 */
-if (IsValidFileName(s_projectFileName)) {
-	if (IsFileUpdated(s_projectFileName, &s_projectFileStat)) {
-		printf("update the project file.\n");
-		AppProjectImport(s_projectFileName);
+	/* プロファイラの表示 */
+	ProfilerSetEnable(s_imGuiStatus.displayProfiler);
+	if (s_imGuiStatus.displayProfiler) {
+		ProfilerCpuBegin("imgui");
+		AppImGuiDrawProfiler();
+		ProfilerCpuEnd();
 	}
-}
 
-/* パイプラインファイルの更新 */
-const char *pipelineFileName = AppPipelineGetLastFileName();
-if (pipelineFileName != NULL
-&&	pipelineFileName[0] != '\0'
-&&	IsValidFileName(pipelineFileName)
-) {
-	if (IsFileUpdated(pipelineFileName, &s_pipelineFileStat)) {
-		printf("update the pipeline file.\n");
-		char errorMessage[512] = {0};
-		if (AppPipelineLoadFromFile(pipelineFileName, errorMessage, sizeof(errorMessage)) == false) {
-			if (errorMessage[0] != '\0') {
-				AppErrorMessageBox(APP_NAME, "%s", errorMessage);
-			} else {
-				AppErrorMessageBox(APP_NAME, "Failed to reload pipeline %s.", pipelineFileName);
-			}
-		}
-	}
-}
+	/* ファイル更新の監視（シェーダの再読み込みを除く）*/
+	ProfilerCpuBegin("file watcher");
 
-/* サウンドシェーダの更新 */
-if (IsValidFileName(s_soundShaderFileName)) {
-	bool includeUpdated = AppHaveShaderIncludeDependenciesUpdated(s_soundShaderIncludeDependencies);
-	bool fileUpdated = IsFileUpdated(s_soundShaderFileName, &s_soundShaderFileStat);
-	if (includeUpdated || fileUpdated) {
-		printf(includeUpdated && !fileUpdated ? "update the sound shader (include).\n" : "update the sound shader.\n");
-		if (s_soundShaderCode != NULL) free(s_soundShaderCode);
-		/* ファイルのロック状態が継続していることがあるため、リトライしながら読む */
-		for (int retryCount = 0; retryCount < 10; retryCount++) {
-			s_soundShaderCode = MallocReadTextFile(s_soundShaderFileName);
-			if (s_soundShaderCode != NULL) break;
-			printf("retry %d ... \n", retryCount);
-			Sleep(100);
-		}
-		if (s_soundShaderCode == NULL) {
-			AppErrorMessageBox(APP_NAME, "Failed to read %s.\n", s_soundShaderFileName);
-		} else {
-			AppReloadSoundShader();
+	/* 監視対象の更新と、変更されたファイルの反映 */
+	AppUpdateWatchedFiles();
+	{
+		FileWatcherEvent event;
+		while (FileWatcherPopEvent(&event)) {
+			AppProcessFileWatcherEvent(&event);
+			if (event.content != NULL) free(event.content);
 		}
 	}
-}
 
-/* コンピュートシェーダの更新 */
-if (IsValidFileName(s_computeShaderFileName)) {
-	bool includeUpdated = AppHaveShaderIncludeDependenciesUpdated(s_computeShaderIncludeDependencies);
-	bool fileUpdated = IsFileUpdated(s_computeShaderFileName, &s_computeShaderFileStat);
-	if (includeUpdated || fileUpdated) {
-		printf(includeUpdated && !fileUpdated ? "update the compute shader (include).\n" : "update the compute shader.\n");
-		if (s_computeShaderCode != NULL) free(s_computeShaderCode);
-		for (int retryCount = 0; retryCount < 10; retryCount++) {
-			s_computeShaderCode = MallocReadTextFile(s_computeShaderFileName);
-			if (s_computeShaderCode != NULL) break;
-			printf("retry %d ... \n", retryCount);
-			Sleep(100);
-		}
-		if (s_computeShaderCode == NULL) {
-			AppErrorMessageBox(APP_NAME, "Failed to read %s.\n", s_computeShaderFileName);
-		} else {
-			AppReloadComputeShader();
-		}
-	}
-}
+	ProfilerCpuEnd();
 
-/* グラフィクスシェーダの更新 */
-if (IsValidFileName(s_graphicsShaderFileName)) {
-	bool includeUpdated = AppHaveShaderIncludeDependenciesUpdated(s_graphicsShaderIncludeDependencies);
-	bool fileUpdated = IsFileUpdated(s_graphicsShaderFileName, &s_graphicsShaderFileStat);
-	if (includeUpdated || fileUpdated) {
-		printf(includeUpdated && !fileUpdated ? "update the graphics shader (include).\n" : "update the graphics shader.\n");
-		if (s_graphicsShaderCode != NULL) free(s_graphicsShaderCode);
-		/* ファイルのロック状態が継続していることがあるため、リトライしながら読む */
-		for (int retryCount = 0; retryCount < 10; retryCount++) {
-			s_graphicsShaderCode = MallocReadTextFile(s_graphicsShaderFileName);
-			if (s_graphicsShaderCode != NULL) break;
-			printf("retry %d ... \n", retryCount);
-			Sleep(100);
-		}
-		if (s_graphicsShaderCode == NULL) {
-			AppErrorMessageBox(APP_NAME, "Failed to read %s.\n", s_graphicsShaderFileName);
-		} else {
-			AppReloadGraphicsShader();
-		}
-	}
-}
+	/* 準備が完了したシェーダソースのコンパイルを開始 */
+	AppUpdateShaderSourceJobs();
+	AppUpdatePipelinePassShaderSourceJobs();
+
+	/* コンパイルが完了したシェーダをフレームの境界で差し替える */
+	AppUpdateShaderCompileTasks();
 
 	/* カメラコントロールが必要ならカメラ更新 */
 	if (GraphicsShaderRequiresCameraControlUniforms()) {
@@ -2759,14 +3317,14 @@ if (IsValidFileName(s_graphicsShaderFileName)) {
 
 	/* サウンドの更新 */
 	CheckGlError("pre SoundUpdate");
-	if (s_soundCreateShaderSucceeded) {
+	if (s_soundShaderInstalled) {
 		SoundUpdate(s_frameCount);
 	}
 	CheckGlError("post SoundUpdate");
 
 	/* グラフィクスの更新 */
 	CheckGlError("pre GraphicsUpdate");
-	if (s_graphicsCreateShaderSucceeded) {
+	if (s_graphicsShaderInstalled) {
 		CurrentFrameParams params = {0};
 		params.waveOutPos				= SoundGetWaveOutPos();
 		params.frameCount				= s_frameCount;
@@ -2781,6 +3339,7 @@ if (IsValidFileName(s_graphicsShaderFileName)) {
 		params.fovYInRadians			= s_camera.fovYInRadians;
 		Mat4x4Copy(params.mat4x4CameraInWorld,		s_camera.mat4x4CameraInWorld);
 		Mat4x4Copy(params.mat4x4PrevCameraInWorld,	s_camera.mat4x4PrevCameraInWorld);
+		GraphicsSetDynamicResolutionSettings(&s_dynamicResolutionSettings);
 		GraphicsUpdate(&params, &s_renderSettings);
 	}
 	CheckGlError("post GraphicsUpdate");
@@ -2817,18 +3376,31 @@ bool AppHelpAbout(
 bool AppInitialize(int argc, char **argv){
 	memset(&s_projectFileStat, 0, sizeof(s_projectFileStat));
 	memset(&s_pipelineFileStat, 0, sizeof(s_pipelineFileStat));
-	memset(&s_graphicsShaderFileStat, 0, sizeof(s_graphicsShaderFileStat));
-	memset(&s_computeShaderFileStat, 0, sizeof(s_computeShaderFileStat));
-	memset(&s_soundShaderFileStat, 0, sizeof(s_soundShaderFileStat));
 
 	if (HighPrecisionTimerInitialize() == false) {
 		AppErrorMessageBox(APP_NAME, "HighPrecisionTimerInitialize() failed.");
 		return false;
 	}
+	if (FileWatcherInitialize() == false) {
+		AppErrorMessageBox(APP_NAME, "FileWatcherInitialize() failed.");
+		return false;
+	}
+	if (ShaderIncludeCacheInitialize() == false) {
+		AppErrorMessageBox(APP_NAME, "ShaderIncludeCacheInitialize() failed.");
+		return false;
+	}
+	if (ShaderSourceJobInitialize() == false) {
+		AppErrorMessageBox(APP_NAME, "ShaderSourceJobInitialize() failed.");
+		return false;
+	}
 	if (CameraInitialize() == false) {
 		AppErrorMessageBox(APP_NAME, "CameraInitialize() failed.");
 		return false;
 	}
+	if (ShaderCacheInitialize() == false) {
+		AppErrorMessageBox(APP_NAME, "ShaderCacheInitialize() failed.");
+		return false;
+	}
 	if (SoundInitialize() == false) {
 		AppErrorMessageBox(APP_NAME, "SoundInitialize() failed.");
 		return false;
@@ -2838,6 +3410,10 @@ bool AppInitialize(int argc, char **argv){
 		AppErrorMessageBox(APP_NAME, "GraphicsInitialize() failed.");
 		return false;
 	}
+	if (ProfilerInitialize() == false) {
+		AppErrorMessageBox(APP_NAME, "ProfilerInitialize() failed.");
+		return false;
+	}
 	PipelineDescriptionInit(&s_pipelineDescriptionForProject);
 	s_pipelineDescriptionIsValid = false;
 	GraphicsApplyPipelineDescription(NULL);
@@ -2861,6 +3437,7 @@ bool AppInitialize(int argc, char **argv){
 }
 
 bool AppTerminate(){
+	AppCancelShaderCompileTasks();
 	if (s_soundShaderCode != NULL) {
 		free(s_soundShaderCode);
 		s_soundShaderCode = NULL;
@@ -2874,6 +3451,22 @@ bool AppTerminate(){
 		s_graphicsShaderCode = NULL;
 	}
 
+	if (FileWatcherTerminate() == false) {
+		AppErrorMessageBox(APP_NAME, "FileWatcherTerminate() failed.");
+		return false;
+	}
+	if (ShaderSourceJobTerminate() == false) {
+		AppErrorMessageBox(APP_NAME, "ShaderSourceJobTerminate() failed.");
+		return false;
+	}
+	if (ShaderIncludeCacheTerminate() == false) {
+		AppErrorMessageBox(APP_NAME, "ShaderIncludeCacheTerminate() failed.");
+		return false;
+	}
+	if (ProfilerTerminate() == false) {
+		AppErrorMessageBox(APP_NAME, "ProfilerTerminate() failed.");
+		return false;
+	}
 	if (GraphicsTerminate() == false) {
 		AppErrorMessageBox(APP_NAME, "GraphicsTerminate() failed.");
 		return false;
@@ -2886,6 +3479,10 @@ bool AppTerminate(){
 		AppErrorMessageBox(APP_NAME, "CameraTerminate() failed.");
 		return false;
 	}
+	if (ShaderCacheTerminate() == false) {
+		AppErrorMessageBox(APP_NAME, "ShaderCacheTerminate() failed.");
+		return false;
+	}
 	if (HighPrecisionTimerTerminate() == false) {
 		AppErrorMessageBox(APP_NAME, "HighPrecisionTimerTerminate() failed.");
 		return false;
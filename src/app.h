@@ -93,6 +93,12 @@ void AppImGuiSetDisplayCameraSettingsFlag(bool flag);
 /* ImGui 設定 : Camera Settings 表示フラグの取得 */
 bool AppImGuiGetDisplayCameraSettingsFlag();
 
+/* ImGui 設定 : Profiler 表示フラグの設定 */
+void AppImGuiSetDisplayProfilerFlag(bool flag);
+
+/* ImGui 設定 : Profiler 表示フラグの取得 */
+bool AppImGuiGetDisplayProfilerFlag();
+
 
 /* プリファレンス設定 : グラフィクスシェーダ更新によるリスタート有効化フラグの設定 */
 void AppPreferenceSettingsSetEnableAutoRestartByGraphicsShader(bool flag);
@@ -417,6 +423,10 @@ bool AppRecordImageSequenceGetForceReplaceAlphaByOneFlag();
 void AppRecordImageSequence();
 
 
+/* トレース記録の開始（記録完了後に指定ファイルへ書き出す）*/
+bool AppRecordTrace(const char *fileName);
+
+
 /* プロジェクト管理 : 現在のプロジェクトファイル名の取得 */
 const char *AppProjectGetCurrentFileName();
 
@@ -8,11 +8,15 @@
 #include <cctype>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 #include <string.h>
 #include "common.h"
+#include "profiler.h"
+#include "shader_cache.h"
+#include "shader_include_cache.h"
 
-static std::string NormalizePath(const std::string &path){
+std::string NormalizeFilePath(const std::string &path){
 	char buffer[MAX_PATH] = {0};
 	if (_fullpath(buffer, path.c_str(), MAX_PATH) != NULL) {
 		std::string normalized(buffer);
@@ -34,150 +38,6 @@ static std::string NormalizePath(const std::string &path){
 	return normalized;
 }
 
-static std::string ExtractDirectory(const std::string &path){
-	char directoryPath[MAX_PATH] = {0};
-	SplitDirectoryPathFromFilePath(directoryPath, sizeof(directoryPath), path.c_str());
-	return std::string(directoryPath);
-}
-
-static std::string TrimLeftCopy(const std::string &text){
-	size_t index = 0;
-	while (index < text.size() && std::isspace(static_cast<unsigned char>(text[index]))) {
-		++index;
-	}
-	return text.substr(index);
-}
-
-static bool ExpandShaderIncludesInternal(
-	const std::string &filePath,
-	std::unordered_set<std::string> &stack,
-	std::unordered_set<std::string> &included,
-	std::string &output,
-	std::string *errorMessage
-){
-	output.clear();
-
-	std::string normalizedPath = NormalizePath(filePath);
-	if (included.find(normalizedPath) != included.end()) {
-		return true;
-	}
-	if (stack.find(normalizedPath) != stack.end()) {
-		if (errorMessage != NULL) {
-			*errorMessage = normalizedPath + ": error: detected circular #include directives.";
-		}
-		return false;
-	}
-
-	char *rawContent = MallocReadTextFile(normalizedPath.c_str());
-	if (rawContent == NULL) {
-		if (errorMessage != NULL) {
-			*errorMessage = normalizedPath + ": error: failed to read source file.";
-		}
-		return false;
-	}
-	std::string fileContent(rawContent);
-	free(rawContent);
-
-	stack.insert(normalizedPath);
-	const std::string baseDirectory = ExtractDirectory(normalizedPath);
-
-	size_t position = 0;
-	while (position < fileContent.size()) {
-		size_t lineEnd = fileContent.find('\n', position);
-		size_t segmentLength = (lineEnd == std::string::npos)
-			? (fileContent.size() - position)
-			: (lineEnd - position + 1);
-
-		std::string rawLine = fileContent.substr(position, segmentLength);
-		position += segmentLength;
-
-		std::string lineWithoutNewline = rawLine;
-		while (!lineWithoutNewline.empty() && (lineWithoutNewline.back() == '\n' || lineWithoutNewline.back() == '\r')) {
-			lineWithoutNewline.pop_back();
-		}
-		const bool lineHadTrailingNewline = (!rawLine.empty() && rawLine.back() == '\n');
-
-		std::string trimmed = TrimLeftCopy(lineWithoutNewline);
-		bool handled = false;
-		if (!trimmed.empty() && trimmed[0] == '#') {
-			size_t idx = 1;
-			while (idx < trimmed.size() && std::isspace(static_cast<unsigned char>(trimmed[idx]))) {
-				++idx;
-			}
-			const std::string includeToken = "include";
-			if (trimmed.compare(idx, includeToken.size(), includeToken) == 0) {
-				idx += includeToken.size();
-				while (idx < trimmed.size() && std::isspace(static_cast<unsigned char>(trimmed[idx]))) {
-					++idx;
-				}
-				if (idx < trimmed.size() && trimmed[idx] == '"') {
-					++idx;
-					size_t closing = trimmed.find('"', idx);
-					if (closing != std::string::npos) {
-						std::string includeRelativePath = trimmed.substr(idx, closing - idx);
-						char combinedPath[MAX_PATH] = {0};
-						GenerateCombinedPath(
-							combinedPath,
-							sizeof(combinedPath),
-							baseDirectory.c_str(),
-							includeRelativePath.c_str()
-						);
-
-						if (IsValidFileName(combinedPath) == false) {
-							if (errorMessage != NULL) {
-								*errorMessage =
-									normalizedPath
-									+ ": error: cannot open include file \""
-									+ includeRelativePath
-									+ "\" (resolved path: "
-									+ combinedPath
-									+ ").";
-							}
-							stack.erase(normalizedPath);
-							return false;
-						}
-
-						std::string includeFullPath = NormalizePath(combinedPath);
-
-						if (stack.find(includeFullPath) != stack.end()) {
-							if (errorMessage != NULL) {
-								*errorMessage =
-									normalizedPath
-									+ ": error: detected circular #include involving \""
-									+ includeRelativePath
-									+ "\".";
-							}
-							stack.erase(normalizedPath);
-							return false;
-						}
-
-						std::string includedSource;
-						if (ExpandShaderIncludesInternal(includeFullPath, stack, included, includedSource, errorMessage) == false) {
-							stack.erase(normalizedPath);
-							return false;
-						}
-						if (!includedSource.empty()) {
-							output.append(includedSource);
-						}
-						if (lineHadTrailingNewline && (output.empty() || output.back() != '\n')) {
-							output.push_back('\n');
-						}
-						handled = true;
-					}
-				}
-			}
-		}
-
-		if (handled == false) {
-			output.append(rawLine);
-		}
-	}
-
-	stack.erase(normalizedPath);
-	included.insert(normalizedPath);
-	return true;
-}
-
 bool ExpandShaderIncludes(
 	const std::string &filePath,
 	std::unordered_set<std::string> &stack,
@@ -185,7 +45,7 @@ bool ExpandShaderIncludes(
 	std::string &output,
 	std::string *errorMessage
 ){
-	return ExpandShaderIncludesInternal(filePath, stack, included, output, errorMessage);
+	return ShaderIncludeCacheExpand(filePath, stack, included, output, errorMessage);
 }
 
 bool ExpandShaderIncludes(
@@ -195,7 +55,7 @@ bool ExpandShaderIncludes(
 	std::string *errorMessage
 ){
 	std::unordered_set<std::string> included;
-	return ExpandShaderIncludesInternal(filePath, stack, included, output, errorMessage);
+	return ShaderIncludeCacheExpand(filePath, stack, included, output, errorMessage);
 }
 
 bool ExpandShaderIncludes(
@@ -205,7 +65,7 @@ bool ExpandShaderIncludes(
 ){
 	std::unordered_set<std::string> stack;
 	std::unordered_set<std::string> included;
-	return ExpandShaderIncludesInternal(filePath, stack, included, output, errorMessage);
+	return ShaderIncludeCacheExpand(filePath, stack, included, output, errorMessage);
 }
 
 bool ExpandShaderIncludes(
@@ -216,7 +76,7 @@ bool ExpandShaderIncludes(
 ){
 	std::unordered_set<std::string> stack;
 	std::unordered_set<std::string> included;
-	bool result = ExpandShaderIncludesInternal(filePath, stack, included, output, errorMessage);
+	bool result = ShaderIncludeCacheExpand(filePath, stack, included, output, errorMessage);
 	if (result) {
 		includedFiles.assign(included.begin(), included.end());
 	} else {
@@ -465,34 +325,439 @@ bool IsSuffix(
 }
 
 
-GLuint CreateShader(
+/* プログラム毎のリフレクション情報 */
+static std::unordered_map<GLuint, ShaderReflection> s_shaderReflections;
+
+static bool IsSamplerUniformType(GLenum type){
+	switch (type) {
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+		case GL_SAMPLER_BUFFER: {
+			return true;
+		} break;
+	}
+	return false;
+}
+
+static bool IsImageUniformType(GLenum type){
+	switch (type) {
+		case GL_IMAGE_1D:
+		case GL_IMAGE_2D:
+		case GL_IMAGE_3D:
+		case GL_IMAGE_CUBE:
+		case GL_IMAGE_2D_ARRAY:
+		case GL_IMAGE_BUFFER:
+		case GL_INT_IMAGE_2D:
+		case GL_UNSIGNED_INT_IMAGE_2D: {
+			return true;
+		} break;
+	}
+	return false;
+}
+
+/* リンク済みプログラムのリフレクション情報を構築 */
+static void BuildShaderReflection(
+	GLuint programId,
+	ShaderReflection *reflection
+){
+	memset(reflection, 0, sizeof(ShaderReflection));
+
+	GLint numActiveUniforms = 0;
+	glGetProgramInterfaceiv(programId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numActiveUniforms);
+	for (int interfaceIndex = 0; interfaceIndex < numActiveUniforms; ++interfaceIndex) {
+		GLenum properties[2] = {GL_TYPE, GL_LOCATION};
+		GLint values[2] = {0, -1};
+		glGetProgramResourceiv(
+			/* GLuint program */			programId,
+			/* GLenum programInterface */	GL_UNIFORM,
+			/* GLuint index */				interfaceIndex,
+			/* GLsizei propCount */			SIZE_OF_ARRAY(properties),
+			/* const GLenum * props */		&properties[0],
+			/* GLsizei bufSize */			SIZE_OF_ARRAY(values),
+			/* GLsizei * length */			NULL,
+			/* GLint * params */			&values[0]
+		);
+		GLenum type = (GLenum)values[0];
+		GLint location = values[1];
+		if (location < 0) continue;		/* uniform block のメンバ等 */
+		if (location < SHADER_REFLECTION_MAX_LOCATIONS) {
+			reflection->uniformLocationMask |= 1u << location;
+			reflection->uniformTypes[location] = type;
+		}
+
+		/* sampler/image はバインドされているユニット番号を記録 */
+		if (IsSamplerUniformType(type) || IsImageUniformType(type)) {
+			GLint unit = -1;
+			glGetUniformiv(programId, location, &unit);
+			if (unit >= 0 && unit < 32) {
+				if (IsSamplerUniformType(type)) {
+					reflection->samplerBindingMask |= 1u << unit;
+				} else {
+					reflection->imageBindingMask |= 1u << unit;
+				}
+			}
+		}
+	}
+
+	GLint numActiveStorageBlocks = 0;
+	glGetProgramInterfaceiv(programId, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &numActiveStorageBlocks);
+	for (int interfaceIndex = 0; interfaceIndex < numActiveStorageBlocks; ++interfaceIndex) {
+		GLenum property = GL_BUFFER_BINDING;
+		GLint binding = -1;
+		glGetProgramResourceiv(programId, GL_SHADER_STORAGE_BLOCK, interfaceIndex, 1, &property, 1, NULL, &binding);
+		if (binding >= 0 && binding < 32) {
+			reflection->shaderStorageBindingMask |= 1u << binding;
+		}
+	}
+}
+
+static const char *SkipSpacesInLine(const char *p, const char *end){
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+	return p;
+}
+
+/* p から始まる語が word と一致し、その直後が語の区切りか？ */
+static bool MatchWordInLine(const char *p, const char *end, const char *word){
+	size_t length = strlen(word);
+	if ((size_t)(end - p) < length || strncmp(p, word, length) != 0) return false;
+	if (p + length == end) return true;
+	char c = p[length];
+	return !(isalnum((unsigned char)c) || c == '_');
+}
+
+/*
+	シェーダソースの #pragma mipmap_inputs(unit, ...) を解析し、ミップマップを
+	参照するテクスチャユニットを求める。宣言が無いシェーダでは、アクティブな
+	全ての sampler がミップマップを参照するものとみなす。
+	指令は行頭（空白のみ先行可）にあるものだけを認識し、コメント中の行と
+	#if 0 で無効化された区間は無視する（それ以外の条件は評価しない）。
+*/
+static void ParseMipmapInputsPragma(
+	GLsizei count,
+	const GLchar* const *strings,
+	ShaderReflection *reflection
+){
+	bool declared = false;
+	uint32_t mask = 0;
+	bool inBlockComment = false;
+	int skipDepth = 0;		/* #if 0 の中なら 1 以上（ネストした #if の深さ）*/
+	for (int stringIndex = 0; stringIndex < count; ++stringIndex) {
+		const char *line = strings[stringIndex];
+		while (line != NULL && *line != '\0') {
+			const char *end = strchr(line, '\n');
+			const char *next = (end != NULL)? end + 1: NULL;
+			if (end == NULL) end = line + strlen(line);
+
+			/* 前の行から続くブロックコメントの中で始まる行は指令として扱わない */
+			bool startsInComment = inBlockComment;
+
+			/* 次の行のためにブロックコメントの状態を更新 */
+			for (const char *p = line; p < end; ++p) {
+				if (inBlockComment) {
+					if (p + 1 < end && p[0] == '*' && p[1] == '/') {
+						inBlockComment = false;
+						++p;
+					}
+				} else
+				if (p + 1 < end && p[0] == '/' && p[1] == '/') {
+					break;
+				} else
+				if (p + 1 < end && p[0] == '/' && p[1] == '*') {
+					inBlockComment = true;
+					++p;
+				}
+			}
+
+			const char *p = SkipSpacesInLine(line, end);
+			if (startsInComment == false && p < end && *p == '#') {
+				p = SkipSpacesInLine(p + 1, end);
+				if (skipDepth > 0) {
+					if (MatchWordInLine(p, end, "if")
+					||	MatchWordInLine(p, end, "ifdef")
+					||	MatchWordInLine(p, end, "ifndef")
+					) {
+						++skipDepth;
+					} else
+					if (MatchWordInLine(p, end, "endif")) {
+						--skipDepth;
+					} else
+					if (skipDepth == 1
+					&&	(MatchWordInLine(p, end, "else") || MatchWordInLine(p, end, "elif"))
+					) {
+						skipDepth = 0;
+					}
+				} else
+				if (MatchWordInLine(p, end, "if")) {
+					const char *condition = SkipSpacesInLine(p + 2, end);
+					if (MatchWordInLine(condition, end, "0")) skipDepth = 1;
+				} else
+				if (MatchWordInLine(p, end, "pragma")) {
+					p = SkipSpacesInLine(p + 6, end);
+					if (MatchWordInLine(p, end, "mipmap_inputs")) {
+						declared = true;
+						p += 13;
+						while (p < end) {
+							if (p + 1 < end && p[0] == '/' && (p[1] == '/' || p[1] == '*')) break;
+							if ('0' <= *p && *p <= '9') {
+								int unit = (int)strtol(p, (char **)&p, 10);
+								if (unit < 32) mask |= 1u << unit;
+							} else {
+								++p;
+							}
+						}
+					}
+				}
+			}
+			line = next;
+		}
+	}
+	reflection->mipmapSamplerBindingMask =
+		declared? (mask & reflection->samplerBindingMask): reflection->samplerBindingMask;
+}
+
+const ShaderReflection *GetShaderReflection(
+	GLuint programId
+){
+	auto found = s_shaderReflections.find(programId);
+	if (found == s_shaderReflections.end()) return NULL;
+	return &found->second;
+}
+
+bool ShaderReflectionHasUniform(
+	const ShaderReflection *reflection,
+	GLint location,
+	GLenum typeEnum
+){
+	if (reflection == NULL) return false;
+	if (location < 0 || location >= SHADER_REFLECTION_MAX_LOCATIONS) return false;
+	return (reflection->uniformLocationMask & (1u << location)) != 0
+		&& reflection->uniformTypes[location] == typeEnum;
+}
+
+
+/*
+	セパレートプログラムの作成（コンパイルとリンクの発行のみ）
+	glCreateShaderProgramv はコンパイル結果を確認してから戻るため、並列シェーダ
+	コンパイル拡張が有効でもコンパイルの完了を待ってしまう。ここでは各段階を
+	発行するだけで結果は問い合わせず、シェーダオブジェクトはエラーログの取得用に
+	リンクの完了まで保持する。
+*/
+static GLuint BeginCreateSeparableProgram(
 	GLenum type,
 	GLsizei count,
-	const GLchar* const *strings
+	const GLchar* const *strings,
+	GLuint *shaderIdRet
 ){
-	GLuint programId = glCreateShaderProgramv(
-		/* (GLenum type */					type,
-		/* GLsizei count */					count,
-		/* const GLchar* const *strings */	strings
-	);
+	GLuint shaderId = glCreateShader(type);
+	glShaderSource(shaderId, count, strings, NULL);
+	glCompileShader(shaderId);
 
+	GLuint programId = glCreateProgram();
+	glProgramParameteri(programId, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);	/* プログラムバイナリキャッシュ用 */
+	glAttachShader(programId, shaderId);
+	glLinkProgram(programId);
+
+	*shaderIdRet = shaderId;
+	return programId;
+}
+
+/* 作成したプログラムのエラーチェックとリフレクション情報の構築（shaderId が 0 ならキャッシュから読み込んだもの）*/
+static bool FinishCreateShader(
+	GLuint programId,
+	GLuint shaderId,
+	GLsizei count,
+	const GLchar* const *strings
+){
 	/* エラーチェック */
 	{
-		GLint status;
-		glGetProgramiv(programId, GL_LINK_STATUS, &status);
+		char info[0x10000];
+		GLint status = GL_TRUE;
+		if (shaderId != 0) {
+			glGetShaderiv(shaderId, GL_COMPILE_STATUS, &status);
+			if (!status) {
+				glGetShaderInfoLog(shaderId, sizeof(info), NULL, info);
+				printf("	compile error : %s", info);
+			}
+		}
+		if (status) {
+			glGetProgramiv(programId, GL_LINK_STATUS, &status);
+			if (!status) {
+				glGetProgramInfoLog(programId, sizeof(info), NULL, info);
+				printf("	compile error : %s", info);
+			}
+		}
+		if (shaderId != 0) {
+			glDetachShader(programId, shaderId);
+			glDeleteShader(shaderId);
+		}
 		if (!status) {
-			char info[0x10000];
-			glGetProgramInfoLog(programId, sizeof(info), NULL, info);
-			printf("	compile error : %s", info);
-			glDeleteProgram(programId);
-			return 0;
+			DeleteShaderProgram(programId);
+			return false;
 		}
 	}
 
+	/* リフレクション情報の構築 */
+	BuildShaderReflection(programId, &s_shaderReflections[programId]);
+	ParseMipmapInputsPragma(count, strings, &s_shaderReflections[programId]);
+
+	return true;
+}
+
+void DeleteShaderProgram(
+	GLuint programId
+){
+	if (programId == 0) return;
+	s_shaderReflections.erase(programId);
+	glDeleteProgram(programId);
+}
+
+GLuint CreateShader(
+	GLenum type,
+	GLsizei count,
+	const GLchar* const *strings
+){
+	PROFILER_CPU_SCOPE("shader compile");
+	uint64_t cacheKey = ShaderCacheComputeKey(type, count, strings);
+	GLuint programId = ShaderCacheLoadProgram(cacheKey);
+	GLuint shaderId = 0;
+	bool loadedFromCache = (programId != 0);
+	if (loadedFromCache == false) {
+		programId = BeginCreateSeparableProgram(type, count, strings, &shaderId);
+	}
+	if (FinishCreateShader(programId, shaderId, count, strings) == false) return 0;
+	if (loadedFromCache == false) ShaderCacheStoreProgram(cacheKey, programId);
 	return programId;
 }
 
 
+/*=============================================================================
+▼	非同期シェーダ作成
+-----------------------------------------------------------------------------*/
+static bool s_parallelShaderCompileAvailable = false;
+
+bool InitializeParallelShaderCompile(
+){
+	/* KHR 版を優先し、無ければ ARB 版を使う */
+	const char *procName = NULL;
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint extensionIndex = 0; extensionIndex < numExtensions; extensionIndex++) {
+		const char *extensionName = (const char *)glGetStringi(GL_EXTENSIONS, extensionIndex);
+		if (extensionName == NULL) continue;
+		if (strcmp(extensionName, "GL_KHR_parallel_shader_compile") == 0) {
+			procName = "glMaxShaderCompilerThreadsKHR";
+			break;
+		}
+		if (strcmp(extensionName, "GL_ARB_parallel_shader_compile") == 0) {
+			procName = "glMaxShaderCompilerThreadsARB";
+		}
+	}
+
+	s_parallelShaderCompileAvailable = false;
+	if (procName != NULL) {
+		PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreads =
+			(PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)wglGetProcAddress(procName);
+		if (glMaxShaderCompilerThreads != NULL) {
+			/* スレッド数はドライバに任せる */
+			glMaxShaderCompilerThreads(0xFFFFFFFF);
+			s_parallelShaderCompileAvailable = true;
+		}
+	}
+	printf("parallel shader compile ... %s.\n", s_parallelShaderCompileAvailable? "available": "not available");
+	return s_parallelShaderCompileAvailable;
+}
+
+bool IsParallelShaderCompileAvailable(
+){
+	return s_parallelShaderCompileAvailable;
+}
+
+void ShaderCompileTaskStart(
+	ShaderCompileTask *task,
+	GLenum type,
+	const char *source
+){
+	ShaderCompileTaskCancel(task);
+
+	PROFILER_CPU_SCOPE("shader compile");
+	task->type = type;
+	task->source = SkipBomConst(source);
+	task->startTickCount = GetTickCount();
+	const GLchar *strings[] = {task->source.c_str()};
+
+	/* キャッシュにあればリンク済みの状態で得られる */
+	task->cacheKey = ShaderCacheComputeKey(type, 1, strings);
+	task->programId = ShaderCacheLoadProgram(task->cacheKey);
+	task->loadedFromCache = (task->programId != 0);
+	task->shaderId = 0;
+	if (task->loadedFromCache == false) {
+		task->programId = BeginCreateSeparableProgram(type, 1, strings, &task->shaderId);
+	}
+	task->active = true;
+}
+
+ShaderCompileStatus ShaderCompileTaskPoll(
+	ShaderCompileTask *task,
+	GLuint *programIdRet
+){
+	*programIdRet = 0;
+	if (task->active == false) return ShaderCompileStatusIdle;
+
+	/* 並列コンパイルが有効なら、完了するまでコンパイル結果もリンク結果も問い合わせない（問い合わせるとブロックする）*/
+	if (s_parallelShaderCompileAvailable) {
+		GLint completed = GL_FALSE;
+		glGetProgramiv(task->programId, GL_COMPLETION_STATUS_KHR, &completed);
+		if (completed == GL_FALSE) return ShaderCompileStatusCompiling;
+	}
+
+	const GLchar *strings[] = {task->source.c_str()};
+	bool succeeded = FinishCreateShader(task->programId, task->shaderId, 1, strings);
+	if (succeeded) {
+		if (task->loadedFromCache == false) ShaderCacheStoreProgram(task->cacheKey, task->programId);
+		*programIdRet = task->programId;
+	}
+
+	task->active = false;
+	task->programId = 0;
+	task->shaderId = 0;
+	task->source.clear();
+	return succeeded? ShaderCompileStatusSucceeded: ShaderCompileStatusFailed;
+}
+
+void ShaderCompileTaskCancel(
+	ShaderCompileTask *task
+){
+	if (task->active == false) return;
+	if (task->shaderId != 0) glDeleteShader(task->shaderId);
+	DeleteShaderProgram(task->programId);
+	task->active = false;
+	task->programId = 0;
+	task->shaderId = 0;
+	task->source.clear();
+}
+
+bool ShaderCompileTaskIsActive(
+	const ShaderCompileTask *task
+){
+	return task->active;
+}
+
+float ShaderCompileTaskGetElapsedTimeInSeconds(
+	const ShaderCompileTask *task
+){
+	if (task->active == false) return 0.0f;
+	return (float)(GetTickCount() - task->startTickCount) / 1000.0f;
+}
+
+
 void DumpShaderInterfaces(
 	GLuint programId
 ){
@@ -589,6 +854,14 @@ ExistsShaderUniform(
 	GLint	location,
 	GLint	typeEnum
 ){
+	/* CreateShader で作成されたプログラムならリフレクション情報を参照する */
+	const ShaderReflection *reflection = GetShaderReflection(programId);
+	if (reflection != NULL
+	&&	location >= 0 && location < SHADER_REFLECTION_MAX_LOCATIONS
+	) {
+		return ShaderReflectionHasUniform(reflection, location, (GLenum)typeEnum);
+	}
+
 	GLenum properties[2] = {GL_TYPE, GL_LOCATION};
 	GLint values[2];
 
@@ -804,6 +1077,19 @@ const char *SkipBomConst(
 	return p;
 }
 
+uint64_t Fnv1aHash64(
+	uint64_t hash,
+	const void *data,
+	size_t sizeInBytes
+){
+	const uint8_t *p = (const uint8_t *)data;
+	for (size_t i = 0; i < sizeInBytes; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
 static int CALLBACK SHBrowseProc(HWND hWnd, UINT uMsg, LPARAM lParam, LPARAM lpData)
 {
 	/* 初期状態のパスを設定 */
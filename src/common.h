@@ -126,11 +126,39 @@ GLuint CreateShader(
 	const GLchar* const *strings
 );
 
+/* CreateShader やシェーダ作成タスクで作成したプログラムの削除（リフレクション情報も破棄）*/
+void DeleteShaderProgram(
+	GLuint programId
+);
+
 /* シェーダ入出力インターフェースを解析し TTY に出力する */
 void DumpShaderInterfaces(
 	GLuint programId
 );
 
+/* シェーダのリフレクション情報（CreateShader のリンク時に一度だけ構築される）*/
+#define SHADER_REFLECTION_MAX_LOCATIONS		32
+struct ShaderReflection {
+	uint32_t uniformLocationMask;							/* location n の uniform が存在するなら bit n が立つ */
+	GLenum uniformTypes[SHADER_REFLECTION_MAX_LOCATIONS];	/* location 毎の uniform の型 */
+	uint32_t samplerBindingMask;							/* sampler が参照するテクスチャユニット */
+	uint32_t mipmapSamplerBindingMask;						/* ミップマップを参照するテクスチャユニット（#pragma mipmap_inputs で宣言）*/
+	uint32_t imageBindingMask;								/* image が参照するイメージユニット */
+	uint32_t shaderStorageBindingMask;						/* SSBO のバインディングポイント */
+};
+
+/* シェーダのリフレクション情報を取得する（CreateShader 以外で作成されたプログラムなら NULL）*/
+const ShaderReflection *GetShaderReflection(
+	GLuint programId
+);
+
+/* リフレクション情報から uniform の存在を確認する */
+bool ShaderReflectionHasUniform(
+	const ShaderReflection *reflection,
+	GLint location,
+	GLenum typeEnum
+);
+
 /* 指定のシェーダ入出力インターフェースが存在することを確認する */
 bool
 ExistsShaderUniform(
@@ -185,6 +213,14 @@ const char *SkipBomConst(
 	const char *string
 );
 
+/* FNV-1a による 64bit ハッシュ値（前回の戻り値を hash に渡すと連結したデータのハッシュ値になる）*/
+#define FNV1A_HASH64_INITIAL_VALUE	(0xCBF29CE484222325ull)
+uint64_t Fnv1aHash64(
+	uint64_t hash,
+	const void *data,
+	size_t sizeInBytes
+);
+
 /* ディレクトリの選択 */
 bool SelectDirectory(
 	const char *title,
@@ -240,6 +276,11 @@ void SetMenuItemCheck(
 #include <unordered_set>
 #include <vector>
 
+/* ファイルパスの正規化（小文字のフルパス）*/
+std::string NormalizeFilePath(
+ const std::string &path
+);
+
 bool ExpandShaderIncludes(
  const std::string &filePath,
  std::unordered_set<std::string> &stack,
@@ -264,6 +305,66 @@ bool ExpandShaderIncludes(
  std::vector<std::string> &includedFiles,
  std::string *errorMessage = NULL
 );
+
+/*
+	非同期シェーダ作成
+	GL_KHR_parallel_shader_compile（または ARB 版）が利用可能なら、コンパイルと
+	リンクはドライバのスレッドで行われ、ShaderCompileTaskPoll は完了するまで
+	ShaderCompileStatusCompiling を返す（結果は完了後にのみ問い合わせる）。利用できない環境では
+	ShaderCompileTaskStart の中で同期的にコンパイルされ、次の
+	ShaderCompileTaskPoll で結果が返る。
+*/
+enum ShaderCompileStatus {
+	ShaderCompileStatusIdle = 0,	/* タスクが無い */
+	ShaderCompileStatusCompiling,	/* コンパイル中 */
+	ShaderCompileStatusSucceeded,	/* 成功（プログラムの所有権は呼び出し側に移る）*/
+	ShaderCompileStatusFailed,		/* 失敗 */
+};
+struct ShaderCompileTask {
+	bool active;
+	GLenum type;
+	GLuint programId;
+	GLuint shaderId;			/* エラーログ取得用のシェーダオブジェクト（キャッシュから読み込んだなら 0）*/
+	std::string source;
+	DWORD startTickCount;
+	uint64_t cacheKey;			/* プログラムバイナリキャッシュのキー */
+	bool loadedFromCache;		/* キャッシュから読み込まれたか？ */
+	ShaderCompileTask() : active(false), type(0), programId(0), shaderId(0), startTickCount(0), cacheKey(0), loadedFromCache(false) {}
+};
+
+/* 並列シェーダコンパイル拡張の初期化（GL コンテキスト作成後に呼ぶ）*/
+bool InitializeParallelShaderCompile();
+
+/* 並列シェーダコンパイル拡張が利用可能か？ */
+bool IsParallelShaderCompileAvailable();
+
+/* コンパイルの開始（実行中のタスクは破棄される）*/
+void ShaderCompileTaskStart(
+	ShaderCompileTask *task,
+	GLenum type,
+	const char *source
+);
+
+/* コンパイル状態の取得（成功した場合は *programIdRet にプログラムが返る）*/
+ShaderCompileStatus ShaderCompileTaskPoll(
+	ShaderCompileTask *task,
+	GLuint *programIdRet
+);
+
+/* コンパイルの中止 */
+void ShaderCompileTaskCancel(
+	ShaderCompileTask *task
+);
+
+/* コンパイル中か？ */
+bool ShaderCompileTaskIsActive(
+	const ShaderCompileTask *task
+);
+
+/* コンパイル開始からの経過時間 */
+float ShaderCompileTaskGetElapsedTimeInSeconds(
+	const ShaderCompileTask *task
+);
 #endif
 
 #define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof(a[0]))
@@ -35,6 +35,30 @@
 /* デフォルトのフレームレート */
 #define DEFAULT_FRAMES_PER_SECOND				(60.0f)
 
+/* 動的解像度のデフォルトの目標 GPU フレーム時間と最小スケール */
+#define DEFAULT_DYNAMIC_RESOLUTION_TARGET_FRAME_TIME_IN_MILLISECONDS	(16.0f)
+#define DEFAULT_DYNAMIC_RESOLUTION_MIN_SCALE							(0.5f)
+
+/* トレース記録のフレーム数 */
+#define DEFAULT_TRACE_NUM_FRAMES				(300)
+
+/* ファイル監視で連続した書き込みをまとめる時間と、通知を使えない場合の確認間隔 */
+#define FILE_WATCHER_DEBOUNCE_IN_MILLISECONDS			(50)
+#define FILE_WATCHER_POLLING_INTERVAL_IN_MILLISECONDS	(500)
+
+/* プログラムバイナリキャッシュの総サイズの上限 */
+#define DEFAULT_SHADER_CACHE_MAX_SIZE_IN_BYTES	(256ull * 1024 * 1024)
+
+/* シェーダソースの準備を行うワーカースレッド数 */
+#define SHADER_SOURCE_JOB_NUM_WORKER_THREADS	(2)
+
+/*
+	連番画像保存で、読み出しを待たずに先行して描画するフレーム数と、
+	読み出し用バッファ数の上限
+*/
+#define RECORD_IMAGE_SEQUENCE_READBACK_LOOKAHEAD_FRAMES	(2)
+#define RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS		(32)
+
 /* 解像度の上限 */
 #define MAX_RESO								(8192)
 
@@ -50,6 +74,9 @@
 #define UNIFORM_LOCATION_PREV_CAMERA_COORD		8
 #define UNIFORM_LOCATION_PIPELINE_PASS_INDEX	9
 
+/* フレームパラメータ uniform block のバインディングポイント */
+#define UNIFORM_BLOCK_BINDING_FRAME_PARAMS		0
+
 /* レンダーターゲット数 */
 #define NUM_RENDER_TARGETS						(4)
 
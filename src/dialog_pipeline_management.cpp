@@ -97,6 +97,18 @@ static void FormatResourceSummary(
 				resource->resolution.height
 			);
 		} break;
+		case PipelineResolutionModeScale: {
+			AppendFormattedText(
+				buffer,
+				bufferSizeInBytes,
+				" | resolution=%gx%g",
+				resource->resolution.scaleX,
+				resource->resolution.scaleY
+			);
+			if (resource->resolution.alignment > 1) {
+				AppendFormattedText(buffer, bufferSizeInBytes, " (align %d)", resource->resolution.alignment);
+			}
+		} break;
 		case PipelineResolutionModeFramebuffer:
 		default: {
 			AppendFormattedText(
@@ -114,6 +126,21 @@ static void FormatResourceSummary(
 		" | history=%d",
 		resource->historyLength
 	);
+
+	const PipelineReachability *reachability = GraphicsGetPipelineReachability();
+	if (reachability != NULL && reachability->resourceReachable[resourceIndex] == false) {
+		AppendFormattedText(buffer, bufferSizeInBytes, " | culled");
+	}
+
+	int aliasSlot = GraphicsGetPipelineResourceAliasSlot(resourceIndex);
+	if (aliasSlot >= 0) {
+		AppendFormattedText(
+			buffer,
+			bufferSizeInBytes,
+			" | transient=slot%d",
+			aliasSlot
+		);
+	}
 }
 
 static void AppendBindingSummary(
@@ -172,6 +199,11 @@ static void FormatPassSummary(
 		type != NULL ? type : "unknown"
 	);
 
+	const PipelineReachability *reachability = GraphicsGetPipelineReachability();
+	if (reachability != NULL && reachability->passReachable[passIndex] == false) {
+		AppendFormattedText(buffer, bufferSizeInBytes, " (culled)");
+	}
+
 	if (pass->numInputs > 0) {
 		AppendFormattedText(buffer, bufferSizeInBytes, " | In: ");
 		for (int index = 0; index < pass->numInputs; ++index) {
@@ -264,6 +296,36 @@ static void UpdatePipelineDialogControls(HWND hDwnd){
 		);
 	}
 
+	const PipelineReachability *reachability = GraphicsGetPipelineReachability();
+	if (reachability != NULL
+	&&	(reachability->numCulledPasses > 0 || reachability->numCulledResources > 0)
+	) {
+		AppendFormattedText(
+			status,
+			sizeof(status),
+			"  Culled: %d passes / %d resources.",
+			reachability->numCulledPasses,
+			reachability->numCulledResources
+		);
+	}
+
+	int numTransientTextures = GraphicsGetNumPipelineTransientTextures();
+	if (numTransientTextures > 0 && activePipeline != NULL) {
+		int numAliasedResources = 0;
+		for (int resourceIndex = 0; resourceIndex < activePipeline->numResources; ++resourceIndex) {
+			if (GraphicsGetPipelineResourceAliasSlot(resourceIndex) >= 0) {
+				++numAliasedResources;
+			}
+		}
+		AppendFormattedText(
+			status,
+			sizeof(status),
+			"  Transient: %d resources share %d textures.",
+			numAliasedResources,
+			numTransientTextures
+		);
+	}
+
 	if (s_pipelineFeedback[0] != '\0') {
 		AppendFormattedText(status, sizeof(status), "  %s", s_pipelineFeedback);
 	}
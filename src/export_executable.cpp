@@ -228,6 +228,7 @@ PipelineResolutionModeEnumName(PipelineResolutionMode mode){
 	switch (mode) {
 		case PipelineResolutionModeFramebuffer:	return "PipelineResolutionModeFramebuffer";
 		case PipelineResolutionModeFixed:		return "PipelineResolutionModeFixed";
+		case PipelineResolutionModeScale:		return "PipelineResolutionModeScale";
 		default:								return "PipelineResolutionModeFramebuffer";
 	}
 }
@@ -238,10 +239,31 @@ PipelinePassTypeEnumName(PipelinePassType type){
 		case PipelinePassTypeFragment:	return "PipelinePassTypeFragment";
 		case PipelinePassTypeCompute:	return "PipelinePassTypeCompute";
 		case PipelinePassTypePresent:	return "PipelinePassTypePresent";
+		case PipelinePassTypeDownsample:	return "PipelinePassTypeDownsample";
+		case PipelinePassTypeUpsample:	return "PipelinePassTypeUpsample";
 		default:						return "PipelinePassTypeFragment";
 	}
 }
 
+static const char *
+PipelineDownsampleFilterEnumName(PipelineDownsampleFilter filter){
+	switch (filter) {
+		case PipelineDownsampleFilterAverage:	return "PipelineDownsampleFilterAverage";
+		case PipelineDownsampleFilterMax:		return "PipelineDownsampleFilterMax";
+		case PipelineDownsampleFilterKawase:	return "PipelineDownsampleFilterKawase";
+		default:								return "PipelineDownsampleFilterAverage";
+	}
+}
+
+static const char *
+PipelineUpsampleFilterEnumName(PipelineUpsampleFilter filter){
+	switch (filter) {
+		case PipelineUpsampleFilterBicubic:		return "PipelineUpsampleFilterBicubic";
+		case PipelineUpsampleFilterBilateral:	return "PipelineUpsampleFilterBilateral";
+		default:								return "PipelineUpsampleFilterBicubic";
+	}
+}
+
 static const char *
 PipelineResourceAccessEnumName(PipelineResourceAccess access){
 	switch (access) {
@@ -254,9 +276,21 @@ PipelineResourceAccessEnumName(PipelineResourceAccess access){
 	}
 }
 
+static const char *
+PipelinePlanBindingKindEnumName(PipelinePlanBindingKind kind){
+	switch (kind) {
+		case PipelinePlanBindingKindTexture:			return "PipelinePlanBindingKindTexture";
+		case PipelinePlanBindingKindImage:				return "PipelinePlanBindingKindImage";
+		case PipelinePlanBindingKindColorAttachment:	return "PipelinePlanBindingKindColorAttachment";
+		case PipelinePlanBindingKindBlitSource:			return "PipelinePlanBindingKindBlitSource";
+		default:										return "PipelinePlanBindingKindTexture";
+	}
+}
+
 static bool
 WritePipelineDescriptionInl(
 	const PipelineDescription *pipeline,
+	const PipelineExecutionPlan *plan,
 	const char *fileName
 ){
 	FILE *file = fopen(fileName, "wt");
@@ -276,10 +310,13 @@ WritePipelineDescriptionInl(
 		WriteEscapedString(file, resource->id);
 		fprintf(file, ",\n");
 		fprintf(file, "\t\t\t/* pixelFormat */ %s,\n", PixelFormatEnumName(resource->pixelFormat));
-		fprintf(file, "\t\t\t/* resolution */ { %s, %d, %d },\n",
+		fprintf(file, "\t\t\t/* resolution */ { %s, %d, %d, %.8ff, %.8ff, %d },\n",
 			PipelineResolutionModeEnumName(resource->resolution.mode),
 			resource->resolution.width,
-			resource->resolution.height
+			resource->resolution.height,
+			resource->resolution.scaleX,
+			resource->resolution.scaleY,
+			resource->resolution.alignment
 		);
 		fprintf(file, "\t\t\t/* historyLength */ %d,\n", resource->historyLength);
 		fprintf(file, "\t\t\t/* textureFilter */ %s,\n", TextureFilterEnumName(resource->textureFilter));
@@ -340,17 +377,119 @@ WritePipelineDescriptionInl(
 		);
 
 		fprintf(file, "\t\t\t/* overrideWorkGroupSize */ %s,\n", pass->overrideWorkGroupSize? "true" : "false");
-		fprintf(file, "\t\t\t/* workGroupSize */ { %u, %u, %u }\n",
+		fprintf(file, "\t\t\t/* workGroupSize */ { %u, %u, %u },\n",
 			(unsigned int)pass->workGroupSize[0],
 			(unsigned int)pass->workGroupSize[1],
 			(unsigned int)pass->workGroupSize[2]
 		);
+		fprintf(file, "\t\t\t/* downsampleFilter */ %s,\n", PipelineDownsampleFilterEnumName(pass->downsampleFilter));
+		fprintf(file, "\t\t\t/* upsampleFilter */ %s\n", PipelineUpsampleFilterEnumName(pass->upsampleFilter));
 		fprintf(file, "\t\t}%s\n", (passIndex + 1 < pipeline->numPasses)? "," : "");
 	}
 	fprintf(file, "\t},\n");
 	fprintf(file, "\t/* numPasses */ %d\n", pipeline->numPasses);
 	fprintf(file, "};\n");
 
+	/* 実行プラン（ユニット割り当てとバリアはエディタと同じコンパイラで解決済み）*/
+	fprintf(file, "static const PipelineExecutionPlan g_exportedPipelinePlan = {\n");
+	fprintf(file, "\t/* commands */\n\t{\n");
+	for (int commandIndex = 0; commandIndex < plan->numCommands; ++commandIndex) {
+		const PipelinePlanCommand *command = &plan->commands[commandIndex];
+		fprintf(file, "\t\t{\n");
+		fprintf(file, "\t\t\t/* passIndex */ %d,\n", command->passIndex);
+		fprintf(file, "\t\t\t/* type */ %s,\n", PipelinePassTypeEnumName(command->type));
+		fprintf(file, "\t\t\t/* executable */ %s,\n", command->executable? "true" : "false");
+		fprintf(file, "\t\t\t/* barrierBits */ 0x%08X,\n", (unsigned int)command->barrierBits);
+		fprintf(file, "\t\t\t/* targetResourceIndex */ %d,\n", command->targetResourceIndex);
+		fprintf(file, "\t\t\t/* clear */ { %s, { %.8f, %.8f, %.8f, %.8f }, %s, %.8f },\n",
+			command->clear.enableColorClear? "true" : "false",
+			command->clear.clearColor[0],
+			command->clear.clearColor[1],
+			command->clear.clearColor[2],
+			command->clear.clearColor[3],
+			command->clear.enableDepthClear? "true" : "false",
+			command->clear.clearDepth
+		);
+		fprintf(file, "\t\t\t/* overrideWorkGroupSize */ %s,\n", command->overrideWorkGroupSize? "true" : "false");
+		fprintf(file, "\t\t\t/* workGroupSize */ { %u, %u, %u },\n",
+			(unsigned int)command->workGroupSize[0],
+			(unsigned int)command->workGroupSize[1],
+			(unsigned int)command->workGroupSize[2]
+		);
+		fprintf(file, "\t\t\t/* bindings */ {\n");
+		for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+			const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+			fprintf(file, "\t\t\t\t{ %s, %d, %d, %d, 0x%04X, 0x%04X, %s, %s, %s, %s }%s\n",
+				PipelinePlanBindingKindEnumName(binding->kind),
+				binding->resourceIndex,
+				binding->historyOffset,
+				binding->unit,
+				(unsigned int)binding->imageAccess,
+				(unsigned int)binding->imageFormat,
+				TextureFilterEnumName(binding->textureFilter),
+				TextureWrapEnumName(binding->textureWrap),
+				binding->enableMipmap? "true" : "false",
+				binding->mipmapPrebuilt? "true" : "false",
+				(bindingIndex + 1 < command->numBindings)? "," : ""
+			);
+		}
+		fprintf(file, "\t\t\t},\n");
+		fprintf(file, "\t\t\t/* numBindings */ %d,\n", command->numBindings);
+		fprintf(file, "\t\t\t/* downsampleFilter */ %s\n", PipelineDownsampleFilterEnumName(command->downsampleFilter));
+		fprintf(file, "\t\t}%s\n", (commandIndex + 1 < plan->numCommands)? "," : "");
+	}
+	fprintf(file, "\t},\n");
+	fprintf(file, "\t/* numCommands */ %d\n", plan->numCommands);
+	fprintf(file, "};\n");
+
+	fclose(file);
+	return true;
+}
+
+
+/*=============================================================================
+▼	パイプラインパス個別のシェーダのファイル名生成
+-----------------------------------------------------------------------------*/
+static void
+GeneratePipelinePassShaderFullPath(
+	char *buffer,
+	size_t bufferSizeInBytes,
+	const char *workDirName,
+	int passIndex,
+	const char *extension
+){
+	snprintf(buffer, bufferSizeInBytes, "%s\\pipeline_pass_shader%d.%s", workDirName, passIndex, extension);
+}
+
+
+/*=============================================================================
+▼	パイプラインパス個別のシェーダをまとめる inl の生成
+-----------------------------------------------------------------------------*/
+/*
+	パス毎に end mark で区切った文字列を生成する。
+	個別シェーダを持たないパスは空文字列となり、実行時には共有シェーダが使われる。
+*/
+static bool
+WritePipelinePassShadersInl(
+	const PipelineDescription *pipeline,
+	const char *const *pipelinePassShaderCodes,
+	const char *fileName
+){
+	FILE *file = fopen(fileName, "wt");
+	if (file == NULL) {
+		AppErrorMessageBox(APP_NAME, "Failed to open %s.", fileName);
+		return false;
+	}
+
+	fprintf(file, "/* Auto-generated pipeline pass shaders */\n");
+	fprintf(file, "\"\"\n");
+	for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+		if (pipelinePassShaderCodes[passIndex] != NULL) {
+			fprintf(file, "#include \"pipeline_pass_shader%d.inl\"\n", passIndex);
+		}
+		fprintf(file, "\"\\0\"\n");
+	}
+
 	fclose(file);
 	return true;
 }
@@ -549,6 +688,7 @@ bool ExportExecutableSub(
 	const char *graphicsShaderCode,
 	const char *computeShaderCode,
 	const char *soundShaderCode,
+	const char *const *pipelinePassShaderCodes,
 #if USE_MAIN_CPP
 	const char *mainCppFullPath,
 	const char *glextHeaderFullPath,
@@ -567,6 +707,7 @@ bool ExportExecutableSub(
 	const char *soundComputeShaderGlslFullPath,
 	const char *soundComputeShaderInlFullPath,
 	const char *pipelineDescriptionInlFullPath,
+	const char *pipelinePassShadersInlFullPath,
 	const char *crinklerReportFullPath,
 	const char *crinklerReuseFullPath,
 	const char *minifyBatFullPath,
@@ -678,15 +819,68 @@ bool ExportExecutableSub(
 		fclose(file);
 	}
 
-	{
-		const PipelineDescription *pipeline = GraphicsGetActivePipelineDescription();
-		if (pipeline == NULL) {
-			AppErrorMessageBox(APP_NAME, "Failed to obtain pipeline description.");
-			return false;
-		}
-		if (WritePipelineDescriptionInl(pipeline, pipelineDescriptionInlFullPath) == false) {
+	const PipelineDescription *activePipeline = GraphicsGetActivePipelineDescription();
+	if (activePipeline == NULL) {
+		AppErrorMessageBox(APP_NAME, "Failed to obtain pipeline description.");
+		return false;
+	}
+
+	/*
+		present パスに寄与しないパスとリソースは出力しない。
+		パス番号が詰められるので、パス個別のシェーダも付け替える。
+	*/
+	static PipelineDescription s_strippedPipeline;
+	int sourcePassIndices[PIPELINE_MAX_PASSES] = {0};
+	const char *strippedPassShaderCodes[PIPELINE_MAX_PASSES] = {0};
+	PipelineReachability reachability;
+	PipelineDescriptionAnalyzeReachability(activePipeline, &reachability);
+	PipelineDescriptionStripUnreachable(activePipeline, &reachability, &s_strippedPipeline, sourcePassIndices);
+	for (int passIndex = 0; passIndex < s_strippedPipeline.numPasses; ++passIndex) {
+		strippedPassShaderCodes[passIndex] = pipelinePassShaderCodes[sourcePassIndices[passIndex]];
+	}
+	pipelinePassShaderCodes = strippedPassShaderCodes;
+	const PipelineDescription *pipeline = &s_strippedPipeline;
+	if (reachability.numCulledPasses > 0 || reachability.numCulledResources > 0) {
+		printf(
+			"%d passes and %d resources are culled from the exported pipeline.\n",
+			reachability.numCulledPasses,
+			reachability.numCulledResources
+		);
+	}
+	static PipelineExecutionPlan s_exportedPlan;
+	PipelineDescriptionCompileExecutionPlan(
+		pipeline,
+		NULL,	/* 到達不能なパスは既に取り除かれている */
+		renderSettings->enableMipmapGeneration,
+		&s_exportedPlan
+	);
+	if (WritePipelineDescriptionInl(pipeline, &s_exportedPlan, pipelineDescriptionInlFullPath) == false) {
+		return false;
+	}
+
+	/* pipeline_pass_shader?.glsl 生成 */
+	for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+		if (pipelinePassShaderCodes[passIndex] == NULL) continue;
+		char glslFullPath[MAX_PATH];
+		GeneratePipelinePassShaderFullPath(glslFullPath, sizeof(glslFullPath), workDirName, passIndex, "glsl");
+		printf("generate %s.\n", glslFullPath);
+		FILE *file = fopen(glslFullPath, "wt");
+		if (file == NULL) {
+			AppErrorMessageBox(APP_NAME, "Failed to generate %s.", glslFullPath);
 			return false;
 		}
+
+		fprintf(
+			file,
+			"%s\n",
+			pipelinePassShaderCodes[passIndex]
+		);
+		fclose(file);
+	}
+
+	/* pipeline_pass_shaders.inl 生成 */
+	if (WritePipelinePassShadersInl(pipeline, pipelinePassShaderCodes, pipelinePassShadersInlFullPath) == false) {
+		return false;
 	}
 
 	/* version ディレクティブの除去と保存 */
@@ -717,6 +911,20 @@ bool ExportExecutableSub(
 	) {
 		return false;
 	}
+	static char s_pipelinePassShaderVersionDirectiveBuffers[PIPELINE_MAX_PASSES][0x1000];
+	for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+		if (pipelinePassShaderCodes[passIndex] == NULL) continue;
+		char glslFullPath[MAX_PATH];
+		GeneratePipelinePassShaderFullPath(glslFullPath, sizeof(glslFullPath), workDirName, passIndex, "glsl");
+		if (RemoveAndSaveVersionDirective(
+				glslFullPath,
+				s_pipelinePassShaderVersionDirectiveBuffers[passIndex],
+				sizeof(s_pipelinePassShaderVersionDirectiveBuffers[passIndex])
+			) == false
+		) {
+			return false;
+		}
+	}
 
 	/* VisualStudio コマンドプロンプトを起動する定型文（失敗したら exit /b 1）*/
 	#define OPEN_DEVELOPER_COMMAND_PROMPT \
@@ -843,6 +1051,30 @@ bool ExportExecutableSub(
 				soundComputeShaderVersionDirectiveBuffer								/* arg 3 */
 			);
 
+			/*
+				パイプラインパス個別のシェーダにも同様に適用
+				pipeline_pass_shader?.glsl -> pipeline_pass_shader?.i
+			*/
+			for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+				if (pipelinePassShaderCodes[passIndex] == NULL) continue;
+				fprintf(
+					file,
+					"cl /P /EP /DEXPORT_EXECUTABLE=1 /DSCREEN_XRESO=%d /DSCREEN_YRESO=%d pipeline_pass_shader%d.glsl || exit /b 9\n"
+					"echo %s > pipeline_pass_shader%d.version\n"
+					"copy /b pipeline_pass_shader%d.version + pipeline_pass_shader%d.i pipeline_pass_shader%d.tmp\n"
+					"del pipeline_pass_shader%d.version\n"
+					"del pipeline_pass_shader%d.i\n"
+					"rename pipeline_pass_shader%d.tmp pipeline_pass_shader%d.i\n"
+					,
+					executableExportSettings->xReso, executableExportSettings->yReso, passIndex,
+					s_pipelinePassShaderVersionDirectiveBuffers[passIndex], passIndex,
+					passIndex, passIndex, passIndex,
+					passIndex,
+					passIndex,
+					passIndex, passIndex
+				);
+			}
+
 			/* shader_minifier.exe の存在チェック */
 			fprintf(
 				file,
@@ -867,6 +1099,14 @@ bool ExportExecutableSub(
 				shaderMinifierPath, shaderMinifierOptions,								/* arg 3,4 */
 				shaderMinifierPath, shaderMinifierOptions								/* arg 5,6 */
 			);
+			for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+				if (pipelinePassShaderCodes[passIndex] == NULL) continue;
+				fprintf(
+					file,
+					"\"%s\" %s pipeline_pass_shader%d.i -o pipeline_pass_shader%d.inl --format c-array || exit /b 10\n",
+					shaderMinifierPath, shaderMinifierOptions, passIndex, passIndex
+				);
+			}
 
 			fclose(file);
 		}
@@ -909,6 +1149,12 @@ bool ExportExecutableSub(
 				case 8: {
 					AppErrorMessageBox(APP_NAME, "Failed to minify sound compute shader.");
 				} break;
+				case 9: {
+					AppErrorMessageBox(APP_NAME, "Failed to pre-process pipeline pass shader.");
+				} break;
+				case 10: {
+					AppErrorMessageBox(APP_NAME, "Failed to minify pipeline pass shader.");
+				} break;
 				default: {
 					assert(false);
 				} break;
@@ -938,6 +1184,17 @@ bool ExportExecutableSub(
 	if (ApplyWorkAround(soundComputeShaderInlFullPath) == false) {
 		return false;
 	}
+	for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+		if (pipelinePassShaderCodes[passIndex] == NULL) continue;
+		char inlFullPath[MAX_PATH];
+		GeneratePipelinePassShaderFullPath(inlFullPath, sizeof(inlFullPath), workDirName, passIndex, "inl");
+		if (RemoveComma(inlFullPath) == false) {
+			return false;
+		}
+		if (ApplyWorkAround(inlFullPath) == false) {
+			return false;
+		}
+	}
 
 	/* build.bat 生成 */
 	{
@@ -1251,6 +1508,7 @@ bool ExportExecutable(
 	const char *graphicsShaderCode,
 	const char *computeShaderCode,
 	const char *soundShaderCode,
+	const char *const *pipelinePassShaderCodes,
 	const RenderSettings *renderSettings,
 	const ExecutableExportSettings *executableExportSettings
 ){
@@ -1323,6 +1581,7 @@ bool ExportExecutable(
 	char soundComputeShaderTmpFullPath[MAX_PATH] = {0};
 	char soundComputeShaderInlFullPath[MAX_PATH] = {0};
 	char pipelineDescriptionInlFullPath[MAX_PATH] = {0};
+	char pipelinePassShadersInlFullPath[MAX_PATH] = {0};
 	char crinklerReportFullPath[MAX_PATH] = {0};
 	char crinklerReuseFullPath[MAX_PATH] = {0};
 	char minifyBatFullPath[MAX_PATH] = {0};
@@ -1352,6 +1611,7 @@ bool ExportExecutable(
 	snprintf(soundComputeShaderTmpFullPath,  sizeof(soundComputeShaderTmpFullPath),  "%s\\sound_compute_shader.i",  workDirName);
 	snprintf(soundComputeShaderInlFullPath,  sizeof(soundComputeShaderInlFullPath),  "%s\\sound_compute_shader.inl",  workDirName);
 	snprintf(pipelineDescriptionInlFullPath, sizeof(pipelineDescriptionInlFullPath), "%s\\pipeline_description.inl", workDirName);
+	snprintf(pipelinePassShadersInlFullPath, sizeof(pipelinePassShadersInlFullPath), "%s\\pipeline_pass_shaders.inl", workDirName);
 	snprintf(crinklerReportFullPath, sizeof(crinklerReportFullPath), "%s.crinkler_report.html", executableExportSettings->fileName);
 	snprintf(crinklerReuseFullPath, sizeof(crinklerReuseFullPath), "%s.crinkler_reuse.txt", executableExportSettings->fileName);
 	snprintf(minifyBatFullPath, sizeof(minifyBatFullPath), "%s\\minify.bat", workDirName);
@@ -1379,6 +1639,7 @@ bool ExportExecutable(
 		graphicsShaderCode,
 		computeShaderCode,
 		soundShaderCode,
+		pipelinePassShaderCodes,
 #if USE_MAIN_CPP
 		mainCppFullPath,
 		glextHeaderFullPath,
@@ -1397,6 +1658,7 @@ bool ExportExecutable(
 		soundComputeShaderGlslFullPath,
 		soundComputeShaderInlFullPath,
 		pipelineDescriptionInlFullPath,
+		pipelinePassShadersInlFullPath,
 		crinklerReportFullPath,
 		crinklerReuseFullPath,
 		minifyBatFullPath,
@@ -1444,6 +1706,15 @@ bool ExportExecutable(
 	remove(soundComputeShaderGlslFullPath);
 	remove(soundComputeShaderTmpFullPath);
 	remove(soundComputeShaderInlFullPath);
+	remove(pipelinePassShadersInlFullPath);
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; ++passIndex) {
+		static const char *s_extensions[] = {"glsl", "i", "inl"};
+		for (int i = 0; i < (int)SIZE_OF_ARRAY(s_extensions); ++i) {
+			char fullPath[MAX_PATH];
+			GeneratePipelinePassShaderFullPath(fullPath, sizeof(fullPath), workDirName, passIndex, s_extensions[i]);
+			remove(fullPath);
+		}
+	}
 #if USE_MAIN_CPP
 	if (RemoveDirectory(glDirName) == FALSE) {
 		AppLastErrorMessageBox(APP_NAME);
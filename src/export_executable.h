@@ -51,6 +51,7 @@ bool ExportExecutable(
 	const char *graphicsShaderCode,
 	const char *computeShaderCode,
 	const char *soundShaderCode,
+	const char *const *pipelinePassShaderCodes,	/* パス毎のシェーダ（NULL なら共有シェーダを使う）*/
 	const RenderSettings *renderSettings,
 	const ExecutableExportSettings *executableExportSettings
 );
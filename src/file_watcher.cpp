@@ -0,0 +1,467 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include <process.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "config.h"
+#include "profiler.h"
+#include "file_watcher.h"
+
+
+/* ReadDirectoryChangesW の受信バッファサイズ */
+#define FILE_WATCHER_NOTIFY_BUFFER_SIZE_IN_BYTES	(0x4000)
+
+/* 通知で監視できるディレクトリ数の上限（残りはタイムスタンプを確認する）*/
+#define FILE_WATCHER_MAX_NOTIFIED_DIRECTORIES		(MAXIMUM_WAIT_OBJECTS - 1)
+
+struct WatchedDirectory {
+	std::string directoryName;				/* 正規化されたパス */
+	std::vector<std::string> fileNames;		/* ディレクトリ内の監視対象（正規化されたパス）*/
+	std::vector<time_t> fileTimes;			/* タイムスタンプ確認用の最終修正時刻 */
+	bool polling;							/* 通知を使わずタイムスタンプを確認するか？ */
+	HANDLE hDirectory;
+	HANDLE hEvent;
+	OVERLAPPED overlapped;
+	DWORD buffer[FILE_WATCHER_NOTIFY_BUFFER_SIZE_IN_BYTES / sizeof(DWORD)];	/* DWORD 境界に揃える必要がある */
+};
+
+/* メインスレッドと共有する状態（s_criticalSection で保護）*/
+static CRITICAL_SECTION s_criticalSection;
+static HANDLE s_hThread = NULL;
+static HANDLE s_hWakeEvent = NULL;
+static bool s_terminateRequested = false;
+static std::vector<std::string> s_watchedFileNames;
+static bool s_watchedFileNamesUpdated = false;
+static std::vector<std::string> s_readRequests;
+static std::deque<FileWatcherEvent> s_events;
+
+/* メインスレッドのみが参照する状態 */
+static std::vector<std::string> s_lastWatchedFileNames;
+
+/* 監視スレッドのみが参照する状態 */
+static std::vector<WatchedDirectory *> s_directories;
+static std::unordered_map<std::string, DWORD> s_pendingFiles;	/* 変更を検出したファイルと最後に検出した時刻 */
+static DWORD s_lastPollingTickCount = 0;
+
+
+/*=============================================================================
+▼	監視スレッド
+-----------------------------------------------------------------------------*/
+static void FileWatcherUpdateFileTimes(
+	WatchedDirectory *directory
+){
+	directory->fileTimes.resize(directory->fileNames.size());
+	for (size_t i = 0; i < directory->fileNames.size(); i++) {
+		struct stat fileStat;
+		directory->fileTimes[i] = (stat(directory->fileNames[i].c_str(), &fileStat) == 0)? fileStat.st_mtime: 0;
+	}
+}
+
+static bool FileWatcherIssueRead(
+	WatchedDirectory *directory
+){
+	ResetEvent(directory->hEvent);
+	memset(&directory->overlapped, 0, sizeof(directory->overlapped));
+	directory->overlapped.hEvent = directory->hEvent;
+	BOOL ret = ReadDirectoryChangesW(
+		/* HANDLE hDirectory */									directory->hDirectory,
+		/* LPVOID lpBuffer */									directory->buffer,
+		/* DWORD nBufferLength */								sizeof(directory->buffer),
+		/* BOOL bWatchSubtree */								FALSE,
+		/* DWORD dwNotifyFilter */								FILE_NOTIFY_CHANGE_FILE_NAME
+																|	FILE_NOTIFY_CHANGE_LAST_WRITE
+																|	FILE_NOTIFY_CHANGE_SIZE,
+		/* LPDWORD lpBytesReturned */							NULL,
+		/* LPOVERLAPPED lpOverlapped */							&directory->overlapped,
+		/* LPOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine */	NULL
+	);
+	return ret != FALSE;
+}
+
+static void FileWatcherStopNotification(
+	WatchedDirectory *directory
+){
+	if (directory->hDirectory != INVALID_HANDLE_VALUE) {
+		if (directory->polling == false) {
+			/* 発行中の読み込みが完了するまで、バッファを解放してはならない */
+			DWORD numBytes;
+			CancelIo(directory->hDirectory);
+			GetOverlappedResult(directory->hDirectory, &directory->overlapped, &numBytes, TRUE);
+		}
+		CloseHandle(directory->hDirectory);
+		directory->hDirectory = INVALID_HANDLE_VALUE;
+	}
+	if (directory->hEvent != NULL) {
+		CloseHandle(directory->hEvent);
+		directory->hEvent = NULL;
+	}
+	directory->polling = true;
+}
+
+static WatchedDirectory *FileWatcherOpenDirectory(
+	const std::string &directoryName,
+	bool enableNotification
+){
+	WatchedDirectory *directory = new WatchedDirectory;
+	directory->directoryName = directoryName;
+	directory->polling = true;
+	directory->hDirectory = INVALID_HANDLE_VALUE;
+	directory->hEvent = NULL;
+
+	if (enableNotification) {
+		directory->hDirectory = CreateFileA(
+			/* LPCSTR lpFileName */								directoryName.c_str(),
+			/* DWORD dwDesiredAccess */							FILE_LIST_DIRECTORY,
+			/* DWORD dwShareMode */								FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			/* LPSECURITY_ATTRIBUTES lpSecurityAttributes */	NULL,
+			/* DWORD dwCreationDisposition */					OPEN_EXISTING,
+			/* DWORD dwFlagsAndAttributes */					FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+			/* HANDLE hTemplateFile */							NULL
+		);
+		if (directory->hDirectory != INVALID_HANDLE_VALUE) {
+			directory->hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+			if (directory->hEvent != NULL
+			&&	FileWatcherIssueRead(directory)
+			) {
+				directory->polling = false;
+			}
+		}
+	}
+	if (directory->polling) {
+		FileWatcherStopNotification(directory);
+		printf("file watcher : %s is polled.\n", directoryName.c_str());
+	}
+	return directory;
+}
+
+static void FileWatcherCloseDirectory(
+	WatchedDirectory *directory
+){
+	FileWatcherStopNotification(directory);
+	delete directory;
+}
+
+static void FileWatcherApplyWatchedFiles(
+	const std::vector<std::string> &fileNames
+){
+	/* 監視対象をディレクトリごとにまとめる */
+	std::unordered_map<std::string, std::vector<std::string> > fileNamesByDirectory;
+	for (const std::string &fileName : fileNames) {
+		std::string normalizedFileName = NormalizeFilePath(fileName);
+		size_t separator = normalizedFileName.find_last_of("\\/");
+		if (separator == std::string::npos) continue;
+		std::vector<std::string> &directoryFileNames = fileNamesByDirectory[normalizedFileName.substr(0, separator)];
+		if (std::find(directoryFileNames.begin(), directoryFileNames.end(), normalizedFileName) == directoryFileNames.end()) {
+			directoryFileNames.push_back(normalizedFileName);
+		}
+	}
+
+	/* 監視対象が無くなったディレクトリを閉じる */
+	for (size_t i = 0; i < s_directories.size();) {
+		if (fileNamesByDirectory.find(s_directories[i]->directoryName) == fileNamesByDirectory.end()) {
+			FileWatcherCloseDirectory(s_directories[i]);
+			s_directories.erase(s_directories.begin() + i);
+		} else {
+			i++;
+		}
+	}
+
+	/* ディレクトリの追加と監視対象の更新 */
+	int numNotifiedDirectories = 0;
+	for (WatchedDirectory *directory : s_directories) {
+		if (directory->polling == false) numNotifiedDirectories++;
+	}
+	for (auto &entry : fileNamesByDirectory) {
+		WatchedDirectory *directory = NULL;
+		for (WatchedDirectory *existingDirectory : s_directories) {
+			if (existingDirectory->directoryName == entry.first) {
+				directory = existingDirectory;
+				break;
+			}
+		}
+		if (directory == NULL) {
+			directory = FileWatcherOpenDirectory(
+				entry.first,
+				numNotifiedDirectories < FILE_WATCHER_MAX_NOTIFIED_DIRECTORIES
+			);
+			if (directory->polling == false) numNotifiedDirectories++;
+			s_directories.push_back(directory);
+		}
+		directory->fileNames = entry.second;
+		FileWatcherUpdateFileTimes(directory);
+	}
+}
+
+static void FileWatcherProcessNotification(
+	WatchedDirectory *directory
+){
+	DWORD tickCount = GetTickCount();
+	DWORD numBytes = 0;
+	if (GetOverlappedResult(directory->hDirectory, &directory->overlapped, &numBytes, FALSE) == FALSE
+	||	numBytes == 0
+	) {
+		/* 受信バッファが溢れた。ディレクトリ内の監視対象を全て変更されたものとみなす */
+		for (const std::string &fileName : directory->fileNames) {
+			s_pendingFiles[fileName] = tickCount;
+		}
+	} else {
+		const uint8_t *p = (const uint8_t *)directory->buffer;
+		for (;;) {
+			const FILE_NOTIFY_INFORMATION *info = (const FILE_NOTIFY_INFORMATION *)p;
+
+			/* エディタによっては一時ファイルからのリネームで保存される */
+			if (info->Action == FILE_ACTION_ADDED
+			||	info->Action == FILE_ACTION_MODIFIED
+			||	info->Action == FILE_ACTION_RENAMED_NEW_NAME
+			) {
+				char name[MAX_PATH];
+				int length = WideCharToMultiByte(
+					/* UINT CodePage */				CP_ACP,
+					/* DWORD dwFlags */				0,
+					/* LPCWCH lpWideCharStr */		info->FileName,
+					/* int cchWideChar */			(int)(info->FileNameLength / sizeof(WCHAR)),
+					/* LPSTR lpMultiByteStr */		name,
+					/* int cbMultiByte */			sizeof(name) - 1,
+					/* LPCCH lpDefaultChar */		NULL,
+					/* LPBOOL lpUsedDefaultChar */	NULL
+				);
+				if (length > 0) {
+					name[length] = '\0';
+					std::string fileName = NormalizeFilePath(directory->directoryName + "\\" + name);
+					if (std::find(directory->fileNames.begin(), directory->fileNames.end(), fileName) != directory->fileNames.end()) {
+						s_pendingFiles[fileName] = tickCount;
+					}
+				}
+			}
+			if (info->NextEntryOffset == 0) break;
+			p += info->NextEntryOffset;
+		}
+	}
+
+	if (FileWatcherIssueRead(directory) == false) {
+		FileWatcherStopNotification(directory);
+		FileWatcherUpdateFileTimes(directory);
+		printf("file watcher : %s is polled.\n", directory->directoryName.c_str());
+	}
+}
+
+static void FileWatcherPollDirectories(
+){
+	DWORD tickCount = GetTickCount();
+	for (WatchedDirectory *directory : s_directories) {
+		if (directory->polling == false) continue;
+		for (size_t i = 0; i < directory->fileNames.size(); i++) {
+			struct stat fileStat;
+			time_t fileTime = (stat(directory->fileNames[i].c_str(), &fileStat) == 0)? fileStat.st_mtime: 0;
+			if (fileTime != directory->fileTimes[i]) {
+				directory->fileTimes[i] = fileTime;
+				s_pendingFiles[directory->fileNames[i]] = tickCount;
+			}
+		}
+	}
+}
+
+static char *FileWatcherReadFile(
+	const char *fileName
+){
+	PROFILER_CPU_SCOPE("file read");
+
+	/* ファイルのロック状態が継続していることがあるため、リトライしながら読む */
+	for (int retryCount = 0; retryCount < 10; retryCount++) {
+		char *content = MallocReadTextFile(fileName);
+		if (content != NULL) return content;
+		printf("retry %d ... \n", retryCount);
+		Sleep(100);
+	}
+	return NULL;
+}
+
+/* 書き込みが落ち着いたファイルを読み込み、イベントとして通知する */
+static void FileWatcherFlushPendingFiles(
+){
+	DWORD tickCount = GetTickCount();
+	for (auto it = s_pendingFiles.begin(); it != s_pendingFiles.end();) {
+		if (tickCount - it->second < FILE_WATCHER_DEBOUNCE_IN_MILLISECONDS) {
+			++it;
+			continue;
+		}
+		FileWatcherEvent event;
+		event.fileName = it->first;
+		event.content = FileWatcherReadFile(it->first.c_str());
+		it = s_pendingFiles.erase(it);
+
+		EnterCriticalSection(&s_criticalSection);
+		s_events.push_back(event);
+		LeaveCriticalSection(&s_criticalSection);
+	}
+}
+
+static unsigned __stdcall FileWatcherThreadProc(
+	void	*pWork_
+){
+	ProfilerSetThreadName("file watcher");
+	for (;;) {
+		/* メインスレッドからの要求を取り込む */
+		bool watchedFileNamesUpdated = false;
+		std::vector<std::string> watchedFileNames;
+		std::vector<std::string> readRequests;
+		EnterCriticalSection(&s_criticalSection);
+		if (s_terminateRequested) {
+			LeaveCriticalSection(&s_criticalSection);
+			break;
+		}
+		if (s_watchedFileNamesUpdated) {
+			watchedFileNames = s_watchedFileNames;
+			s_watchedFileNamesUpdated = false;
+			watchedFileNamesUpdated = true;
+		}
+		readRequests.swap(s_readRequests);
+		LeaveCriticalSection(&s_criticalSection);
+
+		if (watchedFileNamesUpdated) {
+			FileWatcherApplyWatchedFiles(watchedFileNames);
+		}
+		for (const std::string &fileName : readRequests) {
+			/* 読み込み要求は待たずに処理する */
+			s_pendingFiles[NormalizeFilePath(fileName)] = GetTickCount() - FILE_WATCHER_DEBOUNCE_IN_MILLISECONDS;
+		}
+
+		/* 変更通知、メインスレッドからの要求、待ち時間の経過のいずれかを待つ */
+		HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+		WatchedDirectory *handleDirectories[MAXIMUM_WAIT_OBJECTS];
+		DWORD numHandles = 0;
+		handles[numHandles] = s_hWakeEvent;
+		handleDirectories[numHandles] = NULL;
+		numHandles++;
+		bool hasPollingDirectories = false;
+		for (WatchedDirectory *directory : s_directories) {
+			if (directory->polling) {
+				hasPollingDirectories = true;
+			} else {
+				handles[numHandles] = directory->hEvent;
+				handleDirectories[numHandles] = directory;
+				numHandles++;
+			}
+		}
+		DWORD timeoutInMilliseconds = INFINITE;
+		if (hasPollingDirectories) {
+			timeoutInMilliseconds = FILE_WATCHER_POLLING_INTERVAL_IN_MILLISECONDS;
+		}
+		if (s_pendingFiles.empty() == false
+		&&	timeoutInMilliseconds > FILE_WATCHER_DEBOUNCE_IN_MILLISECONDS
+		) {
+			timeoutInMilliseconds = FILE_WATCHER_DEBOUNCE_IN_MILLISECONDS;
+		}
+		DWORD result = WaitForMultipleObjects(numHandles, handles, FALSE, timeoutInMilliseconds);
+		if (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + numHandles) {
+			FileWatcherProcessNotification(handleDirectories[result - WAIT_OBJECT_0]);
+		}
+
+		if (hasPollingDirectories
+		&&	GetTickCount() - s_lastPollingTickCount >= FILE_WATCHER_POLLING_INTERVAL_IN_MILLISECONDS
+		) {
+			FileWatcherPollDirectories();
+			s_lastPollingTickCount = GetTickCount();
+		}
+		FileWatcherFlushPendingFiles();
+	}
+
+	for (WatchedDirectory *directory : s_directories) {
+		FileWatcherCloseDirectory(directory);
+	}
+	s_directories.clear();
+	s_pendingFiles.clear();
+	return 0;
+}
+
+
+/*=============================================================================
+▼	メインスレッドからの操作
+-----------------------------------------------------------------------------*/
+void FileWatcherSetWatchedFiles(
+	const std::vector<std::string> &fileNames
+){
+	if (fileNames == s_lastWatchedFileNames) return;
+	s_lastWatchedFileNames = fileNames;
+
+	EnterCriticalSection(&s_criticalSection);
+	s_watchedFileNames = fileNames;
+	s_watchedFileNamesUpdated = true;
+	LeaveCriticalSection(&s_criticalSection);
+	SetEvent(s_hWakeEvent);
+}
+
+void FileWatcherRequestRead(
+	const char *fileName
+){
+	if (fileName == NULL || fileName[0] == '\0') return;
+
+	EnterCriticalSection(&s_criticalSection);
+	s_readRequests.push_back(fileName);
+	LeaveCriticalSection(&s_criticalSection);
+	SetEvent(s_hWakeEvent);
+}
+
+bool FileWatcherPopEvent(
+	FileWatcherEvent *event
+){
+	bool popped = false;
+	EnterCriticalSection(&s_criticalSection);
+	if (s_events.empty() == false) {
+		*event = s_events.front();
+		s_events.pop_front();
+		popped = true;
+	}
+	LeaveCriticalSection(&s_criticalSection);
+	return popped;
+}
+
+
+/*=============================================================================
+▼	初期化 & 終了処理
+-----------------------------------------------------------------------------*/
+bool FileWatcherInitialize(
+){
+	InitializeCriticalSection(&s_criticalSection);
+	s_terminateRequested = false;
+	s_watchedFileNamesUpdated = false;
+	s_lastWatchedFileNames.clear();
+
+	s_hWakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (s_hWakeEvent == NULL) return false;
+
+	s_hThread = (HANDLE)_beginthreadex(NULL, 0, FileWatcherThreadProc, NULL, 0, NULL);
+	if (s_hThread == NULL) return false;
+
+	return true;
+}
+
+bool FileWatcherTerminate(
+){
+	EnterCriticalSection(&s_criticalSection);
+	s_terminateRequested = true;
+	LeaveCriticalSection(&s_criticalSection);
+	SetEvent(s_hWakeEvent);
+
+	if (WaitForSingleObject(s_hThread, INFINITE) != WAIT_OBJECT_0) return false;
+	if (CloseHandle(s_hThread) == FALSE) return false;
+	s_hThread = NULL;
+	if (CloseHandle(s_hWakeEvent) == FALSE) return false;
+	s_hWakeEvent = NULL;
+
+	/* 取り出されなかったイベントの破棄 */
+	for (FileWatcherEvent &event : s_events) {
+		if (event.content != NULL) free(event.content);
+	}
+	s_events.clear();
+	s_readRequests.clear();
+	s_watchedFileNames.clear();
+
+	DeleteCriticalSection(&s_criticalSection);
+	return true;
+}
@@ -0,0 +1,52 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include "common.h"
+#include <string>
+#include <vector>
+
+
+#ifndef _FILE_WATCHER_H_
+#define _FILE_WATCHER_H_
+
+
+/*
+	ファイル監視
+
+	バックグラウンドのスレッドで、監視対象ファイルのあるディレクトリを
+	ReadDirectoryChangesW で監視する。短時間に連続した書き込みは
+	FILE_WATCHER_DEBOUNCE_IN_MILLISECONDS の間まとめてから、1 回の変更として
+	扱う。変更されたファイルはスレッド側で読み込み、内容と共にイベントとして
+	キューに積む。メインスレッドは毎フレーム FileWatcherPopEvent でイベントを
+	取り出す。
+	ReadDirectoryChangesW で監視できないディレクトリのファイルは、スレッド側で
+	一定間隔ごとにタイムスタンプを確認する。
+*/
+
+struct FileWatcherEvent {
+	std::string fileName;	/* NormalizeFilePath で正規化されたパス */
+	char *content;			/* ファイルの内容（\0 終端、呼び出し側で free する）。読み込みに失敗したなら NULL */
+};
+
+/* 監視対象ファイルの設定（前回の設定から変化が無ければ何もしない）*/
+void FileWatcherSetWatchedFiles(
+	const std::vector<std::string> &fileNames
+);
+
+/* 変更の有無に関わらずファイルを読み込み、イベントとして通知する */
+void FileWatcherRequestRead(
+	const char *fileName
+);
+
+/* イベントの取り出し（イベントが無ければ false）*/
+bool FileWatcherPopEvent(
+	FileWatcherEvent *event
+);
+
+/* 初期化 */
+bool FileWatcherInitialize();
+
+/* 終了処理 */
+bool FileWatcherTerminate();
+
+
+#endif
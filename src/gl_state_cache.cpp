@@ -0,0 +1,314 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include <string.h>
+#include "common.h"
+#include "gl_state_cache.h"
+
+
+/* 状態が不明であることを示す値 */
+#define GL_STATE_CACHE_UNKNOWN					(0xFFFFFFFF)
+
+#define GL_STATE_CACHE_MAX_TEXTURE_UNITS		(32)
+#define GL_STATE_CACHE_MAX_BUFFER_INDICES		(16)
+
+/* キャッシュ対象のテクスチャターゲット */
+static const GLenum s_textureTargets[] = {
+	GL_TEXTURE_2D,
+	GL_TEXTURE_CUBE_MAP,
+	GL_TEXTURE_2D_ARRAY,
+	GL_TEXTURE_3D,
+};
+#define GL_STATE_CACHE_NUM_TEXTURE_TARGETS		SIZE_OF_ARRAY(s_textureTargets)
+
+/* キャッシュ対象のバッファターゲット（インデクス付きバインドは先頭 2 つのみ）*/
+static const GLenum s_bufferTargets[] = {
+	GL_UNIFORM_BUFFER,
+	GL_SHADER_STORAGE_BUFFER,
+	GL_ARRAY_BUFFER,
+	GL_PIXEL_PACK_BUFFER,
+	GL_PIXEL_UNPACK_BUFFER,
+};
+#define GL_STATE_CACHE_NUM_BUFFER_TARGETS		SIZE_OF_ARRAY(s_bufferTargets)
+#define GL_STATE_CACHE_NUM_INDEXED_BUFFER_TARGETS	(2)
+
+typedef struct {
+	GLuint buffer;
+	GLintptr offset;
+	GLsizeiptr size;	/* -1 = バッファ全体（glBindBufferBase）*/
+} IndexedBufferBinding;
+
+static struct {
+	GLuint activeTextureUnit;
+	GLuint textures[GL_STATE_CACHE_MAX_TEXTURE_UNITS][GL_STATE_CACHE_NUM_TEXTURE_TARGETS];
+	GLuint samplers[GL_STATE_CACHE_MAX_TEXTURE_UNITS];
+	GLuint program;
+	GLuint programPipeline;
+	GLuint buffers[GL_STATE_CACHE_NUM_BUFFER_TARGETS];
+	IndexedBufferBinding indexedBuffers[GL_STATE_CACHE_NUM_INDEXED_BUFFER_TARGETS][GL_STATE_CACHE_MAX_BUFFER_INDICES];
+	GLuint readFramebuffer;
+	GLuint drawFramebuffer;
+	bool viewportValid;
+	GLint viewport[4];
+} s_cache;
+static bool s_cacheInitialized = false;
+static GlStateCacheStatistics s_statistics = {0};
+
+
+static int FindTextureTarget(GLenum target){
+	for (int i = 0; i < (int)GL_STATE_CACHE_NUM_TEXTURE_TARGETS; ++i) {
+		if (s_textureTargets[i] == target) return i;
+	}
+	return -1;
+}
+
+static int FindBufferTarget(GLenum target){
+	for (int i = 0; i < (int)GL_STATE_CACHE_NUM_BUFFER_TARGETS; ++i) {
+		if (s_bufferTargets[i] == target) return i;
+	}
+	return -1;
+}
+
+static void InitializeIfRequired(){
+	if (s_cacheInitialized == false) {
+		GlStateCacheInvalidate();
+	}
+}
+
+/* 呼び出しを計上し、省略可能なら true を返す */
+static bool CountCall(bool redundant){
+	++s_statistics.numCalls;
+	if (redundant) ++s_statistics.numSkippedCalls;
+	return redundant;
+}
+
+void GlStateCacheInvalidate(){
+	/* GL_STATE_CACHE_UNKNOWN は全バイト 0xFF */
+	memset(&s_cache, 0xFF, sizeof(s_cache));
+	s_cache.viewportValid = false;
+	s_cacheInitialized = true;
+}
+
+void GlStateCacheActiveTexture(GLenum texture){
+	InitializeIfRequired();
+	GLuint unit = texture - GL_TEXTURE0;
+	if (CountCall(s_cache.activeTextureUnit == unit)) return;
+	glActiveTexture(texture);
+	s_cache.activeTextureUnit = unit;
+}
+
+void GlStateCacheBindTexture(GLenum target, GLuint texture){
+	InitializeIfRequired();
+	GLuint unit = s_cache.activeTextureUnit;
+	int targetIndex = FindTextureTarget(target);
+	if (unit >= GL_STATE_CACHE_MAX_TEXTURE_UNITS || targetIndex < 0) {
+		/* キャッシュ対象外 */
+		CountCall(false);
+		glBindTexture(target, texture);
+		return;
+	}
+	GLuint *cached = &s_cache.textures[unit][targetIndex];
+	if (CountCall(*cached == texture)) return;
+	glBindTexture(target, texture);
+	*cached = texture;
+}
+
+void GlStateCacheBindSampler(GLuint unit, GLuint sampler){
+	InitializeIfRequired();
+	if (unit >= GL_STATE_CACHE_MAX_TEXTURE_UNITS) {
+		CountCall(false);
+		glBindSampler(unit, sampler);
+		return;
+	}
+	if (CountCall(s_cache.samplers[unit] == sampler)) return;
+	glBindSampler(unit, sampler);
+	s_cache.samplers[unit] = sampler;
+}
+
+void GlStateCacheUseProgram(GLuint program){
+	InitializeIfRequired();
+	if (CountCall(s_cache.program == program)) return;
+	glUseProgram(program);
+	s_cache.program = program;
+}
+
+void GlStateCacheBindProgramPipeline(GLuint pipeline){
+	InitializeIfRequired();
+	if (CountCall(s_cache.programPipeline == pipeline)) return;
+	glBindProgramPipeline(pipeline);
+	s_cache.programPipeline = pipeline;
+}
+
+void GlStateCacheBindBuffer(GLenum target, GLuint buffer){
+	InitializeIfRequired();
+	int targetIndex = FindBufferTarget(target);
+	if (targetIndex < 0) {
+		CountCall(false);
+		glBindBuffer(target, buffer);
+		return;
+	}
+	if (CountCall(s_cache.buffers[targetIndex] == buffer)) return;
+	glBindBuffer(target, buffer);
+	s_cache.buffers[targetIndex] = buffer;
+}
+
+/* インデクス付きバインドの共通処理（汎用バインドポイントも同時に更新される）*/
+static bool BindIndexedBufferRequired(
+	GLenum target,
+	GLuint index,
+	GLuint buffer,
+	GLintptr offset,
+	GLsizeiptr size
+){
+	int targetIndex = FindBufferTarget(target);
+	if (targetIndex < 0
+	||	targetIndex >= GL_STATE_CACHE_NUM_INDEXED_BUFFER_TARGETS
+	||	index >= GL_STATE_CACHE_MAX_BUFFER_INDICES
+	) {
+		CountCall(false);
+		if (0 <= targetIndex) s_cache.buffers[targetIndex] = buffer;
+		return true;
+	}
+	IndexedBufferBinding *cached = &s_cache.indexedBuffers[targetIndex][index];
+	if (CountCall(
+			cached->buffer == buffer
+		&&	cached->offset == offset
+		&&	cached->size == size
+		&&	s_cache.buffers[targetIndex] == buffer
+	)) return false;
+	cached->buffer = buffer;
+	cached->offset = offset;
+	cached->size = size;
+	s_cache.buffers[targetIndex] = buffer;
+	return true;
+}
+
+void GlStateCacheBindBufferBase(GLenum target, GLuint index, GLuint buffer){
+	InitializeIfRequired();
+	if (BindIndexedBufferRequired(target, index, buffer, 0, -1)) {
+		glBindBufferBase(target, index, buffer);
+	}
+}
+
+void GlStateCacheBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size){
+	InitializeIfRequired();
+	if (BindIndexedBufferRequired(target, index, buffer, offset, size)) {
+		glBindBufferRange(target, index, buffer, offset, size);
+	}
+}
+
+void GlStateCacheBindFramebuffer(GLenum target, GLuint framebuffer){
+	InitializeIfRequired();
+	bool redundant;
+	switch (target) {
+		case GL_READ_FRAMEBUFFER: {
+			redundant = (s_cache.readFramebuffer == framebuffer);
+		} break;
+		case GL_DRAW_FRAMEBUFFER: {
+			redundant = (s_cache.drawFramebuffer == framebuffer);
+		} break;
+		default: {
+			redundant = (s_cache.readFramebuffer == framebuffer && s_cache.drawFramebuffer == framebuffer);
+		} break;
+	}
+	if (CountCall(redundant)) return;
+	glBindFramebuffer(target, framebuffer);
+	if (target != GL_DRAW_FRAMEBUFFER) s_cache.readFramebuffer = framebuffer;
+	if (target != GL_READ_FRAMEBUFFER) s_cache.drawFramebuffer = framebuffer;
+}
+
+void GlStateCacheViewport(GLint x, GLint y, GLsizei width, GLsizei height){
+	InitializeIfRequired();
+	if (CountCall(
+			s_cache.viewportValid
+		&&	s_cache.viewport[0] == x
+		&&	s_cache.viewport[1] == y
+		&&	s_cache.viewport[2] == width
+		&&	s_cache.viewport[3] == height
+	)) return;
+	glViewport(x, y, width, height);
+	s_cache.viewportValid = true;
+	s_cache.viewport[0] = x;
+	s_cache.viewport[1] = y;
+	s_cache.viewport[2] = width;
+	s_cache.viewport[3] = height;
+}
+
+/*
+	GL はバインド中のオブジェクトを削除すると、そのバインドを 0 に戻す。
+	キャッシュも同様に更新しないと、名前が再利用された際に必要なバインドを
+	誤って省略してしまう。
+*/
+void GlStateCacheDeleteTextures(GLsizei n, const GLuint *textures){
+	InitializeIfRequired();
+	for (int i = 0; i < n; ++i) {
+		if (textures[i] == 0) continue;
+		for (int unit = 0; unit < GL_STATE_CACHE_MAX_TEXTURE_UNITS; ++unit) {
+			for (int targetIndex = 0; targetIndex < (int)GL_STATE_CACHE_NUM_TEXTURE_TARGETS; ++targetIndex) {
+				if (s_cache.textures[unit][targetIndex] == textures[i]) {
+					s_cache.textures[unit][targetIndex] = 0;
+				}
+			}
+		}
+	}
+	glDeleteTextures(n, textures);
+}
+
+void GlStateCacheDeleteBuffers(GLsizei n, const GLuint *buffers){
+	InitializeIfRequired();
+	for (int i = 0; i < n; ++i) {
+		if (buffers[i] == 0) continue;
+		for (int targetIndex = 0; targetIndex < (int)GL_STATE_CACHE_NUM_BUFFER_TARGETS; ++targetIndex) {
+			if (s_cache.buffers[targetIndex] == buffers[i]) {
+				s_cache.buffers[targetIndex] = 0;
+			}
+		}
+		/* インデクス付きバインドの扱いは実装依存なので不明扱いにする */
+		for (int targetIndex = 0; targetIndex < GL_STATE_CACHE_NUM_INDEXED_BUFFER_TARGETS; ++targetIndex) {
+			for (int index = 0; index < GL_STATE_CACHE_MAX_BUFFER_INDICES; ++index) {
+				IndexedBufferBinding *cached = &s_cache.indexedBuffers[targetIndex][index];
+				if (cached->buffer == buffers[i]) {
+					cached->buffer = GL_STATE_CACHE_UNKNOWN;
+				}
+			}
+		}
+	}
+	glDeleteBuffers(n, buffers);
+}
+
+void GlStateCacheDeleteFramebuffers(GLsizei n, const GLuint *framebuffers){
+	InitializeIfRequired();
+	for (int i = 0; i < n; ++i) {
+		if (framebuffers[i] == 0) continue;
+		if (s_cache.readFramebuffer == framebuffers[i]) s_cache.readFramebuffer = 0;
+		if (s_cache.drawFramebuffer == framebuffers[i]) s_cache.drawFramebuffer = 0;
+	}
+	glDeleteFramebuffers(n, framebuffers);
+}
+
+void GlStateCacheDeleteProgramPipelines(GLsizei n, const GLuint *pipelines){
+	InitializeIfRequired();
+	for (int i = 0; i < n; ++i) {
+		if (pipelines[i] == 0) continue;
+		if (s_cache.programPipeline == pipelines[i]) s_cache.programPipeline = 0;
+	}
+	glDeleteProgramPipelines(n, pipelines);
+}
+
+void GlStateCacheDeleteSamplers(GLsizei n, const GLuint *samplers){
+	InitializeIfRequired();
+	for (int i = 0; i < n; ++i) {
+		if (samplers[i] == 0) continue;
+		for (int unit = 0; unit < GL_STATE_CACHE_MAX_TEXTURE_UNITS; ++unit) {
+			if (s_cache.samplers[unit] == samplers[i]) s_cache.samplers[unit] = 0;
+		}
+	}
+	glDeleteSamplers(n, samplers);
+}
+
+void GlStateCacheGetStatistics(GlStateCacheStatistics *statistics){
+	*statistics = s_statistics;
+}
+
+void GlStateCacheResetStatistics(){
+	memset(&s_statistics, 0, sizeof(s_statistics));
+}
@@ -0,0 +1,71 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include "common.h"
+
+
+#ifndef _GL_STATE_CACHE_H_
+#define _GL_STATE_CACHE_H_
+
+
+/*
+	GL ステートのシャドウ
+
+	バインド系の GL 呼び出しの直前の状態を保持し、状態を変化させない呼び出しを
+	省略する。キャッシュを経由しない GL 呼び出し（ImGui の描画など）でステートが
+	変化した可能性がある場合は、GlStateCacheInvalidate() で全状態を不明扱いに
+	戻すこと。
+*/
+
+struct GlStateCacheStatistics {
+	int numCalls;			/* キャッシュに要求された呼び出し数 */
+	int numSkippedCalls;	/* 状態が変化しないため省略した呼び出し数 */
+};
+
+/* キャッシュされた全状態を不明扱いにする */
+void GlStateCacheInvalidate();
+
+/* glActiveTexture */
+void GlStateCacheActiveTexture(GLenum texture);
+
+/* glBindTexture（アクティブなテクスチャユニットに対して）*/
+void GlStateCacheBindTexture(GLenum target, GLuint texture);
+
+/* glBindSampler */
+void GlStateCacheBindSampler(GLuint unit, GLuint sampler);
+
+/* glUseProgram */
+void GlStateCacheUseProgram(GLuint program);
+
+/* glBindProgramPipeline */
+void GlStateCacheBindProgramPipeline(GLuint pipeline);
+
+/* glBindBuffer */
+void GlStateCacheBindBuffer(GLenum target, GLuint buffer);
+
+/* glBindBufferBase */
+void GlStateCacheBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+/* glBindBufferRange */
+void GlStateCacheBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+/* glBindFramebuffer */
+void GlStateCacheBindFramebuffer(GLenum target, GLuint framebuffer);
+
+/* glViewport */
+void GlStateCacheViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+/* 削除されたオブジェクトのバインドを GL と同様に解除しつつ削除 */
+void GlStateCacheDeleteTextures(GLsizei n, const GLuint *textures);
+void GlStateCacheDeleteBuffers(GLsizei n, const GLuint *buffers);
+void GlStateCacheDeleteFramebuffers(GLsizei n, const GLuint *framebuffers);
+void GlStateCacheDeleteProgramPipelines(GLsizei n, const GLuint *pipelines);
+void GlStateCacheDeleteSamplers(GLsizei n, const GLuint *samplers);
+
+/* 統計情報の取得 */
+void GlStateCacheGetStatistics(GlStateCacheStatistics *statistics);
+
+/* 統計情報のリセット */
+void GlStateCacheResetStatistics();
+
+
+#endif
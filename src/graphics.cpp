@@ -1,5 +1,6 @@
 ﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
 
+#include <unordered_map>
 #include <math.h>
 #include <string.h>
 #include "common.h"
@@ -12,6 +13,8 @@
 #include "tiny_vmath.h"
 #include "dds_parser.h"
 #include "pipeline_description.h"
+#include "gl_state_cache.h"
+#include "profiler.h"
 
 
 #define USER_TEXTURE_START_INDEX				(8)
@@ -29,6 +32,23 @@ static GLuint s_vertexShaderId = 0;
 static GLuint s_fragmentShaderId = 0;
 static GLuint s_computeTextures[2 /* 裏表 */][NUM_RENDER_TARGETS] = {{0}};
 static GLuint s_computeShaderId = 0;
+
+/* (TextureFilter, TextureWrap, ミップマップ有無) の組み合わせ毎の immutable なサンプラ */
+#define NUM_TEXTURE_FILTERS						(2)
+#define NUM_TEXTURE_WRAPS						(3)
+static GLuint s_samplers[NUM_TEXTURE_FILTERS][NUM_TEXTURE_WRAPS][2 /* ミップマップ無効/有効 */] = {{{0}}};
+
+/*
+	テクスチャ毎の書き込みバージョン
+	パスが書き込む度に writeVersion を進め、ミップマップを参照するパスが読む時点で
+	mipmapVersion と異なる場合のみミップマップを再生成する。
+	未登録のテクスチャはミップマップ未生成として扱う。
+*/
+typedef struct {
+	uint32_t writeVersion = 1;
+	uint32_t mipmapVersion = 0;
+} TextureMipmapState;
+static std::unordered_map<GLuint, TextureMipmapState> s_textureMipmapStates;
 static GLint s_computeWorkGroupSize[3] = {1, 1, 1};
 static RenderSettings s_currentRenderSettings = {(PixelFormat)0};
 static int s_xReso = DEFAULT_SCREEN_XRESO;
@@ -37,21 +57,254 @@ static PipelineDescription s_pipelineDescription = {{0}};
 static bool s_pipelineHasCustomDescription = false;
 static int s_activePipelinePassIndex = -1;
 
+/*
+	Set when a pass fell back to the legacy path, which always renders at s_xReso x s_yReso.
+	Starts out set so that dynamic resolution stays at 1.0 until a frame has run on the compiled pipeline.
+*/
+static bool s_pipelineUsedLegacyFallback = true;
+
 typedef struct {
 	GLuint textureIds[PIPELINE_MAX_HISTORY_LENGTH];
 	int width;
 	int height;
 	PixelFormat pixelFormat;
 	int historyLength;
+	int numMipLevels;	/* > 1 only for resources written by a downsample pass */
 	bool initialized;
+	bool aliased;		/* textureIds[0] is borrowed from the transient texture pool */
+	int aliasSlot;
 } PipelineRuntimeResourceState;
 
 static PipelineRuntimeResourceState s_pipelineRuntimeResources[PIPELINE_MAX_RESOURCES] = {{0}};
 
+/*
+	Resources without history whose live ranges (first to last referencing
+	pass) do not overlap share physical textures from this pool.
+*/
+typedef struct {
+	int firstPassIndex;
+	int lastPassIndex;
+	bool transient;
+} PipelineResourceLifetime;
+
+typedef struct {
+	GLuint textureId;
+	int width;
+	int height;
+	PixelFormat pixelFormat;
+	int numMipLevels;
+} PipelineTransientTexture;
+
+static PipelineResourceLifetime s_pipelineResourceLifetimes[PIPELINE_MAX_RESOURCES] = {{0}};
+static PipelineTransientTexture s_pipelineTransientTextures[PIPELINE_MAX_RESOURCES] = {{0}};
+static int s_numPipelineTransientTextures = 0;
+
+/*
+	History slot assignments repeat with the least common multiple of the
+	history lengths, so plan commands are resolved once per phase of that
+	period.
+*/
+#define PIPELINE_PLAN_MAX_PHASES				(12)	/* lcm(1..PIPELINE_MAX_HISTORY_LENGTH) */
+
+/* Framebuffer objects are cached per attachment set to avoid per-pass object churn */
+#define PIPELINE_MAX_FRAMEBUFFER_CACHE_ENTRIES	(PIPELINE_MAX_PASSES * PIPELINE_PLAN_MAX_PHASES)
+
+typedef struct {
+	int resourceIndex;
+	int historySlot;
+	int mipLevel;
+} PipelineFramebufferAttachment;
+
+typedef struct {
+	PipelineFramebufferAttachment attachments[PIPELINE_MAX_BINDINGS_PER_PASS];
+	int numAttachments;
+	GLuint framebufferId;
+	bool complete;
+} PipelineFramebufferCacheEntry;
+
+static PipelineFramebufferCacheEntry s_pipelineFramebufferCache[PIPELINE_MAX_FRAMEBUFFER_CACHE_ENTRIES] = {{{{0}}}};
+static int s_numPipelineFramebufferCacheEntries = 0;
+
+typedef struct {
+	GLuint programId;
+	GLuint shaderPipelineId;
+	GLint workGroupSize[3];
+} PipelinePassProgramState;
+
+static PipelinePassProgramState s_pipelinePassPrograms[PIPELINE_MAX_PASSES] = {{0}};
+
+/*
+	Built-in programs of downsample passes, created on first use for every
+	(filter, pixel format) pair. r32ui is rejected when the description is
+	parsed, so only the three color formats are needed.
+*/
+#define NUM_DOWNSAMPLE_PIXEL_FORMATS			(3)
+#define DOWNSAMPLE_UNIFORM_LOCATION_SRC_LEVEL		(0)
+#define DOWNSAMPLE_UNIFORM_LOCATION_NUM_DST_LEVELS	(1)
+static GLuint s_pipelineDownsamplePrograms[PipelineDownsampleFilterCount][NUM_DOWNSAMPLE_PIXEL_FORMATS] = {{0}};
+
+/* Built-in programs of upsample passes; executed through the compute pass path */
+static GLuint s_pipelineUpsamplePrograms[PipelineUpsampleFilterCount][NUM_DOWNSAMPLE_PIXEL_FORMATS] = {{0}};
+
+/* Passes and resources that do not contribute to the present pass are culled */
+static PipelineReachability s_pipelineReachability = {{0}};
+
+/*
+	Command list compiled from the active description (units, barriers,
+	sampler state). The per-frame loop only walks this list.
+*/
+static PipelineExecutionPlan s_pipelineExecutionPlan = {{{0}}};
+
+/* Set when the description or the settings it depends on change; the plan is recompiled when the description is next resolved */
+static bool s_pipelineCompileDirty = true;
+
+/* GL objects of a plan command, resolved for every phase of the history period */
+typedef struct {
+	GLuint programId;
+	GLuint shaderPipelineId;
+	GLuint textureIds[PIPELINE_PLAN_MAX_PHASES][PIPELINE_PLAN_MAX_BINDINGS];
+	GLuint framebufferIds[PIPELINE_PLAN_MAX_PHASES];
+	int targetWidth;
+	int targetHeight;
+	GLuint numGroups[3];
+	bool valid;
+} PipelineResolvedCommand;
+
+/* Inputs of the resolve step; commands are re-resolved whenever any of them changes */
+typedef struct {
+	PipelineRuntimeResourceState resources[PIPELINE_MAX_RESOURCES];
+	PipelinePassProgramState passPrograms[PIPELINE_MAX_PASSES];
+	GLuint fragmentShaderId;
+	GLuint shaderPipelineId;
+	GLuint computeShaderId;
+	GLint computeWorkGroupSize[3];
+} PipelineResolveSnapshot;
+
+static PipelineResolvedCommand s_pipelineResolvedCommands[PIPELINE_MAX_PASSES] = {{0}};
+static PipelineResolveSnapshot s_pipelineResolveSnapshot = {{{0}}};
+static int s_pipelinePlanPeriod = 1;
+static bool s_pipelinePlanResolveDirty = true;
+
+/*
+	Per-frame parameters shared by every pass and the sound shader.
+	Must match the std140 layout of the following block:
+
+	layout(std140, binding = UNIFORM_BLOCK_BINDING_FRAME_PARAMS) uniform FrameParams {
+		mat4 cameraInWorld;
+		mat4 prevCameraInWorld;
+		vec2 resolution;
+		vec2 mouse;
+		ivec3 mouseButtons;
+		int waveOutPos;
+		int frameCount;
+		float time;
+		float tanFovY;
+	};
+
+	Pass specific values (pass index, per-pass resolution) stay as
+	layout(location) uniforms, as do the legacy uniforms for compatibility.
+*/
+typedef struct {
+	GLfloat mat4x4CameraInWorld[4][4];		/* offset 0 */
+	GLfloat mat4x4PrevCameraInWorld[4][4];	/* offset 64 */
+	GLfloat resolution[2];					/* offset 128 */
+	GLfloat mouse[2];						/* offset 136 */
+	GLint mouseButtons[3];					/* offset 144 */
+	GLint waveOutPos;						/* offset 156 */
+	GLint frameCount;						/* offset 160 */
+	GLfloat time;							/* offset 164 */
+	GLfloat tanFovY;						/* offset 168 */
+	GLint padding;							/* offset 172 */
+} FrameParamsBlock;
+
+/* Persistently mapped ring of frame parameter blocks guarded by fences */
+#define FRAME_PARAMS_RING_SIZE	(3)
+static struct {
+	GLuint buffer;
+	uint8_t *mappedPointer;
+	GLsizeiptr slotStride;
+	GLsync fences[FRAME_PARAMS_RING_SIZE];
+	int currentSlot;
+} s_frameParamsRing = {0};
+
+/*
+	連番画像キャプチャ用の読み出しリング
+	各スロットは永続マップしたピクセルパックバッファとフェンスを持ち、
+	描画結果は glReadPixels で非同期にスロットへ読み出される。
+*/
+static struct {
+	bool active;
+	int xReso;
+	int yReso;
+	GlPixelFormatInfo glPixelFormatInfo;
+	GLsizeiptr frameSizeInBytes;
+	int numSlots;
+	GLuint buffers[RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS];
+	const void *mappedPointers[RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS];
+	GLsync fences[RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS];
+} s_captureSequence = {0};
+
+/*
+	キャプチャ用のオフスクリーンレンダーターゲット
+	解像度とフォーマットが変わらない限り作り直さずに使い回す。
+	連番画像キャプチャ中はセッション終了まで保持し、それ以外では
+	キャプチャ 1 回ごとに解放する。
+*/
+static struct {
+	GLuint fbo;
+	GLuint texture;
+	int xReso;
+	int yReso;
+	GLenum internalformat;
+} s_captureRenderTarget = {0};
+
+/*
+	Dynamic resolution controller.
+	GPU time of the pipeline is measured with a ring of GL_TIME_ELAPSED
+	queries that are read back a few frames late, so measuring never stalls.
+	Framebuffer-relative resources are rendered at the current scale and the
+	present pass stretches the result over the window.
+*/
+#define DYNAMIC_RESOLUTION_QUERY_RING_SIZE		(4)
+#define DYNAMIC_RESOLUTION_SCALE_STEP			(0.05f)	/* scales are quantized to limit reallocations */
+#define DYNAMIC_RESOLUTION_DOWNSCALE_THRESHOLD	(1.10f)	/* shrink above target * threshold */
+#define DYNAMIC_RESOLUTION_UPSCALE_THRESHOLD	(0.80f)	/* grow below target * threshold */
+#define DYNAMIC_RESOLUTION_SETTLE_FRAMES		(DYNAMIC_RESOLUTION_QUERY_RING_SIZE + 8)
+static struct {
+	DynamicResolutionSettings settings;
+	GLuint queries[DYNAMIC_RESOLUTION_QUERY_RING_SIZE];
+	bool queryPending[DYNAMIC_RESOLUTION_QUERY_RING_SIZE];
+	int nextQuery;
+	float scale;
+	float filteredGpuTimeInMs;		/* 0 = no sample since the last scale change */
+	int numSamplesSinceChange;
+} s_dynamicResolution = {
+	/* DynamicResolutionSettings settings; */	{
+		false,
+		DEFAULT_DYNAMIC_RESOLUTION_TARGET_FRAME_TIME_IN_MILLISECONDS,
+		DEFAULT_DYNAMIC_RESOLUTION_MIN_SCALE
+	},
+	/* GLuint queries[]; */						{0},
+	/* bool queryPending[]; */					{false},
+	/* int nextQuery; */						0,
+	/* float scale; */							1.0f,
+	/* float filteredGpuTimeInMs; */			0.0f,
+	/* int numSamplesSinceChange; */			0,
+};
+
 static void GraphicsDispatchCompute(
 	const CurrentFrameParams *params,
 	const RenderSettings *settings
 );
+static void GraphicsCreateFrameParamsRing();
+static void GraphicsDeleteFrameParamsRing();
+static void GraphicsReleaseCaptureRenderTarget();
+static void GraphicsUploadFrameParams(
+	const CurrentFrameParams *params
+);
+static void GraphicsCreateDynamicResolutionQueries();
+static void GraphicsDeleteDynamicResolutionQueries();
+static void GraphicsResetDynamicResolution();
 static void GraphicsBuildLegacyPipelineDescription(
 	PipelineDescription *pipeline
 );
@@ -61,29 +314,69 @@ static void GraphicsExecutePipeline(
 	const CurrentFrameParams *params,
 	const RenderSettings *settings
 );
+static void GraphicsCompilePipelineDescription(
+	const PipelineDescription *pipeline
+);
+static void GraphicsDumpPipelineExecutionPlan(
+	const PipelineDescription *pipeline,
+	const PipelineExecutionPlan *plan
+);
+static void GraphicsCapturePipelineResolveSnapshot(
+	PipelineResolveSnapshot *snapshot
+);
+static void GraphicsResolvePipelineExecutionPlan(
+	const PipelineDescription *pipeline
+);
+static void GraphicsBuildPipelineResourceLifetimes(
+	const PipelineDescription *pipeline,
+	const PipelineReachability *reachability,
+	PipelineResourceLifetime *lifetimes
+);
 static void GraphicsResetPipelineRuntimeResources();
 static void GraphicsEnsurePipelineResources(
 	const PipelineDescription *pipeline,
 	const CurrentFrameParams *params
 );
-static GLuint GraphicsAcquirePipelineResourceTexture(
+static int GraphicsResolvePipelineResourceHistorySlot(
 	int resourceIndex,
 	int frameCount,
 	int historyOffset
 );
-static const PipelineResource *GraphicsGetPipelineResource(
-	const PipelineDescription *pipeline,
+static GLuint GraphicsAcquirePipelineFramebuffer(
+	const PipelineFramebufferAttachment *attachments,
+	int numAttachments
+);
+static void GraphicsInvalidatePipelineFramebuffers(
 	int resourceIndex
 );
 static PipelineRuntimeResourceState *GraphicsGetPipelineRuntimeResource(
 	int resourceIndex
 );
-static bool GraphicsParseLegacyResourceIndex(
-	const PipelineResource *resource,
-	const char *prefix,
-	int *outIndex
+static const PipelinePassProgramState *GraphicsGetPipelinePassProgram(
+	const PipelineDescription *pipeline,
+	const PipelinePass *pass
 );
-static void GraphicsSetTextureSampler(
+static void GraphicsDeleteTextures(
+	GLsizei n,
+	const GLuint *textures
+);
+static void GraphicsMarkTextureWritten(
+	GLuint textureId
+);
+static void GraphicsMarkTextureMipmapBuilt(
+	GLuint textureId
+);
+static bool GraphicsShaderSamplesMipmap(
+	GLuint programId,
+	GLuint unit
+);
+static void GraphicsUpdateMipmapIfStale(
+	GLuint textureId
+);
+static void GraphicsCreateSamplers();
+static void GraphicsDeleteSamplers();
+static void GraphicsBindTextureSampler(
+	GLuint unit,
 	GLenum target,
 	TextureFilter filter,
 	TextureWrap wrap,
@@ -107,155 +400,81 @@ static void GraphicsCreateComputeTextures(
 );
 static void GraphicsDeleteComputeTextures(void);
 static bool GraphicsExecuteComputePassPipeline(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
-	const CurrentFrameParams *params,
-	const RenderSettings *settings
+	const PipelinePlanCommand *command,
+	const PipelineResolvedCommand *resolved,
+	int phase,
+	const CurrentFrameParams *params
+);
+static GLuint GraphicsGetPipelineDownsampleProgram(
+	PipelineDownsampleFilter filter,
+	PixelFormat pixelFormat
+);
+static void GraphicsDeletePipelineDownsamplePrograms();
+static GLuint GraphicsGetPipelineUpsampleProgram(
+	PipelineUpsampleFilter filter,
+	PixelFormat pixelFormat
+);
+static void GraphicsDeletePipelineUpsamplePrograms();
+static bool GraphicsExecuteDownsamplePassPipeline(
+	const PipelinePlanCommand *command,
+	const PipelineResolvedCommand *resolved,
+	int phase
 );
 static bool GraphicsExecuteFragmentPassPipeline(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
+	const PipelinePlanCommand *command,
+	const PipelineResolvedCommand *resolved,
+	int phase,
 	const CurrentFrameParams *params,
 	const RenderSettings *settings
 ){
-	if (pipeline == NULL || pass == NULL || params == NULL || settings == NULL) {
-		return false;
-	}
-	if (s_fragmentShaderId == 0 || s_shaderPipelineId == 0) {
+	if (command == NULL || resolved == NULL || params == NULL || settings == NULL) {
 		return false;
 	}
-
-	GLuint framebuffer = 0;
-	GLenum drawBuffers[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numColorAttachments = 0;
-	int targetWidth = params->xReso;
-	int targetHeight = params->yReso;
-
-	/* Collect outputs */
-	for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
-		const PipelineResourceBinding *binding = &pass->outputs[outputIndex];
-		if (binding->access != PipelineResourceAccessColorAttachment) {
-			continue;
-		}
-		const PipelineResource *resource = GraphicsGetPipelineResource(pipeline, binding->resourceIndex);
-		PipelineRuntimeResourceState *runtimeState = GraphicsGetPipelineRuntimeResource(binding->resourceIndex);
-		if (resource == NULL || runtimeState == NULL || runtimeState->initialized == false) {
-			return false;
-		}
-		GLuint textureId = GraphicsAcquirePipelineResourceTexture(
-			binding->resourceIndex,
-			params->frameCount,
-			binding->historyOffset
-		);
-		if (textureId == 0) {
-			return false;
-		}
-		if (numColorAttachments == 0) {
-			targetWidth = runtimeState->width;
-			targetHeight = runtimeState->height;
-		}
-		if (framebuffer == 0) {
-			glGenFramebuffers(1, &framebuffer);
-			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-		}
-		GLenum attachment = GL_COLOR_ATTACHMENT0 + numColorAttachments;
-		glFramebufferTexture2D(
-			GL_FRAMEBUFFER,
-			attachment,
-			GL_TEXTURE_2D,
-			textureId,
-			0
-		);
-		drawBuffers[numColorAttachments] = attachment;
-		++numColorAttachments;
-	}
-
-	if (numColorAttachments == 0) {
-		/* No color targets -> fall back */
-		if (framebuffer != 0) {
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glDeleteFramebuffers(1, &framebuffer);
-		}
+	if (resolved->valid == false || resolved->framebufferIds[phase] == 0) {
 		return false;
 	}
+	int targetWidth = resolved->targetWidth;
+	int targetHeight = resolved->targetHeight;
 
-	glDrawBuffers(numColorAttachments, drawBuffers);
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glDeleteFramebuffers(1, &framebuffer);
-		return false;
-	}
+	GlStateCacheBindFramebuffer(GL_FRAMEBUFFER, resolved->framebufferIds[phase]);
 
-	glViewport(0, 0, targetWidth, targetHeight);
+	GlStateCacheViewport(0, 0, targetWidth, targetHeight);
 
-	if (pass->clear.enableColorClear) {
+	if (command->clear.enableColorClear) {
 		glClearColor(
-			pass->clear.clearColor[0],
-			pass->clear.clearColor[1],
-			pass->clear.clearColor[2],
-			pass->clear.clearColor[3]
+			command->clear.clearColor[0],
+			command->clear.clearColor[1],
+			command->clear.clearColor[2],
+			command->clear.clearColor[3]
 		);
 		glClear(GL_COLOR_BUFFER_BIT);
 	}
 
 	/* Bind shader pipeline */
-	glBindProgramPipeline(s_shaderPipelineId);
-
-	/* Bind sampled inputs */
-	GLuint samplerBaseUnit = 0;
-	GLuint boundSamplerUnits[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numBoundSamplerUnits = 0;
-	for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
-		const PipelineResourceBinding *binding = &pass->inputs[inputIndex];
-		const PipelineResource *resource = GraphicsGetPipelineResource(pipeline, binding->resourceIndex);
-		PipelineRuntimeResourceState *runtimeState = GraphicsGetPipelineRuntimeResource(binding->resourceIndex);
-		if (resource == NULL || runtimeState == NULL || runtimeState->initialized == false) {
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glDeleteFramebuffers(1, &framebuffer);
-			glBindProgramPipeline(0);
-			return false;
-		}
-		GLuint textureId = GraphicsAcquirePipelineResourceTexture(
-			binding->resourceIndex,
-			params->frameCount,
-			binding->historyOffset
+	GlStateCacheBindProgramPipeline(resolved->shaderPipelineId);
+
+	/* Bind sampled inputs (units were assigned when the plan was compiled) */
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind != PipelinePlanBindingKindTexture) {
+			continue;
+		}
+		GLuint textureId = resolved->textureIds[phase][bindingIndex];
+		bool useMipmap =
+				binding->enableMipmap
+			&&	GraphicsShaderSamplesMipmap(resolved->programId, binding->unit);
+		GlStateCacheActiveTexture(GL_TEXTURE0 + binding->unit);
+		GlStateCacheBindTexture(GL_TEXTURE_2D, textureId);
+		GraphicsBindTextureSampler(
+			binding->unit,
+			GL_TEXTURE_2D,
+			binding->textureFilter,
+			binding->textureWrap,
+			useMipmap
 		);
-		if (textureId == 0) {
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glDeleteFramebuffers(1, &framebuffer);
-			glBindProgramPipeline(0);
-			return false;
-		}
-
-		switch (binding->access) {
-			case PipelineResourceAccessSampled:
-			case PipelineResourceAccessHistoryRead: {
-				int legacyIndex = 0;
-				GLuint samplerUnit = samplerBaseUnit + numBoundSamplerUnits;
-				bool enableMipmap = settings->enableMipmapGeneration;
-				if (GraphicsParseLegacyResourceIndex(resource, "legacy_mrt", &legacyIndex)) {
-					samplerUnit = (GLuint)legacyIndex;
-					enableMipmap = settings->enableMipmapGeneration;
-				} else if (GraphicsParseLegacyResourceIndex(resource, "legacy_compute", &legacyIndex)) {
-					samplerUnit = COMPUTE_TEXTURE_START_INDEX + (GLuint)legacyIndex;
-					enableMipmap = false;
-				}
-				glActiveTexture(GL_TEXTURE0 + samplerUnit);
-				glBindTexture(GL_TEXTURE_2D, textureId);
-				GraphicsSetTextureSampler(
-					GL_TEXTURE_2D,
-					resource->textureFilter,
-					resource->textureWrap,
-					enableMipmap
-				);
-				if (enableMipmap) {
-					glGenerateMipmap(GL_TEXTURE_2D);
-				}
-				boundSamplerUnits[numBoundSamplerUnits++] = samplerUnit;
-			} break;
-			default: {
-				/* Unsupported binding type for fragment pass */
-			} break;
+		if (useMipmap && binding->mipmapPrebuilt == false) {
+			/* Several passes may sample the same texture; rebuild only after a write */
+			GraphicsUpdateMipmapIfStale(textureId);
 		}
 	}
 
@@ -263,12 +482,13 @@ static bool GraphicsExecuteFragmentPassPipeline(
 	for (int userTextureIndex = 0; userTextureIndex < NUM_USER_TEXTURES; userTextureIndex++) {
 		if (s_userTextures[userTextureIndex].id) {
 			GLuint unit = USER_TEXTURE_START_INDEX + userTextureIndex;
-			glActiveTexture(GL_TEXTURE0 + unit);
-			glBindTexture(
+			GlStateCacheActiveTexture(GL_TEXTURE0 + unit);
+			GlStateCacheBindTexture(
 				s_userTextures[userTextureIndex].target,
 				s_userTextures[userTextureIndex].id
 			);
-			GraphicsSetTextureSampler(
+			GraphicsBindTextureSampler(
+				unit,
 				s_userTextures[userTextureIndex].target,
 				settings->textureFilter,
 				settings->textureWrap,
@@ -278,41 +498,44 @@ static bool GraphicsExecuteFragmentPassPipeline(
 	}
 
 	/* Bind sound SSBO */
-	glBindBufferBase(
+	GlStateCacheBindBufferBase(
 		GL_SHADER_STORAGE_BUFFER,
 		BUFFER_INDEX_FOR_SOUND_VISUALIZER_INPUT,
 		SoundGetOutputSsbo()
 	);
 
 	/* Upload uniforms */
-	glUseProgram(s_fragmentShaderId);
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
+	GLuint programId = resolved->programId;
+	const ShaderReflection *reflection = GetShaderReflection(programId);
+	GlStateCacheUseProgram(programId);
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
 		glUniform1i(UNIFORM_LOCATION_PIPELINE_PASS_INDEX, s_activePipelinePassIndex);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
 		glUniform1i(UNIFORM_LOCATION_WAVE_OUT_POS, params->waveOutPos);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
 		glUniform1i(UNIFORM_LOCATION_FRAME_COUNT, params->frameCount);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
 		glUniform1f(UNIFORM_LOCATION_TIME, params->time);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
 		glUniform2f(
 			UNIFORM_LOCATION_RESO,
 			(GLfloat)targetWidth,
 			(GLfloat)targetHeight
 		);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
 		glUniform2f(
 			UNIFORM_LOCATION_MOUSE_POS,
-			(GLfloat)params->xMouse / (GLfloat)targetWidth,
-			1.0f - (GLfloat)params->yMouse / (GLfloat)targetHeight
+			/* Mouse position is relative to the framebuffer, also for scaled targets */
+			(GLfloat)params->xMouse / (GLfloat)params->xReso,
+			1.0f - (GLfloat)params->yMouse / (GLfloat)params->yReso
 		);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
 		glUniform3i(
 			UNIFORM_LOCATION_MOUSE_BUTTONS,
 			params->mouseLButtonPressed,
@@ -320,10 +543,10 @@ static bool GraphicsExecuteFragmentPassPipeline(
 			params->mouseRButtonPressed
 		);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
 		glUniform1f(UNIFORM_LOCATION_TAN_FOVY, tanf(params->fovYInRadians));
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
 		glUniformMatrix4fv(
 			UNIFORM_LOCATION_CAMERA_COORD,
 			1,
@@ -331,7 +554,7 @@ static bool GraphicsExecuteFragmentPassPipeline(
 			&params->mat4x4CameraInWorld[0][0]
 		);
 	}
-	if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
 		glUniformMatrix4fv(
 			UNIFORM_LOCATION_PREV_CAMERA_COORD,
 			1,
@@ -351,14 +574,15 @@ static bool GraphicsExecuteFragmentPassPipeline(
 	glEnableVertexAttribArray(0);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
-	glMemoryBarrier(
-			GL_TEXTURE_FETCH_BARRIER_BIT
-		|	GL_FRAMEBUFFER_BARRIER_BIT
-	);
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		if (command->bindings[bindingIndex].kind == PipelinePlanBindingKindColorAttachment) {
+			GraphicsMarkTextureWritten(resolved->textureIds[phase][bindingIndex]);
+		}
+	}
 
 	/* Cleanup */
 	glDisableVertexAttribArray(0);
-	glBindBufferBase(
+	GlStateCacheBindBufferBase(
 		GL_SHADER_STORAGE_BUFFER,
 		BUFFER_INDEX_FOR_SOUND_VISUALIZER_INPUT,
 		0
@@ -367,90 +591,58 @@ static bool GraphicsExecuteFragmentPassPipeline(
 	for (int userTextureIndex = 0; userTextureIndex < NUM_USER_TEXTURES; userTextureIndex++) {
 		if (s_userTextures[userTextureIndex].id) {
 			GLuint unit = USER_TEXTURE_START_INDEX + userTextureIndex;
-			glActiveTexture(GL_TEXTURE0 + unit);
-			glBindTexture(s_userTextures[userTextureIndex].target, 0);
+			GlStateCacheActiveTexture(GL_TEXTURE0 + unit);
+			GlStateCacheBindTexture(s_userTextures[userTextureIndex].target, 0);
 		}
 	}
 
-	for (int samplerIndex = 0; samplerIndex < numBoundSamplerUnits; ++samplerIndex) {
-		GLuint unit = boundSamplerUnits[samplerIndex];
-		glActiveTexture(GL_TEXTURE0 + unit);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind != PipelinePlanBindingKindTexture) {
+			continue;
+		}
+		GlStateCacheActiveTexture(GL_TEXTURE0 + binding->unit);
+		GlStateCacheBindTexture(GL_TEXTURE_2D, 0);
 	}
-	glActiveTexture(GL_TEXTURE0);
+	GlStateCacheActiveTexture(GL_TEXTURE0);
 
-	glBindProgramPipeline(0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glDeleteFramebuffers(1, &framebuffer);
-	glViewport(0, 0, params->xReso, params->yReso);
+	GlStateCacheBindProgramPipeline(0);
+	GlStateCacheBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GlStateCacheViewport(0, 0, params->xReso, params->yReso);
 
 	return true;
 }
 
 static bool GraphicsExecutePresentPassPipeline(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
-	const CurrentFrameParams *params,
-	const RenderSettings *settings
+	const PipelinePlanCommand *command,
+	const PipelineResolvedCommand *resolved,
+	int phase,
+	const CurrentFrameParams *params
 ){
-	(void)settings;
-
-	if (pipeline == NULL || pass == NULL || params == NULL) {
+	if (command == NULL || resolved == NULL || params == NULL) {
 		return false;
 	}
-
-	if (pass->numInputs <= 0) {
+	GLuint readFbo = resolved->framebufferIds[phase];
+	if (resolved->valid == false || readFbo == 0) {
 		return false;
 	}
 
-	const PipelineResourceBinding *binding = &pass->inputs[0];
-	const PipelineResource *resource = GraphicsGetPipelineResource(pipeline, binding->resourceIndex);
-	PipelineRuntimeResourceState *runtimeState = GraphicsGetPipelineRuntimeResource(binding->resourceIndex);
-	if (resource == NULL || runtimeState == NULL || runtimeState->initialized == false) {
-		return false;
-	}
-	GLuint textureId = GraphicsAcquirePipelineResourceTexture(
-		binding->resourceIndex,
-		params->frameCount,
-		binding->historyOffset
-	);
-	if (textureId == 0) {
-		return false;
-	}
-
-	int width = runtimeState->width > 0 ? runtimeState->width : params->xReso;
-	int height = runtimeState->height > 0 ? runtimeState->height : params->yReso;
-	if (width <= 0) width = params->xReso;
-	if (height <= 0) height = params->yReso;
+	int width = resolved->targetWidth > 0 ? resolved->targetWidth : params->xReso;
+	int height = resolved->targetHeight > 0 ? resolved->targetHeight : params->yReso;
 
-	GLuint readFbo = 0;
-	glGenFramebuffers(1, &readFbo);
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
-	glFramebufferTexture2D(
-		GL_READ_FRAMEBUFFER,
-		GL_COLOR_ATTACHMENT0,
-		GL_TEXTURE_2D,
-		textureId,
-		0
-	);
-
-	if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-		glDeleteFramebuffers(1, &readFbo);
-		return false;
-	}
-
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	/* params may be scaled by the dynamic resolution controller; the window keeps s_xReso x s_yReso */
+	bool stretch = (width != s_xReso || height != s_yReso);
+	GlStateCacheBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+	GlStateCacheBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 	glBlitFramebuffer(
 		0, 0, width, height,
-		0, 0, params->xReso, params->yReso,
+		0, 0, s_xReso, s_yReso,
 		GL_COLOR_BUFFER_BIT,
-		GL_NEAREST
+		stretch? GL_LINEAR: GL_NEAREST
 	);
 
-	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-	glDeleteFramebuffers(1, &readFbo);
-	glViewport(0, 0, params->xReso, params->yReso);
+	GlStateCacheBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	GlStateCacheViewport(0, 0, s_xReso, s_yReso);
 
 	return true;
 }
@@ -607,18 +799,267 @@ static void GraphicsBuildLegacyPipelineDescription(
 }
 
 static const PipelineDescription *GraphicsResolvePipelineDescription(){
-	if (s_pipelineHasCustomDescription) {
-		if (s_pipelineDescription.numPasses == 0) {
-			s_pipelineHasCustomDescription = false;
+	if (s_pipelineHasCustomDescription && s_pipelineDescription.numPasses == 0) {
+		s_pipelineHasCustomDescription = false;
+		s_pipelineCompileDirty = true;
+	}
+
+	if (s_pipelineCompileDirty) {
+		/* The legacy description only depends on the render settings and the compute shader */
+		if (s_pipelineHasCustomDescription == false) {
 			GraphicsBuildLegacyPipelineDescription(&s_pipelineDescription);
 		}
-		return &s_pipelineDescription;
+		GraphicsCompilePipelineDescription(&s_pipelineDescription);
 	}
-
-	GraphicsBuildLegacyPipelineDescription(&s_pipelineDescription);
 	return &s_pipelineDescription;
 }
 
+static void GraphicsCompilePipelineDescription(
+	const PipelineDescription *pipeline
+){
+	PipelineReachability reachability;
+	PipelineDescriptionAnalyzeReachability(pipeline, &reachability);
+	if (memcmp(&reachability, &s_pipelineReachability, sizeof(reachability)) != 0) {
+		s_pipelineReachability = reachability;
+		for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+			if (reachability.passReachable[passIndex] == false) {
+				printf("[Pipeline] pass '%s' is culled (not reachable from the present pass).\n", pipeline->passes[passIndex].name);
+			}
+		}
+		for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
+			if (reachability.resourceReachable[resourceIndex] == false) {
+				printf("[Pipeline] resource '%s' is culled (not referenced by live passes).\n", pipeline->resources[resourceIndex].id);
+			}
+		}
+	}
+
+	static PipelineExecutionPlan s_compiledPlan;
+	PipelineDescriptionCompileExecutionPlan(
+		pipeline,
+		&s_pipelineReachability,
+		s_currentRenderSettings.enableMipmapGeneration,
+		&s_compiledPlan
+	);
+	if (memcmp(&s_compiledPlan, &s_pipelineExecutionPlan, sizeof(PipelineExecutionPlan)) != 0) {
+		memcpy(&s_pipelineExecutionPlan, &s_compiledPlan, sizeof(PipelineExecutionPlan));
+		GraphicsDumpPipelineExecutionPlan(pipeline, &s_pipelineExecutionPlan);
+	}
+
+	GraphicsBuildPipelineResourceLifetimes(pipeline, &s_pipelineReachability, s_pipelineResourceLifetimes);
+
+	s_pipelineCompileDirty = false;
+	s_pipelinePlanResolveDirty = true;
+}
+
+static void GraphicsDumpPipelineExecutionPlan(
+	const PipelineDescription *pipeline,
+	const PipelineExecutionPlan *plan
+){
+	static const struct {
+		GLbitfield bit;
+		const char *name;
+	} s_barrierBitNames[] = {
+		{GL_SHADER_IMAGE_ACCESS_BARRIER_BIT,	"SHADER_IMAGE_ACCESS"},
+		{GL_TEXTURE_FETCH_BARRIER_BIT,			"TEXTURE_FETCH"},
+		{GL_TEXTURE_UPDATE_BARRIER_BIT,			"TEXTURE_UPDATE"},
+		{GL_FRAMEBUFFER_BARRIER_BIT,			"FRAMEBUFFER"},
+	};
+
+	printf("[Pipeline] execution plan (%d commands)\n", plan->numCommands);
+	for (int commandIndex = 0; commandIndex < plan->numCommands; ++commandIndex) {
+		const PipelinePlanCommand *command = &plan->commands[commandIndex];
+		char bitsString[128] = "none";
+		size_t length = 0;
+		for (int bitIndex = 0; bitIndex < (int)SIZE_OF_ARRAY(s_barrierBitNames); ++bitIndex) {
+			if ((command->barrierBits & s_barrierBitNames[bitIndex].bit) == 0) continue;
+			length += _snprintf_s(
+				bitsString + length,
+				sizeof(bitsString) - length,
+				_TRUNCATE,
+				"%s%s",
+				(length == 0)? "": " | ",
+				s_barrierBitNames[bitIndex].name
+			);
+		}
+		printf(
+			"  #%d %-24s : barrier %s%s\n",
+			commandIndex,
+			pipeline->passes[command->passIndex].name,
+			bitsString,
+			command->executable? "": " (fallback)"
+		);
+		for (int writerIndex = 0; writerIndex < plan->numCommands; ++writerIndex) {
+			if ((command->previousFrameWriterMask & (1u << writerIndex)) == 0) continue;
+			printf(
+				"      after previous frame of #%d %s\n",
+				writerIndex,
+				pipeline->passes[plan->commands[writerIndex].passIndex].name
+			);
+		}
+		for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+			const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+			printf(
+				"      %-16s %-24s unit %d history %d\n",
+				PipelinePlanBindingKindToString(binding->kind),
+				pipeline->resources[binding->resourceIndex].id,
+				binding->unit,
+				binding->historyOffset
+			);
+		}
+	}
+}
+
+static void GraphicsCapturePipelineResolveSnapshot(
+	PipelineResolveSnapshot *snapshot
+){
+	memset(snapshot, 0, sizeof(PipelineResolveSnapshot));
+	memcpy(snapshot->resources, s_pipelineRuntimeResources, sizeof(snapshot->resources));
+	memcpy(snapshot->passPrograms, s_pipelinePassPrograms, sizeof(snapshot->passPrograms));
+	snapshot->fragmentShaderId = s_fragmentShaderId;
+	snapshot->shaderPipelineId = s_shaderPipelineId;
+	snapshot->computeShaderId = s_computeShaderId;
+	memcpy(snapshot->computeWorkGroupSize, s_computeWorkGroupSize, sizeof(snapshot->computeWorkGroupSize));
+}
+
+static void GraphicsResolvePipelineExecutionPlan(
+	const PipelineDescription *pipeline
+){
+	/* Framebuffers are re-acquired below for every command and phase */
+	GraphicsInvalidatePipelineFramebuffers(-1);
+
+	int period = 1;
+	for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
+		const PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
+		if (state->initialized == false || state->historyLength <= 1) continue;
+		int a = period;
+		int b = state->historyLength;
+		while (b != 0) {
+			int t = a % b;
+			a = b;
+			b = t;
+		}
+		period = period / a * state->historyLength;
+	}
+	assert(period <= PIPELINE_PLAN_MAX_PHASES);
+	s_pipelinePlanPeriod = period;
+
+	const PipelineExecutionPlan *plan = &s_pipelineExecutionPlan;
+	for (int commandIndex = 0; commandIndex < plan->numCommands; ++commandIndex) {
+		const PipelinePlanCommand *command = &plan->commands[commandIndex];
+		const PipelinePass *pass = &pipeline->passes[command->passIndex];
+		PipelineResolvedCommand *resolved = &s_pipelineResolvedCommands[commandIndex];
+		memset(resolved, 0, sizeof(PipelineResolvedCommand));
+		if (command->executable == false) {
+			continue;
+		}
+		bool valid = true;
+
+		/* Per-pass program takes precedence over the global shaders */
+		const PipelinePassProgramState *passProgram = GraphicsGetPipelinePassProgram(pipeline, pass);
+		GLint programWorkGroupSize[3] = {1, 1, 1};
+		switch (command->type) {
+			case PipelinePassTypeFragment: {
+				resolved->programId = (passProgram != NULL)? passProgram->programId: s_fragmentShaderId;
+				resolved->shaderPipelineId = (passProgram != NULL)? passProgram->shaderPipelineId: s_shaderPipelineId;
+				valid = (resolved->programId != 0 && resolved->shaderPipelineId != 0);
+			} break;
+			case PipelinePassTypeCompute: {
+				resolved->programId = (passProgram != NULL)? passProgram->programId: s_computeShaderId;
+				memcpy(
+					programWorkGroupSize,
+					(passProgram != NULL)? passProgram->workGroupSize: s_computeWorkGroupSize,
+					sizeof(programWorkGroupSize)
+				);
+				valid = (resolved->programId != 0);
+			} break;
+			case PipelinePassTypeDownsample: {
+				resolved->programId = GraphicsGetPipelineDownsampleProgram(
+					command->downsampleFilter,
+					pipeline->resources[command->targetResourceIndex].pixelFormat
+				);
+				valid = (resolved->programId != 0);
+			} break;
+			case PipelinePassTypeUpsample: {
+				resolved->programId = GraphicsGetPipelineUpsampleProgram(
+					pass->upsampleFilter,
+					pipeline->resources[command->targetResourceIndex].pixelFormat
+				);
+				programWorkGroupSize[0] = PIPELINE_UPSAMPLE_TILE_SIZE;
+				programWorkGroupSize[1] = PIPELINE_UPSAMPLE_TILE_SIZE;
+				valid = (resolved->programId != 0);
+			} break;
+			default: {
+			} break;
+		}
+
+		/* Viewport and dispatch size follow the target resource */
+		const PipelineRuntimeResourceState *targetState = GraphicsGetPipelineRuntimeResource(command->targetResourceIndex);
+		if (targetState == NULL || targetState->initialized == false) {
+			valid = false;
+		} else {
+			resolved->targetWidth = targetState->width;
+			resolved->targetHeight = targetState->height;
+		}
+		if (command->type == PipelinePassTypeCompute
+		||	command->type == PipelinePassTypeUpsample
+		) {
+			GLuint workGroupSize[3];
+			for (int axis = 0; axis < 3; ++axis) {
+				workGroupSize[axis] = (GLuint)(programWorkGroupSize[axis] > 0? programWorkGroupSize[axis]: 1);
+				if (command->overrideWorkGroupSize && command->workGroupSize[axis] > 0) {
+					workGroupSize[axis] = command->workGroupSize[axis];
+				}
+			}
+			GLuint extents[3] = {(GLuint)resolved->targetWidth, (GLuint)resolved->targetHeight, 1};
+			for (int axis = 0; axis < 3; ++axis) {
+				resolved->numGroups[axis] = (extents[axis] + workGroupSize[axis] - 1) / workGroupSize[axis];
+				if (resolved->numGroups[axis] == 0) resolved->numGroups[axis] = 1;
+			}
+		}
+
+		for (int phase = 0; phase < period && valid; ++phase) {
+			PipelineFramebufferAttachment attachments[PIPELINE_MAX_BINDINGS_PER_PASS] = {{0}};
+			int numAttachments = 0;
+			for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+				const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+				const PipelineRuntimeResourceState *state = GraphicsGetPipelineRuntimeResource(binding->resourceIndex);
+				int historySlot = GraphicsResolvePipelineResourceHistorySlot(
+					binding->resourceIndex,
+					phase,
+					binding->historyOffset
+				);
+				if (state == NULL || historySlot < 0 || state->textureIds[historySlot] == 0) {
+					valid = false;
+					break;
+				}
+				if (binding->kind == PipelinePlanBindingKindImage && binding->imageFormat == 0) {
+					valid = false;
+					break;
+				}
+				resolved->textureIds[phase][bindingIndex] = state->textureIds[historySlot];
+				if (binding->kind == PipelinePlanBindingKindColorAttachment
+				||	binding->kind == PipelinePlanBindingKindBlitSource
+				) {
+					if (numAttachments >= PIPELINE_MAX_BINDINGS_PER_PASS) {
+						valid = false;
+						break;
+					}
+					attachments[numAttachments].resourceIndex = binding->resourceIndex;
+					attachments[numAttachments].historySlot = historySlot;
+					attachments[numAttachments].mipLevel = 0;
+					++numAttachments;
+				}
+			}
+			if (valid && numAttachments > 0) {
+				resolved->framebufferIds[phase] = GraphicsAcquirePipelineFramebuffer(attachments, numAttachments);
+				valid = (resolved->framebufferIds[phase] != 0);
+			}
+		}
+		resolved->valid = valid;
+	}
+	s_pipelinePlanResolveDirty = false;
+}
+
 static void GraphicsExecutePipeline(
 	const PipelineDescription *pipeline,
 	const CurrentFrameParams *params,
@@ -630,53 +1071,217 @@ static void GraphicsExecutePipeline(
 
 	GraphicsEnsurePipelineResources(pipeline, params);
 
-	for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
-		const PipelinePass *pass = &pipeline->passes[passIndex];
-		s_activePipelinePassIndex = passIndex;
-		switch (pass->type) {
+	/* Re-resolve GL objects only when resources or programs were recreated */
+	PipelineResolveSnapshot snapshot;
+	GraphicsCapturePipelineResolveSnapshot(&snapshot);
+	if (s_pipelinePlanResolveDirty
+	||	memcmp(&snapshot, &s_pipelineResolveSnapshot, sizeof(PipelineResolveSnapshot)) != 0
+	) {
+		GraphicsResolvePipelineExecutionPlan(pipeline);
+		memcpy(&s_pipelineResolveSnapshot, &snapshot, sizeof(PipelineResolveSnapshot));
+	}
+	int phase = params->frameCount % s_pipelinePlanPeriod;
+	if (phase < 0) {
+		phase += s_pipelinePlanPeriod;
+	}
+
+	s_pipelineUsedLegacyFallback = false;
+	const PipelineExecutionPlan *plan = &s_pipelineExecutionPlan;
+	for (int commandIndex = 0; commandIndex < plan->numCommands; ++commandIndex) {
+		const PipelinePlanCommand *command = &plan->commands[commandIndex];
+		const PipelineResolvedCommand *resolved = &s_pipelineResolvedCommands[commandIndex];
+		s_activePipelinePassIndex = command->passIndex;
+		ProfilerGpuBegin(pipeline->passes[command->passIndex].name);
+		if (command->barrierBits != 0) {
+			glMemoryBarrier(command->barrierBits);
+		}
+		switch (command->type) {
 			case PipelinePassTypeCompute: {
-				if (!GraphicsExecuteComputePassPipeline(pipeline, pass, params, settings)) {
+				if (!GraphicsExecuteComputePassPipeline(command, resolved, phase, params)) {
+					s_pipelineUsedLegacyFallback = true;
+					ProfilerGpuBegin("(legacy compute)");
 					GraphicsDispatchCompute(params, settings);
+					ProfilerGpuEnd();
 				}
 			} break;
 			case PipelinePassTypeFragment: {
-				if (!GraphicsExecuteFragmentPassPipeline(pipeline, pass, params, settings)) {
+				if (!GraphicsExecuteFragmentPassPipeline(command, resolved, phase, params, settings)) {
+					s_pipelineUsedLegacyFallback = true;
+					ProfilerGpuBegin("(legacy fullscreen quad)");
 					GraphicsDrawFullScreenQuad(
 						0,
 						params,
 						settings
 					);
+					ProfilerGpuEnd();
 				}
 			} break;
+			case PipelinePassTypeDownsample: {
+				/* No shared shader to fall back to; a failed downsample is skipped */
+				GraphicsExecuteDownsamplePassPipeline(command, resolved, phase);
+			} break;
+			case PipelinePassTypeUpsample: {
+				/* Same as downsample; a failed upsample is skipped */
+				GraphicsExecuteComputePassPipeline(command, resolved, phase, params);
+			} break;
 			case PipelinePassTypePresent: {
-				if (!GraphicsExecutePresentPassPipeline(pipeline, pass, params, settings)) {
+				if (!GraphicsExecutePresentPassPipeline(command, resolved, phase, params)) {
 					/* Present fallback: draw fullscreen quad to default framebuffer */
+					s_pipelineUsedLegacyFallback = true;
+					ProfilerGpuBegin("(legacy fullscreen quad)");
 					GraphicsDrawFullScreenQuad(
 						0,
 						params,
 						settings
 					);
+					ProfilerGpuEnd();
 				}
 			} break;
 			default: {
 				/* 未対応のパスはスキップ */
 			} break;
 		}
+		ProfilerGpuEnd();
 		s_activePipelinePassIndex = -1;
 	}
 	s_activePipelinePassIndex = -1;
 }
 
+static void GraphicsBuildPipelineResourceLifetimes(
+	const PipelineDescription *pipeline,
+	const PipelineReachability *reachability,
+	PipelineResourceLifetime *lifetimes
+){
+	for (int resourceIndex = 0; resourceIndex < PIPELINE_MAX_RESOURCES; ++resourceIndex) {
+		lifetimes[resourceIndex].firstPassIndex = -1;
+		lifetimes[resourceIndex].lastPassIndex = -1;
+		lifetimes[resourceIndex].transient = false;
+	}
+	if (pipeline == NULL) return;
+
+	bool readsPreviousContents[PIPELINE_MAX_RESOURCES] = {0};
+	for (int passIndex = 0; passIndex < pipeline->numPasses && passIndex < PIPELINE_MAX_PASSES; ++passIndex) {
+		if (reachability->passReachable[passIndex] == false) continue;
+		const PipelinePass *pass = &pipeline->passes[passIndex];
+		for (int bindingIndex = 0; bindingIndex < pass->numInputs + pass->numOutputs; ++bindingIndex) {
+			bool isInput = (bindingIndex < pass->numInputs);
+			const PipelineResourceBinding *binding = isInput
+				? &pass->inputs[bindingIndex]
+				: &pass->outputs[bindingIndex - pass->numInputs];
+			int resourceIndex = binding->resourceIndex;
+			if (resourceIndex < 0 || resourceIndex >= pipeline->numResources) continue;
+
+			PipelineResourceLifetime *lifetime = &lifetimes[resourceIndex];
+			/* Reading before the first write in the frame consumes the previous frame's contents */
+			if (isInput && (lifetime->firstPassIndex < 0 || lifetime->firstPassIndex == passIndex)) {
+				readsPreviousContents[resourceIndex] = true;
+			}
+			if (binding->historyOffset != 0) {
+				readsPreviousContents[resourceIndex] = true;
+			}
+			if (lifetime->firstPassIndex < 0) {
+				lifetime->firstPassIndex = passIndex;
+			}
+			lifetime->lastPassIndex = passIndex;
+		}
+	}
+
+	for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
+		PipelineResourceLifetime *lifetime = &lifetimes[resourceIndex];
+		lifetime->transient =
+				lifetime->firstPassIndex >= 0
+			&&	pipeline->resources[resourceIndex].historyLength <= 1
+			&&	readsPreviousContents[resourceIndex] == false;
+	}
+}
+
+static int GraphicsCalcNumMipLevels(
+	int width,
+	int height
+){
+	int numMipLevels = 1;
+	int size = (width > height)? width: height;
+	while (size > 1) {
+		size >>= 1;
+		++numMipLevels;
+	}
+	return numMipLevels;
+}
+
+static GLuint GraphicsCreatePipelineTexture(
+	int width,
+	int height,
+	PixelFormat pixelFormat,
+	int numMipLevels
+){
+	GlPixelFormatInfo pixelFormatInfo = PixelFormatToGlPixelFormatInfo(pixelFormat);
+	GLuint textureId = 0;
+	glGenTextures(
+		/* GLsizei n */				1,
+		/* GLuint *textures */		&textureId
+	);
+	GlStateCacheBindTexture(
+		/* GLenum target */		GL_TEXTURE_2D,
+		/* GLuint texture */	textureId
+	);
+	/* Levels past 0 are allocated up front only when a downsample pass writes them */
+	for (int level = 0; level < numMipLevels; ++level) {
+		glTexImage2D(
+			/* GLenum target */			GL_TEXTURE_2D,
+			/* GLint level */			level,
+			/* GLint internalformat */	pixelFormatInfo.internalformat,
+			/* GLsizei width */			(width >> level > 0)? width >> level: 1,
+			/* GLsizei height */		(height >> level > 0)? height >> level: 1,
+			/* GLint border */			0,
+			/* GLenum format */			pixelFormatInfo.format,
+			/* GLenum type */			pixelFormatInfo.type,
+			/* const void * data */		NULL
+		);
+	}
+
+	/* Sampling goes through sampler objects; these only keep image access complete */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GlStateCacheBindTexture(
+		/* GLenum target */		GL_TEXTURE_2D,
+		/* GLuint texture */	0
+	);
+	return textureId;
+}
+
+static void GraphicsDeletePipelineTransientTextures(
+	int firstSlot
+){
+	for (int slot = firstSlot; slot < s_numPipelineTransientTextures; ++slot) {
+		PipelineTransientTexture *transientTexture = &s_pipelineTransientTextures[slot];
+		if (transientTexture->textureId != 0) {
+			GraphicsDeleteTextures(1, &transientTexture->textureId);
+		}
+		memset(transientTexture, 0, sizeof(PipelineTransientTexture));
+	}
+	if (s_numPipelineTransientTextures > firstSlot) {
+		s_numPipelineTransientTextures = firstSlot;
+	}
+}
+
 static void GraphicsDeletePipelineRuntimeResource(
 	PipelineRuntimeResourceState *state
 ){
 	if (state == NULL) return;
 	if (state->initialized == false) return;
 
+	if (state->aliased) {
+		/* The texture belongs to the transient pool */
+		memset(state->textureIds, 0, sizeof(state->textureIds));
+		state->aliased = false;
+		state->aliasSlot = 0;
+	}
 	for (int historyIndex = 0; historyIndex < state->historyLength; ++historyIndex) {
 		GLuint textureId = state->textureIds[historyIndex];
 		if (textureId != 0) {
-			glDeleteTextures(
+			GraphicsDeleteTextures(
 				/* GLsizei n */				1,
 				/* const GLuint *textures */	&state->textureIds[historyIndex]
 			);
@@ -688,12 +1293,17 @@ static void GraphicsDeletePipelineRuntimeResource(
 	state->height = 0;
 	state->pixelFormat = (PixelFormat)0;
 	state->historyLength = 0;
+	state->numMipLevels = 0;
 }
 
 static void GraphicsResetPipelineRuntimeResources(){
+	/* Unknown whether the rebuilt pipeline falls back; render the next frame unscaled */
+	s_pipelineUsedLegacyFallback = true;
+	GraphicsInvalidatePipelineFramebuffers(-1);
 	for (int resourceIndex = 0; resourceIndex < PIPELINE_MAX_RESOURCES; ++resourceIndex) {
 		GraphicsDeletePipelineRuntimeResource(&s_pipelineRuntimeResources[resourceIndex]);
 	}
+	GraphicsDeletePipelineTransientTextures(0);
 }
 
 static void GraphicsResolveResourceDimensions(
@@ -702,41 +1312,22 @@ static void GraphicsResolveResourceDimensions(
 	int *outWidth,
 	int *outHeight
 ){
-	int width = params->xReso;
-	int height = params->yReso;
-
-	if (resource != NULL) {
-		switch (resource->resolution.mode) {
-			case PipelineResolutionModeFixed: {
-				if (resource->resolution.width > 0) {
-					width = resource->resolution.width;
-				}
-				if (resource->resolution.height > 0) {
-					height = resource->resolution.height;
-				}
-			} break;
-			case PipelineResolutionModeFramebuffer:
-			default: {
-				width = params->xReso;
-				height = params->yReso;
-			} break;
-		}
-	}
-
-	if (width <= 0) width = params->xReso;
-	if (height <= 0) height = params->yReso;
-	if (width <= 0) width = 1;
-	if (height <= 0) height = 1;
-
-	if (outWidth)  *outWidth = width;
-	if (outHeight) *outHeight = height;
+	/* Shared with the exported runtime so both allocate identical sizes */
+	PipelineResourceResolutionResolve(
+		(resource != NULL)? &resource->resolution: NULL,
+		params->xReso,
+		params->yReso,
+		outWidth,
+		outHeight
+	);
 }
 
 static void GraphicsCreateOrResizePipelineResource(
 	PipelineRuntimeResourceState *state,
 	const PipelineResource *resource,
 	int width,
-	int height
+	int height,
+	int numMipLevels
 ){
 	if (state == NULL || resource == NULL) {
 		return;
@@ -750,11 +1341,13 @@ static void GraphicsCreateOrResizePipelineResource(
 	|| state->height != height
 	|| state->pixelFormat != resource->pixelFormat
 	|| state->historyLength != resource->historyLength
+	|| state->numMipLevels != numMipLevels
 	) {
 		needsRecreate = true;
 	}
 
 	if (needsRecreate) {
+		GraphicsInvalidatePipelineFramebuffers((int)(state - s_pipelineRuntimeResources));
 		GraphicsDeletePipelineRuntimeResource(state);
 	}
 
@@ -766,63 +1359,26 @@ static void GraphicsCreateOrResizePipelineResource(
 		if (historyLength > PIPELINE_MAX_HISTORY_LENGTH) {
 			historyLength = PIPELINE_MAX_HISTORY_LENGTH;
 		}
-
-		GlPixelFormatInfo pixelFormatInfo = PixelFormatToGlPixelFormatInfo(resource->pixelFormat);
-		memset(state->textureIds, 0, sizeof(state->textureIds));
-		glGenTextures(
-			/* GLsizei n */				historyLength,
-			/* GLuint *textures */		state->textureIds
-		);
-
-		for (int historyIndex = 0; historyIndex < historyLength; ++historyIndex) {
-			GLuint textureId = state->textureIds[historyIndex];
-			glBindTexture(
-				/* GLenum target */		GL_TEXTURE_2D,
-				/* GLuint texture */	textureId
-			);
-			glTexImage2D(
-				/* GLenum target */			GL_TEXTURE_2D,
-				/* GLint level */			0,
-				/* GLint internalformat */	pixelFormatInfo.internalformat,
-				/* GLsizei width */			width,
-				/* GLsizei height */		height,
-				/* GLint border */			0,
-				/* GLenum format */			pixelFormatInfo.format,
-				/* GLenum type */			pixelFormatInfo.type,
-				/* const void * data */		NULL
-			);
-			GraphicsSetTextureSampler(
-				GL_TEXTURE_2D,
-				resource->textureFilter,
-				resource->textureWrap,
-				false
+
+		memset(state->textureIds, 0, sizeof(state->textureIds));
+		for (int historyIndex = 0; historyIndex < historyLength; ++historyIndex) {
+			state->textureIds[historyIndex] = GraphicsCreatePipelineTexture(
+				width,
+				height,
+				resource->pixelFormat,
+				numMipLevels
 			);
 		}
-		glBindTexture(
-			/* GLenum target */		GL_TEXTURE_2D,
-			/* GLuint texture */	0
-		);
 
 		state->initialized = true;
 		state->width = width;
 		state->height = height;
 		state->pixelFormat = resource->pixelFormat;
 		state->historyLength = historyLength;
+		state->numMipLevels = numMipLevels;
 		for (int historyIndex = historyLength; historyIndex < PIPELINE_MAX_HISTORY_LENGTH; ++historyIndex) {
 			state->textureIds[historyIndex] = 0;
 		}
-	} else {
-		for (int historyIndex = 0; historyIndex < state->historyLength; ++historyIndex) {
-			GLuint textureId = state->textureIds[historyIndex];
-			glBindTexture(GL_TEXTURE_2D, textureId);
-			GraphicsSetTextureSampler(
-				GL_TEXTURE_2D,
-				resource->textureFilter,
-				resource->textureWrap,
-				false
-			);
-		}
-		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 }
 
@@ -833,37 +1389,150 @@ static void GraphicsEnsurePipelineResources(
 	if (pipeline == NULL) return;
 	if (params == NULL) return;
 
+	int widths[PIPELINE_MAX_RESOURCES] = {0};
+	int heights[PIPELINE_MAX_RESOURCES] = {0};
+	int numMipLevels[PIPELINE_MAX_RESOURCES] = {0};
 	for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
-		const PipelineResource *resource = &pipeline->resources[resourceIndex];
-		PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
-		int width = 0;
-		int height = 0;
 		GraphicsResolveResourceDimensions(
-			resource,
+			&pipeline->resources[resourceIndex],
 			params,
-			&width,
-			&height
+			&widths[resourceIndex],
+			&heights[resourceIndex]
 		);
-		GraphicsCreateOrResizePipelineResource(
-			state,
-			resource,
-			width,
-			height
+		numMipLevels[resourceIndex] = PipelineDescriptionResourceHasMipChain(pipeline, resourceIndex)
+			? GraphicsCalcNumMipLevels(widths[resourceIndex], heights[resourceIndex])
+			: 1;
+	}
+
+	/*
+		Assign transient resources to pool slots, visiting them in order of
+		first use. A slot is reusable once the live range of its previous
+		occupant has ended and the format and size are identical.
+	*/
+	int aliasSlots[PIPELINE_MAX_RESOURCES];
+	PipelineTransientTexture slotDescs[PIPELINE_MAX_RESOURCES] = {{0}};
+	int slotLastPassIndices[PIPELINE_MAX_RESOURCES] = {0};
+	int numSlots = 0;
+	for (int resourceIndex = 0; resourceIndex < PIPELINE_MAX_RESOURCES; ++resourceIndex) {
+		aliasSlots[resourceIndex] = -1;
+	}
+	for (int passIndex = 0; passIndex < pipeline->numPasses; ++passIndex) {
+		for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
+			const PipelineResourceLifetime *lifetime = &s_pipelineResourceLifetimes[resourceIndex];
+			if (lifetime->transient == false || lifetime->firstPassIndex != passIndex) continue;
+
+			int slot = 0;
+			for (; slot < numSlots; ++slot) {
+				if (slotLastPassIndices[slot] < lifetime->firstPassIndex
+				&&	slotDescs[slot].width == widths[resourceIndex]
+				&&	slotDescs[slot].height == heights[resourceIndex]
+				&&	slotDescs[slot].pixelFormat == pipeline->resources[resourceIndex].pixelFormat
+				&&	slotDescs[slot].numMipLevels == numMipLevels[resourceIndex]
+				) {
+					break;
+				}
+			}
+			if (slot == numSlots) {
+				slotDescs[slot].width = widths[resourceIndex];
+				slotDescs[slot].height = heights[resourceIndex];
+				slotDescs[slot].pixelFormat = pipeline->resources[resourceIndex].pixelFormat;
+				slotDescs[slot].numMipLevels = numMipLevels[resourceIndex];
+				++numSlots;
+			}
+			slotLastPassIndices[slot] = lifetime->lastPassIndex;
+			aliasSlots[resourceIndex] = slot;
+		}
+	}
+
+	/* Realize the pool, keeping textures whose description did not change */
+	bool aliasingChanged = (numSlots != s_numPipelineTransientTextures);
+	GraphicsDeletePipelineTransientTextures(numSlots);
+	for (int slot = 0; slot < numSlots; ++slot) {
+		PipelineTransientTexture *transientTexture = &s_pipelineTransientTextures[slot];
+		if (transientTexture->textureId != 0
+		&&	transientTexture->width == slotDescs[slot].width
+		&&	transientTexture->height == slotDescs[slot].height
+		&&	transientTexture->pixelFormat == slotDescs[slot].pixelFormat
+		&&	transientTexture->numMipLevels == slotDescs[slot].numMipLevels
+		) {
+			continue;
+		}
+		if (transientTexture->textureId != 0) {
+			GraphicsDeleteTextures(1, &transientTexture->textureId);
+		}
+		*transientTexture = slotDescs[slot];
+		transientTexture->textureId = GraphicsCreatePipelineTexture(
+			slotDescs[slot].width,
+			slotDescs[slot].height,
+			slotDescs[slot].pixelFormat,
+			slotDescs[slot].numMipLevels
 		);
+		aliasingChanged = true;
+	}
+	s_numPipelineTransientTextures = numSlots;
+	for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
+		const PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
+		bool aliased = (aliasSlots[resourceIndex] >= 0);
+		if (state->aliased != aliased
+		||	(aliased && state->aliasSlot != aliasSlots[resourceIndex])
+		) {
+			aliasingChanged = true;
+		}
+	}
+	if (aliasingChanged) {
+		GraphicsInvalidatePipelineFramebuffers(-1);
+	}
+
+	for (int resourceIndex = 0; resourceIndex < pipeline->numResources; ++resourceIndex) {
+		const PipelineResource *resource = &pipeline->resources[resourceIndex];
+		PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
+		int slot = aliasSlots[resourceIndex];
+		if (slot >= 0) {
+			if (state->aliased == false) {
+				GraphicsDeletePipelineRuntimeResource(state);
+			}
+			memset(state->textureIds, 0, sizeof(state->textureIds));
+			state->textureIds[0] = s_pipelineTransientTextures[slot].textureId;
+			state->initialized = true;
+			state->aliased = true;
+			state->aliasSlot = slot;
+			state->width = widths[resourceIndex];
+			state->height = heights[resourceIndex];
+			state->pixelFormat = resource->pixelFormat;
+			state->historyLength = 1;
+			state->numMipLevels = numMipLevels[resourceIndex];
+		} else if (s_pipelineReachability.resourceReachable[resourceIndex] == false) {
+			/* Culled resources are never allocated */
+			if (state->initialized) {
+				GraphicsInvalidatePipelineFramebuffers(resourceIndex);
+				GraphicsDeletePipelineRuntimeResource(state);
+			}
+		} else {
+			if (state->aliased) {
+				GraphicsDeletePipelineRuntimeResource(state);
+			}
+			GraphicsCreateOrResizePipelineResource(
+				state,
+				resource,
+				widths[resourceIndex],
+				heights[resourceIndex],
+				numMipLevels[resourceIndex]
+			);
+		}
 	}
 }
 
-static GLuint GraphicsAcquirePipelineResourceTexture(
+static int GraphicsResolvePipelineResourceHistorySlot(
 	int resourceIndex,
 	int frameCount,
 	int historyOffset
 ){
 	if (resourceIndex < 0 || resourceIndex >= PIPELINE_MAX_RESOURCES) {
-		return 0;
+		return -1;
 	}
 	PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
 	if (state->initialized == false || state->historyLength <= 0) {
-		return 0;
+		return -1;
 	}
 
 	int historyLength = state->historyLength;
@@ -882,18 +1551,83 @@ static GLuint GraphicsAcquirePipelineResourceTexture(
 		resolvedIndex = baseIndex;
 	}
 
-	return state->textureIds[resolvedIndex];
+	return resolvedIndex;
 }
 
-static const PipelineResource *GraphicsGetPipelineResource(
-	const PipelineDescription *pipeline,
-	int resourceIndex
+static GLuint GraphicsAcquirePipelineFramebuffer(
+	const PipelineFramebufferAttachment *attachments,
+	int numAttachments
 ){
-	if (pipeline == NULL) return NULL;
-	if (resourceIndex < 0 || resourceIndex >= pipeline->numResources) {
-		return NULL;
+	if (attachments == NULL || numAttachments <= 0 || numAttachments > PIPELINE_MAX_BINDINGS_PER_PASS) {
+		return 0;
+	}
+
+	/* Cache hit -> reuse (completeness was checked on creation) */
+	for (int entryIndex = 0; entryIndex < s_numPipelineFramebufferCacheEntries; ++entryIndex) {
+		const PipelineFramebufferCacheEntry *entry = &s_pipelineFramebufferCache[entryIndex];
+		if (entry->numAttachments == numAttachments
+		&&	memcmp(entry->attachments, attachments, sizeof(PipelineFramebufferAttachment) * numAttachments) == 0
+		) {
+			return entry->complete ? entry->framebufferId : 0;
+		}
+	}
+
+	/* Cache miss -> create a new entry (flush the whole cache when it is full) */
+	if (s_numPipelineFramebufferCacheEntries >= PIPELINE_MAX_FRAMEBUFFER_CACHE_ENTRIES) {
+		GraphicsInvalidatePipelineFramebuffers(-1);
+	}
+	PipelineFramebufferCacheEntry *entry = &s_pipelineFramebufferCache[s_numPipelineFramebufferCacheEntries++];
+	memset(entry, 0, sizeof(PipelineFramebufferCacheEntry));
+	memcpy(entry->attachments, attachments, sizeof(PipelineFramebufferAttachment) * numAttachments);
+	entry->numAttachments = numAttachments;
+
+	GLenum drawBuffers[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
+	glGenFramebuffers(1, &entry->framebufferId);
+	GlStateCacheBindFramebuffer(GL_FRAMEBUFFER, entry->framebufferId);
+	for (int attachmentIndex = 0; attachmentIndex < numAttachments; ++attachmentIndex) {
+		const PipelineFramebufferAttachment *attachment = &attachments[attachmentIndex];
+		const PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[attachment->resourceIndex];
+		glFramebufferTexture2D(
+			GL_FRAMEBUFFER,
+			GL_COLOR_ATTACHMENT0 + attachmentIndex,
+			GL_TEXTURE_2D,
+			state->textureIds[attachment->historySlot],
+			attachment->mipLevel
+		);
+		drawBuffers[attachmentIndex] = GL_COLOR_ATTACHMENT0 + attachmentIndex;
+	}
+	glDrawBuffers(numAttachments, drawBuffers);
+	entry->complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	GlStateCacheBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (entry->complete == false) {
+		printf("[Pipeline Warning] incomplete framebuffer (resource %d).\n", attachments[0].resourceIndex);
+	}
+
+	return entry->complete ? entry->framebufferId : 0;
+}
+
+static void GraphicsInvalidatePipelineFramebuffers(
+	int resourceIndex	/* -1 = all */
+){
+	int numKeptEntries = 0;
+	for (int entryIndex = 0; entryIndex < s_numPipelineFramebufferCacheEntries; ++entryIndex) {
+		PipelineFramebufferCacheEntry *entry = &s_pipelineFramebufferCache[entryIndex];
+		bool invalidate = (resourceIndex < 0);
+		for (int attachmentIndex = 0; attachmentIndex < entry->numAttachments; ++attachmentIndex) {
+			if (entry->attachments[attachmentIndex].resourceIndex == resourceIndex) {
+				invalidate = true;
+			}
+		}
+		if (invalidate) {
+			GlStateCacheDeleteFramebuffers(1, &entry->framebufferId);
+			continue;
+		}
+		if (numKeptEntries != entryIndex) {
+			s_pipelineFramebufferCache[numKeptEntries] = *entry;
+		}
+		++numKeptEntries;
 	}
-	return &pipeline->resources[resourceIndex];
+	s_numPipelineFramebufferCacheEntries = numKeptEntries;
 }
 
 static PipelineRuntimeResourceState *GraphicsGetPipelineRuntimeResource(
@@ -905,25 +1639,22 @@ static PipelineRuntimeResourceState *GraphicsGetPipelineRuntimeResource(
 	return &s_pipelineRuntimeResources[resourceIndex];
 }
 
-static bool GraphicsParseLegacyResourceIndex(
-	const PipelineResource *resource,
-	const char *prefix,
-	int *outIndex
+static const PipelinePassProgramState *GraphicsGetPipelinePassProgram(
+	const PipelineDescription *pipeline,
+	const PipelinePass *pass
 ){
-	if (resource == NULL || prefix == NULL) return false;
-	size_t prefixLength = strlen(prefix);
-	if (strncmp(resource->id, prefix, prefixLength) != 0) {
-		return false;
-	}
-	int index = 0;
-	const char *suffix = resource->id + prefixLength;
-	if (*suffix != '\0') {
-		index = atoi(suffix);
+	/* パス個別のプログラムはカスタムパイプラインでのみ有効 */
+	if (s_pipelineHasCustomDescription == false) return NULL;
+	if (pipeline != &s_pipelineDescription || pass == NULL) return NULL;
+	int passIndex = (int)(pass - pipeline->passes);
+	if (passIndex < 0 || passIndex >= pipeline->numPasses) {
+		return NULL;
 	}
-	if (outIndex) {
-		*outIndex = index;
+	const PipelinePassProgramState *state = &s_pipelinePassPrograms[passIndex];
+	if (state->programId == 0) {
+		return NULL;
 	}
-	return true;
+	return state;
 }
 
 static void GraphicsSynchronizeRenderSettings(
@@ -937,6 +1668,7 @@ static void GraphicsSynchronizeRenderSettings(
 		s_xReso = params->xReso;
 		s_yReso = params->yReso;
 		s_currentRenderSettings = *settings;
+		s_pipelineCompileDirty = true;
 
 		GraphicsResetPipelineRuntimeResources();
 
@@ -948,163 +1680,87 @@ static void GraphicsSynchronizeRenderSettings(
 }
 
 static bool GraphicsExecuteComputePassPipeline(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
-	const CurrentFrameParams *params,
-	const RenderSettings *settings
+	const PipelinePlanCommand *command,
+	const PipelineResolvedCommand *resolved,
+	int phase,
+	const CurrentFrameParams *params
 ){
-	if (pipeline == NULL || pass == NULL || params == NULL || settings == NULL) {
+	if (command == NULL || resolved == NULL || params == NULL) {
 		return false;
 	}
-	if (s_computeShaderId == 0) {
+	if (resolved->valid == false) {
 		return false;
 	}
-
-	GlPixelFormatInfo defaultPixelFormatInfo = PixelFormatToGlPixelFormatInfo(settings->pixelFormat);
-
-	GLuint samplerUnitBase = COMPUTE_TEXTURE_START_INDEX;
-	GLuint samplerUnitCount = 0;
-	GLint nextImageUnit = 0;
-	GLuint boundSamplerUnits[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numBoundSamplerUnits = 0;
-	GLuint boundImageUnits[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numBoundImageUnits = 0;
-	GLenum boundImageAccess[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-
-	/* Bind inputs */
-	for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
-		const PipelineResourceBinding *binding = &pass->inputs[inputIndex];
-		const PipelineResource *resource = GraphicsGetPipelineResource(pipeline, binding->resourceIndex);
-		PipelineRuntimeResourceState *runtimeState = GraphicsGetPipelineRuntimeResource(binding->resourceIndex);
-		if (resource == NULL || runtimeState == NULL || runtimeState->initialized == false) {
-			return false;
-		}
-		GLuint textureId = GraphicsAcquirePipelineResourceTexture(
-			binding->resourceIndex,
-			params->frameCount,
-			binding->historyOffset
-		);
-		if (textureId == 0) {
-			return false;
-		}
-
-		GlPixelFormatInfo pixelFormatInfo = PixelFormatToGlPixelFormatInfo(resource->pixelFormat);
-
-		switch (binding->access) {
-			case PipelineResourceAccessSampled:
-			case PipelineResourceAccessHistoryRead: {
-				GLuint samplerUnit = samplerUnitBase + samplerUnitCount;
-				glActiveTexture(GL_TEXTURE0 + samplerUnit);
-				glBindTexture(GL_TEXTURE_2D, textureId);
-				GraphicsSetTextureSampler(
+	int targetWidth = resolved->targetWidth;
+	int targetHeight = resolved->targetHeight;
+
+	/* Bind inputs and outputs (units were assigned when the plan was compiled) */
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		GLuint textureId = resolved->textureIds[phase][bindingIndex];
+		switch (binding->kind) {
+			case PipelinePlanBindingKindTexture: {
+				/* Only mip chains prebuilt by downsample passes are sampled with mips */
+				bool useMipmap =
+						binding->enableMipmap
+					&&	GraphicsShaderSamplesMipmap(resolved->programId, binding->unit);
+				GlStateCacheActiveTexture(GL_TEXTURE0 + binding->unit);
+				GlStateCacheBindTexture(GL_TEXTURE_2D, textureId);
+				GraphicsBindTextureSampler(
+					binding->unit,
 					GL_TEXTURE_2D,
-					resource->textureFilter,
-					resource->textureWrap,
-					false
-				);
-				boundSamplerUnits[numBoundSamplerUnits++] = samplerUnit;
-				++samplerUnitCount;
-			} break;
-			case PipelineResourceAccessImageRead: {
-				GLenum internalformat = pixelFormatInfo.internalformat != 0 ? pixelFormatInfo.internalformat : defaultPixelFormatInfo.internalformat;
-				GLint unit = nextImageUnit++;
-				glBindImageTexture(
-					unit,
-					textureId,
-					0,
-					GL_FALSE,
-					0,
-					GL_READ_ONLY,
-					internalformat
+					binding->textureFilter,
+					binding->textureWrap,
+					useMipmap
 				);
-				boundImageUnits[numBoundImageUnits] = unit;
-				boundImageAccess[numBoundImageUnits] = GL_READ_ONLY;
-				++numBoundImageUnits;
 			} break;
-			default: {
-				/* Unsupported binding type for compute pass */
-				return false;
-			} break;
-		}
-	}
-
-	/* Bind outputs */
-	bool hasWritableOutput = false;
-	for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
-		const PipelineResourceBinding *binding = &pass->outputs[outputIndex];
-		const PipelineResource *resource = GraphicsGetPipelineResource(pipeline, binding->resourceIndex);
-		PipelineRuntimeResourceState *runtimeState = GraphicsGetPipelineRuntimeResource(binding->resourceIndex);
-		if (resource == NULL || runtimeState == NULL || runtimeState->initialized == false) {
-			return false;
-		}
-		GLuint textureId = GraphicsAcquirePipelineResourceTexture(
-			binding->resourceIndex,
-			params->frameCount,
-			binding->historyOffset
-		);
-		if (textureId == 0) {
-			return false;
-		}
-		GlPixelFormatInfo pixelFormatInfo = PixelFormatToGlPixelFormatInfo(resource->pixelFormat);
-		GLenum internalformat = pixelFormatInfo.internalformat != 0 ? pixelFormatInfo.internalformat : defaultPixelFormatInfo.internalformat;
-
-		switch (binding->access) {
-			case PipelineResourceAccessImageWrite: {
-				GLint unit = nextImageUnit++;
+			case PipelinePlanBindingKindImage: {
 				glBindImageTexture(
-					unit,
+					binding->unit,
 					textureId,
 					0,
 					GL_FALSE,
 					0,
-					GL_WRITE_ONLY,
-					internalformat
+					binding->imageAccess,
+					binding->imageFormat
 				);
-				boundImageUnits[numBoundImageUnits] = unit;
-				boundImageAccess[numBoundImageUnits] = GL_WRITE_ONLY;
-				++numBoundImageUnits;
-				hasWritableOutput = true;
 			} break;
 			default: {
-				/* Unsupported output access for compute */
-				return false;
 			} break;
 		}
 	}
 
-	if (hasWritableOutput == false) {
-		/* Nothing useful to write; fall back */
-		return false;
-	}
-
-	glUseProgram(s_computeShaderId);
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
+	GLuint programId = resolved->programId;
+	const ShaderReflection *reflection = GetShaderReflection(programId);
+	GlStateCacheUseProgram(programId);
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
 		glUniform1i(UNIFORM_LOCATION_PIPELINE_PASS_INDEX, s_activePipelinePassIndex);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
 		glUniform1i(UNIFORM_LOCATION_WAVE_OUT_POS, params->waveOutPos);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
 		glUniform1i(UNIFORM_LOCATION_FRAME_COUNT, params->frameCount);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
 		glUniform1f(UNIFORM_LOCATION_TIME, params->time);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
 		glUniform2f(
 			UNIFORM_LOCATION_RESO,
-			(GLfloat)params->xReso,
-			(GLfloat)params->yReso
+			(GLfloat)targetWidth,
+			(GLfloat)targetHeight
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
 		glUniform2f(
 			UNIFORM_LOCATION_MOUSE_POS,
+			/* Mouse position is relative to the framebuffer, also for scaled targets */
 			(GLfloat)params->xMouse / (GLfloat)params->xReso,
 			1.0f - (GLfloat)params->yMouse / (GLfloat)params->yReso
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
 		glUniform3i(
 			UNIFORM_LOCATION_MOUSE_BUTTONS,
 			params->mouseLButtonPressed,
@@ -1112,10 +1768,10 @@ static bool GraphicsExecuteComputePassPipeline(
 			params->mouseRButtonPressed
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
 		glUniform1f(UNIFORM_LOCATION_TAN_FOVY, tanf(params->fovYInRadians));
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
 		glUniformMatrix4fv(
 			UNIFORM_LOCATION_CAMERA_COORD,
 			1,
@@ -1123,7 +1779,7 @@ static bool GraphicsExecuteComputePassPipeline(
 			&params->mat4x4CameraInWorld[0][0]
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
 		glUniformMatrix4fv(
 			UNIFORM_LOCATION_PREV_CAMERA_COORD,
 			1,
@@ -1132,59 +1788,145 @@ static bool GraphicsExecuteComputePassPipeline(
 		);
 	}
 
-	GLuint workGroupSizeX = (GLuint)(s_computeWorkGroupSize[0] > 0? s_computeWorkGroupSize[0]: 1);
-	GLuint workGroupSizeY = (GLuint)(s_computeWorkGroupSize[1] > 0? s_computeWorkGroupSize[1]: 1);
-	GLuint workGroupSizeZ = (GLuint)(s_computeWorkGroupSize[2] > 0? s_computeWorkGroupSize[2]: 1);
-	if (pass->overrideWorkGroupSize) {
-		if (pass->workGroupSize[0] > 0) workGroupSizeX = pass->workGroupSize[0];
-		if (pass->workGroupSize[1] > 0) workGroupSizeY = pass->workGroupSize[1];
-		if (pass->workGroupSize[2] > 0) workGroupSizeZ = pass->workGroupSize[2];
+	glDispatchCompute(resolved->numGroups[0], resolved->numGroups[1], resolved->numGroups[2]);
+
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind == PipelinePlanBindingKindImage && binding->imageAccess != GL_READ_ONLY) {
+			GraphicsMarkTextureWritten(resolved->textureIds[phase][bindingIndex]);
+		}
 	}
 
-	GLuint numGroupsX = (GLuint)((params->xReso + workGroupSizeX - 1) / workGroupSizeX);
-	GLuint numGroupsY = (GLuint)((params->yReso + workGroupSizeY - 1) / workGroupSizeY);
-	GLuint numGroupsZ = (GLuint)((1 + workGroupSizeZ - 1) / workGroupSizeZ);
-	if (numGroupsX == 0) numGroupsX = 1;
-	if (numGroupsY == 0) numGroupsY = 1;
-	if (numGroupsZ == 0) numGroupsZ = 1;
+	/* Barriers are issued by GraphicsExecutePipeline before the consuming pass */
+
+	/* Unbind image units and textures */
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		switch (binding->kind) {
+			case PipelinePlanBindingKindTexture: {
+				GlStateCacheActiveTexture(GL_TEXTURE0 + binding->unit);
+				GlStateCacheBindTexture(GL_TEXTURE_2D, 0);
+			} break;
+			case PipelinePlanBindingKindImage: {
+				glBindImageTexture(
+					binding->unit,
+					0,
+					0,
+					GL_FALSE,
+					0,
+					binding->imageAccess,
+					binding->imageFormat
+				);
+			} break;
+			default: {
+			} break;
+		}
+	}
+	GlStateCacheActiveTexture(GL_TEXTURE0);
 
-	glDispatchCompute(numGroupsX, numGroupsY, numGroupsZ);
+	return true;
+}
 
-	glMemoryBarrier(
-			GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
-		|	GL_TEXTURE_FETCH_BARRIER_BIT
-		|	GL_TEXTURE_UPDATE_BARRIER_BIT
-	);
+static bool GraphicsExecuteDownsamplePassPipeline(
+	const PipelinePlanCommand *command,
+	const PipelineResolvedCommand *resolved,
+	int phase
+){
+	if (command == NULL || resolved == NULL) {
+		return false;
+	}
+	if (resolved->valid == false || command->numBindings != 2) {
+		return false;
+	}
+	const PipelinePlanBinding *srcBinding = &command->bindings[0];
+	const PipelinePlanBinding *dstBinding = &command->bindings[1];
+	GLuint srcTextureId = resolved->textureIds[phase][0];
+	GLuint dstTextureId = resolved->textureIds[phase][1];
+	const PipelineRuntimeResourceState *dstState = GraphicsGetPipelineRuntimeResource(dstBinding->resourceIndex);
+	if (dstState == NULL || dstState->numMipLevels <= 0) {
+		return false;
+	}
 
-	/* Unbind image units */
-	for (int index = 0; index < numBoundImageUnits; ++index) {
-		GLuint unit = boundImageUnits[index];
-		GLenum access = boundImageAccess[index];
-		glBindImageTexture(
-			unit,
-			0,
-			0,
-			GL_FALSE,
-			0,
-			access,
-			defaultPixelFormatInfo.internalformat != 0 ? defaultPixelFormatInfo.internalformat : GL_RGBA8
+	/*
+		In place, levels 1.. are built from level 0. With a separate output,
+		level 0 of the output is reduced from level 0 of the input (normally
+		half the input resolution; the shader maps other sizes through the
+		output size).
+	*/
+	int firstDstLevel = (srcTextureId == dstTextureId)? 1: 0;
+	int levelsPerDispatch = (command->downsampleFilter == PipelineDownsampleFilterKawase)
+		? 1
+		: PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH;
+	TextureFilter samplerFilter = (command->downsampleFilter == PipelineDownsampleFilterKawase)
+		? TextureFilterLinear
+		: TextureFilterNearest;
+
+	GlStateCacheUseProgram(resolved->programId);
+	GlStateCacheActiveTexture(GL_TEXTURE0 + srcBinding->unit);
+	for (int dstLevel = firstDstLevel; dstLevel < dstState->numMipLevels; ) {
+		int numDstLevels = dstState->numMipLevels - dstLevel;
+		if (numDstLevels > levelsPerDispatch) numDstLevels = levelsPerDispatch;
+
+		/* After the first dispatch the output samples its own previous level */
+		GLuint sourceTextureId = (dstLevel == firstDstLevel)? srcTextureId: dstTextureId;
+		int srcLevel = (dstLevel > 0)? dstLevel - 1: 0;
+		GlStateCacheBindTexture(GL_TEXTURE_2D, sourceTextureId);
+		GraphicsBindTextureSampler(
+			srcBinding->unit,
+			GL_TEXTURE_2D,
+			samplerFilter,
+			TextureWrapClampToEdge,
+			/* Only the output owns a complete mip chain */
+			sourceTextureId == dstTextureId
+		);
+		for (int levelIndex = 0; levelIndex < numDstLevels; ++levelIndex) {
+			glBindImageTexture(
+				dstBinding->unit + levelIndex,
+				dstTextureId,
+				dstLevel + levelIndex,
+				GL_FALSE,
+				0,
+				GL_WRITE_ONLY,
+				dstBinding->imageFormat
+			);
+		}
+		glUniform1i(DOWNSAMPLE_UNIFORM_LOCATION_SRC_LEVEL, srcLevel);
+		glUniform1i(DOWNSAMPLE_UNIFORM_LOCATION_NUM_DST_LEVELS, numDstLevels);
+
+		int dstWidth = (dstState->width >> dstLevel > 0)? dstState->width >> dstLevel: 1;
+		int dstHeight = (dstState->height >> dstLevel > 0)? dstState->height >> dstLevel: 1;
+		glDispatchCompute(
+			(GLuint)(dstWidth + PIPELINE_DOWNSAMPLE_TILE_SIZE - 1) / PIPELINE_DOWNSAMPLE_TILE_SIZE,
+			(GLuint)(dstHeight + PIPELINE_DOWNSAMPLE_TILE_SIZE - 1) / PIPELINE_DOWNSAMPLE_TILE_SIZE,
+			1
 		);
+
+		dstLevel += numDstLevels;
+		if (dstLevel < dstState->numMipLevels) {
+			/* The next dispatch fetches the last level stored by this one */
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		}
 	}
 
-	/* Unbind textures */
-	for (int index = 0; index < numBoundSamplerUnits; ++index) {
-		GLuint samplerUnit = boundSamplerUnits[index];
-		glActiveTexture(GL_TEXTURE0 + samplerUnit);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	/* The chain is complete; keep glGenerateMipmap from overwriting it */
+	GraphicsMarkTextureWritten(dstTextureId);
+	GraphicsMarkTextureMipmapBuilt(dstTextureId);
+
+	for (int levelIndex = 0; levelIndex < PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH; ++levelIndex) {
+		glBindImageTexture(dstBinding->unit + levelIndex, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, dstBinding->imageFormat);
 	}
-	glActiveTexture(GL_TEXTURE0);
+	GlStateCacheBindTexture(GL_TEXTURE_2D, 0);
+	GlStateCacheActiveTexture(GL_TEXTURE0);
 
 	return true;
 }
+
 void GraphicsResetPipelineDescriptionToDefault(){
+	GraphicsDeleteAllPipelinePassShaders();
 	GraphicsResetPipelineRuntimeResources();
 	PipelineDescriptionInit(&s_pipelineDescription);
 	s_pipelineHasCustomDescription = false;
+	s_pipelineCompileDirty = true;
 }
 
 bool GraphicsApplyPipelineDescription(const PipelineDescription *pipeline){
@@ -1192,12 +1934,29 @@ bool GraphicsApplyPipelineDescription(const PipelineDescription *pipeline){
 		GraphicsResetPipelineDescriptionToDefault();
 		return true;
 	}
+	GraphicsDeleteAllPipelinePassShaders();
 	GraphicsResetPipelineRuntimeResources();
 	memcpy(&s_pipelineDescription, pipeline, sizeof(PipelineDescription));
 	s_pipelineHasCustomDescription = true;
+	GraphicsCompilePipelineDescription(&s_pipelineDescription);
 	return true;
 }
 
+int GraphicsGetPipelineResourceAliasSlot(int resourceIndex){
+	if (resourceIndex < 0 || resourceIndex >= PIPELINE_MAX_RESOURCES) return -1;
+	const PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
+	return (state->initialized && state->aliased)? state->aliasSlot: -1;
+}
+
+int GraphicsGetNumPipelineTransientTextures(){
+	return s_numPipelineTransientTextures;
+}
+
+const PipelineReachability *GraphicsGetPipelineReachability(){
+	GraphicsResolvePipelineDescription();
+	return &s_pipelineReachability;
+}
+
 bool GraphicsHasCustomPipelineDescription(){
 	return s_pipelineHasCustomDescription;
 }
@@ -1229,7 +1988,7 @@ static void GraphicsCreateFrameBuffer(
 
 		/* レンダーターゲットの巡回 */
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; renderTargetIndex++) {
-			glBindTexture(
+			GlStateCacheBindTexture(
 				/* GLenum target */		GL_TEXTURE_2D,
 				/* GLuint texture */	s_mrtTextures[doubleBufferIndex][renderTargetIndex]
 			);
@@ -1256,12 +2015,12 @@ static void GraphicsDeleteComputeTextures(
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; ++renderTargetIndex) {
 			GLuint textureId = s_computeTextures[doubleBufferIndex][renderTargetIndex];
 			if (textureId != 0) {
-				glActiveTexture(GL_TEXTURE0 + COMPUTE_TEXTURE_START_INDEX + renderTargetIndex);
-				glBindTexture(
+				GlStateCacheActiveTexture(GL_TEXTURE0 + COMPUTE_TEXTURE_START_INDEX + renderTargetIndex);
+				GlStateCacheBindTexture(
 					/* GLenum target */		GL_TEXTURE_2D,
 					/* GLuint texture */	0	/* unbind */
 				);
-				glDeleteTextures(
+				GraphicsDeleteTextures(
 					/* GLsizei n */					1,
 					/* const GLuint * textures */	&s_computeTextures[doubleBufferIndex][renderTargetIndex]
 				);
@@ -1281,7 +2040,7 @@ static void GraphicsDeleteComputeTextures(
 			/* GLenum format */			pixelFormatInfo.internalformat
 		);
 	}
-	glActiveTexture(GL_TEXTURE0);
+	GlStateCacheActiveTexture(GL_TEXTURE0);
 }
 
 static void GraphicsCreateComputeTextures(
@@ -1299,7 +2058,7 @@ static void GraphicsCreateComputeTextures(
 			/* GLuint * textures */		s_computeTextures[doubleBufferIndex]
 		);
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; ++renderTargetIndex) {
-			glBindTexture(
+			GlStateCacheBindTexture(
 				/* GLenum target */		GL_TEXTURE_2D,
 				/* GLuint texture */	s_computeTextures[doubleBufferIndex][renderTargetIndex]
 			);
@@ -1320,7 +2079,7 @@ static void GraphicsCreateComputeTextures(
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		}
 	}
-	glBindTexture(
+	GlStateCacheBindTexture(
 		/* GLenum target */		GL_TEXTURE_2D,
 		/* GLuint texture */	0	/* unbind */
 	);
@@ -1329,13 +2088,13 @@ static void GraphicsCreateComputeTextures(
 static void GraphicsDeleteFrameBuffer(
 ){
 	/* フレームバッファアンバインド */
-	glBindFramebuffer(
+	GlStateCacheBindFramebuffer(
 		/* GLenum target */			GL_FRAMEBUFFER,
 		/* GLuint framebuffer */	0	/* unbind */
 	);
 
 	/* MRT フレームバッファ削除 */
-	glDeleteFramebuffers(
+	GlStateCacheDeleteFramebuffers(
 		/* GLsizei n */				1,
 	 	/* GLuint *ids */			&s_mrtFrameBuffer
 	);
@@ -1344,15 +2103,15 @@ static void GraphicsDeleteFrameBuffer(
 		/* MRT テクスチャ削除 */
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; renderTargetIndex++) {
 			/* テクスチャアンバインド */
-			glActiveTexture(GL_TEXTURE0 + renderTargetIndex);
-			glBindTexture(
+			GlStateCacheActiveTexture(GL_TEXTURE0 + renderTargetIndex);
+			GlStateCacheBindTexture(
 				/* GLenum target */		GL_TEXTURE_2D,
 				/* GLuint texture */	0	/* unbind */
 			);
 		}
 
 		/* テクスチャ削除 */
-		glDeleteTextures(
+		GraphicsDeleteTextures(
 			/* GLsizei n */			NUM_RENDER_TARGETS,
 			/* GLuint * textures */	s_mrtTextures[doubleBufferIndex]
 		);
@@ -1369,35 +2128,54 @@ void GraphicsClearAllRenderTargets(){
 
 bool GraphicsShaderRequiresFrameCountUniform(){
 	if (s_fragmentShaderId != 0) {
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+		if (ShaderReflectionHasUniform(GetShaderReflection(s_fragmentShaderId), UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
 			return true;
 		}
 	}
 	if (s_computeShaderId != 0) {
-		if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+		if (ShaderReflectionHasUniform(GetShaderReflection(s_computeShaderId), UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
 			return true;
 		}
 	}
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		GLuint programId = s_pipelinePassPrograms[passIndex].programId;
+		if (programId != 0) {
+			if (ShaderReflectionHasUniform(GetShaderReflection(programId), UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+				return true;
+			}
+		}
+	}
 	return false;
 }
 
 bool GraphicsShaderRequiresCameraControlUniforms(){
 	if (s_fragmentShaderId != 0) {
 		if (
-			ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)
-		||	ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)
+			ShaderReflectionHasUniform(GetShaderReflection(s_fragmentShaderId), UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)
+		||	ShaderReflectionHasUniform(GetShaderReflection(s_fragmentShaderId), UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)
 		) {
 			return true;
 		}
 	}
 	if (s_computeShaderId != 0) {
 		if (
-			ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)
-		||	ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)
+			ShaderReflectionHasUniform(GetShaderReflection(s_computeShaderId), UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)
+		||	ShaderReflectionHasUniform(GetShaderReflection(s_computeShaderId), UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)
 		) {
 			return true;
 		}
 	}
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		GLuint programId = s_pipelinePassPrograms[passIndex].programId;
+		if (programId != 0) {
+			if (
+				ShaderReflectionHasUniform(GetShaderReflection(programId), UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)
+			||	ShaderReflectionHasUniform(GetShaderReflection(programId), UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)
+			) {
+				return true;
+			}
+		}
+	}
 	return false;
 }
 
@@ -1425,7 +2203,7 @@ static bool GraphicsLoadUserTextureSubAsPng(
 	s_userTextures[userTextureIndex].target = GL_TEXTURE_2D;
 
 	/* テクスチャのバインド */
-	glBindTexture(
+	GlStateCacheBindTexture(
 		/* GLenum target */			GL_TEXTURE_2D,
 		/* GLuint texture */		s_userTextures[userTextureIndex].id
 	);
@@ -1464,7 +2242,7 @@ static bool GraphicsLoadUserTextureSubAsPng(
 	}
 
 	/* テクスチャのアンバインド */
-	glBindTexture(
+	GlStateCacheBindTexture(
 		/* GLenum target */			GL_TEXTURE_2D,
 		/* GLuint texture */		0
 	);
@@ -1544,7 +2322,7 @@ static bool GraphicsLoadUserTextureSubAsDds(
 	}
 
 	/* テクスチャのバインド */
-	glBindTexture(
+	GlStateCacheBindTexture(
 		/* GLenum target */		s_userTextures[userTextureIndex].target,
 		/* GLuint texture */	s_userTextures[userTextureIndex].id
 	);
@@ -1632,7 +2410,7 @@ static bool GraphicsLoadUserTextureSubAsDds(
 	*/
 
 	/* テクスチャのアンバインド */
-	glBindTexture(
+	GlStateCacheBindTexture(
 		/* GLenum target */		s_userTextures[userTextureIndex].target,
 		/* GLuint texture */	0
 	);
@@ -1653,7 +2431,7 @@ bool GraphicsLoadUserTexture(
 
 	/* 既存のテクスチャがあるなら破棄 */
 	if (s_userTextures[userTextureIndex].id != 0) {
-		glDeleteTextures(
+		GraphicsDeleteTextures(
 			/* GLsizei n */					1,
 			/* const GLuint * textures */	&s_userTextures[userTextureIndex].id
 		);
@@ -1686,7 +2464,7 @@ bool GraphicsDeleteUserTexture(
 
 	/* 既存のテクスチャがあるなら破棄 */
 	if (s_userTextures[userTextureIndex].id != 0) {
-		glDeleteTextures(
+		GraphicsDeleteTextures(
 			/* GLsizei n */					1,
 			/* const GLuint * textures */	&s_userTextures[userTextureIndex].id
 		);
@@ -1719,24 +2497,33 @@ bool GraphicsDeleteVertexShader(
 ){
 	if (s_vertexShaderId == 0) return false;
 	glFinish();
-	glDeleteProgram(s_vertexShaderId);
+	DeleteShaderProgram(s_vertexShaderId);
 	s_vertexShaderId = 0;
 	return true;
 }
 
-bool GraphicsCreateFragmentShader(
-	const char *shaderCode
+/*
+	Installs a linked program in place of the running one. Called between
+	frames once the new program has finished compiling; the old program and
+	pipeline are deleted without glFinish, GL keeps them alive until commands
+	already submitted with them have completed.
+*/
+bool GraphicsSetFragmentShader(
+	GLuint programId
 ){
-	printf("setup the fragment shader ...\n");
-	const GLchar *(strings[]) = {
-		SkipBomConst(shaderCode)
-	};
-	assert(s_fragmentShaderId == 0);
-	s_fragmentShaderId = CreateShader(GL_FRAGMENT_SHADER, SIZE_OF_ARRAY(strings), strings);
-	if (s_fragmentShaderId == 0) {
-		printf("setup the fragment shader ... fialed.\n");
-		return false;
+	if (programId == 0) return false;
+	if (s_shaderPipelineId != 0) {
+		GlStateCacheDeleteProgramPipelines(
+			/* GLsizei n */					1,
+			/* const GLuint *pipelines */	&s_shaderPipelineId
+		);
+		s_shaderPipelineId = 0;
+	}
+	if (s_fragmentShaderId != 0) {
+		DeleteShaderProgram(s_fragmentShaderId);
 	}
+	s_fragmentShaderId = programId;
+	GraphicsCreateShaderPipeline();
 	DumpShaderInterfaces(s_fragmentShaderId);
 	printf("setup the fragment shader ... done.\n");
 
@@ -1747,24 +2534,19 @@ bool GraphicsDeleteFragmentShader(
 ){
 	if (s_fragmentShaderId == 0) return false;
 	glFinish();
-	glDeleteProgram(s_fragmentShaderId);
+	DeleteShaderProgram(s_fragmentShaderId);
 	s_fragmentShaderId = 0;
 	return true;
 }
 
-bool GraphicsCreateComputeShader(
-	const char *shaderCode
+bool GraphicsSetComputeShader(
+	GLuint programId
 ){
-	printf("setup the compute shader ...\n");
-	const GLchar *(strings[]) = {
-		SkipBomConst(shaderCode)
-	};
-	assert(s_computeShaderId == 0);
-	s_computeShaderId = CreateShader(GL_COMPUTE_SHADER, SIZE_OF_ARRAY(strings), strings);
-	if (s_computeShaderId == 0) {
-		printf("setup the compute shader ... failed.\n");
-		return false;
+	if (programId == 0) return false;
+	if (s_computeShaderId != 0) {
+		DeleteShaderProgram(s_computeShaderId);
 	}
+	s_computeShaderId = programId;
 	glGetProgramiv(
 		/* GLuint program */	s_computeShaderId,
 		/* GLenum pname */		GL_COMPUTE_WORK_GROUP_SIZE,
@@ -1777,6 +2559,7 @@ bool GraphicsCreateComputeShader(
 	}
 	DumpShaderInterfaces(s_computeShaderId);
 	printf("setup the compute shader ... done.\n");
+	s_pipelineCompileDirty = true;
 
 	return true;
 }
@@ -1785,11 +2568,12 @@ bool GraphicsDeleteComputeShader(
 ){
 	if (s_computeShaderId == 0) return false;
 	glFinish();
-	glDeleteProgram(s_computeShaderId);
+	DeleteShaderProgram(s_computeShaderId);
 	s_computeShaderId = 0;
 	s_computeWorkGroupSize[0] = 1;
 	s_computeWorkGroupSize[1] = 1;
 	s_computeWorkGroupSize[2] = 1;
+	s_pipelineCompileDirty = true;
 	return true;
 }
 
@@ -1805,75 +2589,566 @@ bool GraphicsCreateShaderPipeline(
 	return true;
 }
 
-bool GraphicsDeleteShaderPipeline(
+bool GraphicsDeleteShaderPipeline(
+){
+	if (s_shaderPipelineId == 0) return false;
+	glFinish();
+	GlStateCacheDeleteProgramPipelines(
+		/* GLsizei n */					1,
+		/* const GLuint *pipelines */	&s_shaderPipelineId
+	);
+	s_shaderPipelineId = 0;
+	return true;
+}
+
+GLenum GraphicsGetPipelinePassShaderType(
+	int passIndex
+){
+	if (s_pipelineHasCustomDescription == false) return 0;
+	if (passIndex < 0 || passIndex >= s_pipelineDescription.numPasses) return 0;
+	switch (s_pipelineDescription.passes[passIndex].type) {
+		case PipelinePassTypeFragment: {
+			return GL_FRAGMENT_SHADER;
+		} break;
+		case PipelinePassTypeCompute: {
+			return GL_COMPUTE_SHADER;
+		} break;
+		default: {
+			/* シェーダを持たないパス */
+			return 0;
+		} break;
+	}
+}
+
+bool GraphicsSetPipelinePassShader(
+	int passIndex,
+	GLuint programId
+){
+	if (programId == 0) return false;
+	GLenum shaderType = GraphicsGetPipelinePassShaderType(passIndex);
+	if (shaderType == 0) {
+		/* The pass has gone away while the program was compiling. */
+		DeleteShaderProgram(programId);
+		return false;
+	}
+	PipelinePass *pass = &s_pipelineDescription.passes[passIndex];
+	PipelinePassProgramState *state = &s_pipelinePassPrograms[passIndex];
+
+	/* Same as GraphicsSetFragmentShader, the old program is released without glFinish. */
+	if (state->shaderPipelineId != 0) {
+		GlStateCacheDeleteProgramPipelines(
+			/* GLsizei n */					1,
+			/* const GLuint *pipelines */	&state->shaderPipelineId
+		);
+	}
+	if (state->programId != 0) {
+		DeleteShaderProgram(state->programId);
+	}
+	memset(state, 0, sizeof(*state));
+
+	if (shaderType == GL_COMPUTE_SHADER) {
+		glGetProgramiv(
+			/* GLuint program */	programId,
+			/* GLenum pname */		GL_COMPUTE_WORK_GROUP_SIZE,
+			/* GLint *params */		state->workGroupSize
+		);
+		for (int i = 0; i < 3; ++i) {
+			if (state->workGroupSize[i] <= 0) {
+				state->workGroupSize[i] = 1;
+			}
+		}
+	} else {
+		glGenProgramPipelines(
+			/* GLsizei n */			1,
+			/* GLuint *pipelines */	&state->shaderPipelineId
+		);
+		glUseProgramStages(state->shaderPipelineId, GL_VERTEX_SHADER_BIT, s_vertexShaderId);
+		glUseProgramStages(state->shaderPipelineId, GL_FRAGMENT_SHADER_BIT, programId);
+	}
+	state->programId = programId;
+	pass->programId = programId;
+	DumpShaderInterfaces(programId);
+	printf("setup the pipeline pass shader (%s) ... done.\n", pass->name);
+
+	return true;
+}
+
+bool GraphicsDeletePipelinePassShader(
+	int passIndex
+){
+	if (passIndex < 0 || passIndex >= PIPELINE_MAX_PASSES) return false;
+	PipelinePassProgramState *state = &s_pipelinePassPrograms[passIndex];
+	if (state->programId == 0) return false;
+	glFinish();
+	if (state->shaderPipelineId != 0) {
+		GlStateCacheDeleteProgramPipelines(
+			/* GLsizei n */					1,
+			/* const GLuint *pipelines */	&state->shaderPipelineId
+		);
+	}
+	DeleteShaderProgram(state->programId);
+	memset(state, 0, sizeof(*state));
+	if (passIndex < s_pipelineDescription.numPasses) {
+		s_pipelineDescription.passes[passIndex].programId = 0;
+	}
+	return true;
+}
+
+void GraphicsDeleteAllPipelinePassShaders(
+){
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; passIndex++) {
+		GraphicsDeletePipelinePassShader(passIndex);	/* false が得られてもエラー扱いとしない */
+	}
+}
+
+/*
+	Built-in shader of downsample passes.
+
+	A 16x16 work group reduces its tile of the first destination level and
+	keeps it in shared memory, so up to PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH
+	levels are written by a single dispatch without reading back what it
+	stored. The kawase filter takes bilinear taps across tile borders and
+	therefore writes one level per dispatch.
+	Stores outside of a level are discarded by GL, so partial tiles need no
+	bounds checks.
+	Texel positions are mapped through the actual size of the first
+	destination level, so a separate output that is not exactly half the
+	input is still sampled across its whole footprint.
+*/
+static const char s_pipelineDownsampleShaderBody[] =
+	"#define FILTER_AVERAGE 0\n"
+	"#define FILTER_MAX 1\n"
+	"#define FILTER_KAWASE 2\n"
+	"#define TILE_SIZE 16\n"
+	"layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;\n"
+	"layout(binding = 4) uniform sampler2D srcTexture;\n"
+	"layout(binding = 0, IMAGE_FORMAT) writeonly uniform image2D dstImage0;\n"
+	"layout(binding = 1, IMAGE_FORMAT) writeonly uniform image2D dstImage1;\n"
+	"layout(binding = 2, IMAGE_FORMAT) writeonly uniform image2D dstImage2;\n"
+	"layout(binding = 3, IMAGE_FORMAT) writeonly uniform image2D dstImage3;\n"
+	"layout(binding = 4, IMAGE_FORMAT) writeonly uniform image2D dstImage4;\n"
+	"layout(location = 0) uniform int srcLevel;\n"
+	"layout(location = 1) uniform int numDstLevels;\n"
+	"shared vec4 tile[TILE_SIZE][TILE_SIZE];\n"
+	"vec4 Reduce(vec4 a, vec4 b, vec4 c, vec4 d) {\n"
+	"#if FILTER == FILTER_MAX\n"
+	"	return max(max(a, b), max(c, d));\n"
+	"#else\n"
+	"	return (a + b + c + d) * 0.25;\n"
+	"#endif\n"
+	"}\n"
+	"void Store(int level, ivec2 pos, vec4 value) {\n"
+	"	if (level == 1) imageStore(dstImage1, pos, value);\n"
+	"	else if (level == 2) imageStore(dstImage2, pos, value);\n"
+	"	else if (level == 3) imageStore(dstImage3, pos, value);\n"
+	"	else imageStore(dstImage4, pos, value);\n"
+	"}\n"
+	"void main() {\n"
+	"	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);\n"
+	"	ivec2 srcSize = textureSize(srcTexture, srcLevel);\n"
+	"	ivec2 dstSize = max(imageSize(dstImage0), ivec2(1));\n"
+	"#if FILTER == FILTER_KAWASE\n"
+	"	vec2 uv = (vec2(pos) + 0.5) / vec2(dstSize);\n"
+	"	vec2 halfTexel = 0.5 / vec2(dstSize);\n"
+	"	float lod = float(srcLevel);\n"
+	"	vec4 value = textureLod(srcTexture, uv, lod) * 4.0;\n"
+	"	value += textureLod(srcTexture, uv - halfTexel, lod);\n"
+	"	value += textureLod(srcTexture, uv + halfTexel, lod);\n"
+	"	value += textureLod(srcTexture, uv + vec2(halfTexel.x, -halfTexel.y), lod);\n"
+	"	value += textureLod(srcTexture, uv - vec2(halfTexel.x, -halfTexel.y), lod);\n"
+	"	imageStore(dstImage0, pos, value * 0.125);\n"
+	"#else\n"
+	"	ivec2 lid = ivec2(gl_LocalInvocationID.xy);\n"
+	"	ivec2 maxSrc = srcSize - 1;\n"
+	"	ivec2 p = (pos * srcSize) / dstSize;\n"
+	"	vec4 value = Reduce(\n"
+	"		texelFetch(srcTexture, min(p, maxSrc), srcLevel),\n"
+	"		texelFetch(srcTexture, min(p + ivec2(1, 0), maxSrc), srcLevel),\n"
+	"		texelFetch(srcTexture, min(p + ivec2(0, 1), maxSrc), srcLevel),\n"
+	"		texelFetch(srcTexture, min(p + ivec2(1, 1), maxSrc), srcLevel)\n"
+	"	);\n"
+	"	imageStore(dstImage0, pos, value);\n"
+	"	tile[lid.y][lid.x] = value;\n"
+	"	for (int level = 1; level < numDstLevels; ++level) {\n"
+	"		int tileSize = TILE_SIZE >> level;\n"
+	"		bool active = all(lessThan(lid, ivec2(tileSize)));\n"
+	"		barrier();\n"
+	"		if (active) {\n"
+	"			ivec2 t = lid * 2;\n"
+	"			value = Reduce(tile[t.y][t.x], tile[t.y][t.x + 1], tile[t.y + 1][t.x], tile[t.y + 1][t.x + 1]);\n"
+	"		}\n"
+	"		barrier();\n"
+	"		if (active) {\n"
+	"			tile[lid.y][lid.x] = value;\n"
+	"			Store(level, ivec2(gl_WorkGroupID.xy) * tileSize + lid, value);\n"
+	"		}\n"
+	"	}\n"
+	"#endif\n"
+	"}\n"
+;
+
+static bool GraphicsFormatPipelineDownsampleShaderSource(
+	PipelineDownsampleFilter filter,
+	PixelFormat pixelFormat,
+	char *buffer,
+	size_t bufferSizeInBytes
+){
+	const char *imageFormat = NULL;
+	switch (pixelFormat) {
+		case PixelFormatUnorm8Rgba:	imageFormat = "rgba8";		break;
+		case PixelFormatFp16Rgba:	imageFormat = "rgba16f";	break;
+		case PixelFormatFp32Rgba:	imageFormat = "rgba32f";	break;
+		default:					return false;
+	}
+	int length = _snprintf_s(
+		buffer,
+		bufferSizeInBytes,
+		_TRUNCATE,
+		"#version 430\n"
+		"#define FILTER %d\n"
+		"#define IMAGE_FORMAT %s\n"
+		"%s",
+		(int)filter,
+		imageFormat,
+		s_pipelineDownsampleShaderBody
+	);
+	return (length > 0);
+}
+
+/*
+	Built-in upsample shader.
+	bicubic is a cubic B-spline reconstructed from four bilinear taps.
+	bilateral is a joint bilateral upsample: the four nearest source texels
+	are weighted bilinearly and by how close the first channel of the guide
+	(e.g. linear depth) at each texel is to the guide at the output pixel,
+	which keeps edges of low resolution passes from bleeding.
+*/
+static const char s_pipelineUpsampleShaderBody[] =
+	"#define FILTER_BICUBIC 0\n"
+	"#define FILTER_BILATERAL 1\n"
+	"#define TILE_SIZE 8\n"
+	"#define BILATERAL_SHARPNESS 64.0\n"
+	"layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;\n"
+	"layout(binding = 4) uniform sampler2D srcTexture;\n"
+	"layout(binding = 5) uniform sampler2D guideTexture;\n"
+	"layout(binding = 0, IMAGE_FORMAT) writeonly uniform image2D dstImage;\n"
+	"void main() {\n"
+	"	ivec2 pos = ivec2(gl_GlobalInvocationID.xy);\n"
+	"	ivec2 dstSize = imageSize(dstImage);\n"
+	"	if (any(greaterThanEqual(pos, dstSize))) return;\n"
+	"	vec2 srcSize = vec2(textureSize(srcTexture, 0));\n"
+	"	vec2 st = (vec2(pos) + 0.5) / vec2(dstSize) * srcSize - 0.5;\n"
+	"	vec2 i = floor(st);\n"
+	"	vec2 f = st - i;\n"
+	"#if FILTER == FILTER_BILATERAL\n"
+	"	ivec2 guideSize = textureSize(guideTexture, 0);\n"
+	"	float guide = texelFetch(guideTexture, min(pos * guideSize / dstSize, guideSize - 1), 0).x;\n"
+	"	vec4 sum = vec4(0.0);\n"
+	"	float weightSum = 0.0;\n"
+	"	for (int y = 0; y < 2; ++y) {\n"
+	"		for (int x = 0; x < 2; ++x) {\n"
+	"			ivec2 t = clamp(ivec2(i) + ivec2(x, y), ivec2(0), ivec2(srcSize) - 1);\n"
+	"			ivec2 g = min(ivec2((vec2(t) + 0.5) / srcSize * vec2(guideSize)), guideSize - 1);\n"
+	"			float similarity = exp(-BILATERAL_SHARPNESS * abs(texelFetch(guideTexture, g, 0).x - guide));\n"
+	"			float weight = (x == 0? 1.0 - f.x: f.x) * (y == 0? 1.0 - f.y: f.y) * max(similarity, 1e-4);\n"
+	"			sum += texelFetch(srcTexture, t, 0) * weight;\n"
+	"			weightSum += weight;\n"
+	"		}\n"
+	"	}\n"
+	"	imageStore(dstImage, pos, sum / max(weightSum, 1e-8));\n"
+	"#else\n"
+	"	vec2 f2 = f * f;\n"
+	"	vec2 f3 = f2 * f;\n"
+	"	vec2 w0 = (1.0 - 3.0 * f + 3.0 * f2 - f3) / 6.0;\n"
+	"	vec2 w1 = (4.0 - 6.0 * f2 + 3.0 * f3) / 6.0;\n"
+	"	vec2 w2 = (1.0 + 3.0 * f + 3.0 * f2 - 3.0 * f3) / 6.0;\n"
+	"	vec2 w3 = f3 / 6.0;\n"
+	"	vec2 g0 = w0 + w1;\n"
+	"	vec2 g1 = w2 + w3;\n"
+	"	vec2 h0 = (i - 0.5 + w1 / g0) / srcSize;\n"
+	"	vec2 h1 = (i + 1.5 + w3 / g1) / srcSize;\n"
+	"	vec4 value =\n"
+	"		g0.y * (g0.x * textureLod(srcTexture, vec2(h0.x, h0.y), 0.0) + g1.x * textureLod(srcTexture, vec2(h1.x, h0.y), 0.0)) +\n"
+	"		g1.y * (g0.x * textureLod(srcTexture, vec2(h0.x, h1.y), 0.0) + g1.x * textureLod(srcTexture, vec2(h1.x, h1.y), 0.0));\n"
+	"	imageStore(dstImage, pos, value);\n"
+	"#endif\n"
+	"}\n"
+;
+
+static bool GraphicsFormatPipelineUpsampleShaderSource(
+	PipelineUpsampleFilter filter,
+	PixelFormat pixelFormat,
+	char *buffer,
+	size_t bufferSizeInBytes
+){
+	const char *imageFormat = NULL;
+	switch (pixelFormat) {
+		case PixelFormatUnorm8Rgba:	imageFormat = "rgba8";		break;
+		case PixelFormatFp16Rgba:	imageFormat = "rgba16f";	break;
+		case PixelFormatFp32Rgba:	imageFormat = "rgba32f";	break;
+		default:					return false;
+	}
+	int length = _snprintf_s(
+		buffer,
+		bufferSizeInBytes,
+		_TRUNCATE,
+		"#version 430\n"
+		"#define FILTER %d\n"
+		"#define IMAGE_FORMAT %s\n"
+		"%s",
+		(int)filter,
+		imageFormat,
+		s_pipelineUpsampleShaderBody
+	);
+	return (length > 0);
+}
+
+const char *GraphicsGetPipelineBuiltinPassShaderSource(
+	int passIndex
+){
+	if (passIndex < 0 || passIndex >= s_pipelineDescription.numPasses) return NULL;
+	const PipelinePass *pass = &s_pipelineDescription.passes[passIndex];
+	if (pass->type != PipelinePassTypeDownsample && pass->type != PipelinePassTypeUpsample) return NULL;
+
+	/* The exported runtime compiles the same source as an ordinary per-pass compute shader */
+	static char s_sources[PIPELINE_MAX_PASSES][
+		((sizeof(s_pipelineDownsampleShaderBody) > sizeof(s_pipelineUpsampleShaderBody))
+			? sizeof(s_pipelineDownsampleShaderBody)
+			: sizeof(s_pipelineUpsampleShaderBody)
+		) + 0x100
+	];
+	PixelFormat pixelFormat = s_pipelineDescription.resources[pass->outputs[0].resourceIndex].pixelFormat;
+	bool succeeded = false;
+	switch (pass->type) {
+		case PipelinePassTypeDownsample: {
+			succeeded = GraphicsFormatPipelineDownsampleShaderSource(
+				pass->downsampleFilter,
+				pixelFormat,
+				s_sources[passIndex],
+				sizeof(s_sources[passIndex])
+			);
+		} break;
+		case PipelinePassTypeUpsample: {
+			succeeded = GraphicsFormatPipelineUpsampleShaderSource(
+				pass->upsampleFilter,
+				pixelFormat,
+				s_sources[passIndex],
+				sizeof(s_sources[passIndex])
+			);
+		} break;
+		default: {
+		} break;
+	}
+	return succeeded? s_sources[passIndex]: NULL;
+}
+
+static GLuint GraphicsGetPipelineDownsampleProgram(
+	PipelineDownsampleFilter filter,
+	PixelFormat pixelFormat
+){
+	if ((int)filter < 0 || filter >= PipelineDownsampleFilterCount) return 0;
+	if ((int)pixelFormat < 0 || (int)pixelFormat >= NUM_DOWNSAMPLE_PIXEL_FORMATS) return 0;
+	GLuint *programId = &s_pipelineDownsamplePrograms[filter][pixelFormat];
+	if (*programId != 0) return *programId;
+
+	char source[sizeof(s_pipelineDownsampleShaderBody) + 0x100];
+	if (GraphicsFormatPipelineDownsampleShaderSource(filter, pixelFormat, source, sizeof(source)) == false) {
+		return 0;
+	}
+	printf("setup the downsample shader (%s, %s) ...\n",
+		PipelineDownsampleFilterToString(filter),
+		PixelFormatToPipelineString(pixelFormat)
+	);
+	const GLchar *(strings[]) = {
+		source
+	};
+	*programId = CreateShader(GL_COMPUTE_SHADER, SIZE_OF_ARRAY(strings), strings);
+	printf("setup the downsample shader ... %s.\n", (*programId != 0)? "done": "failed");
+	return *programId;
+}
+
+static void GraphicsDeletePipelineDownsamplePrograms(
 ){
-	if (s_shaderPipelineId == 0) return false;
-	glFinish();
-	glDeleteProgramPipelines(
-		/* GLsizei n */					1,
-		/* const GLuint *pipelines */	&s_shaderPipelineId
+	for (int filter = 0; filter < PipelineDownsampleFilterCount; ++filter) {
+		for (int pixelFormat = 0; pixelFormat < NUM_DOWNSAMPLE_PIXEL_FORMATS; ++pixelFormat) {
+			GLuint *programId = &s_pipelineDownsamplePrograms[filter][pixelFormat];
+			if (*programId != 0) {
+				DeleteShaderProgram(*programId);
+				*programId = 0;
+			}
+		}
+	}
+}
+
+static GLuint GraphicsGetPipelineUpsampleProgram(
+	PipelineUpsampleFilter filter,
+	PixelFormat pixelFormat
+){
+	if ((int)filter < 0 || filter >= PipelineUpsampleFilterCount) return 0;
+	if ((int)pixelFormat < 0 || (int)pixelFormat >= NUM_DOWNSAMPLE_PIXEL_FORMATS) return 0;
+	GLuint *programId = &s_pipelineUpsamplePrograms[filter][pixelFormat];
+	if (*programId != 0) return *programId;
+
+	char source[sizeof(s_pipelineUpsampleShaderBody) + 0x100];
+	if (GraphicsFormatPipelineUpsampleShaderSource(filter, pixelFormat, source, sizeof(source)) == false) {
+		return 0;
+	}
+	printf("setup the upsample shader (%s, %s) ...\n",
+		PipelineUpsampleFilterToString(filter),
+		PixelFormatToPipelineString(pixelFormat)
 	);
-	s_shaderPipelineId = 0;
-	return true;
+	const GLchar *(strings[]) = {
+		source
+	};
+	*programId = CreateShader(GL_COMPUTE_SHADER, SIZE_OF_ARRAY(strings), strings);
+	printf("setup the upsample shader ... %s.\n", (*programId != 0)? "done": "failed");
+	return *programId;
 }
 
-static void GraphicsSetTextureSampler(
-	GLenum target,
-	TextureFilter textureFilter,
-	TextureWrap textureWrap,
-	bool useMipmap
+static void GraphicsDeletePipelineUpsamplePrograms(
 ){
-	{
-		GLint minFilter = 0;
-		GLint magFilter = 0;
-		switch (textureFilter) {
-			case TextureFilterNearest: {
-				if (useMipmap) {
-					minFilter = GL_NEAREST_MIPMAP_NEAREST;
-				} else {
-					minFilter = GL_NEAREST;
+	for (int filter = 0; filter < PipelineUpsampleFilterCount; ++filter) {
+		for (int pixelFormat = 0; pixelFormat < NUM_DOWNSAMPLE_PIXEL_FORMATS; ++pixelFormat) {
+			GLuint *programId = &s_pipelineUpsamplePrograms[filter][pixelFormat];
+			if (*programId != 0) {
+				DeleteShaderProgram(*programId);
+				*programId = 0;
+			}
+		}
+	}
+}
+
+static void GraphicsDeleteTextures(
+	GLsizei n,
+	const GLuint *textures
+){
+	/* 名前は再利用されるので、バージョン情報も破棄する */
+	for (int i = 0; i < n; ++i) {
+		s_textureMipmapStates.erase(textures[i]);
+	}
+	GlStateCacheDeleteTextures(n, textures);
+}
+
+static void GraphicsMarkTextureWritten(
+	GLuint textureId
+){
+	if (textureId == 0) return;
+	s_textureMipmapStates[textureId].writeVersion++;
+}
+
+static void GraphicsMarkTextureMipmapBuilt(
+	GLuint textureId
+){
+	/* 書き込み済みのミップマップチェーンを最新とみなし、glGenerateMipmap を抑止する */
+	if (textureId == 0) return;
+	TextureMipmapState *state = &s_textureMipmapStates[textureId];
+	state->mipmapVersion = state->writeVersion;
+}
+
+static bool GraphicsShaderSamplesMipmap(
+	GLuint programId,
+	GLuint unit
+){
+	/* リフレクション情報が無ければ従来通りミップマップを参照するものとみなす */
+	const ShaderReflection *reflection = GetShaderReflection(programId);
+	if (reflection == NULL) return true;
+	if (unit >= 32) return true;
+	return (reflection->mipmapSamplerBindingMask & (1u << unit)) != 0;
+}
+
+static void GraphicsUpdateMipmapIfStale(
+	GLuint textureId
+){
+	/* textureId はアクティブなテクスチャユニットにバインドされていること */
+	if (textureId == 0) return;
+	TextureMipmapState *state = &s_textureMipmapStates[textureId];
+	if (state->mipmapVersion == state->writeVersion) return;
+	glGenerateMipmap(GL_TEXTURE_2D);
+	state->mipmapVersion = state->writeVersion;
+}
+
+static void GraphicsCreateSamplers(
+){
+	for (int filterIndex = 0; filterIndex < NUM_TEXTURE_FILTERS; filterIndex++) {
+		for (int wrapIndex = 0; wrapIndex < NUM_TEXTURE_WRAPS; wrapIndex++) {
+			for (int mipmapIndex = 0; mipmapIndex < 2; mipmapIndex++) {
+				GLuint *sampler = &s_samplers[filterIndex][wrapIndex][mipmapIndex];
+				assert(*sampler == 0);
+				glGenSamplers(1, sampler);
+
+				GLint minFilter = 0;
+				GLint magFilter = 0;
+				switch ((TextureFilter)filterIndex) {
+					case TextureFilterNearest: {
+						if (mipmapIndex) {
+							minFilter = GL_NEAREST_MIPMAP_NEAREST;
+						} else {
+							minFilter = GL_NEAREST;
+						}
+						magFilter = GL_NEAREST;
+					} break;
+					case TextureFilterLinear: {
+						if (mipmapIndex) {
+							minFilter = GL_LINEAR_MIPMAP_LINEAR;
+						} else {
+							minFilter = GL_LINEAR;
+						}
+						magFilter = GL_LINEAR;
+					} break;
+					default: {
+						assert(false);
+					} break;
 				}
-				magFilter = GL_NEAREST;
-			} break;
-			case TextureFilterLinear: {
-				if (useMipmap) {
-					minFilter = GL_LINEAR_MIPMAP_LINEAR;
-				} else {
-					minFilter = GL_LINEAR;
+				glSamplerParameteri(*sampler, GL_TEXTURE_MIN_FILTER, minFilter);
+				glSamplerParameteri(*sampler, GL_TEXTURE_MAG_FILTER, magFilter);
+
+				GLint param = GL_REPEAT;
+				switch ((TextureWrap)wrapIndex) {
+					case TextureWrapRepeat: {
+						param = GL_REPEAT;
+					} break;
+					case TextureWrapClampToEdge: {
+						param = GL_CLAMP_TO_EDGE;
+					} break;
+					case TextureWrapMirroredRepeat: {
+						param = GL_MIRRORED_REPEAT;
+					} break;
+					default: {
+						assert(false);
+					} break;
 				}
-				magFilter = GL_LINEAR;
-			} break;
-			default: {
-				assert(false);
-			} break;
+				glSamplerParameteri(*sampler, GL_TEXTURE_WRAP_S, param);
+				glSamplerParameteri(*sampler, GL_TEXTURE_WRAP_T, param);
+				glSamplerParameteri(*sampler, GL_TEXTURE_WRAP_R, param);
+			}
 		}
-		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minFilter);
-		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, magFilter);
 	}
+}
 
-	{
-		GLint param = GL_REPEAT;
-		switch (textureWrap) {
-			case TextureWrapRepeat: {
-				param = GL_REPEAT;
-			} break;
-			case TextureWrapClampToEdge: {
-				param = GL_CLAMP_TO_EDGE;
-			} break;
-			case TextureWrapMirroredRepeat: {
-				param = GL_MIRRORED_REPEAT;
-			} break;
-			default: {
-				assert(false);
-			} break;
-		}
-		if (target == GL_TEXTURE_CUBE_MAP) {
-			param = GL_CLAMP_TO_EDGE;
-		}
-		glTexParameteri(target, GL_TEXTURE_WRAP_S, param);
-		glTexParameteri(target, GL_TEXTURE_WRAP_T, param);
-		glTexParameteri(target, GL_TEXTURE_WRAP_R, param);
+static void GraphicsDeleteSamplers(
+){
+	GlStateCacheDeleteSamplers(
+		/* GLsizei n */					NUM_TEXTURE_FILTERS * NUM_TEXTURE_WRAPS * 2,
+		/* const GLuint *samplers */	&s_samplers[0][0][0]
+	);
+	memset(s_samplers, 0, sizeof(s_samplers));
+}
+
+static void GraphicsBindTextureSampler(
+	GLuint unit,
+	GLenum target,
+	TextureFilter textureFilter,
+	TextureWrap textureWrap,
+	bool useMipmap
+){
+	/* キューブマップは常に clamp to edge */
+	if (target == GL_TEXTURE_CUBE_MAP) {
+		textureWrap = TextureWrapClampToEdge;
 	}
+	GlStateCacheBindSampler(
+		/* GLuint unit */		unit,
+		/* GLuint sampler */	s_samplers[textureFilter][textureWrap][useMipmap? 1: 0]
+	);
 }
 
 static void GraphicsDrawFullScreenQuad(
@@ -1896,7 +3171,7 @@ static void GraphicsDrawFullScreenQuad(
 	}
 
 	/* シェーダパイプラインのバインド */
-	glBindProgramPipeline(
+	GlStateCacheBindProgramPipeline(
 		/* GLuint program */	s_shaderPipelineId
 	);
 
@@ -1904,18 +3179,24 @@ static void GraphicsDrawFullScreenQuad(
 	if (settings->enableBackBuffer) {
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; renderTargetIndex++) {
 			/* 裏テクスチャのバインド */
-			glActiveTexture(GL_TEXTURE0 + renderTargetIndex);
-			glBindTexture(
+			GLuint textureId = s_mrtTextures[(params->frameCount & 1) ^ 1] [renderTargetIndex];
+			GlStateCacheActiveTexture(GL_TEXTURE0 + renderTargetIndex);
+			GlStateCacheBindTexture(
 				/* GLenum target */		GL_TEXTURE_2D,
-				/* GLuint texture */	s_mrtTextures[(params->frameCount & 1) ^ 1] [renderTargetIndex]
+				/* GLuint texture */	textureId
 			);
 
+			/* シェーダがミップマップを参照するユニットに限りミップマップを使う */
+			bool useMipmap =
+					settings->enableMipmapGeneration
+				&&	GraphicsShaderSamplesMipmap(s_fragmentShaderId, renderTargetIndex);
+
 			/* サンプラの設定 */
-			GraphicsSetTextureSampler(GL_TEXTURE_2D, settings->textureFilter, settings->textureWrap, settings->enableMipmapGeneration);
+			GraphicsBindTextureSampler(renderTargetIndex, GL_TEXTURE_2D, settings->textureFilter, settings->textureWrap, useMipmap);
 
-			/* ミップマップ生成 */
-			if (settings->enableMipmapGeneration) {
-				glGenerateMipmap(GL_TEXTURE_2D);
+			/* ミップマップ生成（前回の生成以降に書き込まれている場合のみ）*/
+			if (useMipmap) {
+				GraphicsUpdateMipmapIfStale(textureId);
 			}
 		}
 	}
@@ -1925,14 +3206,14 @@ static void GraphicsDrawFullScreenQuad(
 		int computeTextureIndex = (params->frameCount & 1) ^ 1;
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; renderTargetIndex++) {
 			if (s_computeTextures[computeTextureIndex][renderTargetIndex] != 0) {
-				glActiveTexture(GL_TEXTURE0 + COMPUTE_TEXTURE_START_INDEX + renderTargetIndex);
-				glBindTexture(
+				GlStateCacheActiveTexture(GL_TEXTURE0 + COMPUTE_TEXTURE_START_INDEX + renderTargetIndex);
+				GlStateCacheBindTexture(
 					/* GLenum target */		GL_TEXTURE_2D,
 					/* GLuint texture */	s_computeTextures[computeTextureIndex][renderTargetIndex]
 				);
 
 				/* サンプラの設定 */
-				GraphicsSetTextureSampler(GL_TEXTURE_2D, settings->textureFilter, settings->textureWrap, false);
+				GraphicsBindTextureSampler(COMPUTE_TEXTURE_START_INDEX + renderTargetIndex, GL_TEXTURE_2D, settings->textureFilter, settings->textureWrap, false);
 			}
 		}
 	}
@@ -1941,19 +3222,19 @@ static void GraphicsDrawFullScreenQuad(
 	for (int userTextureIndex = 0; userTextureIndex < NUM_USER_TEXTURES; userTextureIndex++) {
 		if (s_userTextures[userTextureIndex].id) {
 			/* テクスチャのバインド */
-			glActiveTexture(GL_TEXTURE0 + USER_TEXTURE_START_INDEX + userTextureIndex);
-			glBindTexture(
+			GlStateCacheActiveTexture(GL_TEXTURE0 + USER_TEXTURE_START_INDEX + userTextureIndex);
+			GlStateCacheBindTexture(
 				/* GLenum target */		s_userTextures[userTextureIndex].target,
 				/* GLuint texture */	s_userTextures[userTextureIndex].id
 			);
 
 			/* サンプラの設定 */
-			GraphicsSetTextureSampler(s_userTextures[userTextureIndex].target, settings->textureFilter, settings->textureWrap, true);
+			GraphicsBindTextureSampler(USER_TEXTURE_START_INDEX + userTextureIndex, s_userTextures[userTextureIndex].target, settings->textureFilter, settings->textureWrap, true);
 		}
 	}
 
 	/* サウンドバッファのバインド */
-	glBindBufferBase(
+	GlStateCacheBindBufferBase(
 		/* GLenum target */		GL_SHADER_STORAGE_BUFFER,
 		/* GLuint index */		BUFFER_INDEX_FOR_SOUND_VISUALIZER_INPUT,
 		/* GLuint buffer */		SoundGetOutputSsbo()
@@ -1961,47 +3242,48 @@ static void GraphicsDrawFullScreenQuad(
 
 	/* ユニフォームパラメータ設定 */
 	{
-		glUseProgram(s_fragmentShaderId);
+		const ShaderReflection *reflection = GetShaderReflection(s_fragmentShaderId);
+		GlStateCacheUseProgram(s_fragmentShaderId);
 
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
 			glUniform1i(
 				/* GLint location */	UNIFORM_LOCATION_PIPELINE_PASS_INDEX,
 				/* GLint v0 */			s_activePipelinePassIndex
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
 			glUniform1i(
 				/* GLint location */	UNIFORM_LOCATION_WAVE_OUT_POS,
 				/* GLint v0 */			params->waveOutPos
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
 			glUniform1i(
 				/* GLint location */	UNIFORM_LOCATION_FRAME_COUNT,
 				/* GLint v0 */			params->frameCount
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
 			glUniform1f(
 				/* GLint location */	UNIFORM_LOCATION_TIME,
 				/* GLfloat v0 */		params->time
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
 			glUniform2f(
 				/* GLint location */	UNIFORM_LOCATION_RESO,
 				/* GLfloat v0 */		(GLfloat)params->xReso,
 				/* GLfloat v1 */		(GLfloat)params->yReso
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
 			glUniform2f(
 				/* GLint location */	UNIFORM_LOCATION_MOUSE_POS,
 				/* GLfloat v0 */		(GLfloat)params->xMouse / (GLfloat)params->xReso,
 				/* GLfloat v1 */		1.0f - (GLfloat)params->yMouse / (GLfloat)params->yReso
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
 			glUniform3i(
 				/* GLint location */	UNIFORM_LOCATION_MOUSE_BUTTONS,
 				/* GLint v0 */			params->mouseLButtonPressed,
@@ -2009,13 +3291,13 @@ static void GraphicsDrawFullScreenQuad(
 				/* GLint v2 */			params->mouseRButtonPressed
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
 			glUniform1f(
 				/* GLint location */	UNIFORM_LOCATION_TAN_FOVY,
 				/* GLfloat v0 */		tanf(params->fovYInRadians)
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
 			glUniformMatrix4fv(
 				/* GLint location */		UNIFORM_LOCATION_CAMERA_COORD,
 				/* GLsizei count */			1,
@@ -2023,7 +3305,7 @@ static void GraphicsDrawFullScreenQuad(
 				/* const GLfloat *value */	&params->mat4x4CameraInWorld[0][0]
 			);
 		}
-		if (ExistsShaderUniform(s_fragmentShaderId, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
+		if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
 			glUniformMatrix4fv(
 				/* GLint location */		UNIFORM_LOCATION_PREV_CAMERA_COORD,
 				/* GLsizei count */			1,
@@ -2034,13 +3316,13 @@ static void GraphicsDrawFullScreenQuad(
 	}
 
 	/* MRT フレームバッファのバインド */
-	glBindFramebuffer(
+	GlStateCacheBindFramebuffer(
 		/* GLenum target */			GL_FRAMEBUFFER,
 		/* GLuint framebuffer */	s_mrtFrameBuffer
 	);
 
 	/* ビューポートの設定 */
-	glViewport(0, 0, params->xReso, params->yReso);
+	GlStateCacheViewport(0, 0, params->xReso, params->yReso);
 
 	/* MRT の設定 */
 	{
@@ -2094,6 +3376,12 @@ static void GraphicsDrawFullScreenQuad(
 			/* GLint first */	0,
 			/* GLsizei count */	4
 		);
+
+		/* 書き込んだ表テクスチャのバージョンを進める */
+		int numRenderTargets = settings->enableMultipleRenderTargets? settings->numEnabledRenderTargets: 1;
+		for (int renderTargetIndex = 0; renderTargetIndex < numRenderTargets; renderTargetIndex++) {
+			GraphicsMarkTextureWritten(s_mrtTextures[params->frameCount & 1] [renderTargetIndex]);
+		}
 	}
 
 	/* 描画結果をデフォルトフレームバッファにコピー */
@@ -2113,13 +3401,13 @@ static void GraphicsDrawFullScreenQuad(
 	);
 
 	/* MRT フレームバッファのアンバインド */
-	glBindFramebuffer(
+	GlStateCacheBindFramebuffer(
 		/* GLenum target */			GL_FRAMEBUFFER,
 		/* GLuint framebuffer */	0	/* unbind */
 	);
 
 	/* サウンドバッファのアンバインド */
-	glBindBufferBase(
+	GlStateCacheBindBufferBase(
 		/* GLenum target */			GL_SHADER_STORAGE_BUFFER,
 		/* GLuint index */			BUFFER_INDEX_FOR_SOUND_VISUALIZER_INPUT,
 		/* GLuint buffer */			0	/* unbind */
@@ -2128,8 +3416,8 @@ static void GraphicsDrawFullScreenQuad(
 	/* ユーザーテクスチャのアンバインド */
 	for (int userTextureIndex = 0; userTextureIndex < NUM_USER_TEXTURES; userTextureIndex++) {
 		if (s_userTextures[userTextureIndex].id) {
-			glActiveTexture(GL_TEXTURE0 + USER_TEXTURE_START_INDEX + userTextureIndex);
-			glBindTexture(
+			GlStateCacheActiveTexture(GL_TEXTURE0 + USER_TEXTURE_START_INDEX + userTextureIndex);
+			GlStateCacheBindTexture(
 				/* GLenum target */		s_userTextures[userTextureIndex].target,
 				/* GLuint texture */	0	/* unbind */
 			);
@@ -2139,8 +3427,8 @@ static void GraphicsDrawFullScreenQuad(
 	/* コンピュートテクスチャのアンバインド */
 	if (s_computeShaderId != 0) {
 		for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; renderTargetIndex++) {
-			glActiveTexture(GL_TEXTURE0 + COMPUTE_TEXTURE_START_INDEX + renderTargetIndex);
-			glBindTexture(
+			GlStateCacheActiveTexture(GL_TEXTURE0 + COMPUTE_TEXTURE_START_INDEX + renderTargetIndex);
+			GlStateCacheBindTexture(
 				/* GLenum target */		GL_TEXTURE_2D,
 				/* GLuint texture */	0	/* unbind */
 			);
@@ -2149,80 +3437,140 @@ static void GraphicsDrawFullScreenQuad(
 
 	/* MRT テクスチャのアンバインド */
 	for (int renderTargetIndex = 0; renderTargetIndex < NUM_RENDER_TARGETS; renderTargetIndex++) {
-		glActiveTexture(GL_TEXTURE0 + renderTargetIndex);
-		glBindTexture(
+		GlStateCacheActiveTexture(GL_TEXTURE0 + renderTargetIndex);
+		GlStateCacheBindTexture(
 			/* GLenum target */		GL_TEXTURE_2D,
 			/* GLuint texture */	0	/* unbind */
 		);
 	}
 
 	/* シェーダパイプラインのアンバインド */
-	glBindProgramPipeline(NULL);
+	GlStateCacheBindProgramPipeline(NULL);
 }
 
-bool GraphicsCaptureScreenShotOnMemory(
-	void *buffer,
-	size_t bufferSizeInBytes,
-	const CurrentFrameParams *params,
-	const RenderSettings *renderSettings,
-	const CaptureScreenShotSettings *captureSettings
+/* キャプチャ用のオフスクリーンレンダーターゲットを取得し、FBO をバインドして返す */
+static GLuint GraphicsAcquireCaptureRenderTarget(
+	int xReso,
+	int yReso,
+	GLenum internalformat
 ){
-	/* OpenGL のピクセルフォーマット情報 */
-	GlPixelFormatInfo glPixelFormatInfo = PixelFormatToGlPixelFormatInfo(renderSettings->pixelFormat);
-
-	/* バッファ容量が不足しているならエラー */
-	if (bufferSizeInBytes < (size_t)(params->xReso * params->yReso * glPixelFormatInfo.numBitsPerPixel / 8)) return false;
+	/* 解像度かフォーマットが変わった場合のみ作り直す */
+	if (s_captureRenderTarget.fbo != 0
+	&&	s_captureRenderTarget.xReso == xReso
+	&&	s_captureRenderTarget.yReso == yReso
+	&&	s_captureRenderTarget.internalformat == internalformat
+	) {
+		GlStateCacheBindFramebuffer(
+			/* GLenum target */			GL_FRAMEBUFFER,
+			/* GLuint framebuffer */	s_captureRenderTarget.fbo
+		);
+		return s_captureRenderTarget.fbo;
+	}
+	GraphicsReleaseCaptureRenderTarget();
+	s_captureRenderTarget.xReso = xReso;
+	s_captureRenderTarget.yReso = yReso;
+	s_captureRenderTarget.internalformat = internalformat;
 
 	/* FBO 作成 */
-	GLuint offscreenRenderTargetFbo = 0;
-	GLuint offscreenRenderTargetTexture = 0;
 	glGenFramebuffers(
 		/* GLsizei n */				1,
-	 	/* GLuint *ids */			&offscreenRenderTargetFbo
+	 	/* GLuint *ids */			&s_captureRenderTarget.fbo
 	);
-	glBindFramebuffer(
+	GlStateCacheBindFramebuffer(
 		/* GLenum target */			GL_FRAMEBUFFER,
-		/* GLuint framebuffer */	offscreenRenderTargetFbo
+		/* GLuint framebuffer */	s_captureRenderTarget.fbo
 	);
 
 	/* レンダーターゲットとなるテクスチャ作成 */
 	glGenTextures(
 		/* GLsizei n */				1,
-		/* GLuint * textures */		&offscreenRenderTargetTexture
+		/* GLuint * textures */		&s_captureRenderTarget.texture
 	);
-	glBindTexture(
+	GlStateCacheBindTexture(
 		/* GLenum target */			GL_TEXTURE_2D,
-		/* GLuint texture */		offscreenRenderTargetTexture
+		/* GLuint texture */		s_captureRenderTarget.texture
 	);
 	glTexStorage2D(
 		/* GLenum target */			GL_TEXTURE_2D,
 		/* GLsizei levels */		1,
-		/* GLenum internalformat */	glPixelFormatInfo.internalformat,
-		/* GLsizei width */			params->xReso,
-		/* GLsizei height */		params->yReso
+		/* GLenum internalformat */	internalformat,
+		/* GLsizei width */			xReso,
+		/* GLsizei height */		yReso
 	);
 
 	/* レンダーターゲットのバインド */
 	glFramebufferTexture(
 		/* GLenum target */			GL_FRAMEBUFFER,
 		/* GLenum attachment */		GL_COLOR_ATTACHMENT0,
-		/* GLuint texture */		offscreenRenderTargetTexture,
+		/* GLuint texture */		s_captureRenderTarget.texture,
 		/* GLint level */			0
 	);
+	return s_captureRenderTarget.fbo;
+}
+
+/* キャプチャ用のオフスクリーンレンダーターゲットの解放 */
+static void GraphicsReleaseCaptureRenderTarget(
+){
+	if (s_captureRenderTarget.texture != 0) {
+		GraphicsDeleteTextures(
+			/* GLsizei n */						1,
+			/* const GLuint * textures */		&s_captureRenderTarget.texture
+		);
+	}
+	if (s_captureRenderTarget.fbo != 0) {
+		GlStateCacheDeleteFramebuffers(
+			/* GLsizei n */						1,
+			/* const GLuint * framebuffers */	&s_captureRenderTarget.fbo
+		);
+	}
+	memset(&s_captureRenderTarget, 0, sizeof(s_captureRenderTarget));
+}
+
+/* 単発のキャプチャの後始末（連番画像キャプチャ中はセッション終了まで保持する）*/
+static void GraphicsFinishCaptureRenderTarget(
+){
+	if (s_captureSequence.active == false) {
+		GraphicsReleaseCaptureRenderTarget();
+	}
+}
+
+bool GraphicsCaptureScreenShotOnMemory(
+	void *buffer,
+	size_t bufferSizeInBytes,
+	const CurrentFrameParams *params,
+	const RenderSettings *renderSettings,
+	const CaptureScreenShotSettings *captureSettings
+){
+	/* OpenGL のピクセルフォーマット情報 */
+	GlPixelFormatInfo glPixelFormatInfo = PixelFormatToGlPixelFormatInfo(renderSettings->pixelFormat);
+
+	/* バッファ容量が不足しているならエラー */
+	if (bufferSizeInBytes < (size_t)(params->xReso * params->yReso * glPixelFormatInfo.numBitsPerPixel / 8)) return false;
+
+	/* キャプチャは常に等倍。キャプチャによる停止時間も計測から除外する */
+	GraphicsResetDynamicResolution();
+
+	/* オフスクリーンレンダーターゲット取得（解像度とフォーマットが同じなら使い回す）*/
+	GLuint offscreenRenderTargetFbo = GraphicsAcquireCaptureRenderTarget(
+		/* int xReso */				params->xReso,
+		/* int yReso */				params->yReso,
+		/* GLenum internalformat */	glPixelFormatInfo.internalformat
+	);
 
 	/* FBO 設定、ビューポート設定 */
-	glBindFramebuffer(
+	GlStateCacheBindFramebuffer(
 		/* GLenum target */			GL_FRAMEBUFFER,
 		/* GLuint framebuffer */	offscreenRenderTargetFbo
 	);
 
 	/* 画面全体に四角形を描画 */
+	GraphicsUploadFrameParams(params);
 	GraphicsDispatchCompute(params, renderSettings);
 	GraphicsDrawFullScreenQuad(offscreenRenderTargetFbo, params, renderSettings);
 
 	/* 描画結果の取得 */
 	glFinish();		/* 不要と信じたいが念のため */
-	glBindFramebuffer(
+	GlStateCacheBindFramebuffer(
 		/* GLenum target */			GL_FRAMEBUFFER,
 		/* GLuint framebuffer */	offscreenRenderTargetFbo
 	);
@@ -2255,19 +3603,160 @@ bool GraphicsCaptureScreenShotOnMemory(
 		}
 	}
 
-	/* オフスクリーンレンダーターゲット、FBO 破棄 */
-	glDeleteTextures(
-		/* GLsizei n */						1,
-		/* const GLuint * textures */		&offscreenRenderTargetTexture
+	/* 連番画像キャプチャ中でなければオフスクリーンレンダーターゲットを解放 */
+	GraphicsFinishCaptureRenderTarget();
+
+	return true;
+}
+
+bool GraphicsCaptureSequenceBegin(
+	int xReso,
+	int yReso,
+	int numSlots,
+	const RenderSettings *renderSettings
+){
+	assert(s_captureSequence.active == false);
+	if (numSlots < 1 || RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS < numSlots) return false;
+	memset(&s_captureSequence, 0, sizeof(s_captureSequence));
+	s_captureSequence.numSlots = numSlots;
+	s_captureSequence.xReso = xReso;
+	s_captureSequence.yReso = yReso;
+	s_captureSequence.glPixelFormatInfo = PixelFormatToGlPixelFormatInfo(renderSettings->pixelFormat);
+	s_captureSequence.frameSizeInBytes = (GLsizeiptr)xReso * yReso * s_captureSequence.glPixelFormatInfo.numBitsPerPixel / 8;
+	s_captureSequence.active = true;
+
+	/* オフスクリーンレンダーターゲットはセッション中の全フレームで共有 */
+	GraphicsAcquireCaptureRenderTarget(
+		/* int xReso */				xReso,
+		/* int yReso */				yReso,
+		/* GLenum internalformat */	s_captureSequence.glPixelFormatInfo.internalformat
+	);
+
+	/* 読み出し先のバッファは CPU から直接参照できるよう永続マップしておく */
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(s_captureSequence.numSlots, s_captureSequence.buffers);
+	for (int slot = 0; slot < s_captureSequence.numSlots; slot++) {
+		GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, s_captureSequence.buffers[slot]);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, s_captureSequence.frameSizeInBytes, NULL, flags | GL_CLIENT_STORAGE_BIT);
+		s_captureSequence.mappedPointers[slot] = glMapBufferRange(
+			GL_PIXEL_PACK_BUFFER,
+			0,
+			s_captureSequence.frameSizeInBytes,
+			flags
+		);
+		if (s_captureSequence.mappedPointers[slot] == NULL) {
+			GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			GraphicsCaptureSequenceEnd();
+			return false;
+		}
+	}
+	GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return true;
+}
+
+bool GraphicsCaptureSequenceRenderFrame(
+	int slot,
+	const CurrentFrameParams *params,
+	const RenderSettings *renderSettings,
+	bool replaceAlphaByOne
+){
+	if (s_captureSequence.active == false) return false;
+	if (slot < 0 || s_captureSequence.numSlots <= slot) return false;
+	if (params->xReso != s_captureSequence.xReso || params->yReso != s_captureSequence.yReso) return false;
+
+	/* キャプチャは常に等倍。キャプチャによる停止時間も計測から除外する */
+	GraphicsResetDynamicResolution();
+
+	/* 画面全体に四角形を描画 */
+	GLuint offscreenRenderTargetFbo = GraphicsAcquireCaptureRenderTarget(
+		/* int xReso */				params->xReso,
+		/* int yReso */				params->yReso,
+		/* GLenum internalformat */	s_captureSequence.glPixelFormatInfo.internalformat
 	);
-	glDeleteFramebuffers(
-		/* GLsizei n */						1,
-		/* const GLuint * framebuffers */	&offscreenRenderTargetFbo
+	GraphicsUploadFrameParams(params);
+	GraphicsDispatchCompute(params, renderSettings);
+	GraphicsDrawFullScreenQuad(offscreenRenderTargetFbo, params, renderSettings);
+	GlStateCacheBindFramebuffer(
+		/* GLenum target */			GL_FRAMEBUFFER,
+		/* GLuint framebuffer */	offscreenRenderTargetFbo
 	);
 
+	/* αチャンネルの強制 1.0 置換（CPU で書き換えずに済むよう GPU で行う）*/
+	if (replaceAlphaByOne) {
+		static const GLfloat s_one[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_TRUE);
+		glClearBufferfv(GL_COLOR, 0, s_one);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+	/* スロットのバッファへの読み出しを発行し、完了を待たずに戻る */
+	GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, s_captureSequence.buffers[slot]);
+	glReadPixels(
+		/* GLint x */				0,
+		/* GLint y */				0,
+		/* GLsizei width */			params->xReso,
+		/* GLsizei height */		params->yReso,
+		/* GLenum format */			s_captureSequence.glPixelFormatInfo.format,
+		/* GLenum type */			s_captureSequence.glPixelFormatInfo.type,
+		/* GLvoid * data */			NULL	/* バッファ先頭からのオフセット */
+	);
+	GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (s_captureSequence.fences[slot] != NULL) {
+		glDeleteSync(s_captureSequence.fences[slot]);
+	}
+	s_captureSequence.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
 	return true;
 }
 
+const void *GraphicsCaptureSequenceMapFrame(
+	int slot
+){
+	if (s_captureSequence.active == false) return NULL;
+	if (slot < 0 || s_captureSequence.numSlots <= slot) return NULL;
+	GLsync fence = s_captureSequence.fences[slot];
+	if (fence == NULL) return NULL;
+
+	/*
+		読み出しの完了待ち
+		GPU のハングやドライバのリセットで永久に待たないよう、数回タイムアウト
+		したら失敗とする（フェンスは GraphicsCaptureSequenceEnd で破棄される）。
+	*/
+	PROFILER_CPU_SCOPE("capture readback wait");
+	for (int retry = 0; ; retry++) {
+		if (retry == 5) return NULL;
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 /* 1 sec */);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+		if (result == GL_WAIT_FAILED) return NULL;
+	}
+	glDeleteSync(fence);
+	s_captureSequence.fences[slot] = NULL;
+	return s_captureSequence.mappedPointers[slot];
+}
+
+void GraphicsCaptureSequenceEnd(
+){
+	if (s_captureSequence.active == false) return;
+
+	/* 読み出し中のバッファは完了を待ってから破棄する */
+	for (int slot = 0; slot < s_captureSequence.numSlots; slot++) {
+		if (s_captureSequence.fences[slot] != NULL) {
+			glClientWaitSync(s_captureSequence.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 /* 1 sec */);
+			glDeleteSync(s_captureSequence.fences[slot]);
+		}
+		if (s_captureSequence.mappedPointers[slot] != NULL) {
+			GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, s_captureSequence.buffers[slot]);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+	}
+	GlStateCacheBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	GlStateCacheDeleteBuffers(s_captureSequence.numSlots, s_captureSequence.buffers);
+
+	/* セッション終了でオフスクリーンレンダーターゲットを解放 */
+	GraphicsReleaseCaptureRenderTarget();
+	memset(&s_captureSequence, 0, sizeof(s_captureSequence));
+}
+
 bool GraphicsCaptureScreenShotAsPngTexture2d(
 	const CurrentFrameParams *params,
 	const RenderSettings *renderSettings,
@@ -2346,47 +3835,21 @@ bool GraphicsCaptureAsDdsCubemap(
 	/* OpenGL のピクセルフォーマット情報 */
 	GlPixelFormatInfo glPixelFormatInfo = PixelFormatToGlPixelFormatInfo(renderSettings->pixelFormat);
 
+	/* キャプチャは常に等倍。キャプチャによる停止時間も計測から除外する */
+	GraphicsResetDynamicResolution();
+
 	/* 先だって全レンダーターゲットのクリア */
 	GraphicsClearAllRenderTargets();
 
-	/* FBO 作成 */
-	GLuint offscreenRenderTargetFbo = 0;
-	GLuint offscreenRenderTargetTexture = 0;
-	glGenFramebuffers(
-		/* GLsizei n */				1,
-	 	/* GLuint *ids */			&offscreenRenderTargetFbo
-	);
-	glBindFramebuffer(
-		/* GLenum target */			GL_FRAMEBUFFER,
-		/* GLuint framebuffer */	offscreenRenderTargetFbo
-	);
-
-	/* レンダーターゲットとなるテクスチャ作成 */
-	glGenTextures(
-		/* GLsizei n */				1,
-		/* GLuint * textures */		&offscreenRenderTargetTexture
-	);
-	glBindTexture(
-		/* GLenum target */			GL_TEXTURE_2D,
-		/* GLuint texture */		offscreenRenderTargetTexture
-	);
-	glTexStorage2D(
-		/* GLenum target */			GL_TEXTURE_2D,
-		/* GLsizei levels */		1,
-		/* GLenum internalformat */	glPixelFormatInfo.internalformat,
-		/* GLsizei width */			params->xReso,
-		/* GLsizei height */		params->yReso
-	);
-
-	/* レンダーターゲットのバインド */
-	glFramebufferTexture(
-		/* GLenum target */			GL_FRAMEBUFFER,
-		/* GLenum attachment */		GL_COLOR_ATTACHMENT0,
-		/* GLuint texture */		offscreenRenderTargetTexture,
-		/* GLint level */			0
+	/* オフスクリーンレンダーターゲット取得（解像度とフォーマットが同じなら使い回す）*/
+	GLuint offscreenRenderTargetFbo = GraphicsAcquireCaptureRenderTarget(
+		/* int xReso */				params->xReso,
+		/* int yReso */				params->yReso,
+		/* GLenum internalformat */	glPixelFormatInfo.internalformat
 	);
 
 	/* キューブマップ各面の描画と結果の取得 */
+	GraphicsUploadFrameParams(params);
 	GraphicsDispatchCompute(params, renderSettings);
 	void *(data[6]);
 	for (int iFace = 0; iFace < 6; iFace++) {
@@ -2572,12 +4035,13 @@ bool GraphicsCaptureAsDdsCubemap(
 		}
 
 		/* 画面全体に四角形を描画 */
+		GraphicsUploadFrameParams(&faceParams);
 		GraphicsDrawFullScreenQuad(offscreenRenderTargetFbo, &faceParams, renderSettings);
 
 		/* 描画結果の取得 */
 		data[iFace] = malloc(sizeof(float) * 4 * params->xReso * params->yReso);
 		glFinish();		/* 不要と信じたいが念のため */
-		glBindFramebuffer(
+		GlStateCacheBindFramebuffer(
 			/* GLenum target */			GL_FRAMEBUFFER,
 			/* GLuint framebuffer */	offscreenRenderTargetFbo
 		);
@@ -2612,15 +4076,8 @@ bool GraphicsCaptureAsDdsCubemap(
 		free(data[iFace]);
 	}
 
-	/* オフスクリーンレンダーターゲット、FBO 破棄 */
-	glDeleteTextures(
-		/* GLsizei n */						1,
-		/* const GLuint * textures */		&offscreenRenderTargetTexture
-	);
-	glDeleteFramebuffers(
-		/* GLsizei n */						1,
-		/* const GLuint * framebuffers */	&offscreenRenderTargetFbo
-	);
+	/* 連番画像キャプチャ中でなければオフスクリーンレンダーターゲットを解放 */
+	GraphicsFinishCaptureRenderTarget();
 
 	return ret;
 }
@@ -2668,46 +4125,47 @@ static void GraphicsDispatchCompute(
 		);
 	}
 
-	glUseProgram(s_computeShaderId);
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
+	const ShaderReflection *reflection = GetShaderReflection(s_computeShaderId);
+	GlStateCacheUseProgram(s_computeShaderId);
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT)) {
 		glUniform1i(
 			/* GLint location */	UNIFORM_LOCATION_PIPELINE_PASS_INDEX,
 			/* GLint v0 */			s_activePipelinePassIndex
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
 		glUniform1i(
 			/* GLint location */	UNIFORM_LOCATION_WAVE_OUT_POS,
 			/* GLint v0 */			params->waveOutPos
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_FRAME_COUNT, GL_INT)) {
 		glUniform1i(
 			/* GLint location */	UNIFORM_LOCATION_FRAME_COUNT,
 			/* GLint v0 */			params->frameCount
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TIME, GL_FLOAT)) {
 		glUniform1f(
 			/* GLint location */	UNIFORM_LOCATION_TIME,
 			/* GLfloat v0 */		params->time
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2)) {
 		glUniform2f(
 			/* GLint location */	UNIFORM_LOCATION_RESO,
 			/* GLfloat v0 */		(GLfloat)params->xReso,
 			/* GLfloat v1 */		(GLfloat)params->yReso
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_POS, GL_FLOAT_VEC2)) {
 		glUniform2f(
 			/* GLint location */	UNIFORM_LOCATION_MOUSE_POS,
 			/* GLfloat v0 */		(GLfloat)params->xMouse / (GLfloat)params->xReso,
 			/* GLfloat v1 */		1.0f - (GLfloat)params->yMouse / (GLfloat)params->yReso
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3)) {
 		glUniform3i(
 			/* GLint location */	UNIFORM_LOCATION_MOUSE_BUTTONS,
 			/* GLint v0 */			params->mouseLButtonPressed,
@@ -2715,13 +4173,13 @@ static void GraphicsDispatchCompute(
 			/* GLint v2 */			params->mouseRButtonPressed
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_TAN_FOVY, GL_FLOAT)) {
 		glUniform1f(
 			/* GLint location */	UNIFORM_LOCATION_TAN_FOVY,
 			/* GLfloat v0 */		tanf(params->fovYInRadians)
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_CAMERA_COORD, GL_FLOAT_MAT4)) {
 		glUniformMatrix4fv(
 			/* GLint location */		UNIFORM_LOCATION_CAMERA_COORD,
 			/* GLsizei count */			1,
@@ -2729,7 +4187,7 @@ static void GraphicsDispatchCompute(
 			/* const GLfloat *value */	&params->mat4x4CameraInWorld[0][0]
 		);
 	}
-	if (ExistsShaderUniform(s_computeShaderId, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
+	if (ShaderReflectionHasUniform(reflection, UNIFORM_LOCATION_PREV_CAMERA_COORD, GL_FLOAT_MAT4)) {
 		glUniformMatrix4fv(
 			/* GLint location */		UNIFORM_LOCATION_PREV_CAMERA_COORD,
 			/* GLsizei count */			1,
@@ -2774,18 +4232,250 @@ static void GraphicsDispatchCompute(
 	}
 }
 
+static void GraphicsCreateFrameParamsRing(
+){
+	assert(s_frameParamsRing.buffer == 0);
+
+	/* Each slot must start at a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT */
+	GLint offsetAlignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	if (offsetAlignment <= 0) offsetAlignment = 256;
+	s_frameParamsRing.slotStride =
+		(GLsizeiptr)((sizeof(FrameParamsBlock) + offsetAlignment - 1) / offsetAlignment * offsetAlignment);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &s_frameParamsRing.buffer);
+	GlStateCacheBindBuffer(GL_UNIFORM_BUFFER, s_frameParamsRing.buffer);
+	glBufferStorage(GL_UNIFORM_BUFFER, s_frameParamsRing.slotStride * FRAME_PARAMS_RING_SIZE, NULL, flags);
+	s_frameParamsRing.mappedPointer = (uint8_t *)glMapBufferRange(
+		GL_UNIFORM_BUFFER,
+		0,
+		s_frameParamsRing.slotStride * FRAME_PARAMS_RING_SIZE,
+		flags
+	);
+	memset(s_frameParamsRing.mappedPointer, 0, s_frameParamsRing.slotStride * FRAME_PARAMS_RING_SIZE);
+	GlStateCacheBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	s_frameParamsRing.currentSlot = 0;
+	GlStateCacheBindBufferRange(
+		GL_UNIFORM_BUFFER,
+		UNIFORM_BLOCK_BINDING_FRAME_PARAMS,
+		s_frameParamsRing.buffer,
+		0,
+		sizeof(FrameParamsBlock)
+	);
+}
+
+static void GraphicsDeleteFrameParamsRing(
+){
+	for (int slot = 0; slot < FRAME_PARAMS_RING_SIZE; ++slot) {
+		if (s_frameParamsRing.fences[slot] != NULL) {
+			glDeleteSync(s_frameParamsRing.fences[slot]);
+		}
+	}
+	if (s_frameParamsRing.buffer != 0) {
+		GlStateCacheBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING_FRAME_PARAMS, 0);
+		GlStateCacheBindBuffer(GL_UNIFORM_BUFFER, s_frameParamsRing.buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		GlStateCacheBindBuffer(GL_UNIFORM_BUFFER, 0);
+		GlStateCacheDeleteBuffers(1, &s_frameParamsRing.buffer);
+	}
+	memset(&s_frameParamsRing, 0, sizeof(s_frameParamsRing));
+}
+
+static void GraphicsUploadFrameParams(
+	const CurrentFrameParams *params
+){
+	if (s_frameParamsRing.mappedPointer == NULL) return;
+
+	/* The slot in use so far is retired once the commands issued so far complete */
+	int prevSlot = s_frameParamsRing.currentSlot;
+	if (s_frameParamsRing.fences[prevSlot] != NULL) {
+		glDeleteSync(s_frameParamsRing.fences[prevSlot]);
+	}
+	s_frameParamsRing.fences[prevSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	/* Wait until the GPU has finished reading the slot we are about to overwrite */
+	int slot = (prevSlot + 1) % FRAME_PARAMS_RING_SIZE;
+	if (s_frameParamsRing.fences[slot] != NULL) {
+		glClientWaitSync(s_frameParamsRing.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 /* 1 sec */);
+		glDeleteSync(s_frameParamsRing.fences[slot]);
+		s_frameParamsRing.fences[slot] = NULL;
+	}
+	s_frameParamsRing.currentSlot = slot;
+
+	FrameParamsBlock *block = (FrameParamsBlock *)(s_frameParamsRing.mappedPointer + s_frameParamsRing.slotStride * slot);
+	memcpy(block->mat4x4CameraInWorld, params->mat4x4CameraInWorld, sizeof(block->mat4x4CameraInWorld));
+	memcpy(block->mat4x4PrevCameraInWorld, params->mat4x4PrevCameraInWorld, sizeof(block->mat4x4PrevCameraInWorld));
+	block->resolution[0] = (GLfloat)params->xReso;
+	block->resolution[1] = (GLfloat)params->yReso;
+	block->mouse[0] = (GLfloat)params->xMouse / (GLfloat)params->xReso;
+	block->mouse[1] = 1.0f - (GLfloat)params->yMouse / (GLfloat)params->yReso;
+	block->mouseButtons[0] = params->mouseLButtonPressed;
+	block->mouseButtons[1] = params->mouseMButtonPressed;
+	block->mouseButtons[2] = params->mouseRButtonPressed;
+	block->waveOutPos = params->waveOutPos;
+	block->frameCount = params->frameCount;
+	block->time = params->time;
+	block->tanFovY = tanf(params->fovYInRadians);
+	block->padding = 0;
+
+	/* The binding stays in place so the sound shader sees the same block */
+	GlStateCacheBindBufferRange(
+		GL_UNIFORM_BUFFER,
+		UNIFORM_BLOCK_BINDING_FRAME_PARAMS,
+		s_frameParamsRing.buffer,
+		s_frameParamsRing.slotStride * slot,
+		sizeof(FrameParamsBlock)
+	);
+}
+
+static void GraphicsCreateDynamicResolutionQueries(
+){
+	glGenQueries(DYNAMIC_RESOLUTION_QUERY_RING_SIZE, s_dynamicResolution.queries);
+	GraphicsResetDynamicResolution();
+}
+
+static void GraphicsDeleteDynamicResolutionQueries(
+){
+	glDeleteQueries(DYNAMIC_RESOLUTION_QUERY_RING_SIZE, s_dynamicResolution.queries);
+	memset(s_dynamicResolution.queries, 0, sizeof(s_dynamicResolution.queries));
+	memset(s_dynamicResolution.queryPending, 0, sizeof(s_dynamicResolution.queryPending));
+}
+
+static void GraphicsResetDynamicResolution(
+){
+	/* Results still in flight are drained but ignored */
+	s_dynamicResolution.scale = 1.0f;
+	s_dynamicResolution.filteredGpuTimeInMs = 0.0f;
+	s_dynamicResolution.numSamplesSinceChange = -DYNAMIC_RESOLUTION_QUERY_RING_SIZE;
+}
+
+static void GraphicsCollectDynamicResolutionQueries(
+){
+	/* Queries complete in issue order; stop at the first one still in flight */
+	for (int count = 0; count < DYNAMIC_RESOLUTION_QUERY_RING_SIZE; ++count) {
+		int index = (s_dynamicResolution.nextQuery + count) % DYNAMIC_RESOLUTION_QUERY_RING_SIZE;
+		if (s_dynamicResolution.queryPending[index] == false) continue;
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(s_dynamicResolution.queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE) break;
+		GLuint64 elapsedInNs = 0;
+		glGetQueryObjectui64v(s_dynamicResolution.queries[index], GL_QUERY_RESULT, &elapsedInNs);
+		s_dynamicResolution.queryPending[index] = false;
+
+		/* Samples issued before the last scale change measure the old resolution */
+		if (s_dynamicResolution.numSamplesSinceChange++ < 0) continue;
+		float elapsedInMs = (float)((double)elapsedInNs * 1e-6);
+		if (s_dynamicResolution.filteredGpuTimeInMs <= 0.0f) {
+			s_dynamicResolution.filteredGpuTimeInMs = elapsedInMs;
+		} else {
+			s_dynamicResolution.filteredGpuTimeInMs += (elapsedInMs - s_dynamicResolution.filteredGpuTimeInMs) * 0.2f;
+		}
+	}
+}
+
+static void GraphicsUpdateDynamicResolutionScale(
+){
+	const DynamicResolutionSettings *settings = &s_dynamicResolution.settings;
+	float gpuTime = s_dynamicResolution.filteredGpuTimeInMs;
+	float target = settings->targetFrameTimeInMilliseconds;
+	if (target <= 0.0f || gpuTime <= 0.0f) return;
+	if (s_dynamicResolution.numSamplesSinceChange < DYNAMIC_RESOLUTION_SETTLE_FRAMES) return;
+
+	/* Hysteresis band: keep the current scale while the frame time is near the target */
+	if (gpuTime < target * DYNAMIC_RESOLUTION_DOWNSCALE_THRESHOLD
+	&&	gpuTime > target * DYNAMIC_RESOLUTION_UPSCALE_THRESHOLD
+	) {
+		return;
+	}
+
+	/* GPU time is roughly proportional to the pixel count, i.e. to scale^2 */
+	float ratio = sqrtf(target / gpuTime);
+	if (ratio < 0.5f) ratio = 0.5f;
+	if (ratio > 1.25f) ratio = 1.25f;
+	float scale = s_dynamicResolution.scale * ratio;
+	scale = (ratio < 1.0f)
+		? floorf(scale / DYNAMIC_RESOLUTION_SCALE_STEP) * DYNAMIC_RESOLUTION_SCALE_STEP
+		: floorf(scale / DYNAMIC_RESOLUTION_SCALE_STEP + 0.5f) * DYNAMIC_RESOLUTION_SCALE_STEP;
+	float minScale = (settings->minScale > 0.0f && settings->minScale <= 1.0f)? settings->minScale: 1.0f;
+	if (scale < minScale) scale = minScale;
+	if (scale > 1.0f) scale = 1.0f;
+	if (fabsf(scale - s_dynamicResolution.scale) < DYNAMIC_RESOLUTION_SCALE_STEP * 0.5f) return;
+
+	s_dynamicResolution.scale = scale;
+	s_dynamicResolution.filteredGpuTimeInMs = 0.0f;
+	s_dynamicResolution.numSamplesSinceChange = -DYNAMIC_RESOLUTION_QUERY_RING_SIZE;
+}
+
+void GraphicsSetDynamicResolutionSettings(
+	const DynamicResolutionSettings *settings
+){
+	bool wasEnabled = s_dynamicResolution.settings.enable;
+	s_dynamicResolution.settings = *settings;
+	if (wasEnabled != settings->enable) {
+		GraphicsResetDynamicResolution();
+	}
+}
+
+void GraphicsGetDynamicResolutionStatus(
+	DynamicResolutionStatus *status
+){
+	status->scale = s_dynamicResolution.scale;
+	status->gpuFrameTimeInMilliseconds = s_dynamicResolution.filteredGpuTimeInMs;
+}
+
 void GraphicsUpdate(
 	const CurrentFrameParams *params,
 	const RenderSettings *settings
 ){
+	PROFILER_CPU_SCOPE("GraphicsUpdate");
 	GraphicsSynchronizeRenderSettings(params, settings);
+
+	/* Framebuffer-relative resources follow the scaled resolution; the present pass stretches to the window */
+	GraphicsCollectDynamicResolutionQueries();
+	CurrentFrameParams renderParams = *params;
+	if (s_dynamicResolution.settings.enable
+	&&	s_pipelineUsedLegacyFallback == false
+	&&	params->xReso > 0
+	&&	params->yReso > 0
+	) {
+		GraphicsUpdateDynamicResolutionScale();
+		float scale = s_dynamicResolution.scale;
+		renderParams.xReso = (int)((float)params->xReso * scale + 0.5f);
+		renderParams.yReso = (int)((float)params->yReso * scale + 0.5f);
+		if (renderParams.xReso < 1) renderParams.xReso = 1;
+		if (renderParams.yReso < 1) renderParams.yReso = 1;
+		renderParams.xMouse = params->xMouse * renderParams.xReso / params->xReso;
+		renderParams.yMouse = params->yMouse * renderParams.yReso / params->yReso;
+	} else if (s_dynamicResolution.scale != 1.0f) {
+		GraphicsResetDynamicResolution();
+	}
+
+	/* Skip the measurement rather than stall when the oldest query is still in flight */
+	int queryIndex = s_dynamicResolution.nextQuery;
+	bool measure =
+			s_dynamicResolution.settings.enable
+		&&	s_dynamicResolution.queries[queryIndex] != 0
+		&&	s_dynamicResolution.queryPending[queryIndex] == false;
+	if (measure) {
+		glBeginQuery(GL_TIME_ELAPSED, s_dynamicResolution.queries[queryIndex]);
+	}
+
+	GraphicsUploadFrameParams(&renderParams);
 	const PipelineDescription *pipeline = GraphicsResolvePipelineDescription();
 	GraphicsExecutePipeline(
 		pipeline,
-		params,
+		&renderParams,
 		settings
 	);
 
+	if (measure) {
+		glEndQuery(GL_TIME_ELAPSED);
+		s_dynamicResolution.queryPending[queryIndex] = true;
+		s_dynamicResolution.nextQuery = (queryIndex + 1) % DYNAMIC_RESOLUTION_QUERY_RING_SIZE;
+	}
+
 	/* スワップ設定 */
 	if (settings->enableSwapIntervalControl) {
 		typedef BOOL (WINAPI * PFNWGLSWAPINTERVALEXTPROC)(int interval);
@@ -2810,9 +4500,14 @@ void GraphicsUpdate(
 
 bool GraphicsInitialize(
 ){
+	GlStateCacheInvalidate();
+	GraphicsCreateSamplers();
 	GraphicsCreateFrameBuffer(s_xReso, s_yReso, &s_currentRenderSettings);
 	GraphicsCreateComputeTextures(s_xReso, s_yReso, &s_currentRenderSettings);
+	GraphicsCreateFrameParamsRing();
+	GraphicsCreateDynamicResolutionQueries();
 	GraphicsResetPipelineDescriptionToDefault();
+	InitializeParallelShaderCompile();
 
 	/* glRects() 相当の動作を模倣する簡単な頂点シェーダを作成 */
 	{
@@ -2832,11 +4527,19 @@ bool GraphicsInitialize(
 
 bool GraphicsTerminate(
 ){
+	GraphicsDeleteAllPipelinePassShaders();
+	GraphicsDeletePipelineDownsamplePrograms();
+	GraphicsDeletePipelineUpsamplePrograms();
 	GraphicsDeleteComputeShader();	/* false が得られてもエラー扱いとしない */
 	GraphicsDeleteFragmentShader();	/* false が得られてもエラー扱いとしない */
 	GraphicsDeleteVertexShader();	/* false が得られてもエラー扱いとしない */
 	GraphicsDeleteComputeTextures();
 	GraphicsDeleteFrameBuffer();
+	GraphicsDeleteFrameParamsRing();
+	GraphicsCaptureSequenceEnd();
+	GraphicsReleaseCaptureRenderTarget();
+	GraphicsDeleteDynamicResolutionQueries();
+	GraphicsDeleteSamplers();
 	GraphicsResetPipelineDescriptionToDefault();
 	return true;
 }
@@ -66,9 +66,33 @@ struct CaptureCubemapSettings {
 	int reso;
 };
 
+/*
+	動的解像度の設定
+	GPU フレーム時間を計測し、フレームバッファ基準のリソースの解像度を
+	目標フレーム時間に近づくよう縮小/復帰する。縮小した結果は present パスで
+	ウィンドウ解像度に拡大される。
+*/
+struct DynamicResolutionSettings {
+	bool enable;
+	float targetFrameTimeInMilliseconds;
+	float minScale;
+};
+
+/* 動的解像度の状態 */
+struct DynamicResolutionStatus {
+	float scale;						/* 現在のレンダースケール（1.0 = 等倍）*/
+	float gpuFrameTimeInMilliseconds;	/* 平滑化された GPU フレーム時間（未計測なら 0）*/
+};
+
 /* 全レンダーターゲットのクリア */
 void GraphicsClearAllRenderTargets();
 
+/* 動的解像度の設定 */
+void GraphicsSetDynamicResolutionSettings(const DynamicResolutionSettings *settings);
+
+/* 動的解像度の状態取得 */
+void GraphicsGetDynamicResolutionStatus(DynamicResolutionStatus *status);
+
 /* シェーダが frameCount uniform 変数を要求するか？ */
 bool GraphicsShaderRequiresFrameCountUniform();
 
@@ -94,17 +118,21 @@ bool GraphicsCreateVertexShader(
 /* 頂点シェーダの削除 */
 bool GraphicsDeleteVertexShader();
 
-/* フラグメントシェーダの作成 */
-bool GraphicsCreateFragmentShader(
-	const char *shaderCode
+/*
+	フラグメントシェーダの設定
+	作成済みのプログラムで実行中のものを置き換える（所有権は graphics 側に移る）。
+	古いプログラムの削除で glFinish は行わない。
+*/
+bool GraphicsSetFragmentShader(
+	GLuint programId
 );
 
 /* フラグメントシェーダの削除 */
 bool GraphicsDeleteFragmentShader();
 
-/* コンピュートシェーダの作成 */
-bool GraphicsCreateComputeShader(
-	const char *shaderCode
+/* コンピュートシェーダの設定（GraphicsSetFragmentShader と同様）*/
+bool GraphicsSetComputeShader(
+	GLuint programId
 );
 
 /* コンピュートシェーダの削除 */
@@ -116,6 +144,33 @@ bool GraphicsCreateShaderPipeline();
 /* シェーダパイプラインの削除 */
 bool GraphicsDeleteShaderPipeline();
 
+/* パイプラインパス個別のシェーダの種類を取得（シェーダを持たないパスなら 0）*/
+GLenum GraphicsGetPipelinePassShaderType(
+	int passIndex
+);
+
+/*
+	パイプラインパス個別のシェーダの設定（GraphicsSetFragmentShader と同様）
+	パスが存在しない場合はプログラムを削除して false を返す。
+*/
+bool GraphicsSetPipelinePassShader(
+	int passIndex,
+	GLuint programId
+);
+
+/* パイプラインパス個別のシェーダの削除 */
+bool GraphicsDeletePipelinePassShader(
+	int passIndex
+);
+
+/* パイプラインパス個別のシェーダを全て削除 */
+void GraphicsDeleteAllPipelinePassShaders();
+
+/* downsample/upsample パスの組み込みシェーダのソース取得（それ以外のパスは NULL）*/
+const char *GraphicsGetPipelineBuiltinPassShaderSource(
+	int passIndex
+);
+
 /* スクリーンショットキャプチャ */
 bool GraphicsCaptureScreenShotOnMemory(
 	void *buffer,
@@ -125,6 +180,30 @@ bool GraphicsCaptureScreenShotOnMemory(
 	const CaptureScreenShotSettings *captureSettings
 );
 
+/*
+	連番画像キャプチャ（非同期読み出し）
+	GraphicsCaptureSequenceRenderFrame で描画と読み出しの発行だけを行い、
+	GraphicsCaptureSequenceMapFrame で読み出し完了を待って結果を参照する。
+	スロットは 0 ～ numSlots-1（numSlots は RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS
+	以下）。返されたポインタは、同じスロットに次の描画を発行するまで有効。
+*/
+bool GraphicsCaptureSequenceBegin(
+	int xReso,
+	int yReso,
+	int numSlots,
+	const RenderSettings *renderSettings
+);
+bool GraphicsCaptureSequenceRenderFrame(
+	int slot,
+	const CurrentFrameParams *params,
+	const RenderSettings *renderSettings,
+	bool replaceAlphaByOne
+);
+const void *GraphicsCaptureSequenceMapFrame(
+	int slot
+);
+void GraphicsCaptureSequenceEnd();
+
 /* スクリーンショットキャプチャ */
 bool GraphicsCaptureScreenShotAsPngTexture2d(
 	const CurrentFrameParams *params,
@@ -153,6 +232,16 @@ bool GraphicsApplyPipelineDescription(const struct PipelineDescription *pipeline
 bool GraphicsHasCustomPipelineDescription();
 const struct PipelineDescription *GraphicsGetActivePipelineDescription();
 
+/* パイプラインリソースが共有するトランジェントテクスチャのスロット（-1 = 専用テクスチャ）*/
+int GraphicsGetPipelineResourceAliasSlot(int resourceIndex);
+
+/* トランジェントテクスチャプールの物理テクスチャ数 */
+int GraphicsGetNumPipelineTransientTextures();
+
+/* present パスからの到達可能性（到達不能なパスとリソースはカリングされる）*/
+struct PipelineReachability;
+const struct PipelineReachability *GraphicsGetPipelineReachability();
+
 /* グラフィクスの更新 */
 void GraphicsUpdate(
 	const CurrentFrameParams *params,
@@ -24,6 +24,8 @@
 #include "dialog_preprocessor_definitions.h"
 #include "common.h"
 #include "gl3w_work_around.h"
+#include "gl_state_cache.h"
+#include "profiler.h"
 #include "app.h"
 
 #include "resource/resource.h"
@@ -382,6 +384,29 @@ static LRESULT CALLBACK MainWndProc(
 					return 0;
 				} break;
 
+				/* トレース記録 */
+				case IDM_RECORD_TRACE: {
+					if (s_fullScreen) {
+						ToggleFullScreen();
+					} else {
+						char fileName[MAX_PATH] = "trace.json";
+						OPENFILENAME ofn = {0};
+						ofn.lStructSize = sizeof(OPENFILENAME);
+						ofn.hwndOwner = NULL;
+						ofn.lpstrFilter =
+							"Chrome trace json file (*.json)\0*.json\0"
+							"\0";
+						ofn.lpstrFile = fileName;
+						ofn.nMaxFile = sizeof(fileName);
+						ofn.lpstrTitle = (LPSTR)"Record trace to json file";
+
+						if (GetSaveFileName(&ofn)) {
+							AppRecordTrace(fileName);
+						}
+					}
+					return 0;
+				} break;
+
 				/* プロジェクトファイルのインポート */
 				case IDM_IMPORT_PROJECT: {
 					if (s_fullScreen) {
@@ -568,6 +593,15 @@ static LRESULT CALLBACK MainWndProc(
 					AppImGuiSetDisplayCameraSettingsFlag(flag);
 				} break;
 
+				/* ImGui Profiler の表示 */
+				case IDM_TOGGLE_DISPLAY_PROFILER: {
+					bool flag = ToggleMenuItemCheck(
+						GetMenu(AppGetMainWindowHandle()),
+						IDM_TOGGLE_DISPLAY_PROFILER
+					);
+					AppImGuiSetDisplayProfilerFlag(flag);
+				} break;
+
 				/* グラフィクスシェーダ用ユニフォーム一覧 */
 				case IDM_HELP_GRAPHICS_SHADER_UNIFORMS: {
 					if (s_fullScreen) {
@@ -904,6 +938,9 @@ int WINAPI WinMain(
 	/* メインループ */
 	HWND hWnd = AppGetMainWindowHandle();
 	while (!done) {
+		/* プロファイラのフレームの開始 */
+		ProfilerNewFrame();
+
 		/* メッセージ監視 */
 		while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
 			if (msg.message == WM_QUIT) done = 1;
@@ -914,9 +951,11 @@ int WINAPI WinMain(
 		}
 
 		/* ImGui フレームの開始 */
+		ProfilerCpuBegin("imgui");
 		ImGui_ImplOpenGL3_NewFrame();
 		ImGui_ImplWin32_NewFrame();
 		ImGui::NewFrame();
+		ProfilerCpuEnd();
 
 		/* アプリケーション更新 */
 		if (AppUpdate() == false) {
@@ -937,6 +976,11 @@ int WINAPI WinMain(
 				IDM_TOGGLE_DISPLAY_CAMERA_SETTINGS,
 				AppImGuiGetDisplayCameraSettingsFlag()
 			);
+			SetMenuItemCheck(
+				hMenu,
+				IDM_TOGGLE_DISPLAY_PROFILER,
+				AppImGuiGetDisplayProfilerFlag()
+			);
 		}
 
 		/* アプリケーション解像度取得 */
@@ -994,9 +1038,16 @@ int WINAPI WinMain(
 //		ImGui::ShowDemoWindow();
 
 		/* ImGui レンダリング */
+		ProfilerCpuBegin("imgui");
+		ProfilerGpuBegin("imgui");
 		ImGui::Render();
-		glViewport(0, 0, xReso, yReso);
+		GlStateCacheViewport(0, 0, xReso, yReso);
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		ProfilerGpuEnd();
+		ProfilerCpuEnd();
+
+		/* ImGui はステートキャッシュを経由せずに GL ステートを変更する */
+		GlStateCacheInvalidate();
 
 		/* フリップ */
 		SwapBuffers(s_hDC);
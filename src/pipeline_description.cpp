@@ -9,6 +9,7 @@
 #include "pipeline_description.h"
 #include "external/cJSON/cJSON.h"
 #include "external/cJSON/cJSON_Utils.h"
+#include <math.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -17,6 +18,16 @@ typedef struct {
     PipelinePassType value;
 } PipelinePassTypeEntry;
 
+typedef struct {
+    const char *name;
+    PipelineDownsampleFilter value;
+} PipelineDownsampleFilterEntry;
+
+typedef struct {
+    const char *name;
+    PipelineUpsampleFilter value;
+} PipelineUpsampleFilterEntry;
+
 typedef struct {
     const char *name;
     PipelineResourceAccess value;
@@ -46,6 +57,19 @@ static const PipelinePassTypeEntry s_passTypeTable[] = {
     {"fragment", PipelinePassTypeFragment},
     {"compute",  PipelinePassTypeCompute},
     {"present",  PipelinePassTypePresent},
+    {"downsample", PipelinePassTypeDownsample},
+    {"upsample",   PipelinePassTypeUpsample},
+};
+
+static const PipelineDownsampleFilterEntry s_downsampleFilterTable[] = {
+    {"average", PipelineDownsampleFilterAverage},
+    {"max",     PipelineDownsampleFilterMax},
+    {"kawase",  PipelineDownsampleFilterKawase},
+};
+
+static const PipelineUpsampleFilterEntry s_upsampleFilterTable[] = {
+    {"bicubic",   PipelineUpsampleFilterBicubic},
+    {"bilateral", PipelineUpsampleFilterBilateral},
 };
 
 static const PipelineResourceAccessEntry s_resourceAccessTable[] = {
@@ -59,6 +83,7 @@ static const PipelineResourceAccessEntry s_resourceAccessTable[] = {
 static const PipelineResolutionModeEntry s_resolutionModeTable[] = {
     {"framebuffer", PipelineResolutionModeFramebuffer},
     {"fixed",       PipelineResolutionModeFixed},
+    {"scale",       PipelineResolutionModeScale},
 };
 
 static const PipelinePixelFormatEntry s_pixelFormatTable[] = {
@@ -119,6 +144,9 @@ static void InitResourceDefaults(PipelineResource *resource){
     memset(resource, 0, sizeof(*resource));
     resource->pixelFormat = DEFAULT_PIXEL_FORMAT;
     resource->resolution.mode = PipelineResolutionModeFramebuffer;
+    resource->resolution.scaleX = 1.0f;
+    resource->resolution.scaleY = 1.0f;
+    resource->resolution.alignment = 1;
     resource->historyLength = 1;
     resource->textureFilter = DEFAULT_TEXTURE_FILTER;
     resource->textureWrap = DEFAULT_TEXTURE_WRAP;
@@ -135,6 +163,8 @@ static void InitPassDefaults(PipelinePass *pass){
     pass->workGroupSize[0] = 0;
     pass->workGroupSize[1] = 0;
     pass->workGroupSize[2] = 0;
+    pass->downsampleFilter = PipelineDownsampleFilterAverage;
+    pass->upsampleFilter = PipelineUpsampleFilterBicubic;
 }
 
 static bool ParseStringField(
@@ -240,6 +270,24 @@ static const char *LookupNameByPassType(PipelinePassType type){
     return NULL;
 }
 
+static const char *LookupNameByDownsampleFilter(PipelineDownsampleFilter filter){
+    for (size_t index = 0; index < sizeof(s_downsampleFilterTable) / sizeof(s_downsampleFilterTable[0]); ++index) {
+        if (s_downsampleFilterTable[index].value == filter) {
+            return s_downsampleFilterTable[index].name;
+        }
+    }
+    return NULL;
+}
+
+static const char *LookupNameByUpsampleFilter(PipelineUpsampleFilter filter){
+    for (size_t index = 0; index < sizeof(s_upsampleFilterTable) / sizeof(s_upsampleFilterTable[0]); ++index) {
+        if (s_upsampleFilterTable[index].value == filter) {
+            return s_upsampleFilterTable[index].name;
+        }
+    }
+    return NULL;
+}
+
 static const char *LookupNameByResourceAccess(PipelineResourceAccess access){
     for (size_t index = 0; index < sizeof(s_resourceAccessTable) / sizeof(s_resourceAccessTable[0]); ++index) {
         if (s_resourceAccessTable[index].value == access) {
@@ -300,6 +348,514 @@ void PipelineDescriptionInit(PipelineDescription *description){
     description->numPasses = 0;
 }
 
+static bool PassWritesResource(const PipelinePass *pass, int resourceIndex){
+    for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
+        if (pass->outputs[outputIndex].resourceIndex == resourceIndex) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PipelineDescriptionResourceHasMipChain(
+    const PipelineDescription *description,
+    int resourceIndex
+){
+    if (description == NULL) {
+        return false;
+    }
+    for (int passIndex = 0; passIndex < description->numPasses && passIndex < PIPELINE_MAX_PASSES; ++passIndex) {
+        const PipelinePass *pass = &description->passes[passIndex];
+        if (pass->type == PipelinePassTypeDownsample && PassWritesResource(pass, resourceIndex)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PipelineDescriptionAnalyzeReachability(
+    const PipelineDescription *description,
+    PipelineReachability *reachability
+){
+    if (reachability == NULL) {
+        return;
+    }
+    memset(reachability, 0, sizeof(*reachability));
+    if (description == NULL) {
+        return;
+    }
+
+    int numPasses = description->numPasses;
+    if (numPasses > PIPELINE_MAX_PASSES) numPasses = PIPELINE_MAX_PASSES;
+    int numResources = description->numResources;
+    if (numResources > PIPELINE_MAX_RESOURCES) numResources = PIPELINE_MAX_RESOURCES;
+
+    bool hasPresentPass = false;
+    for (int passIndex = 0; passIndex < numPasses; ++passIndex) {
+        if (description->passes[passIndex].type == PipelinePassTypePresent) {
+            reachability->passReachable[passIndex] = true;
+            hasPresentPass = true;
+        }
+    }
+
+    if (hasPresentPass == false) {
+        /* Nothing to anchor the analysis on; keep everything */
+        for (int passIndex = 0; passIndex < numPasses; ++passIndex) {
+            reachability->passReachable[passIndex] = true;
+        }
+    } else {
+        /*
+         * Every writer of a resource read by a reachable pass becomes
+         * reachable. Writers are not ordered against readers on purpose:
+         * a write after the last read of the frame is still consumed by the
+         * next frame (history reads, or reads before the first write).
+         */
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int readerIndex = 0; readerIndex < numPasses; ++readerIndex) {
+                if (reachability->passReachable[readerIndex] == false) continue;
+                const PipelinePass *reader = &description->passes[readerIndex];
+                for (int inputIndex = 0; inputIndex < reader->numInputs; ++inputIndex) {
+                    int resourceIndex = reader->inputs[inputIndex].resourceIndex;
+                    for (int writerIndex = 0; writerIndex < numPasses; ++writerIndex) {
+                        if (reachability->passReachable[writerIndex]) continue;
+                        if (PassWritesResource(&description->passes[writerIndex], resourceIndex)) {
+                            reachability->passReachable[writerIndex] = true;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int passIndex = 0; passIndex < numPasses; ++passIndex) {
+        const PipelinePass *pass = &description->passes[passIndex];
+        if (reachability->passReachable[passIndex] == false) {
+            reachability->numCulledPasses++;
+            continue;
+        }
+        for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+            int resourceIndex = pass->inputs[inputIndex].resourceIndex;
+            if (resourceIndex >= 0 && resourceIndex < numResources) {
+                reachability->resourceReachable[resourceIndex] = true;
+            }
+        }
+        for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
+            int resourceIndex = pass->outputs[outputIndex].resourceIndex;
+            if (resourceIndex >= 0 && resourceIndex < numResources) {
+                reachability->resourceReachable[resourceIndex] = true;
+            }
+        }
+    }
+    for (int resourceIndex = 0; resourceIndex < numResources; ++resourceIndex) {
+        if (reachability->resourceReachable[resourceIndex] == false) {
+            reachability->numCulledResources++;
+        }
+    }
+}
+
+static bool ParseLegacyResourceIndex(
+    const PipelineResource *resource,
+    const char *prefix,
+    int *outIndex
+){
+    size_t prefixLength = strlen(prefix);
+    if (strncmp(resource->id, prefix, prefixLength) != 0) {
+        return false;
+    }
+    const char *suffix = resource->id + prefixLength;
+    *outIndex = (*suffix != '\0')? atoi(suffix) : 0;
+    return true;
+}
+
+static PipelinePlanBinding *AddPlanBinding(
+    const PipelineDescription *description,
+    PipelinePlanCommand *command,
+    PipelinePlanBindingKind kind,
+    const PipelineResourceBinding *binding,
+    int unit
+){
+    if (command->numBindings >= PIPELINE_PLAN_MAX_BINDINGS) {
+        command->executable = false;
+        return NULL;
+    }
+    if (binding->resourceIndex < 0 || binding->resourceIndex >= description->numResources) {
+        command->executable = false;
+        return NULL;
+    }
+    const PipelineResource *resource = &description->resources[binding->resourceIndex];
+    PipelinePlanBinding *planBinding = &command->bindings[command->numBindings++];
+    memset(planBinding, 0, sizeof(*planBinding));
+    planBinding->kind = kind;
+    planBinding->resourceIndex = binding->resourceIndex;
+    planBinding->historyOffset = binding->historyOffset;
+    planBinding->unit = unit;
+    planBinding->imageFormat = PixelFormatToGlPixelFormatInfo(resource->pixelFormat).internalformat;
+    planBinding->textureFilter = resource->textureFilter;
+    planBinding->textureWrap = resource->textureWrap;
+    planBinding->mipmapPrebuilt = PipelineDescriptionResourceHasMipChain(description, binding->resourceIndex);
+    return planBinding;
+}
+
+static void CompilePlanCommand(
+    const PipelineDescription *description,
+    int passIndex,
+    bool enableMipmapGeneration,
+    PipelinePlanCommand *command
+){
+    const PipelinePass *pass = &description->passes[passIndex];
+    memset(command, 0, sizeof(*command));
+    command->passIndex = passIndex;
+    command->type = pass->type;
+    command->executable = true;
+    command->targetResourceIndex = -1;
+    command->clear = pass->clear;
+    command->overrideWorkGroupSize = pass->overrideWorkGroupSize;
+    memcpy(command->workGroupSize, pass->workGroupSize, sizeof(command->workGroupSize));
+    command->downsampleFilter = pass->downsampleFilter;
+
+    switch (pass->type) {
+        case PipelinePassTypeFragment: {
+            int numColorAttachments = 0;
+            for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
+                const PipelineResourceBinding *binding = &pass->outputs[outputIndex];
+                if (binding->access != PipelineResourceAccessColorAttachment) {
+                    continue;
+                }
+                if (AddPlanBinding(description, command, PipelinePlanBindingKindColorAttachment, binding, numColorAttachments) == NULL) {
+                    continue;
+                }
+                if (numColorAttachments == 0) {
+                    command->targetResourceIndex = binding->resourceIndex;
+                }
+                ++numColorAttachments;
+            }
+            if (numColorAttachments == 0) {
+                command->executable = false;
+            }
+
+            /* Legacy resources keep the texture units the legacy shaders expect */
+            int numTextures = 0;
+            for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+                const PipelineResourceBinding *binding = &pass->inputs[inputIndex];
+                if (binding->access != PipelineResourceAccessSampled
+                &&  binding->access != PipelineResourceAccessHistoryRead
+                ) {
+                    continue;
+                }
+                if (binding->resourceIndex < 0 || binding->resourceIndex >= description->numResources) {
+                    command->executable = false;
+                    continue;
+                }
+                const PipelineResource *resource = &description->resources[binding->resourceIndex];
+                int unit = numTextures;
+                bool enableMipmap = enableMipmapGeneration;
+                int legacyIndex = 0;
+                if (ParseLegacyResourceIndex(resource, "legacy_mrt", &legacyIndex)) {
+                    unit = legacyIndex;
+                } else if (ParseLegacyResourceIndex(resource, "legacy_compute", &legacyIndex)) {
+                    unit = PIPELINE_PLAN_COMPUTE_TEXTURE_UNIT + legacyIndex;
+                    enableMipmap = false;
+                }
+                PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindTexture, binding, unit);
+                if (planBinding != NULL) {
+                    planBinding->enableMipmap = enableMipmap || planBinding->mipmapPrebuilt;
+                }
+                ++numTextures;
+            }
+        } break;
+
+        case PipelinePassTypeCompute: {
+            int numTextures = 0;
+            int numImages = 0;
+            for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+                const PipelineResourceBinding *binding = &pass->inputs[inputIndex];
+                switch (binding->access) {
+                    case PipelineResourceAccessSampled:
+                    case PipelineResourceAccessHistoryRead: {
+                        /* Compute passes never generate mipmaps; only prebuilt chains are sampled with mips */
+                        PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindTexture, binding, PIPELINE_PLAN_COMPUTE_TEXTURE_UNIT + numTextures++);
+                        if (planBinding != NULL) {
+                            planBinding->enableMipmap = planBinding->mipmapPrebuilt;
+                        }
+                    } break;
+                    case PipelineResourceAccessImageRead: {
+                        PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindImage, binding, numImages++);
+                        if (planBinding != NULL) {
+                            planBinding->imageAccess = GL_READ_ONLY;
+                        }
+                    } break;
+                    default: {
+                        /* Unsupported binding type for compute pass */
+                        command->executable = false;
+                    } break;
+                }
+            }
+            bool hasWritableOutput = false;
+            for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
+                const PipelineResourceBinding *binding = &pass->outputs[outputIndex];
+                if (binding->access != PipelineResourceAccessImageWrite) {
+                    /* Unsupported output access for compute */
+                    command->executable = false;
+                    continue;
+                }
+                PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindImage, binding, numImages++);
+                if (planBinding == NULL) {
+                    continue;
+                }
+                planBinding->imageAccess = GL_WRITE_ONLY;
+                if (hasWritableOutput == false) {
+                    command->targetResourceIndex = binding->resourceIndex;
+                    hasWritableOutput = true;
+                }
+            }
+            if (hasWritableOutput == false) {
+                command->executable = false;
+            }
+        } break;
+
+        case PipelinePassTypeDownsample: {
+            /*
+             * The source is sampled at PIPELINE_PLAN_COMPUTE_TEXTURE_UNIT and
+             * destination levels are bound to image units 0.. by the executor,
+             * one unit per level written by a dispatch.
+             */
+            if (pass->numInputs != 1 || pass->numOutputs != 1
+            ||  AddPlanBinding(description, command, PipelinePlanBindingKindTexture, &pass->inputs[0], PIPELINE_PLAN_COMPUTE_TEXTURE_UNIT) == NULL
+            ) {
+                command->executable = false;
+                break;
+            }
+            PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindImage, &pass->outputs[0], 0);
+            if (planBinding == NULL) {
+                break;
+            }
+            planBinding->imageAccess = GL_WRITE_ONLY;
+            command->targetResourceIndex = pass->outputs[0].resourceIndex;
+        } break;
+
+        case PipelinePassTypeUpsample: {
+            /*
+             * Runs as an ordinary compute pass with a built-in program.  The
+             * bicubic filter is built from bilinear taps, so inputs are always
+             * sampled linearly and clamped regardless of the resource sampler.
+             */
+            for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+                PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindTexture, &pass->inputs[inputIndex], PIPELINE_PLAN_COMPUTE_TEXTURE_UNIT + inputIndex);
+                if (planBinding == NULL) {
+                    break;
+                }
+                planBinding->textureFilter = TextureFilterLinear;
+                planBinding->textureWrap = TextureWrapClampToEdge;
+            }
+            if (pass->numInputs <= 0 || pass->numOutputs != 1) {
+                command->executable = false;
+                break;
+            }
+            PipelinePlanBinding *planBinding = AddPlanBinding(description, command, PipelinePlanBindingKindImage, &pass->outputs[0], 0);
+            if (planBinding == NULL) {
+                break;
+            }
+            planBinding->imageAccess = GL_WRITE_ONLY;
+            command->targetResourceIndex = pass->outputs[0].resourceIndex;
+        } break;
+
+        case PipelinePassTypePresent: {
+            if (pass->numInputs <= 0
+            ||  AddPlanBinding(description, command, PipelinePlanBindingKindBlitSource, &pass->inputs[0], 0) == NULL
+            ) {
+                command->executable = false;
+                break;
+            }
+            command->targetResourceIndex = pass->inputs[0].resourceIndex;
+        } break;
+
+        default: {
+            command->executable = false;
+        } break;
+    }
+}
+
+static GLbitfield BarrierBitsForAccess(
+    PipelinePassType passType,
+    PipelineResourceAccess access
+){
+    if (passType == PipelinePassTypePresent) {
+        /* The present pass reads its input through a framebuffer blit */
+        return GL_FRAMEBUFFER_BARRIER_BIT;
+    }
+    switch (access) {
+        case PipelineResourceAccessSampled:
+        case PipelineResourceAccessHistoryRead: {
+            /* Fragment passes may also generate mipmaps from the base level */
+            if (passType == PipelinePassTypeFragment) {
+                return GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT;
+            }
+            return GL_TEXTURE_FETCH_BARRIER_BIT;
+        }
+        case PipelineResourceAccessImageRead:
+        case PipelineResourceAccessImageWrite: {
+            return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        }
+        case PipelineResourceAccessColorAttachment: {
+            return GL_FRAMEBUFFER_BARRIER_BIT;
+        }
+        default: {
+            return 0;
+        }
+    }
+}
+
+static GLbitfield UncoveredBarrierBits(
+    const PipelineExecutionPlan *plan,
+    int writerCommandIndex,
+    int readerCommandIndex,
+    bool acrossFrames,
+    GLbitfield requiredBits
+){
+    /* A barrier issued before command n covers every write issued before command n */
+    GLbitfield coveredBits = 0;
+    if (acrossFrames) {
+        for (int commandIndex = writerCommandIndex + 1; commandIndex < plan->numCommands; ++commandIndex) {
+            coveredBits |= plan->commands[commandIndex].barrierBits;
+        }
+        for (int commandIndex = 0; commandIndex <= readerCommandIndex; ++commandIndex) {
+            coveredBits |= plan->commands[commandIndex].barrierBits;
+        }
+    } else {
+        for (int commandIndex = writerCommandIndex + 1; commandIndex <= readerCommandIndex; ++commandIndex) {
+            coveredBits |= plan->commands[commandIndex].barrierBits;
+        }
+    }
+    return requiredBits & ~coveredBits;
+}
+
+static void ComputePlanBarrierBits(
+    const PipelineDescription *description,
+    PipelineExecutionPlan *plan
+){
+    /*
+     * Only image stores are incoherent; framebuffer writes are ordered with
+     * later commands by GL itself.  For every image store, the first command
+     * consuming it gets the minimal barrier bits for its access mode.
+     * Same-frame edges are resolved first so that history reads (which
+     * consume writes of the previous frame) can reuse their barriers.
+     * With equal history offsets, a write by the same or a later command
+     * is only seen by the reader in the next frame, so it crosses frames too.
+     */
+    for (int acrossFrames = 0; acrossFrames < 2; ++acrossFrames) {
+        for (int readerIndex = 0; readerIndex < plan->numCommands; ++readerIndex) {
+            const PipelinePass *reader = &description->passes[plan->commands[readerIndex].passIndex];
+            for (int bindingIndex = 0; bindingIndex < reader->numInputs + reader->numOutputs; ++bindingIndex) {
+                const PipelineResourceBinding *readBinding = (bindingIndex < reader->numInputs)
+                    ? &reader->inputs[bindingIndex]
+                    : &reader->outputs[bindingIndex - reader->numInputs];
+                GLbitfield requiredBits = BarrierBitsForAccess(reader->type, readBinding->access);
+                if (requiredBits == 0) continue;
+
+                for (int writerIndex = 0; writerIndex < plan->numCommands; ++writerIndex) {
+                    const PipelinePass *writer = &description->passes[plan->commands[writerIndex].passIndex];
+                    for (int outputIndex = 0; outputIndex < writer->numOutputs; ++outputIndex) {
+                        const PipelineResourceBinding *writeBinding = &writer->outputs[outputIndex];
+                        if (writeBinding->access != PipelineResourceAccessImageWrite) continue;
+                        if (writeBinding->resourceIndex != readBinding->resourceIndex) continue;
+
+                        bool sameOffset = (readBinding->historyOffset == writeBinding->historyOffset);
+                        bool dependsOnWriter = acrossFrames
+                            ? (readBinding->historyOffset < writeBinding->historyOffset || (sameOffset && writerIndex >= readerIndex))
+                            : (sameOffset && writerIndex < readerIndex);
+                        if (dependsOnWriter == false) continue;
+                        if (acrossFrames) {
+                            plan->commands[readerIndex].previousFrameWriterMask |= 1u << writerIndex;
+                        }
+
+                        plan->commands[readerIndex].barrierBits |= UncoveredBarrierBits(
+                            plan,
+                            writerIndex,
+                            readerIndex,
+                            acrossFrames != 0,
+                            requiredBits
+                        );
+                    }
+                }
+            }
+        }
+    }
+}
+
+void PipelineDescriptionCompileExecutionPlan(
+    const PipelineDescription *description,
+    const PipelineReachability *reachability,
+    bool enableMipmapGeneration,
+    PipelineExecutionPlan *plan
+){
+    if (plan == NULL) {
+        return;
+    }
+    memset(plan, 0, sizeof(*plan));
+    if (description == NULL) {
+        return;
+    }
+
+    for (int passIndex = 0; passIndex < description->numPasses && passIndex < PIPELINE_MAX_PASSES; ++passIndex) {
+        if (reachability != NULL && reachability->passReachable[passIndex] == false) {
+            continue;
+        }
+        CompilePlanCommand(
+            description,
+            passIndex,
+            enableMipmapGeneration,
+            &plan->commands[plan->numCommands++]
+        );
+    }
+    ComputePlanBarrierBits(description, plan);
+}
+
+void PipelineDescriptionStripUnreachable(
+    const PipelineDescription *description,
+    const PipelineReachability *reachability,
+    PipelineDescription *outDescription,
+    int *outSourcePassIndices
+){
+    if (description == NULL || reachability == NULL || outDescription == NULL) {
+        return;
+    }
+    PipelineDescriptionInit(outDescription);
+
+    int resourceRemap[PIPELINE_MAX_RESOURCES];
+    for (int resourceIndex = 0; resourceIndex < PIPELINE_MAX_RESOURCES; ++resourceIndex) {
+        resourceRemap[resourceIndex] = -1;
+    }
+    for (int resourceIndex = 0; resourceIndex < description->numResources && resourceIndex < PIPELINE_MAX_RESOURCES; ++resourceIndex) {
+        if (reachability->resourceReachable[resourceIndex] == false) continue;
+        resourceRemap[resourceIndex] = outDescription->numResources;
+        outDescription->resources[outDescription->numResources++] = description->resources[resourceIndex];
+    }
+
+    for (int passIndex = 0; passIndex < description->numPasses && passIndex < PIPELINE_MAX_PASSES; ++passIndex) {
+        if (reachability->passReachable[passIndex] == false) continue;
+        if (outSourcePassIndices != NULL) {
+            outSourcePassIndices[outDescription->numPasses] = passIndex;
+        }
+        PipelinePass *pass = &outDescription->passes[outDescription->numPasses++];
+        *pass = description->passes[passIndex];
+        for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+            int resourceIndex = pass->inputs[inputIndex].resourceIndex;
+            if (resourceIndex >= 0 && resourceIndex < PIPELINE_MAX_RESOURCES) {
+                pass->inputs[inputIndex].resourceIndex = resourceRemap[resourceIndex];
+            }
+        }
+        for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
+            int resourceIndex = pass->outputs[outputIndex].resourceIndex;
+            if (resourceIndex >= 0 && resourceIndex < PIPELINE_MAX_RESOURCES) {
+                pass->outputs[outputIndex].resourceIndex = resourceRemap[resourceIndex];
+            }
+        }
+    }
+}
+
 bool PipelinePassTypeFromString(const char *value, PipelinePassType *type){
     if (value == NULL || type == NULL) {
         return false;
@@ -317,6 +873,40 @@ const char *PipelinePassTypeToString(PipelinePassType type){
     return LookupNameByPassType(type);
 }
 
+bool PipelineDownsampleFilterFromString(const char *value, PipelineDownsampleFilter *filter){
+    if (value == NULL || filter == NULL) {
+        return false;
+    }
+    for (size_t index = 0; index < sizeof(s_downsampleFilterTable) / sizeof(s_downsampleFilterTable[0]); ++index) {
+        if (strcmp(value, s_downsampleFilterTable[index].name) == 0) {
+            *filter = s_downsampleFilterTable[index].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *PipelineDownsampleFilterToString(PipelineDownsampleFilter filter){
+    return LookupNameByDownsampleFilter(filter);
+}
+
+bool PipelineUpsampleFilterFromString(const char *value, PipelineUpsampleFilter *filter){
+    if (value == NULL || filter == NULL) {
+        return false;
+    }
+    for (size_t index = 0; index < sizeof(s_upsampleFilterTable) / sizeof(s_upsampleFilterTable[0]); ++index) {
+        if (strcmp(value, s_upsampleFilterTable[index].name) == 0) {
+            *filter = s_upsampleFilterTable[index].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *PipelineUpsampleFilterToString(PipelineUpsampleFilter filter){
+    return LookupNameByUpsampleFilter(filter);
+}
+
 bool PipelineResourceAccessFromString(const char *value, PipelineResourceAccess *access){
     if (value == NULL || access == NULL) {
         return false;
@@ -334,6 +924,16 @@ const char *PipelineResourceAccessToString(PipelineResourceAccess access){
     return LookupNameByResourceAccess(access);
 }
 
+const char *PipelinePlanBindingKindToString(PipelinePlanBindingKind kind){
+    switch (kind) {
+        case PipelinePlanBindingKindTexture:         return "texture";
+        case PipelinePlanBindingKindImage:           return "image";
+        case PipelinePlanBindingKindColorAttachment: return "color_attachment";
+        case PipelinePlanBindingKindBlitSource:      return "blit_source";
+        default:                                     return NULL;
+    }
+}
+
 bool PipelineResolutionModeFromString(const char *value, PipelineResolutionMode *mode){
     if (value == NULL || mode == NULL) {
         return false;
@@ -351,6 +951,51 @@ const char *PipelineResolutionModeToString(PipelineResolutionMode mode){
     return LookupNameByResolutionMode(mode);
 }
 
+static int ResolveScaledExtent(int framebufferExtent, float scale, int alignment){
+    int extent = (int)ceilf((float)framebufferExtent * scale);
+    if (alignment > 1) {
+        extent = (extent + alignment - 1) / alignment * alignment;
+    }
+    return extent;
+}
+
+void PipelineResourceResolutionResolve(
+    const PipelineResourceResolution *resolution,
+    int framebufferWidth,
+    int framebufferHeight,
+    int *outWidth,
+    int *outHeight
+){
+    int width = framebufferWidth;
+    int height = framebufferHeight;
+    if (resolution != NULL) {
+        switch (resolution->mode) {
+            case PipelineResolutionModeFixed: {
+                if (resolution->width > 0) {
+                    width = resolution->width;
+                }
+                if (resolution->height > 0) {
+                    height = resolution->height;
+                }
+            } break;
+            case PipelineResolutionModeScale: {
+                width = ResolveScaledExtent(framebufferWidth, resolution->scaleX, resolution->alignment);
+                height = ResolveScaledExtent(framebufferHeight, resolution->scaleY, resolution->alignment);
+            } break;
+            case PipelineResolutionModeFramebuffer:
+            default: {
+            } break;
+        }
+    }
+
+    if (width <= 0) width = framebufferWidth;
+    if (height <= 0) height = framebufferHeight;
+    if (width <= 0) width = 1;
+    if (height <= 0) height = 1;
+    if (outWidth != NULL) *outWidth = width;
+    if (outHeight != NULL) *outHeight = height;
+}
+
 bool PixelFormatFromPipelineString(const char *value, PixelFormat *pixelFormat){
     if (value == NULL || pixelFormat == NULL) {
         return false;
@@ -402,6 +1047,64 @@ const char *TextureWrapToPipelineString(TextureWrap wrap){
     return LookupNameByTextureWrap(wrap);
 }
 
+static bool DeserializeResolutionScale(
+    cJSON *jsonResolution,
+    PipelineResource *resource,
+    char *errorMessage,
+    size_t errorMessageSizeInBytes
+){
+    /* "scale" is either one factor for both axes or an [x, y] pair */
+    cJSON *jsonScale = cJSON_GetObjectItemCaseSensitive(jsonResolution, "scale");
+    if (cJSON_IsNumber(jsonScale)) {
+        resource->resolution.scaleX = (float)cJSON_GetNumberValue(jsonScale);
+        resource->resolution.scaleY = resource->resolution.scaleX;
+    } else if (cJSON_IsArray(jsonScale) && cJSON_GetArraySize(jsonScale) == 2
+    &&  cJSON_IsNumber(cJSON_GetArrayItem(jsonScale, 0))
+    &&  cJSON_IsNumber(cJSON_GetArrayItem(jsonScale, 1))
+    ) {
+        resource->resolution.scaleX = (float)cJSON_GetNumberValue(cJSON_GetArrayItem(jsonScale, 0));
+        resource->resolution.scaleY = (float)cJSON_GetNumberValue(cJSON_GetArrayItem(jsonScale, 1));
+    } else {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "\"scale\" must be a number or an array of two numbers in resource \"%s\".",
+            resource->id
+        );
+        return false;
+    }
+    if (resource->resolution.scaleX <= 0.0f || resource->resolution.scaleY <= 0.0f) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "\"scale\" must be > 0 in resource \"%s\".",
+            resource->id
+        );
+        return false;
+    }
+    if (!ParseNumberFieldAsInt(
+            jsonResolution,
+            "alignment",
+            &resource->resolution.alignment,
+            false,
+            errorMessage,
+            errorMessageSizeInBytes
+        )
+    ) {
+        return false;
+    }
+    if (resource->resolution.alignment < 1) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "\"alignment\" must be >= 1 in resource \"%s\".",
+            resource->id
+        );
+        return false;
+    }
+    return true;
+}
+
 static bool DeserializeResource(
     PipelineDescription *description,
     cJSON *jsonResource,
@@ -515,6 +1218,16 @@ static bool DeserializeResource(
                 return false;
             }
         }
+        if (resource->resolution.mode == PipelineResolutionModeScale
+        &&  !DeserializeResolutionScale(
+                jsonResolution,
+                resource,
+                errorMessage,
+                errorMessageSizeInBytes
+            )
+        ) {
+            return false;
+        }
     }
 
     cJSON *jsonHistoryLength = cJSON_GetObjectItemCaseSensitive(jsonResource, "historyLength");
@@ -738,6 +1451,162 @@ static bool DeserializeBindingsArray(
     return true;
 }
 
+static bool DeserializeDownsamplePass(
+    const PipelineDescription *description,
+    cJSON *jsonPass,
+    PipelinePass *pass,
+    char *errorMessage,
+    size_t errorMessageSizeInBytes
+){
+    char filterString[32] = {0};
+    if (!ParseStringField(
+            jsonPass,
+            "filter",
+            filterString,
+            sizeof(filterString),
+            false,
+            errorMessage,
+            errorMessageSizeInBytes
+        )
+    ) {
+        return false;
+    }
+    if (filterString[0] != '\0'
+    &&  !PipelineDownsampleFilterFromString(filterString, &pass->downsampleFilter)
+    ) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Unknown downsample filter \"%s\" (pass \"%s\").",
+            filterString,
+            pass->name
+        );
+        return false;
+    }
+
+    /* The built-in shader fixes the program and its work group size */
+    if (pass->shaderPath[0] != '\0' || pass->overrideWorkGroupSize) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Downsample pass \"%s\" uses a built-in shader; \"shader\" and \"workGroupSize\" are not allowed.",
+            pass->name
+        );
+        return false;
+    }
+
+    if (pass->numInputs != 1
+    ||  pass->inputs[0].access != PipelineResourceAccessSampled
+    ||  pass->numOutputs != 1
+    ||  pass->outputs[0].access != PipelineResourceAccessImageWrite
+    ) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Downsample pass \"%s\" requires one \"sampled\" input and one \"image_write\" output.",
+            pass->name
+        );
+        return false;
+    }
+    if (description->resources[pass->inputs[0].resourceIndex].pixelFormat == PixelFormatR32Ui
+    ||  description->resources[pass->outputs[0].resourceIndex].pixelFormat == PixelFormatR32Ui
+    ) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Downsample pass \"%s\" does not support r32ui resources.",
+            pass->name
+        );
+        return false;
+    }
+    return true;
+}
+
+static bool DeserializeUpsamplePass(
+    const PipelineDescription *description,
+    cJSON *jsonPass,
+    PipelinePass *pass,
+    char *errorMessage,
+    size_t errorMessageSizeInBytes
+){
+    char filterString[32] = {0};
+    if (!ParseStringField(
+            jsonPass,
+            "filter",
+            filterString,
+            sizeof(filterString),
+            false,
+            errorMessage,
+            errorMessageSizeInBytes
+        )
+    ) {
+        return false;
+    }
+    if (filterString[0] != '\0'
+    &&  !PipelineUpsampleFilterFromString(filterString, &pass->upsampleFilter)
+    ) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Unknown upsample filter \"%s\" (pass \"%s\").",
+            filterString,
+            pass->name
+        );
+        return false;
+    }
+
+    if (pass->shaderPath[0] != '\0' || pass->overrideWorkGroupSize) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Upsample pass \"%s\" uses a built-in shader; \"shader\" and \"workGroupSize\" are not allowed.",
+            pass->name
+        );
+        return false;
+    }
+
+    /* inputs[0] is the low resolution source, inputs[1] the guide of the bilateral filter */
+    int numRequiredInputs = (pass->upsampleFilter == PipelineUpsampleFilterBilateral)? 2: 1;
+    bool validBindings = (pass->numInputs == numRequiredInputs)
+        && (pass->numOutputs == 1)
+        && (pass->outputs[0].access == PipelineResourceAccessImageWrite);
+    for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+        if (pass->inputs[inputIndex].access != PipelineResourceAccessSampled
+        &&  pass->inputs[inputIndex].access != PipelineResourceAccessHistoryRead
+        ) {
+            validBindings = false;
+        }
+    }
+    if (validBindings == false) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Upsample pass \"%s\" requires %s and one \"image_write\" output.",
+            pass->name,
+            (numRequiredInputs == 2)? "\"sampled\" source and guide inputs": "one \"sampled\" input"
+        );
+        return false;
+    }
+    for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
+        if (description->resources[pass->inputs[inputIndex].resourceIndex].pixelFormat == PixelFormatR32Ui) {
+            validBindings = false;
+        }
+    }
+    if (description->resources[pass->outputs[0].resourceIndex].pixelFormat == PixelFormatR32Ui) {
+        validBindings = false;
+    }
+    if (validBindings == false) {
+        SetErrorMessage(
+            errorMessage,
+            errorMessageSizeInBytes,
+            "Upsample pass \"%s\" does not support r32ui resources.",
+            pass->name
+        );
+        return false;
+    }
+    return true;
+}
+
 static bool DeserializePass(
     PipelineDescription *description,
     cJSON *jsonPass,
@@ -928,6 +1797,29 @@ static bool DeserializePass(
         }
     }
 
+    if (pass->type == PipelinePassTypeDownsample
+    &&  !DeserializeDownsamplePass(
+            description,
+            jsonPass,
+            pass,
+            errorMessage,
+            errorMessageSizeInBytes
+        )
+    ) {
+        return false;
+    }
+    if (pass->type == PipelinePassTypeUpsample
+    &&  !DeserializeUpsamplePass(
+            description,
+            jsonPass,
+            pass,
+            errorMessage,
+            errorMessageSizeInBytes
+        )
+    ) {
+        return false;
+    }
+
     description->numPasses++;
     return true;
 }
@@ -1077,6 +1969,21 @@ static cJSON *SerializeResolution(const PipelineResource *resource){
         cJSON_AddNumberToObject(jsonResolution, "width", resource->resolution.width);
         cJSON_AddNumberToObject(jsonResolution, "height", resource->resolution.height);
     }
+    if (resource->resolution.mode == PipelineResolutionModeScale) {
+        if (resource->resolution.scaleX == resource->resolution.scaleY) {
+            cJSON_AddNumberToObject(jsonResolution, "scale", resource->resolution.scaleX);
+        } else {
+            cJSON *jsonScale = cJSON_CreateArray();
+            if (jsonScale != NULL) {
+                cJSON_AddItemToArray(jsonScale, cJSON_CreateNumber(resource->resolution.scaleX));
+                cJSON_AddItemToArray(jsonScale, cJSON_CreateNumber(resource->resolution.scaleY));
+                cJSON_AddItemToObject(jsonResolution, "scale", jsonScale);
+            }
+        }
+        if (resource->resolution.alignment > 1) {
+            cJSON_AddNumberToObject(jsonResolution, "alignment", resource->resolution.alignment);
+        }
+    }
     return jsonResolution;
 }
 
@@ -1253,6 +2160,18 @@ cJSON *PipelineDescriptionSerializeToJson(const PipelineDescription *description
         if (pass->shaderPath[0] != '\0') {
             cJSON_AddStringToObject(jsonPass, "shader", pass->shaderPath);
         }
+        if (pass->type == PipelinePassTypeDownsample) {
+            const char *filterString = PipelineDownsampleFilterToString(pass->downsampleFilter);
+            if (filterString != NULL) {
+                cJSON_AddStringToObject(jsonPass, "filter", filterString);
+            }
+        }
+        if (pass->type == PipelinePassTypeUpsample) {
+            const char *filterString = PipelineUpsampleFilterToString(pass->upsampleFilter);
+            if (filterString != NULL) {
+                cJSON_AddStringToObject(jsonPass, "filter", filterString);
+            }
+        }
 
         cJSON *jsonInputs = SerializeBindingsArray(description, pass->inputs, pass->numInputs);
         if (jsonInputs != NULL) {
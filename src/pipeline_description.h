@@ -31,9 +31,26 @@ typedef enum {
     PipelinePassTypeFragment,
     PipelinePassTypeCompute,
     PipelinePassTypePresent,
+    PipelinePassTypeDownsample,
+    PipelinePassTypeUpsample,
     PipelinePassTypeCount
 } PipelinePassType;
 
+/* Reduction used by built-in downsample passes */
+typedef enum {
+    PipelineDownsampleFilterAverage,
+    PipelineDownsampleFilterMax,
+    PipelineDownsampleFilterKawase,
+    PipelineDownsampleFilterCount
+} PipelineDownsampleFilter;
+
+/* Reconstruction used by built-in upsample passes */
+typedef enum {
+    PipelineUpsampleFilterBicubic,
+    PipelineUpsampleFilterBilateral,    /* edge-aware; weights follow the first channel of a guide input */
+    PipelineUpsampleFilterCount
+} PipelineUpsampleFilter;
+
 typedef enum {
     PipelineResourceAccessSampled,
     PipelineResourceAccessImageRead,
@@ -46,13 +63,21 @@ typedef enum {
 typedef enum {
     PipelineResolutionModeFramebuffer,
     PipelineResolutionModeFixed,
+    PipelineResolutionModeScale,
     PipelineResolutionModeCount
 } PipelineResolutionMode;
 
+/*
+ * Scale mode: ceil(framebuffer size * scale), then rounded up to a multiple
+ * of alignment (clamped to at least one pixel).
+ */
 typedef struct {
     PipelineResolutionMode mode;
     int width;
     int height;
+    float scaleX;
+    float scaleY;
+    int alignment;
 } PipelineResourceResolution;
 
 typedef struct {
@@ -90,6 +115,8 @@ typedef struct {
     PipelinePassClear clear;
     bool overrideWorkGroupSize;
     GLuint workGroupSize[3];
+    PipelineDownsampleFilter downsampleFilter;
+    PipelineUpsampleFilter upsampleFilter;
 } PipelinePass;
 
 typedef struct PipelineDescription {
@@ -101,6 +128,93 @@ typedef struct PipelineDescription {
 
 void PipelineDescriptionInit(PipelineDescription *description);
 
+/* Reachability from the present pass (history reads included) */
+typedef struct PipelineReachability {
+    bool passReachable[PIPELINE_MAX_PASSES];
+    bool resourceReachable[PIPELINE_MAX_RESOURCES];
+    int numCulledPasses;
+    int numCulledResources;
+} PipelineReachability;
+
+void PipelineDescriptionAnalyzeReachability(
+    const PipelineDescription *description,
+    PipelineReachability *reachability
+);
+
+/*
+ * Execution plan compiled from a description.
+ *
+ * Culled passes are dropped and texture/image units, attachment slots,
+ * sampler state and barrier masks are resolved up front so executors only
+ * walk the command list.  The editor and the exported runtime share this
+ * layout (the runtime receives it through pipeline_description.inl).
+ */
+#define PIPELINE_PLAN_MAX_BINDINGS             (PIPELINE_MAX_BINDINGS_PER_PASS * 2)
+#define PIPELINE_PLAN_COMPUTE_TEXTURE_UNIT     (4)    /* COMPUTE_TEXTURE_START_INDEX */
+#define PIPELINE_DOWNSAMPLE_TILE_SIZE          (16)   /* work group edge of the built-in downsample shader */
+#define PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH (5)   /* log2(tile size) + 1 levels, one image unit each */
+#define PIPELINE_UPSAMPLE_TILE_SIZE            (8)    /* work group edge of the built-in upsample shader */
+
+typedef enum {
+    PipelinePlanBindingKindTexture,
+    PipelinePlanBindingKindImage,
+    PipelinePlanBindingKindColorAttachment,
+    PipelinePlanBindingKindBlitSource,
+    PipelinePlanBindingKindCount
+} PipelinePlanBindingKind;
+
+typedef struct {
+    PipelinePlanBindingKind kind;
+    int resourceIndex;
+    int historyOffset;
+    int unit;                   /* texture unit, image unit or color attachment index */
+    GLenum imageAccess;
+    GLenum imageFormat;
+    TextureFilter textureFilter;    /* (filter, wrap, mipmap) selects a shared sampler object */
+    TextureWrap textureWrap;
+    bool enableMipmap;
+    bool mipmapPrebuilt;        /* mip chain is written by a downsample pass; never regenerate it */
+} PipelinePlanBinding;
+
+typedef struct {
+    int passIndex;              /* index into PipelineDescription::passes */
+    PipelinePassType type;
+    bool executable;            /* false = the pass falls back to the legacy path */
+    GLbitfield barrierBits;     /* issued right before the pass */
+    uint32_t previousFrameWriterMask;   /* commands whose previous-frame image stores the pass consumes */
+    int targetResourceIndex;    /* determines viewport and dispatch size */
+    PipelinePassClear clear;
+    bool overrideWorkGroupSize;
+    GLuint workGroupSize[3];
+    PipelinePlanBinding bindings[PIPELINE_PLAN_MAX_BINDINGS];
+    int numBindings;
+    PipelineDownsampleFilter downsampleFilter;
+} PipelinePlanCommand;
+
+typedef struct PipelineExecutionPlan {
+    PipelinePlanCommand commands[PIPELINE_MAX_PASSES];
+    int numCommands;
+} PipelineExecutionPlan;
+
+void PipelineDescriptionCompileExecutionPlan(
+    const PipelineDescription *description,
+    const PipelineReachability *reachability,
+    bool enableMipmapGeneration,
+    PipelineExecutionPlan *plan
+);
+
+/*
+ * Copies reachable passes and resources only, remapping resource indices.
+ * outSourcePassIndices (optional) receives the original index of each
+ * remaining pass.
+ */
+void PipelineDescriptionStripUnreachable(
+    const PipelineDescription *description,
+    const PipelineReachability *reachability,
+    PipelineDescription *outDescription,
+    int *outSourcePassIndices
+);
+
 /* Serialization helpers */
 bool PipelineDescriptionDeserializeFromJson(
     PipelineDescription *description,
@@ -116,7 +230,29 @@ cJSON *PipelineDescriptionSerializeToJson(
 const char *PipelinePassTypeToString(PipelinePassType type);
 bool PipelinePassTypeFromString(const char *value, PipelinePassType *type);
 
+const char *PipelineDownsampleFilterToString(PipelineDownsampleFilter filter);
+bool PipelineDownsampleFilterFromString(const char *value, PipelineDownsampleFilter *filter);
+
+/* True when some downsample pass writes the mip chain of the resource */
+bool PipelineDescriptionResourceHasMipChain(
+    const PipelineDescription *description,
+    int resourceIndex
+);
+
+const char *PipelineUpsampleFilterToString(PipelineUpsampleFilter filter);
+bool PipelineUpsampleFilterFromString(const char *value, PipelineUpsampleFilter *filter);
+
+/* Size of a resource for the given framebuffer size (never below 1x1) */
+void PipelineResourceResolutionResolve(
+    const PipelineResourceResolution *resolution,
+    int framebufferWidth,
+    int framebufferHeight,
+    int *outWidth,
+    int *outHeight
+);
+
 const char *PipelineResourceAccessToString(PipelineResourceAccess access);
+const char *PipelinePlanBindingKindToString(PipelinePlanBindingKind kind);
 bool PipelineResourceAccessFromString(const char *value, PipelineResourceAccess *access);
 
 const char *PipelineResolutionModeToString(PipelineResolutionMode mode);
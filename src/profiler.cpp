@@ -0,0 +1,807 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include <string.h>
+#include "common.h"
+#include "profiler.h"
+
+
+#define PROFILER_MAX_SECTIONS					(64)
+#define PROFILER_MAX_SECTION_NAME_LENGTH		(64)
+#define PROFILER_MAX_DEPTH						(16)
+#define PROFILER_INVALID_INDEX					(-1)
+
+/*
+	GPU 計測結果を保持するフレーム数
+	GPU が CPU からこのフレーム数以上遅れた場合、最も古いフレームの計測結果は
+	待たずに捨てる。
+*/
+#define PROFILER_NUM_GPU_FRAMES					(4)
+#define PROFILER_MAX_GPU_RANGES_PER_FRAME		(128)
+
+#define PROFILER_TRACE_MAX_THREADS				(32)
+#define PROFILER_TRACE_MAX_EVENTS_PER_THREAD	(32768)
+#define PROFILER_TRACE_MAX_GPU_EVENTS			(65536)
+#define PROFILER_TRACE_MAX_THREAD_NAME_LENGTH	(64)
+#define PROFILER_TRACE_GPU_THREAD_ID			(0)	/* GPU 計測区間を並べる仮想スレッド */
+
+/* 計測区間 */
+typedef struct {
+	char name[PROFILER_MAX_SECTION_NAME_LENGTH];
+	ProfilerDomain domain;
+	float history[PROFILER_HISTORY_LENGTH];
+	int numHistorySamples;
+	int historyHead;				/* 次に書き込む位置 */
+	int lastNumCalls;
+	uint32_t lastSampleFrameIndex;
+	double accumulatedInSeconds;	/* 集計中のフレームの値（CPU のみ）*/
+	int numCalls;					/* 集計中のフレームの計測回数（CPU のみ）*/
+} ProfilerSection;
+
+/* 実行中の CPU 計測区間 */
+typedef struct {
+	int sectionIndex;
+	LONGLONG beginCount;
+	LONGLONG childCount;			/* 子区間の合計時間 */
+} ProfilerCpuScope;
+
+/* 1 フレーム分の GPU 計測区間 */
+typedef struct {
+	struct {
+		int sectionIndex;
+		int parentRangeIndex;
+	} ranges[PROFILER_MAX_GPU_RANGES_PER_FRAME];
+	GLuint queries[PROFILER_MAX_GPU_RANGES_PER_FRAME * 2 /* 開始 終了 */];
+	int numRanges;
+	int lastIssuedQueryIndex;
+	bool pending;					/* 結果の回収待ちか？ */
+	bool traced;					/* トレースに記録するか？ */
+	double gpuToTraceOffsetInMicroseconds;
+} ProfilerGpuFrame;
+
+/* トレースのイベント（時刻はトレース開始からのマイクロ秒）*/
+typedef struct {
+	char name[PROFILER_MAX_SECTION_NAME_LENGTH];
+	double beginInMicroseconds;
+	double durationInMicroseconds;
+} ProfilerTraceEvent;
+
+/*
+	スレッドごとのトレースイベントバッファ
+	書き込むのは所有スレッドのみで、イベントを書き込んでから numEvents を
+	更新する。読み出し側は numEvents 未満のイベントのみ参照するため、ロックは
+	不要。
+	所有スレッドが終了したバッファは、イベントが空になった（次のトレース
+	開始でリセットされた）時点で別のスレッドに再利用される。
+*/
+typedef enum {
+	ProfilerTraceThreadStateUnused = 0,
+	ProfilerTraceThreadStateActive,		/* 所有スレッドが動作中 */
+	ProfilerTraceThreadStateExited,		/* 所有スレッドが終了済み（再利用可能）*/
+	ProfilerTraceThreadStateClaiming,	/* 再利用のため初期化中 */
+} ProfilerTraceThreadState;
+
+typedef struct {
+	volatile LONG state;				/* ProfilerTraceThreadState */
+	DWORD threadId;
+	char threadName[PROFILER_TRACE_MAX_THREAD_NAME_LENGTH];
+	ProfilerTraceEvent *events;
+	volatile LONG numEvents;
+} ProfilerTraceThread;
+
+typedef enum {
+	ProfilerTraceStateIdle = 0,
+	ProfilerTraceStateRecording,
+	ProfilerTraceStateDraining,		/* 記録済みフレームの GPU 計測結果の回収待ち */
+	ProfilerTraceStateFinished,
+} ProfilerTraceState;
+
+static struct {
+	bool initialized;
+	bool enable;
+	bool requestedEnable;
+	uint32_t frameIndex;
+	LONGLONG frequency;
+	LONGLONG frameBeginCount;
+
+	ProfilerSection sections[PROFILER_MAX_SECTIONS];
+	int numSections;
+	int cpuFrameSectionIndex;
+	int gpuTotalSectionIndex;
+
+	ProfilerCpuScope cpuStack[PROFILER_MAX_DEPTH];
+	int cpuDepth;
+	int gpuStack[PROFILER_MAX_DEPTH];
+	int gpuDepth;
+
+	ProfilerGpuFrame gpuFrames[PROFILER_NUM_GPU_FRAMES];
+	int currentGpuFrame;
+
+	DWORD mainThreadId;
+} s_profiler;
+
+static struct {
+	volatile LONG recording;		/* 全スレッドから参照される */
+	ProfilerTraceState state;
+	char fileName[MAX_PATH];
+	int numFrames;
+	int numRecordedFrames;
+	int numDrainingFrames;
+	LONGLONG beginCount;
+
+	ProfilerTraceThread threads[PROFILER_TRACE_MAX_THREADS];
+	volatile LONG numThreads;
+	volatile LONG numDroppedEvents;
+
+	ProfilerTraceEvent *gpuEvents;
+	int numGpuEvents;
+} s_trace;
+
+/* 呼び出しスレッドの CPU 計測区間（トレース用）*/
+static thread_local struct {
+	const char *name;
+	LONGLONG beginCount;			/* 0 = トレース記録中に開始されていない */
+} s_threadStack[PROFILER_MAX_DEPTH];
+static thread_local int s_threadDepth = 0;
+static thread_local char s_threadName[PROFILER_TRACE_MAX_THREAD_NAME_LENGTH] = {0};
+static thread_local struct ProfilerTraceThreadOwner {
+	ProfilerTraceThread *thread;
+
+	/* スレッド終了時にバッファを手放す */
+	~ProfilerTraceThreadOwner(){
+		if (thread != NULL) InterlockedExchange(&thread->state, ProfilerTraceThreadStateExited);
+	}
+} s_traceThreadOwner;
+static thread_local bool s_traceThreadUnavailable = false;
+
+
+static LONGLONG ProfilerGetCount(){
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+}
+
+static int ProfilerFindOrAddSection(
+	const char *name,
+	ProfilerDomain domain
+){
+	for (int sectionIndex = 0; sectionIndex < s_profiler.numSections; ++sectionIndex) {
+		const ProfilerSection *section = &s_profiler.sections[sectionIndex];
+		if (section->domain == domain
+		&&	strcmp(section->name, name) == 0
+		) {
+			return sectionIndex;
+		}
+	}
+	if (s_profiler.numSections >= PROFILER_MAX_SECTIONS) {
+		return PROFILER_INVALID_INDEX;
+	}
+
+	int sectionIndex = s_profiler.numSections++;
+	ProfilerSection *section = &s_profiler.sections[sectionIndex];
+	memset(section, 0, sizeof(ProfilerSection));
+	strlcpy(section->name, name, sizeof(section->name));
+	section->domain = domain;
+	return sectionIndex;
+}
+
+static void ProfilerPushSample(
+	int sectionIndex,
+	float valueInMilliseconds,
+	int numCalls
+){
+	if (sectionIndex == PROFILER_INVALID_INDEX) return;
+	ProfilerSection *section = &s_profiler.sections[sectionIndex];
+	section->history[section->historyHead] = valueInMilliseconds;
+	section->historyHead = (section->historyHead + 1) % PROFILER_HISTORY_LENGTH;
+	if (section->numHistorySamples < PROFILER_HISTORY_LENGTH) {
+		section->numHistorySamples++;
+	}
+	section->lastNumCalls = numCalls;
+	section->lastSampleFrameIndex = s_profiler.frameIndex;
+}
+
+static void ProfilerResetHistories(){
+	for (int sectionIndex = 0; sectionIndex < s_profiler.numSections; ++sectionIndex) {
+		ProfilerSection *section = &s_profiler.sections[sectionIndex];
+		section->numHistorySamples = 0;
+		section->historyHead = 0;
+		section->lastNumCalls = 0;
+		section->accumulatedInSeconds = 0.0;
+		section->numCalls = 0;
+	}
+	for (int frameIndex = 0; frameIndex < PROFILER_NUM_GPU_FRAMES; ++frameIndex) {
+		s_profiler.gpuFrames[frameIndex].pending = false;
+		s_profiler.gpuFrames[frameIndex].numRanges = 0;
+	}
+}
+
+static void ProfilerCommitCpuFrame(
+	LONGLONG currentCount
+){
+	for (int sectionIndex = 0; sectionIndex < s_profiler.numSections; ++sectionIndex) {
+		ProfilerSection *section = &s_profiler.sections[sectionIndex];
+		if (section->domain != ProfilerDomainCpu
+		||	section->numCalls == 0
+		) {
+			continue;
+		}
+		ProfilerPushSample(sectionIndex, (float)(section->accumulatedInSeconds * 1000.0), section->numCalls);
+		section->accumulatedInSeconds = 0.0;
+		section->numCalls = 0;
+	}
+
+	if (s_profiler.frameBeginCount != 0) {
+		double frameTimeInSeconds = (double)(currentCount - s_profiler.frameBeginCount) / (double)s_profiler.frequency;
+		ProfilerPushSample(s_profiler.cpuFrameSectionIndex, (float)(frameTimeInSeconds * 1000.0), 1);
+	}
+}
+
+static bool ProfilerIsGpuFrameAvailable(
+	const ProfilerGpuFrame *frame
+){
+	/*
+		クエリは発行順に完了するものとみなし、最後に発行したクエリのみ調べる。
+		仮に先行するクエリが未完了でも、結果の取得で待たされるのは僅かな時間である。
+	*/
+	GLint available = 0;
+	glGetQueryObjectiv(frame->queries[frame->lastIssuedQueryIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+	return available != 0;
+}
+
+static void ProfilerResolveGpuFrame(
+	const ProfilerGpuFrame *frame
+){
+	static GLuint64 s_beginTimeInNanoseconds[PROFILER_MAX_GPU_RANGES_PER_FRAME];
+	static GLint64 s_elapsedInNanoseconds[PROFILER_MAX_GPU_RANGES_PER_FRAME];
+	static GLint64 s_exclusiveInNanoseconds[PROFILER_MAX_GPU_RANGES_PER_FRAME];
+	static GLint64 s_sectionTimeInNanoseconds[PROFILER_MAX_SECTIONS];
+	static int s_sectionNumCalls[PROFILER_MAX_SECTIONS];
+
+	for (int rangeIndex = 0; rangeIndex < frame->numRanges; ++rangeIndex) {
+		GLuint64 beginTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(frame->queries[rangeIndex * 2 + 0], GL_QUERY_RESULT, &beginTime);
+		glGetQueryObjectui64v(frame->queries[rangeIndex * 2 + 1], GL_QUERY_RESULT, &endTime);
+		s_beginTimeInNanoseconds[rangeIndex] = beginTime;
+		s_elapsedInNanoseconds[rangeIndex] = (endTime > beginTime)? (GLint64)(endTime - beginTime): 0;
+		s_exclusiveInNanoseconds[rangeIndex] = s_elapsedInNanoseconds[rangeIndex];
+	}
+
+	/* トレースには子区間を含む時間を記録 */
+	if (frame->traced && s_trace.gpuEvents != NULL) {
+		for (int rangeIndex = 0; rangeIndex < frame->numRanges; ++rangeIndex) {
+			if (s_trace.numGpuEvents >= PROFILER_TRACE_MAX_GPU_EVENTS) {
+				InterlockedIncrement(&s_trace.numDroppedEvents);
+				continue;
+			}
+			ProfilerTraceEvent *event = &s_trace.gpuEvents[s_trace.numGpuEvents++];
+			strlcpy(event->name, s_profiler.sections[frame->ranges[rangeIndex].sectionIndex].name, sizeof(event->name));
+			event->beginInMicroseconds = (double)s_beginTimeInNanoseconds[rangeIndex] * 1e-3 + frame->gpuToTraceOffsetInMicroseconds;
+			event->durationInMicroseconds = (double)s_elapsedInNanoseconds[rangeIndex] * 1e-3;
+		}
+	}
+
+	/* 親区間から子区間の時間を除く。最上位の区間の合計がフレームの GPU 時間 */
+	GLint64 totalInNanoseconds = 0;
+	for (int rangeIndex = 0; rangeIndex < frame->numRanges; ++rangeIndex) {
+		int parentRangeIndex = frame->ranges[rangeIndex].parentRangeIndex;
+		if (parentRangeIndex != PROFILER_INVALID_INDEX) {
+			s_exclusiveInNanoseconds[parentRangeIndex] -= s_elapsedInNanoseconds[rangeIndex];
+		} else {
+			totalInNanoseconds += s_elapsedInNanoseconds[rangeIndex];
+		}
+	}
+
+	memset(s_sectionTimeInNanoseconds, 0, sizeof(s_sectionTimeInNanoseconds));
+	memset(s_sectionNumCalls, 0, sizeof(s_sectionNumCalls));
+	for (int rangeIndex = 0; rangeIndex < frame->numRanges; ++rangeIndex) {
+		int sectionIndex = frame->ranges[rangeIndex].sectionIndex;
+		if (s_exclusiveInNanoseconds[rangeIndex] > 0) {
+			s_sectionTimeInNanoseconds[sectionIndex] += s_exclusiveInNanoseconds[rangeIndex];
+		}
+		s_sectionNumCalls[sectionIndex]++;
+	}
+	for (int sectionIndex = 0; sectionIndex < s_profiler.numSections; ++sectionIndex) {
+		if (s_sectionNumCalls[sectionIndex] == 0) continue;
+		ProfilerPushSample(sectionIndex, (float)((double)s_sectionTimeInNanoseconds[sectionIndex] * 1e-6), s_sectionNumCalls[sectionIndex]);
+	}
+	ProfilerPushSample(s_profiler.gpuTotalSectionIndex, (float)((double)totalInNanoseconds * 1e-6), 1);
+}
+
+static void ProfilerCollectGpuFrames(){
+	/* 古いフレームから順に、結果の準備ができたものだけを回収 */
+	for (int i = 1; i <= PROFILER_NUM_GPU_FRAMES; ++i) {
+		ProfilerGpuFrame *frame = &s_profiler.gpuFrames[(s_profiler.currentGpuFrame + i) % PROFILER_NUM_GPU_FRAMES];
+		if (frame->pending == false) continue;
+		if (ProfilerIsGpuFrameAvailable(frame) == false) break;
+		ProfilerResolveGpuFrame(frame);
+		frame->pending = false;
+		frame->numRanges = 0;
+	}
+}
+
+static double ProfilerTraceCountToMicroseconds(
+	LONGLONG count
+){
+	return (double)(count - s_trace.beginCount) * 1e6 / (double)s_profiler.frequency;
+}
+
+/* 終了したスレッドのバッファのうち、未出力のイベントが無いものを引き取る */
+static ProfilerTraceThread *ProfilerTraceClaimExitedThread(){
+	LONG numThreads = s_trace.numThreads;
+	if (numThreads > PROFILER_TRACE_MAX_THREADS) numThreads = PROFILER_TRACE_MAX_THREADS;
+	for (int threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+		ProfilerTraceThread *thread = &s_trace.threads[threadIndex];
+		if (thread->state != ProfilerTraceThreadStateExited) continue;
+		if (thread->numEvents != 0) continue;
+		if (
+			InterlockedCompareExchange(&thread->state, ProfilerTraceThreadStateClaiming, ProfilerTraceThreadStateExited)
+			== ProfilerTraceThreadStateExited
+		) {
+			return thread;
+		}
+	}
+	return NULL;
+}
+
+static ProfilerTraceThread *ProfilerTraceGetCurrentThread(){
+	if (s_traceThreadOwner.thread != NULL) return s_traceThreadOwner.thread;
+	if (s_traceThreadUnavailable) return NULL;
+
+	/* 初回の書き込み時にスレッドのバッファを確保（または再利用）して登録 */
+	ProfilerTraceThread *thread = ProfilerTraceClaimExitedThread();
+	if (thread == NULL) {
+		LONG threadIndex = InterlockedIncrement(&s_trace.numThreads) - 1;
+		if (threadIndex >= PROFILER_TRACE_MAX_THREADS) {
+			s_traceThreadUnavailable = true;
+			return NULL;
+		}
+		thread = &s_trace.threads[threadIndex];
+		thread->events = (ProfilerTraceEvent *)malloc(sizeof(ProfilerTraceEvent) * PROFILER_TRACE_MAX_EVENTS_PER_THREAD);
+		if (thread->events == NULL) {
+			/* スロットは他のスレッドが再利用できないよう使用中のまま残す */
+			InterlockedExchange(&thread->state, ProfilerTraceThreadStateClaiming);
+			s_traceThreadUnavailable = true;
+			return NULL;
+		}
+	}
+	thread->threadId = GetCurrentThreadId();
+	if (s_threadName[0] != '\0') {
+		strlcpy(thread->threadName, s_threadName, sizeof(thread->threadName));
+	} else if (thread->threadId == s_profiler.mainThreadId) {
+		strlcpy(thread->threadName, "main", sizeof(thread->threadName));
+	} else {
+		snprintf(thread->threadName, sizeof(thread->threadName), "thread %lu", (unsigned long)thread->threadId);
+	}
+	thread->numEvents = 0;
+	InterlockedExchange(&thread->state, ProfilerTraceThreadStateActive);
+	s_traceThreadOwner.thread = thread;
+	return thread;
+}
+
+static void ProfilerTraceAddCpuEvent(
+	const char *name,
+	LONGLONG beginCount,
+	LONGLONG endCount
+){
+	ProfilerTraceThread *thread = ProfilerTraceGetCurrentThread();
+	if (thread == NULL) return;
+
+	LONG eventIndex = thread->numEvents;
+	if (eventIndex >= PROFILER_TRACE_MAX_EVENTS_PER_THREAD) {
+		InterlockedIncrement(&s_trace.numDroppedEvents);
+		return;
+	}
+	ProfilerTraceEvent *event = &thread->events[eventIndex];
+	strlcpy(event->name, name, sizeof(event->name));
+	event->beginInMicroseconds = ProfilerTraceCountToMicroseconds(beginCount);
+	event->durationInMicroseconds = (double)(endCount - beginCount) * 1e6 / (double)s_profiler.frequency;
+
+	/* イベントを書き込んでから公開 */
+	InterlockedExchange(&thread->numEvents, eventIndex + 1);
+}
+
+static bool ProfilerTraceHasPendingGpuFrames(){
+	for (int frameIndex = 0; frameIndex < PROFILER_NUM_GPU_FRAMES; ++frameIndex) {
+		const ProfilerGpuFrame *frame = &s_profiler.gpuFrames[frameIndex];
+		if (frame->pending && frame->traced) return true;
+	}
+	return false;
+}
+
+static void ProfilerTraceWriteString(
+	FILE *file,
+	const char *string
+){
+	fputc('"', file);
+	for (const char *p = string; *p != '\0'; ++p) {
+		unsigned char c = (unsigned char)*p;
+		if (c == '"' || c == '\\') {
+			fputc('\\', file);
+			fputc(c, file);
+		} else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		} else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+static void ProfilerTraceWriteThreadName(
+	FILE *file,
+	unsigned long processId,
+	unsigned long threadId,
+	const char *threadName
+){
+	fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":", processId, threadId);
+	ProfilerTraceWriteString(file, threadName);
+	fprintf(file, "}}");
+}
+
+static void ProfilerTraceWriteEvents(
+	FILE *file,
+	unsigned long processId,
+	unsigned long threadId,
+	const char *category,
+	const ProfilerTraceEvent *events,
+	int numEvents
+){
+	for (int eventIndex = 0; eventIndex < numEvents; ++eventIndex) {
+		const ProfilerTraceEvent *event = &events[eventIndex];
+		fprintf(file, ",\n{\"name\":");
+		ProfilerTraceWriteString(file, event->name);
+		fprintf(
+			file,
+			",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+			category,
+			processId,
+			threadId,
+			event->beginInMicroseconds,
+			event->durationInMicroseconds
+		);
+	}
+}
+
+void ProfilerSetEnable(bool enable){
+	s_profiler.requestedEnable = enable;
+}
+
+bool ProfilerGetEnable(){
+	return s_profiler.enable;
+}
+
+void ProfilerNewFrame(){
+	if (s_profiler.initialized == false) return;
+
+	LONGLONG currentCount = ProfilerGetCount();
+	if (s_profiler.enable) {
+		/* 計測区間の開始と終了が対応していない */
+		assert(s_profiler.cpuDepth == 0);
+		assert(s_profiler.gpuDepth == 0);
+
+		ProfilerCommitCpuFrame(currentCount);
+		ProfilerGpuFrame *frame = &s_profiler.gpuFrames[s_profiler.currentGpuFrame];
+		if (frame->numRanges > 0) {
+			frame->pending = true;
+		}
+	}
+
+	/* トレース記録 */
+	if (s_trace.state == ProfilerTraceStateRecording) {
+		if (s_profiler.frameBeginCount >= s_trace.beginCount) {
+			ProfilerTraceAddCpuEvent("main loop", s_profiler.frameBeginCount, currentCount);
+		}
+		if (++s_trace.numRecordedFrames >= s_trace.numFrames) {
+			InterlockedExchange(&s_trace.recording, 0);
+			s_trace.state = ProfilerTraceStateDraining;
+			s_trace.numDrainingFrames = 0;
+		}
+	}
+
+	s_profiler.cpuDepth = 0;
+	s_profiler.gpuDepth = 0;
+	s_profiler.frameBeginCount = currentCount;
+	s_profiler.frameIndex++;
+
+	ProfilerCollectGpuFrames();
+
+	if (s_trace.state == ProfilerTraceStateDraining) {
+		if (ProfilerTraceHasPendingGpuFrames() == false
+		||	++s_trace.numDrainingFrames > PROFILER_NUM_GPU_FRAMES
+		) {
+			s_trace.state = ProfilerTraceStateFinished;
+		}
+	}
+
+	/* トレース記録中は GPU 計測区間を記録するため、表示の有無に関わらず有効にする */
+	bool enable =
+			s_profiler.requestedEnable
+		||	s_trace.state == ProfilerTraceStateRecording
+		||	s_trace.state == ProfilerTraceStateDraining;
+	if (s_profiler.enable != enable) {
+		s_profiler.enable = enable;
+		ProfilerResetHistories();
+	}
+
+	/* 回収が間に合わなかったフレームは捨てる */
+	s_profiler.currentGpuFrame = (s_profiler.currentGpuFrame + 1) % PROFILER_NUM_GPU_FRAMES;
+	ProfilerGpuFrame *frame = &s_profiler.gpuFrames[s_profiler.currentGpuFrame];
+	frame->pending = false;
+	frame->numRanges = 0;
+	frame->traced = false;
+
+	/* GPU の時刻と CPU の時刻をフレームごとに対応付ける */
+	if (s_profiler.enable
+	&&	s_trace.state == ProfilerTraceStateRecording
+	) {
+		GLint64 gpuTimeInNanoseconds = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTimeInNanoseconds);
+		frame->traced = true;
+		frame->gpuToTraceOffsetInMicroseconds =
+			ProfilerTraceCountToMicroseconds(ProfilerGetCount()) - (double)gpuTimeInNanoseconds * 1e-3;
+	}
+}
+
+void ProfilerCpuBegin(const char *name){
+	LONGLONG currentCount = ProfilerGetCount();
+
+	/* トレース（全スレッド）*/
+	if (s_threadDepth < PROFILER_MAX_DEPTH) {
+		s_threadStack[s_threadDepth].name = name;
+		s_threadStack[s_threadDepth].beginCount = s_trace.recording? currentCount: 0;
+	}
+	s_threadDepth++;
+
+	/* フレーム単位の集計（メインスレッドのみ）*/
+	if (s_profiler.enable == false) return;
+	if (GetCurrentThreadId() != s_profiler.mainThreadId) return;
+
+	if (s_profiler.cpuDepth < PROFILER_MAX_DEPTH) {
+		ProfilerCpuScope *scope = &s_profiler.cpuStack[s_profiler.cpuDepth];
+		scope->sectionIndex = ProfilerFindOrAddSection(name, ProfilerDomainCpu);
+		scope->childCount = 0;
+		scope->beginCount = currentCount;
+	}
+	s_profiler.cpuDepth++;
+}
+
+void ProfilerCpuEnd(){
+	LONGLONG currentCount = ProfilerGetCount();
+
+	/* トレース（全スレッド）*/
+	assert(s_threadDepth > 0);
+	s_threadDepth--;
+	if (s_threadDepth < PROFILER_MAX_DEPTH) {
+		if (s_threadStack[s_threadDepth].beginCount != 0
+		&&	s_trace.recording
+		) {
+			ProfilerTraceAddCpuEvent(s_threadStack[s_threadDepth].name, s_threadStack[s_threadDepth].beginCount, currentCount);
+		}
+	}
+
+	/* フレーム単位の集計（メインスレッドのみ）*/
+	if (s_profiler.enable == false) return;
+	if (GetCurrentThreadId() != s_profiler.mainThreadId) return;
+	assert(s_profiler.cpuDepth > 0);
+
+	s_profiler.cpuDepth--;
+	if (s_profiler.cpuDepth < PROFILER_MAX_DEPTH) {
+		const ProfilerCpuScope *scope = &s_profiler.cpuStack[s_profiler.cpuDepth];
+		LONGLONG elapsedCount = currentCount - scope->beginCount;
+		if (s_profiler.cpuDepth > 0) {
+			s_profiler.cpuStack[s_profiler.cpuDepth - 1].childCount += elapsedCount;
+		}
+		if (scope->sectionIndex != PROFILER_INVALID_INDEX) {
+			ProfilerSection *section = &s_profiler.sections[scope->sectionIndex];
+			section->accumulatedInSeconds += (double)(elapsedCount - scope->childCount) / (double)s_profiler.frequency;
+			section->numCalls++;
+		}
+	}
+}
+
+void ProfilerGpuBegin(const char *name){
+	if (s_profiler.enable == false) return;
+
+	ProfilerGpuFrame *frame = &s_profiler.gpuFrames[s_profiler.currentGpuFrame];
+	int rangeIndex = PROFILER_INVALID_INDEX;
+	if (s_profiler.gpuDepth < PROFILER_MAX_DEPTH
+	&&	frame->numRanges < PROFILER_MAX_GPU_RANGES_PER_FRAME
+	) {
+		int sectionIndex = ProfilerFindOrAddSection(name, ProfilerDomainGpu);
+		if (sectionIndex != PROFILER_INVALID_INDEX) {
+			rangeIndex = frame->numRanges++;
+			frame->ranges[rangeIndex].sectionIndex = sectionIndex;
+			frame->ranges[rangeIndex].parentRangeIndex =
+				(s_profiler.gpuDepth > 0)? s_profiler.gpuStack[s_profiler.gpuDepth - 1]: PROFILER_INVALID_INDEX;
+			glQueryCounter(frame->queries[rangeIndex * 2 + 0], GL_TIMESTAMP);
+			frame->lastIssuedQueryIndex = rangeIndex * 2 + 0;
+		}
+	}
+	if (s_profiler.gpuDepth < PROFILER_MAX_DEPTH) {
+		s_profiler.gpuStack[s_profiler.gpuDepth] = rangeIndex;
+	}
+	s_profiler.gpuDepth++;
+}
+
+void ProfilerGpuEnd(){
+	if (s_profiler.enable == false) return;
+	assert(s_profiler.gpuDepth > 0);
+
+	s_profiler.gpuDepth--;
+	if (s_profiler.gpuDepth < PROFILER_MAX_DEPTH) {
+		int rangeIndex = s_profiler.gpuStack[s_profiler.gpuDepth];
+		if (rangeIndex != PROFILER_INVALID_INDEX) {
+			ProfilerGpuFrame *frame = &s_profiler.gpuFrames[s_profiler.currentGpuFrame];
+			glQueryCounter(frame->queries[rangeIndex * 2 + 1], GL_TIMESTAMP);
+			frame->lastIssuedQueryIndex = rangeIndex * 2 + 1;
+		}
+	}
+}
+
+int ProfilerGetNumSections(){
+	return s_profiler.numSections;
+}
+
+static int ProfilerCompareFloat(const void *a, const void *b){
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+	return (fa < fb)? -1: (fa > fb)? 1: 0;
+}
+
+bool ProfilerGetSectionStatistics(int sectionIndex, ProfilerSectionStatistics *statistics){
+	if (sectionIndex < 0 || s_profiler.numSections <= sectionIndex) return false;
+	const ProfilerSection *section = &s_profiler.sections[sectionIndex];
+	if (section->numHistorySamples == 0
+	||	s_profiler.frameIndex - section->lastSampleFrameIndex > PROFILER_HISTORY_LENGTH
+	) {
+		return false;
+	}
+
+	int numSamples = section->numHistorySamples;
+	float sortedSamples[PROFILER_HISTORY_LENGTH];
+	memcpy(sortedSamples, section->history, sizeof(float) * numSamples);
+	qsort(sortedSamples, numSamples, sizeof(float), ProfilerCompareFloat);
+	double sum = 0.0;
+	for (int i = 0; i < numSamples; ++i) {
+		sum += sortedSamples[i];
+	}
+	int p99Index = (numSamples * 99 + 99) / 100 - 1;
+	if (p99Index < 0) p99Index = 0;
+	if (p99Index >= numSamples) p99Index = numSamples - 1;
+
+	statistics->name				= section->name;
+	statistics->domain				= section->domain;
+	statistics->numCalls			= section->lastNumCalls;
+	statistics->lastInMilliseconds	= section->history[(section->historyHead + PROFILER_HISTORY_LENGTH - 1) % PROFILER_HISTORY_LENGTH];
+	statistics->minInMilliseconds	= sortedSamples[0];
+	statistics->avgInMilliseconds	= (float)(sum / numSamples);
+	statistics->p99InMilliseconds	= sortedSamples[p99Index];
+	statistics->history				= section->history;
+	statistics->numHistorySamples	= numSamples;
+	statistics->historyOffset		= (numSamples < PROFILER_HISTORY_LENGTH)? 0: section->historyHead;
+	return true;
+}
+
+void ProfilerSetThreadName(const char *name){
+	strlcpy(s_threadName, name, sizeof(s_threadName));
+	if (s_traceThreadOwner.thread != NULL) {
+		strlcpy(s_traceThreadOwner.thread->threadName, name, sizeof(s_traceThreadOwner.thread->threadName));
+	}
+}
+
+bool ProfilerStartTrace(const char *fileName, int numFrames){
+	if (s_profiler.initialized == false) return false;
+	if (s_trace.state != ProfilerTraceStateIdle) return false;
+	if (numFrames <= 0) return false;
+
+	s_trace.gpuEvents = (ProfilerTraceEvent *)malloc(sizeof(ProfilerTraceEvent) * PROFILER_TRACE_MAX_GPU_EVENTS);
+	if (s_trace.gpuEvents == NULL) return false;
+	s_trace.numGpuEvents = 0;
+
+	/* 登録済みのスレッドのバッファは使い回す（終了済みスレッドのものは再利用可能になる）*/
+	LONG numThreads = s_trace.numThreads;
+	if (numThreads > PROFILER_TRACE_MAX_THREADS) numThreads = PROFILER_TRACE_MAX_THREADS;
+	for (int threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+		InterlockedExchange(&s_trace.threads[threadIndex].numEvents, 0);
+	}
+	InterlockedExchange(&s_trace.numDroppedEvents, 0);
+
+	strlcpy(s_trace.fileName, fileName, sizeof(s_trace.fileName));
+	s_trace.numFrames = numFrames;
+	s_trace.numRecordedFrames = 0;
+	s_trace.beginCount = ProfilerGetCount();
+	s_trace.state = ProfilerTraceStateRecording;
+	InterlockedExchange(&s_trace.recording, 1);
+	return true;
+}
+
+bool ProfilerIsTraceRecording(){
+	return s_trace.state == ProfilerTraceStateRecording
+		|| s_trace.state == ProfilerTraceStateDraining;
+}
+
+bool ProfilerIsTraceFinished(){
+	return s_trace.state == ProfilerTraceStateFinished;
+}
+
+bool ProfilerWriteTrace(){
+	if (s_trace.state != ProfilerTraceStateFinished) return false;
+
+	bool ret = false;
+	FILE *file = fopen(s_trace.fileName, "w");
+	if (file != NULL) {
+		unsigned long processId = (unsigned long)GetCurrentProcessId();
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"args\":{\"name\":\"minimal_gl\"}}", processId);
+
+		ProfilerTraceWriteThreadName(file, processId, PROFILER_TRACE_GPU_THREAD_ID, "GPU");
+		ProfilerTraceWriteEvents(file, processId, PROFILER_TRACE_GPU_THREAD_ID, "gpu", s_trace.gpuEvents, s_trace.numGpuEvents);
+
+		LONG numThreads = s_trace.numThreads;
+		if (numThreads > PROFILER_TRACE_MAX_THREADS) numThreads = PROFILER_TRACE_MAX_THREADS;
+		for (int threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+			ProfilerTraceThread *thread = &s_trace.threads[threadIndex];
+			if (thread->state == ProfilerTraceThreadStateUnused) continue;
+			LONG numEvents = InterlockedCompareExchange(&thread->numEvents, 0, 0);
+			if (numEvents == 0) continue;	/* 再利用中のスロットは名前が書き換わっている可能性がある */
+			ProfilerTraceWriteThreadName(file, processId, (unsigned long)thread->threadId, thread->threadName);
+			ProfilerTraceWriteEvents(file, processId, (unsigned long)thread->threadId, "cpu", thread->events, (int)numEvents);
+		}
+
+		fprintf(file, "\n]}\n");
+		ret = (ferror(file) == 0);
+		if (fclose(file) != 0) ret = false;
+	}
+	if (s_trace.numDroppedEvents > 0) {
+		printf("trace : %ld events were dropped.\n", (long)s_trace.numDroppedEvents);
+	}
+
+	free(s_trace.gpuEvents);
+	s_trace.gpuEvents = NULL;
+	s_trace.numGpuEvents = 0;
+	s_trace.state = ProfilerTraceStateIdle;
+	return ret;
+}
+
+bool ProfilerInitialize(){
+	memset(&s_profiler, 0, sizeof(s_profiler));
+	s_profiler.mainThreadId = GetCurrentThreadId();
+
+	LARGE_INTEGER frequency;
+	if (QueryPerformanceFrequency(&frequency) == FALSE) return false;
+	s_profiler.frequency = frequency.QuadPart;
+
+	for (int frameIndex = 0; frameIndex < PROFILER_NUM_GPU_FRAMES; ++frameIndex) {
+		ProfilerGpuFrame *frame = &s_profiler.gpuFrames[frameIndex];
+		glGenQueries((GLsizei)SIZE_OF_ARRAY(frame->queries), frame->queries);
+	}
+
+	/* フレーム全体の値は常に先頭に並べる */
+	s_profiler.cpuFrameSectionIndex = ProfilerFindOrAddSection("(frame)", ProfilerDomainCpu);
+	s_profiler.gpuTotalSectionIndex = ProfilerFindOrAddSection("(frame)", ProfilerDomainGpu);
+	s_profiler.initialized = true;
+	return true;
+}
+
+bool ProfilerTerminate(){
+	if (s_profiler.initialized == false) return true;
+
+	for (int frameIndex = 0; frameIndex < PROFILER_NUM_GPU_FRAMES; ++frameIndex) {
+		ProfilerGpuFrame *frame = &s_profiler.gpuFrames[frameIndex];
+		glDeleteQueries((GLsizei)SIZE_OF_ARRAY(frame->queries), frame->queries);
+	}
+	memset(&s_profiler, 0, sizeof(s_profiler));
+
+	/* 他のスレッドは終了済みであること */
+	InterlockedExchange(&s_trace.recording, 0);
+	LONG numThreads = s_trace.numThreads;
+	if (numThreads > PROFILER_TRACE_MAX_THREADS) numThreads = PROFILER_TRACE_MAX_THREADS;
+	for (int threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+		free(s_trace.threads[threadIndex].events);
+	}
+	free(s_trace.gpuEvents);
+	memset(&s_trace, 0, sizeof(s_trace));
+	s_traceThreadOwner.thread = NULL;
+	return true;
+}
@@ -0,0 +1,105 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include "common.h"
+
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+
+/*
+	簡易プロファイラ
+
+	名前付きの計測区間ごとに CPU 時間と GPU 時間を計測し、フレーム単位で集計
+	する。GPU 時間は GL_TIMESTAMP クエリで計測し、結果の準備ができたフレーム
+	から順に読み出す（結果待ちでストールしない）。計測区間は入れ子にでき、
+	親区間の時間には子区間の時間を含めない。
+
+	同名の区間が 1 フレーム内で複数回計測された場合は合算する。
+	無効状態では計測関数は何もしない。
+
+	トレース記録中は、全スレッドの CPU 計測区間と GPU 計測区間を Chrome Trace
+	Event 形式（chrome://tracing や Perfetto で読み込める JSON）で記録する。
+	メインスレッド以外の計測区間はトレースにのみ記録される。GPU 計測区間の時刻は
+	フレームごとに GL_TIMESTAMP と CPU 時刻を対応付けて CPU の時間軸に揃える。
+*/
+
+#define PROFILER_HISTORY_LENGTH		(240)
+
+enum ProfilerDomain {
+	ProfilerDomainCpu = 0,
+	ProfilerDomainGpu,
+};
+
+struct ProfilerSectionStatistics {
+	const char *name;
+	ProfilerDomain domain;
+	int numCalls;				/* 最新のフレームで計測された回数 */
+	float lastInMilliseconds;	/* 最新のフレームの計測値 */
+	float minInMilliseconds;	/* 履歴中の最小値 */
+	float avgInMilliseconds;	/* 履歴中の平均値 */
+	float p99InMilliseconds;	/* 履歴中の 99 パーセンタイル値 */
+	const float *history;		/* 履歴（リングバッファ）*/
+	int numHistorySamples;		/* 履歴の有効な要素数 */
+	int historyOffset;			/* 履歴の最古の要素の位置 */
+};
+
+/* 計測の有効/無効の設定（次のフレームから反映）*/
+void ProfilerSetEnable(bool enable);
+
+/* 計測の有効/無効の取得 */
+bool ProfilerGetEnable();
+
+/* フレームの開始（前フレームの集計と、完了した GPU 計測結果の回収）*/
+void ProfilerNewFrame();
+
+/* CPU 計測区間の開始と終了（任意のスレッドから呼び出し可能）*/
+void ProfilerCpuBegin(const char *name);
+void ProfilerCpuEnd();
+
+/* スコープを抜けるまでを CPU 計測区間とする */
+class ProfilerScopedCpuSection {
+public:
+	ProfilerScopedCpuSection(const char *name){ ProfilerCpuBegin(name); }
+	~ProfilerScopedCpuSection(){ ProfilerCpuEnd(); }
+};
+#define PROFILER_CONCAT_(a, b)		a##b
+#define PROFILER_CONCAT(a, b)		PROFILER_CONCAT_(a, b)
+#define PROFILER_CPU_SCOPE(name)	ProfilerScopedCpuSection PROFILER_CONCAT(profilerScopedCpuSection, __LINE__)(name)
+
+/* GPU 計測区間の開始と終了 */
+void ProfilerGpuBegin(const char *name);
+void ProfilerGpuEnd();
+
+/* 計測区間の数を取得 */
+int ProfilerGetNumSections();
+
+/*
+	計測区間の統計情報を取得
+	一定期間計測されていない区間では false を返す。
+*/
+bool ProfilerGetSectionStatistics(int sectionIndex, ProfilerSectionStatistics *statistics);
+
+/* トレースに表示するスレッド名の設定（呼び出したスレッドに対して）*/
+void ProfilerSetThreadName(const char *name);
+
+/* トレース記録の開始（numFrames フレーム記録した後に完了状態になる）*/
+bool ProfilerStartTrace(const char *fileName, int numFrames);
+
+/* トレース記録中か？（記録完了後の GPU 計測結果の回収待ちを含む）*/
+bool ProfilerIsTraceRecording();
+
+/* トレース記録が完了しているか？ */
+bool ProfilerIsTraceFinished();
+
+/* 完了したトレースをファイルに書き出し、トレース記録を終了する */
+bool ProfilerWriteTrace();
+
+/* 初期化 */
+bool ProfilerInitialize();
+
+/* 終了処理 */
+bool ProfilerTerminate();
+
+
+#endif
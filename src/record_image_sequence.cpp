@@ -7,15 +7,26 @@
 #include "png_util.h"
 #include "tiny_vmath.h"
 #include "record_image_sequence.h"
+#include "profiler.h"
 #include "dialog_confirm_over_write.h"
 #include "resource/resource.h"
-#include <process.h>
 #include <winbase.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 
 #define PROGRESS_BAR_MIN_VALUE 0
 #define PROGRESS_BAR_MAX_VALUE 100
 
+#define INITIAL_NUM_WORKERS					2		/* 開始時のワーカースレッド数 */
+#define WORKER_ADJUST_INTERVAL_IN_SECONDS	0.5		/* ワーカースレッド数を見直す間隔 */
+#define WORKER_ADD_SLOT_WAIT_RATIO			0.25	/* 空きスロット待ちの割合がこれ以上ならワーカースレッドを追加 */
+#define WORKER_ADD_MIN_SPEEDUP				1.05	/* 追加後のスループットの伸びがこれ未満なら打ち止め */
+
 typedef enum {
 	StateIdle,
 	StateWorkInProgress,
@@ -106,140 +117,348 @@ static LRESULT CALLBACK DialogFunc(
 }
 
 
-struct Worker {
-	HANDLE hThread;
+/*
+	有界 MPMC ロックフリーキュー（スロット番号を流す）
+	各セルに通し番号を持たせ、enqueuePos と dequeuePos の CAS だけで push/pop
+	する。容量は 2 の冪で、流れるスロット番号の総数以上を確保するので満杯には
+	ならない。取り出す側はキューが空の時だけ条件変数で眠り、push 側は眠っている
+	スレッドがいる場合にのみ起こす。
+*/
+struct SlotQueueCell {
+	std::atomic<size_t> sequence;
+	int value;
 };
-struct Job {
-	char fileName[MAX_PATH];
-	void *image;
-	const RecordImageSequenceSettings *settings;
+struct SlotQueue {
+	SlotQueueCell *cells;
+	size_t mask;
+	std::atomic<size_t> enqueuePos;
+	std::atomic<size_t> dequeuePos;
+	std::atomic<int> numWaiters;
+	std::mutex mutex;
+	std::condition_variable cond;
 };
-static struct Queue {
-	CRITICAL_SECTION criticalSection;
-	HANDLE hSemaWritable;
-	HANDLE hSemaReadable;
-	int writeIndex;
-	int readIndex;
-	int numWorkers;
-	Worker *workers;
-	int numJobs;
-	Job *jobs;
-} s_queue;
-
-static bool TryEnqueue(Job *job){
-	DWORD result = WaitForSingleObject(s_queue.hSemaWritable, 0);			/* tryTake */
-	if (result == WAIT_TIMEOUT) return false;
-	EnterCriticalSection(&s_queue.criticalSection);
-	{
-		int index = s_queue.writeIndex++;
-		index &= (s_queue.numJobs - 1);
-		s_queue.jobs[index] = *job;
+
+static bool SlotQueueInitialize(SlotQueue *queue, int capacity){
+	capacity = Pow2CeilAlign(capacity < 2? 2: capacity);
+	queue->cells = new SlotQueueCell[capacity];
+	for (int i = 0; i < capacity; i++) {
+		queue->cells[i].sequence.store(i, std::memory_order_relaxed);
+		queue->cells[i].value = 0;
 	}
-	LeaveCriticalSection(&s_queue.criticalSection);
-	ReleaseSemaphore(s_queue.hSemaReadable, 1, NULL);		/* post */
+	queue->mask = capacity - 1;
+	queue->enqueuePos.store(0, std::memory_order_relaxed);
+	queue->dequeuePos.store(0, std::memory_order_relaxed);
+	queue->numWaiters.store(0, std::memory_order_relaxed);
 	return true;
 }
 
-static void Enqueue(Job *job){
-	WaitForSingleObject(s_queue.hSemaWritable, INFINITE);	/* take */
-	EnterCriticalSection(&s_queue.criticalSection);
-	{
-		int index = s_queue.writeIndex++;
-		index &= (s_queue.numJobs - 1);
-		s_queue.jobs[index] = *job;
+static void SlotQueueTerminate(SlotQueue *queue){
+	delete[] queue->cells;
+	queue->cells = NULL;
+}
+
+static bool SlotQueueTryPopNoWait(SlotQueue *queue, int *value){
+	size_t pos = queue->dequeuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		SlotQueueCell *cell = &queue->cells[pos & queue->mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (queue->dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				*value = cell->value;
+				cell->sequence.store(pos + queue->mask + 1, std::memory_order_release);
+				return true;
+			}
+		} else
+		if (diff < 0) {
+			return false;	/* 空 */
+		} else {
+			pos = queue->dequeuePos.load(std::memory_order_relaxed);
+		}
 	}
-	LeaveCriticalSection(&s_queue.criticalSection);
-	ReleaseSemaphore(s_queue.hSemaReadable, 1, NULL);		/* post */
 }
 
-static Job Dequeue(){
-	Job job;
-	WaitForSingleObject(s_queue.hSemaReadable, INFINITE);	/* take */
-	EnterCriticalSection(&s_queue.criticalSection);
-	{
-		int index = s_queue.readIndex++;
-		index &= (s_queue.numJobs - 1);
-		job = s_queue.jobs[index];
+static bool SlotQueuePush(SlotQueue *queue, int value){
+	size_t pos = queue->enqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		SlotQueueCell *cell = &queue->cells[pos & queue->mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (queue->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				cell->value = value;
+				cell->sequence.store(pos + 1, std::memory_order_release);
+				break;
+			}
+		} else
+		if (diff < 0) {
+			return false;	/* 満杯（容量の見積もり誤り）*/
+		} else {
+			pos = queue->enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	/*
+		眠っているスレッドがいる時だけ起こす。
+		待つ側は numWaiters を増やしてから空であることを確認するので、
+		フェンスを挟めばどちらかが必ず相手の更新を観測する。
+	*/
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (queue->numWaiters.load(std::memory_order_relaxed) != 0) {
+		{ std::lock_guard<std::mutex> lock(queue->mutex); }
+		queue->cond.notify_all();
 	}
-	LeaveCriticalSection(&s_queue.criticalSection);
-	ReleaseSemaphore(s_queue.hSemaWritable, 1, NULL);		/* post */
-	return job;
+	return true;
+}
+
+/* 取り出し（空なら push されるまで眠る。timeoutInMilliseconds が負なら無制限）*/
+static bool SlotQueuePop(SlotQueue *queue, int *value, int timeoutInMilliseconds){
+	if (SlotQueueTryPopNoWait(queue, value)) return true;
+
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	queue->numWaiters.fetch_add(1, std::memory_order_seq_cst);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	bool ret = true;
+	while (SlotQueueTryPopNoWait(queue, value) == false) {
+		if (timeoutInMilliseconds < 0) {
+			queue->cond.wait(lock);
+		} else
+		if (queue->cond.wait_for(lock, std::chrono::milliseconds(timeoutInMilliseconds)) == std::cv_status::timeout) {
+			ret = SlotQueueTryPopNoWait(queue, value);
+			break;
+		}
+	}
+	queue->numWaiters.fetch_sub(1, std::memory_order_relaxed);
+	return ret;
 }
 
-static unsigned __stdcall WorkerThreadProc(
-	void	*pWork_
+
+/*
+	フレームプール
+	読み出しリングのスロットごとにフレームの記録を固定で持ち、使い回す。
+	画像は永続マップされたスロットのバッファを直接参照するので、フレーム
+	ごとのメモリ確保と解放は行わない。空きスロットは freeSlots を、
+	エンコード待ちのフレームは jobs を、スロット番号として流れる。
+*/
+struct Frame {
+	char fileName[MAX_PATH];
+	const void *image;		/* 読み出しリングのスロットのバッファ（永続マップされたメモリ）*/
+};
+static struct Pool {
+	int numSlots;
+	Frame frames[RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS];
+	SlotQueue freeSlots;	/* メインスレッドが取得し、ワーカースレッドが返却 */
+	SlotQueue jobs;			/* メインスレッドが投入し、ワーカースレッドが取得（負の値は end mark）*/
+	const RecordImageSequenceSettings *settings;
+
+	/* ワーカースレッド数の調整用 */
+	std::vector<std::thread> workers;
+	int maxWorkers;
+	bool saturated;							/* 追加してもスループットが伸びなくなったか？ */
+	std::atomic<int> numEncodedFrames;
+	double windowStartTime;
+	int windowStartNumEncodedFrames;
+	double windowSlotWaitSeconds;			/* 計測区間中に空きスロット待ちで止まっていた時間 */
+	double throughputBeforeLastAdd;			/* 直前の追加前のスループット（frames/sec）*/
+} s_pool;
+
+static double GetSeconds(){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void WorkerThreadProc(
 ){
+	ProfilerSetThreadName("image sequence worker");
 	bool error = false;
 	for (;;) {
-		Job job = Dequeue();
-		if (job.image == NULL) break;	/* end mark 検出 */
+		int slot;
+		SlotQueuePop(&s_pool.jobs, &slot, -1);
+		if (slot < 0) break;	/* end mark 検出 */
+		const Frame *frame = &s_pool.frames[slot];
 		if (error == false) {
-			printf("generate %s.\n", job.fileName);
+			printf("generate %s.\n", frame->fileName);
+			PROFILER_CPU_SCOPE("png encode");
 			bool ret = SerializeAsPng(
-				/* const char *fileName */	job.fileName,
-				/* const void *data */		job.image,
+				/* const char *fileName */	frame->fileName,
+				/* const void *data */		frame->image,
 				/* int numChannels */		4,
-				/* int width */				job.settings->xReso,
-				/* int height */			job.settings->yReso,
+				/* int width */				s_pool.settings->xReso,
+				/* int height */			s_pool.settings->yReso,
 				/* bool verticalFlip */		true
 			);
-			free(job.image);
 			if (ret == false) {
 				printf("failed.\n");
 				error = true;
 				s_state = StateError;
 			}
 		}
+		s_pool.numEncodedFrames.fetch_add(1, std::memory_order_relaxed);
+
+		/* スロットをメインスレッドに返却 */
+		SlotQueuePush(&s_pool.freeSlots, slot);
 	}
-	return 0;
 }
 
-static bool QueueInitialize(int numWorkers, int numJobs){
-	InitializeCriticalSection(&s_queue.criticalSection);
+static bool PoolAddWorker(){
+	try {
+		s_pool.workers.emplace_back(WorkerThreadProc);
+	} catch (...) {
+		return false;
+	}
+	return true;
+}
 
-	s_queue.writeIndex = 0;
-	s_queue.readIndex = 0;
+static bool PoolInitialize(
+	int numSlots,
+	int numInitialWorkers,
+	int maxWorkers,
+	const RecordImageSequenceSettings *settings
+){
+	s_pool.numSlots = numSlots;
+	s_pool.settings = settings;
+	memset(s_pool.frames, 0, sizeof(s_pool.frames));
 
-	s_queue.numWorkers = numWorkers;
-	s_queue.workers = (Worker *)malloc(sizeof(Worker) * numWorkers);
-	if (s_queue.workers == NULL) return false;
+	/* jobs には全スロットに加え、全ワーカースレッド分の end mark が入る */
+	if (SlotQueueInitialize(&s_pool.freeSlots, numSlots) == false) return false;
+	if (SlotQueueInitialize(&s_pool.jobs, numSlots + maxWorkers) == false) return false;
 
-	s_queue.numJobs = numJobs;
-	s_queue.jobs = (Job *)malloc(sizeof(Job) * numJobs);
-	if (s_queue.jobs == NULL) return false;
+	/* 全スロットは未使用の状態から始める */
+	for (int slot = 0; slot < numSlots; slot++) {
+		if (SlotQueuePush(&s_pool.freeSlots, slot) == false) return false;
+	}
 
-	s_queue.hSemaWritable = CreateSemaphore(NULL, numJobs, 0x7FFFFFFF, "semaWritable");
-	s_queue.hSemaReadable = CreateSemaphore(NULL,       0, 0x7FFFFFFF, "semaReadable");
-	if (s_queue.hSemaWritable == NULL) return false;
-	if (s_queue.hSemaReadable == NULL) return false;
+	s_pool.workers.clear();
+	s_pool.maxWorkers = maxWorkers;
+	s_pool.saturated = false;
+	s_pool.numEncodedFrames.store(0, std::memory_order_relaxed);
+	s_pool.windowStartTime = GetSeconds();
+	s_pool.windowStartNumEncodedFrames = 0;
+	s_pool.windowSlotWaitSeconds = 0.0;
+	s_pool.throughputBeforeLastAdd = 0.0;
+	for (int i = 0; i < numInitialWorkers; i++) {
+		if (PoolAddWorker() == false) return false;
+	}
+	return true;
+}
 
-	for (int i = 0; i < numWorkers; i++) {
-		s_queue.workers[i].hThread = (HANDLE)_beginthreadex(NULL, 0, WorkerThreadProc, NULL, 0, NULL);
-		if (s_queue.workers[i].hThread == NULL) return false;
+static bool PoolTerminate(){
+	bool ret = true;
+	for (size_t i = 0; i < s_pool.workers.size(); i++) {
+		if (SlotQueuePush(&s_pool.jobs, -1) == false) ret = false;	/* end mark */
 	}
+	for (size_t i = 0; i < s_pool.workers.size(); i++) {
+		if (s_pool.workers[i].joinable()) s_pool.workers[i].join();
+	}
+	s_pool.workers.clear();
+	SlotQueueTerminate(&s_pool.jobs);
+	SlotQueueTerminate(&s_pool.freeSlots);
+	return ret;
+}
 
-	return true;
+/*
+	ワーカースレッド数の調整
+	一定間隔ごとに、エンコードのスループットと、メインスレッドが空きスロット
+	待ちで止まっていた時間の割合を計測する。エンコードが律速している間は
+	ワーカースレッドを追加し、追加してもスループットが伸びなくなったら
+	（ディスクなどが律速している）それ以上は追加しない。
+*/
+static void PoolAdjustNumWorkers(){
+	double now = GetSeconds();
+	double elapsed = now - s_pool.windowStartTime;
+	if (elapsed < WORKER_ADJUST_INTERVAL_IN_SECONDS) return;
+
+	int numEncodedFrames = s_pool.numEncodedFrames.load(std::memory_order_relaxed);
+	double throughput = (double)(numEncodedFrames - s_pool.windowStartNumEncodedFrames) / elapsed;
+	double slotWaitRatio = s_pool.windowSlotWaitSeconds / elapsed;
+	if (slotWaitRatio < WORKER_ADD_SLOT_WAIT_RATIO) {
+		/* エンコードが間に合っている */
+		s_pool.throughputBeforeLastAdd = 0.0;
+	} else
+	if (s_pool.saturated == false && (int)s_pool.workers.size() < s_pool.maxWorkers) {
+		if (s_pool.throughputBeforeLastAdd > 0.0
+		&&	throughput < s_pool.throughputBeforeLastAdd * WORKER_ADD_MIN_SPEEDUP
+		) {
+			s_pool.saturated = true;
+		} else {
+			s_pool.throughputBeforeLastAdd = throughput;
+			if (PoolAddWorker() == false) s_pool.saturated = true;
+		}
+	}
+
+	s_pool.windowStartTime = now;
+	s_pool.windowStartNumEncodedFrames = numEncodedFrames;
+	s_pool.windowSlotWaitSeconds = 0.0;
 }
 
-static bool QueueTerminate(){
-	for (int i = 0; i < s_queue.numWorkers; i++) {
-		Job job = {{0}};
-		Enqueue(&job);	/* end mark */
+/*
+	ダイアログボックスのメッセージ処理だけ行う。
+	メインウィンドウは操作不能になる。
+*/
+static void ProcessDialogMessages(HWND hDwnd){
+	MSG	msg;
+	while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+		/*
+			IsDialogMessage は、そのメッセージがダイアログ向けか確認し、
+			もしそうなら、そのメッセージを処理する関数である。
+			関数名からは、何らかの処理を行うようには見えないが、
+			実際にはメッセージ処理が行われることに注意。
+		*/
+		IsDialogMessage(hDwnd, &msg);
 	}
+}
 
-	for (int i = 0; i < s_queue.numWorkers; i++) {
-		if (WaitForSingleObject(s_queue.workers[i].hThread, INFINITE) != WAIT_OBJECT_0) return false;
-		if (CloseHandle(s_queue.workers[i].hThread) == FALSE) return false;
+/*
+	空きスロットの取得
+	ワーカースレッドがスロットを返却すると直ちに起こされる。タイムアウトは
+	待っている間もダイアログボックスを応答させるためのもの。
+*/
+static int AcquireFreeSlot(HWND hDwnd){
+	PROFILER_CPU_SCOPE("wait for png encode");
+	double startTime = GetSeconds();
+	int slot;
+	while (SlotQueuePop(&s_pool.freeSlots, &slot, 10) == false) {
+		ProcessDialogMessages(hDwnd);
 	}
+	s_pool.windowSlotWaitSeconds += GetSeconds() - startTime;
+	return slot;
+}
 
-	if (CloseHandle(s_queue.hSemaWritable) == FALSE) return false;
-	if (CloseHandle(s_queue.hSemaReadable) == FALSE) return false;
+/* 読み出しが完了したフレームをワーカースレッドに渡す */
+static bool SubmitFrame(
+	HWND hDwnd,
+	int frameCount,
+	int slot,
+	const RecordImageSequenceSettings *recordImageSequenceSettings
+){
+	Frame *frame = &s_pool.frames[slot];
+	snprintf(
+		frame->fileName,
+		sizeof(frame->fileName),
+		"%s\\%08d.png",
+		recordImageSequenceSettings->directoryName,
+		frameCount
+	);
 
-	free(s_queue.jobs);
-	free(s_queue.workers);
+	/* 読み出し完了待ち（先行して描画したフレームとは並行に進む）*/
+	frame->image = GraphicsCaptureSequenceMapFrame(slot);
+	if (frame->image == NULL) {
+		s_state = StateError;
+		return false;
+	}
 
-	DeleteCriticalSection(&s_queue.criticalSection);
+	/* 上書き確認 */
+	if (DialogConfirmOverWrite(frame->fileName) == DialogConfirmOverWriteResult_Canceled) {
+		s_state = StateAborted;
+		return false;
+	}
 
+	/* ジョブ投入（スロットはワーカースレッドが返却）*/
+	ProcessDialogMessages(hDwnd);
+	if (SlotQueuePush(&s_pool.jobs, slot) == false) {
+		s_state = StateError;
+		return false;
+	}
+	PoolAdjustNumWorkers();
 	return true;
 }
 
@@ -274,21 +493,53 @@ bool RecordImageSequence(
 
 	/* 連番画像の保存 */
 	{
-		/* キューの初期化 */
+		/*
+			ワーカースレッドは INITIAL_NUM_WORKERS から始め、エンコードの
+			スループットを見ながら最大で（論理コア数 - 1）まで増やす。
+			メインスレッドは描画を担当する。
+		*/
+		int maxWorkers = (int)std::thread::hardware_concurrency() - 1;
+		if (maxWorkers > RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS - RECORD_IMAGE_SEQUENCE_READBACK_LOOKAHEAD_FRAMES - 1) {
+			maxWorkers = RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS - RECORD_IMAGE_SEQUENCE_READBACK_LOOKAHEAD_FRAMES - 1;
+		}
+		if (maxWorkers < 1) maxWorkers = 1;
+		int numInitialWorkers = INITIAL_NUM_WORKERS;
+		if (numInitialWorkers > maxWorkers) numInitialWorkers = maxWorkers;
+
+		/*
+			読み出しリングのスロット数。
+			先行して描画するフレームに加え、最大数のワーカースレッドが同時に
+			エンコードできるだけのスロットを用意する。
+		*/
+		int numSlots = maxWorkers + RECORD_IMAGE_SEQUENCE_READBACK_LOOKAHEAD_FRAMES + 1;
+		if (numSlots > RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS) numSlots = RECORD_IMAGE_SEQUENCE_MAX_READBACK_SLOTS;
+		int lookaheadFrames = RECORD_IMAGE_SEQUENCE_READBACK_LOOKAHEAD_FRAMES;
+		if (lookaheadFrames > numSlots - 1) lookaheadFrames = numSlots - 1;
+
+		/* フレームプールの初期化 */
 		{
-			/* ワーカースレッド数は論理コア数の半分とする */
-			SYSTEM_INFO systemInfo;
-			GetSystemInfo(&systemInfo);
-			int numWorkers = (systemInfo.dwNumberOfProcessors + 1) / 2;
-			if (numWorkers == 0) numWorkers = 1;
-
-			int numJobs = Pow2CeilAlign(numWorkers * 16);
-			bool ret = QueueInitialize(numWorkers, numJobs);
+			bool ret = PoolInitialize(numSlots, numInitialWorkers, maxWorkers, recordImageSequenceSettings);
 			if (ret == false) {
-				AppErrorMessageBox(APP_NAME, "QueueInitialize failed.");
+				AppErrorMessageBox(APP_NAME, "PoolInitialize failed.");
+				s_state = StateError;
 			}
 		}
 
+		/* 読み出しリングの初期化 */
+		RenderSettings renderSettingsForceUnorm8 = *renderSettings;
+		renderSettingsForceUnorm8.pixelFormat = PixelFormatUnorm8Rgba;
+		if (
+			GraphicsCaptureSequenceBegin(
+				recordImageSequenceSettings->xReso,
+				recordImageSequenceSettings->yReso,
+				numSlots,
+				&renderSettingsForceUnorm8
+			) == false
+		) {
+			AppErrorMessageBox(APP_NAME, "GraphicsCaptureSequenceBegin failed.");
+			s_state = StateError;
+		}
+
 		float startTime = AppRecordImageSequenceGetStartTimeInSeconds();
 		float duration = AppRecordImageSequenceGetDurationInSeconds();
 		float framesPerSecond = AppRecordImageSequenceGetFramesPerSecond();
@@ -297,45 +548,28 @@ bool RecordImageSequence(
 		float mat4x4CameraInWorld[4][4];
 		AppGetMat4x4CameraInWorld(mat4x4CameraInWorld);
 
+		/*
+			フレーム frameCount の描画を発行した後、lookaheadFrames 前のフレームの
+			読み出し結果をワーカースレッドに渡す。GPU の描画と読み出し、PNG
+			エンコードが並行して進む。
+		*/
 		int numFrameCount = (int)(framesPerSecond * duration);
-		for (int frameCount = 0; frameCount < numFrameCount && s_state == StateWorkInProgress; ++frameCount) {
-			/* 進捗をダイアログボックスに送信 */
-			SendMessage(hDwnd, WM_APP, frameCount, numFrameCount);
-			UpdateWindow(hDwnd);
-
-			/* 経過時間 */
-			float time = startTime + (float)frameCount / framesPerSecond;
-
-			/* サウンド再生位置 */
-			int waveOutPos = (int)(time * NUM_SOUND_SAMPLES_PER_SEC);
-
-			/* ジョブ作成 */
-			Job job;
-			{
-				/* 設定 */
-				job.settings = recordImageSequenceSettings;
-				snprintf(
-					job.fileName,
-					sizeof(job.fileName),
-					"%s\\%08d.png",
-					recordImageSequenceSettings->directoryName,
-					frameCount
-				);
-
-				/* 画像をキャプチャ */
-				RenderSettings renderSettingsForceUnorm8 = *renderSettings;
-				renderSettingsForceUnorm8.pixelFormat = PixelFormatUnorm8Rgba;
-				CaptureScreenShotSettings captureSettings = {
-					/* char fileName[MAX_PATH]; */	{0},
-					/* int xReso; */				recordImageSequenceSettings->xReso,
-					/* int yReso; */				recordImageSequenceSettings->yReso,
-					/* bool replaceAlphaByOne; */	recordImageSequenceSettings->replaceAlphaByOne,
-				};
-				snprintf(captureSettings.fileName, sizeof(captureSettings.fileName), "%s", job.fileName);
-				size_t numBitsPerPixel = PixelFormatToGlPixelFormatInfo(renderSettingsForceUnorm8.pixelFormat).numBitsPerPixel;
-				size_t imageBufferSizeInBytes = (size_t)(recordImageSequenceSettings->xReso * recordImageSequenceSettings->yReso) * numBitsPerPixel / 8;
-				job.image = malloc(imageBufferSizeInBytes);
-				if (job.image == NULL) return false;
+		int inflightSlots[RECORD_IMAGE_SEQUENCE_READBACK_LOOKAHEAD_FRAMES + 1] = {0};	/* 描画済みで未提出のフレームのスロット */
+		for (int frameCount = 0; frameCount < numFrameCount + lookaheadFrames && s_state == StateWorkInProgress; ++frameCount) {
+			if (frameCount < numFrameCount) {
+				/* 進捗をダイアログボックスに送信 */
+				SendMessage(hDwnd, WM_APP, frameCount, numFrameCount);
+				UpdateWindow(hDwnd);
+
+				/* 経過時間 */
+				float time = startTime + (float)frameCount / framesPerSecond;
+
+				/* サウンド再生位置 */
+				int waveOutPos = (int)(time * NUM_SOUND_SAMPLES_PER_SEC);
+
+				/* スロットが空くのを待ってから描画と読み出しを発行 */
+				int slot = AcquireFreeSlot(hDwnd);
+				inflightSlots[frameCount % (lookaheadFrames + 1)] = slot;
 
 				CurrentFrameParams params = {0};
 				params.waveOutPos				= waveOutPos;
@@ -351,42 +585,26 @@ bool RecordImageSequence(
 				params.fovYInRadians			= fovYInRadians;
 				Mat4x4Copy(params.mat4x4CameraInWorld,		mat4x4CameraInWorld);
 				Mat4x4Copy(params.mat4x4PrevCameraInWorld,	mat4x4CameraInWorld);
-				GraphicsCaptureScreenShotOnMemory(
-					job.image, imageBufferSizeInBytes,
-					&params, &renderSettingsForceUnorm8, &captureSettings
-				);
+				if (
+					GraphicsCaptureSequenceRenderFrame(
+						slot,
+						&params,
+						&renderSettingsForceUnorm8,
+						recordImageSequenceSettings->replaceAlphaByOne
+					) == false
+				) {
+					s_state = StateError;
+					break;
+				}
 			}
 
-			/* 上書き確認 */
-			if (DialogConfirmOverWrite(job.fileName) == DialogConfirmOverWriteResult_Canceled) {
-				s_state = StateAborted;
+			/* 先行して描画したフレームの読み出し結果を渡す */
+			int readbackFrameCount = frameCount - lookaheadFrames;
+			if (readbackFrameCount < 0) continue;
+			int readbackSlot = inflightSlots[readbackFrameCount % (lookaheadFrames + 1)];
+			if (SubmitFrame(hDwnd, readbackFrameCount, readbackSlot, recordImageSequenceSettings) == false) {
 				break;
 			}
-
-			/* ジョブ投入に成功するまでリトライ */
-			for (;;) {
-				/*
-					ダイアログボックスのメッセージ処理だけ行う。
-					メインウィンドウは操作不能になる。
-				*/
-				MSG	msg;
-				while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
-					/*
-						IsDialogMessage は、そのメッセージがダイアログ向けか確認し、
-						もしそうなら、そのメッセージを処理する関数である。
-						関数名からは、何らかの処理を行うようには見えないが、
-						実際にはメッセージ処理が行われることに注意。
-					*/
-					IsDialogMessage(hDwnd, &msg);
-				}
-
-				/* ジョブ投入（イメージバッファはワーカースレッドが解放）*/
-				bool ret = TryEnqueue(&job);
-				if (ret) break;
-
-				/* 他のスレッドに処理権を与える */
-				Sleep(10);
-			}
 		}
 
 		/* 正常終了なら StateDone に変更 */
@@ -394,14 +612,17 @@ bool RecordImageSequence(
 			s_state = StateDone;
 		}
 
-		/* キューの終了処理 */
+		/* フレームプールの終了処理 */
 		{
-			bool ret = QueueTerminate();
+			bool ret = PoolTerminate();
 			if (ret == false) {
-				AppErrorMessageBox(APP_NAME, "QueueTerminate failed.");
+				AppErrorMessageBox(APP_NAME, "PoolTerminate failed.");
 			}
 		}
 
+		/* 読み出しリングの終了処理（ワーカースレッドの終了後に行う）*/
+		GraphicsCaptureSequenceEnd();
+
 		/* 進捗 100%（プログレスバー終了）*/
 		SendMessage(hDwnd, WM_APP, numFrameCount, numFrameCount);
 	}
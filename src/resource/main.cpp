@@ -23,8 +23,6 @@
 /* 決め打ちのリソースハンドル */
 #define ASSUMED_SOUND_SSBO													1
 
-#define COMPUTE_TEXTURE_START_INDEX				(4)
-
 #define PIPELINE_MAX_RESOURCES				(32)
 #define PIPELINE_MAX_PASSES				(16)
 #define PIPELINE_MAX_BINDINGS_PER_PASS		(16)
@@ -54,8 +52,21 @@ typedef enum {
 	PipelinePassTypeFragment,
 	PipelinePassTypeCompute,
 	PipelinePassTypePresent,
+	PipelinePassTypeDownsample,
+	PipelinePassTypeUpsample,
 } PipelinePassType;
 
+typedef enum {
+	PipelineDownsampleFilterAverage,
+	PipelineDownsampleFilterMax,
+	PipelineDownsampleFilterKawase,
+} PipelineDownsampleFilter;
+
+typedef enum {
+	PipelineUpsampleFilterBicubic,
+	PipelineUpsampleFilterBilateral,
+} PipelineUpsampleFilter;
+
 typedef enum {
 	PipelineResourceAccessSampled,
 	PipelineResourceAccessImageRead,
@@ -67,12 +78,16 @@ typedef enum {
 typedef enum {
 	PipelineResolutionModeFramebuffer,
 	PipelineResolutionModeFixed,
+	PipelineResolutionModeScale,
 } PipelineResolutionMode;
 
 typedef struct {
 	PipelineResolutionMode mode;
 	int width;
 	int height;
+	float scaleX;
+	float scaleY;
+	int alignment;
 } PipelineResourceResolution;
 
 typedef struct {
@@ -110,6 +125,8 @@ typedef struct {
 	PipelinePassClear clear;
 	bool overrideWorkGroupSize;
 	GLuint workGroupSize[3];
+	PipelineDownsampleFilter downsampleFilter;
+	PipelineUpsampleFilter upsampleFilter;
 } PipelinePass;
 
 typedef struct PipelineDescription {
@@ -119,6 +136,54 @@ typedef struct PipelineDescription {
 	int numPasses;
 } PipelineDescription;
 
+/*
+	エクスポート時にコンパイル済みの実行プラン（pipeline_description.h と同一レイアウト）
+	テクスチャユニット、イメージユニット、バリアは全て解決済みである。
+*/
+#define PIPELINE_PLAN_MAX_BINDINGS			(PIPELINE_MAX_BINDINGS_PER_PASS * 2)
+#define PIPELINE_DOWNSAMPLE_TILE_SIZE		(16)
+#define PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH	(5)
+
+typedef enum {
+	PipelinePlanBindingKindTexture,
+	PipelinePlanBindingKindImage,
+	PipelinePlanBindingKindColorAttachment,
+	PipelinePlanBindingKindBlitSource,
+	PipelinePlanBindingKindCount
+} PipelinePlanBindingKind;
+
+typedef struct {
+	PipelinePlanBindingKind kind;
+	int resourceIndex;
+	int historyOffset;
+	int unit;
+	GLenum imageAccess;
+	GLenum imageFormat;
+	TextureFilter textureFilter;
+	TextureWrap textureWrap;
+	bool enableMipmap;
+	bool mipmapPrebuilt;
+} PipelinePlanBinding;
+
+typedef struct {
+	int passIndex;
+	PipelinePassType type;
+	bool executable;
+	GLbitfield barrierBits;
+	int targetResourceIndex;
+	PipelinePassClear clear;
+	bool overrideWorkGroupSize;
+	GLuint workGroupSize[3];
+	PipelinePlanBinding bindings[PIPELINE_PLAN_MAX_BINDINGS];
+	int numBindings;
+	PipelineDownsampleFilter downsampleFilter;
+} PipelinePlanCommand;
+
+typedef struct PipelineExecutionPlan {
+	PipelinePlanCommand commands[PIPELINE_MAX_PASSES];
+	int numCommands;
+} PipelineExecutionPlan;
+
 #include "pipeline_description.inl"
 
 typedef struct {
@@ -127,24 +192,46 @@ typedef struct {
 	int height;
 	PixelFormat pixelFormat;
 	int historyLength;
+	int numMipLevels;
 	bool initialized;
 } PipelineRuntimeResourceState;
 
 static PipelineDescription s_pipelineDescription = {0};
 static PipelineRuntimeResourceState s_pipelineRuntimeResources[PIPELINE_MAX_RESOURCES] = {{0}};
+
+/* アタッチメントの組み合わせ毎にキャッシュされるフレームバッファ */
+#define PIPELINE_MAX_FRAMEBUFFER_CACHE_ENTRIES	(64)
+
+typedef struct {
+	int resourceIndex;
+	int historySlot;
+	int mipLevel;
+} PipelineFramebufferAttachment;
+
+typedef struct {
+	PipelineFramebufferAttachment attachments[PIPELINE_MAX_BINDINGS_PER_PASS];
+	int numAttachments;
+	GLuint framebufferId;
+	bool complete;
+} PipelineFramebufferCacheEntry;
+
+static PipelineFramebufferCacheEntry s_pipelineFramebufferCache[PIPELINE_MAX_FRAMEBUFFER_CACHE_ENTRIES] = {{{{0}}}};
+static int s_numPipelineFramebufferCacheEntries = 0;
+typedef struct {
+	GLuint programId;
+	GLint workGroupSize[3];
+	bool pipelinePassUniformAvailable;
+	bool waveOutUniformAvailable;
+	bool frameCountUniformAvailable;
+	bool timeUniformAvailable;
+	bool resolutionUniformAvailable;
+	bool mouseButtonsUniformAvailable;
+} PipelineProgramState;
+
 static int s_activePipelinePassIndex = -1;
-static bool s_fragmentPipelinePassUniformAvailable = false;
-static bool s_fragmentWaveOutUniformAvailable = false;
-static bool s_fragmentFrameCountUniformAvailable = false;
-static bool s_fragmentTimeUniformAvailable = false;
-static bool s_fragmentResolutionUniformAvailable = false;
-static bool s_fragmentMouseButtonsUniformAvailable = false;
-static bool s_computePipelinePassUniformAvailable = false;
-static bool s_computeFrameCountUniformAvailable = false;
-static bool s_computeWaveOutUniformAvailable = false;
-static bool s_computeTimeUniformAvailable = false;
-static bool s_computeResolutionUniformAvailable = false;
-static bool s_computeMouseButtonsUniformAvailable = false;
+static PipelineProgramState s_fragmentProgram = {0};
+static PipelineProgramState s_computeProgram = {0};
+static PipelineProgramState s_pipelinePassPrograms[PIPELINE_MAX_PASSES] = {{0}};
 static bool s_loggedPipelineExecutionFailure = false;
 
 /*=============================================================================
@@ -159,53 +246,9 @@ static bool s_loggedPipelineExecutionFailure = false;
 static void *s_glExtFunctions[NUM_GLEXT_FUNCTIONS] = {0};
 
 
-/*=============================================================================
-▼	各種構造体
------------------------------------------------------------------------------*/
-static GLint s_graphicsComputeWorkGroupSize[3] = {1, 1, 1};
-static GLuint s_graphicsComputeProgramId = 0;
-
 /*=============================================================================
 ▼	ローカル関数（CRT 非依存）
 -----------------------------------------------------------------------------*/
-static size_t PipelineStrLen(const char *str){
-	size_t len = 0;
-	if (str == NULL) return 0;
-	while (str[len] != '\0') {
-		++len;
-	}
-	return len;
-}
-
-static int PipelineStrncmp(const char *lhs, const char *rhs, size_t count){
-	if (lhs == NULL || rhs == NULL) return (lhs == rhs)? 0: (lhs? 1: -1);
-	for (size_t i = 0; i < count; ++i) {
-		unsigned char a = (unsigned char)lhs[i];
-		unsigned char b = (unsigned char)rhs[i];
-		if (a != b || a == '\0' || b == '\0') {
-			return (int)a - (int)b;
-		}
-	}
-	return 0;
-}
-
-static int PipelineAtoi(const char *str){
-	if (str == NULL) return 0;
-	int sign = 1;
-	int value = 0;
-	if (*str == '+') {
-		++str;
-	} else if (*str == '-') {
-		sign = -1;
-		++str;
-	}
-	while (*str >= '0' && *str <= '9') {
-		value = value * 10 + (*str - '0');
-		++str;
-	}
-	return sign * value;
-}
-
 static void *PipelineMemcpy(void *dst, const void *src, size_t size){
 	if (dst == NULL || src == NULL) return dst;
 	unsigned char *d = (unsigned char*)dst;
@@ -265,6 +308,78 @@ static bool PipelineProgramHasUniform(
 	return false;
 }
 
+static void PipelineSetupProgramState(
+	PipelineProgramState *state,
+	GLuint programId,
+	GLenum type
+){
+	PipelineMemset(state, 0, sizeof(PipelineProgramState));
+	state->programId = programId;
+	if (programId == 0) {
+		return;
+	}
+	if (type == GL_COMPUTE_SHADER) {
+		glExtGetProgramiv(
+			/* GLuint program */		programId,
+			/* GLenum pname */		GL_COMPUTE_WORK_GROUP_SIZE,
+			/* GLint *params */		state->workGroupSize
+		);
+		for (int i = 0; i < 3; ++i) {
+			if (state->workGroupSize[i] <= 0) {
+				state->workGroupSize[i] = 1;
+			}
+		}
+	}
+	state->pipelinePassUniformAvailable = PipelineProgramHasUniform(programId, UNIFORM_LOCATION_PIPELINE_PASS_INDEX, GL_INT);
+	state->waveOutUniformAvailable = PipelineProgramHasUniform(programId, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT);
+	state->frameCountUniformAvailable = PipelineProgramHasUniform(programId, UNIFORM_LOCATION_FRAME_COUNT, GL_INT);
+	state->timeUniformAvailable = PipelineProgramHasUniform(programId, UNIFORM_LOCATION_TIME, GL_FLOAT);
+	state->resolutionUniformAvailable = PipelineProgramHasUniform(programId, UNIFORM_LOCATION_RESO, GL_FLOAT_VEC2);
+	state->mouseButtonsUniformAvailable = PipelineProgramHasUniform(programId, UNIFORM_LOCATION_MOUSE_BUTTONS, GL_INT_VEC3);
+}
+
+static void PipelineDeleteProgramState(PipelineProgramState *state){
+	if (state->programId != 0) {
+		glExtDeleteProgram(state->programId);
+	}
+	PipelineMemset(state, 0, sizeof(PipelineProgramState));
+}
+
+/* パス個別のプログラムが存在すればそれを、無ければ共有プログラムを返す */
+static const PipelineProgramState *PipelineGetPassProgramState(
+	int passIndex,
+	const PipelineProgramState *sharedProgram
+){
+	if (passIndex >= 0 && passIndex < PIPELINE_MAX_PASSES
+	&&	s_pipelinePassPrograms[passIndex].programId != 0
+	) {
+		return &s_pipelinePassPrograms[passIndex];
+	}
+	return sharedProgram;
+}
+
+static void PipelineInvalidateFramebuffers(int resourceIndex /* -1 = all */){
+	int numKeptEntries = 0;
+	for (int entryIndex = 0; entryIndex < s_numPipelineFramebufferCacheEntries; ++entryIndex) {
+		PipelineFramebufferCacheEntry *entry = &s_pipelineFramebufferCache[entryIndex];
+		bool invalidate = (resourceIndex < 0);
+		for (int attachmentIndex = 0; attachmentIndex < entry->numAttachments; ++attachmentIndex) {
+			if (entry->attachments[attachmentIndex].resourceIndex == resourceIndex) {
+				invalidate = true;
+			}
+		}
+		if (invalidate) {
+			glExtDeleteFramebuffers(1, &entry->framebufferId);
+			continue;
+		}
+		if (numKeptEntries != entryIndex) {
+			PipelineMemcpy(&s_pipelineFramebufferCache[numKeptEntries], entry, sizeof(PipelineFramebufferCacheEntry));
+		}
+		++numKeptEntries;
+	}
+	s_numPipelineFramebufferCacheEntries = numKeptEntries;
+}
+
 static void PipelineDeleteRuntimeResource(PipelineRuntimeResourceState *state){
 	if (state == NULL) return;
 	if (state->initialized == false) return;
@@ -282,6 +397,7 @@ static void PipelineDeleteRuntimeResource(PipelineRuntimeResourceState *state){
 }
 
 static void PipelineResetRuntimeResources(void){
+	PipelineInvalidateFramebuffers(-1);
 	for (int resourceIndex = 0; resourceIndex < PIPELINE_MAX_RESOURCES; ++resourceIndex) {
 		PipelineDeleteRuntimeResource(&s_pipelineRuntimeResources[resourceIndex]);
 	}
@@ -350,6 +466,36 @@ static void PipelineSetTextureSampler(GLenum target, TextureFilter filter, Textu
 	glTexParameteri(target, GL_TEXTURE_WRAP_R, wrapParam);
 }
 
+/* scale モードの解像度（エディタの PipelineResourceResolutionResolve と同じ丸め）*/
+static int PipelineCalcScaledExtent(int screenExtent, float scale, int alignment){
+	/* ceilf を使わずに切り上げる */
+	float scaled = (float)screenExtent * scale;
+	int extent = (int)scaled;
+	if ((float)extent < scaled) ++extent;
+	if (alignment > 1) {
+		extent = (extent + alignment - 1) / alignment * alignment;
+	}
+	return extent;
+}
+
+/* downsample パスが書き込むリソースは全ミップレベルを確保する */
+static int PipelineCalcNumMipLevels(const PipelineRuntimeResourceState *state, int width, int height){
+	int resourceIndex = (int)(state - s_pipelineRuntimeResources);
+	for (int passIndex = 0; passIndex < s_pipelineDescription.numPasses; ++passIndex) {
+		const PipelinePass *pass = &s_pipelineDescription.passes[passIndex];
+		if (pass->type == PipelinePassTypeDownsample && pass->outputs[0].resourceIndex == resourceIndex) {
+			int numMipLevels = 1;
+			int size = (width > height)? width: height;
+			while (size > 1) {
+				size >>= 1;
+				++numMipLevels;
+			}
+			return numMipLevels;
+		}
+	}
+	return 1;
+}
+
 static void PipelineCreateOrResizeResource(
 	PipelineRuntimeResourceState *state,
 	const PipelineResource *resource
@@ -362,19 +508,30 @@ static void PipelineCreateOrResizeResource(
 		historyLength = PIPELINE_MAX_HISTORY_LENGTH;
 	}
 
-	int width = (resource->resolution.mode == PipelineResolutionModeFixed)? resource->resolution.width: SCREEN_WIDTH;
-	int height = (resource->resolution.mode == PipelineResolutionModeFixed)? resource->resolution.height: SCREEN_HEIGHT;
+	int width = SCREEN_WIDTH;
+	int height = SCREEN_HEIGHT;
+	if (resource->resolution.mode == PipelineResolutionModeFixed) {
+		width = resource->resolution.width;
+		height = resource->resolution.height;
+	} else if (resource->resolution.mode == PipelineResolutionModeScale) {
+		width = PipelineCalcScaledExtent(SCREEN_WIDTH, resource->resolution.scaleX, resource->resolution.alignment);
+		height = PipelineCalcScaledExtent(SCREEN_HEIGHT, resource->resolution.scaleY, resource->resolution.alignment);
+	}
 	if (width <= 0) width = SCREEN_WIDTH;
 	if (height <= 0) height = SCREEN_HEIGHT;
 
+	int numMipLevels = PipelineCalcNumMipLevels(state, width, height);
+
 	bool needsRecreate =
 		state->initialized == false
 	||	state->width != width
 	||	state->height != height
 	||	state->pixelFormat != resource->pixelFormat
-	||	state->historyLength != historyLength;
+	||	state->historyLength != historyLength
+	||	state->numMipLevels != numMipLevels;
 
 	if (needsRecreate) {
+		PipelineInvalidateFramebuffers((int)(state - s_pipelineRuntimeResources));
 		PipelineDeleteRuntimeResource(state);
 
 		GLenum internalformat = GL_RGBA8;
@@ -385,7 +542,14 @@ static void PipelineCreateOrResizeResource(
 		glGenTextures(historyLength, state->textureIds);
 		for (int historyIndex = 0; historyIndex < historyLength; ++historyIndex) {
 			glBindTexture(GL_TEXTURE_2D, state->textureIds[historyIndex]);
-			glTexImage2D(GL_TEXTURE_2D, 0, internalformat, width, height, 0, format, type, NULL);
+			for (int level = 0; level < numMipLevels; ++level) {
+				glTexImage2D(
+					GL_TEXTURE_2D, level, internalformat,
+					(width >> level > 0)? width >> level: 1,
+					(height >> level > 0)? height >> level: 1,
+					0, format, type, NULL
+				);
+			}
 			PipelineSetTextureSampler(GL_TEXTURE_2D, resource->textureFilter, resource->textureWrap, false);
 		}
 		glBindTexture(GL_TEXTURE_2D, 0);
@@ -395,6 +559,7 @@ static void PipelineCreateOrResizeResource(
 		state->height = height;
 		state->pixelFormat = resource->pixelFormat;
 		state->historyLength = historyLength;
+		state->numMipLevels = numMipLevels;
 	} else {
 		for (int historyIndex = 0; historyIndex < state->historyLength; ++historyIndex) {
 			glBindTexture(GL_TEXTURE_2D, state->textureIds[historyIndex]);
@@ -411,17 +576,17 @@ static void PipelineEnsureResources(const PipelineDescription *pipeline){
 	}
 }
 
-static GLuint PipelineAcquireResourceTexture(
+static int PipelineResolveResourceHistorySlot(
 	int resourceIndex,
 	int frameCount,
 	int historyOffset
 ){
 	if (resourceIndex < 0 || resourceIndex >= PIPELINE_MAX_RESOURCES) {
-		return 0;
+		return -1;
 	}
 	PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[resourceIndex];
 	if (state->initialized == false || state->historyLength <= 0) {
-		return 0;
+		return -1;
 	}
 
 	int historyLength = state->historyLength;
@@ -439,188 +604,154 @@ static GLuint PipelineAcquireResourceTexture(
 	if (resolvedIndex < 0 || resolvedIndex >= historyLength) {
 		resolvedIndex = baseIndex;
 	}
-	return state->textureIds[resolvedIndex];
+	return resolvedIndex;
 }
 
-static bool PipelineParseLegacyResourceIndex(
-	const PipelineResource *resource,
-	const char *prefix,
-	int *outIndex
+/* コマンドの全バインディングのテクスチャを解決する（履歴スロットはフレーム毎に変わる）*/
+static bool PipelineResolveCommandTextures(
+	const PipelinePlanCommand *command,
+	int frameCount,
+	GLuint *textureIds,
+	int *historySlots
 ){
-	if (resource == NULL || prefix == NULL) return false;
-	size_t prefixLength = PipelineStrLen(prefix);
-	if (PipelineStrncmp(resource->id, prefix, prefixLength) != 0) {
-		return false;
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		int historySlot = PipelineResolveResourceHistorySlot(binding->resourceIndex, frameCount, binding->historyOffset);
+		if (historySlot < 0) {
+			return false;
+		}
+		historySlots[bindingIndex] = historySlot;
+		textureIds[bindingIndex] = s_pipelineRuntimeResources[binding->resourceIndex].textureIds[historySlot];
+		if (textureIds[bindingIndex] == 0) {
+			return false;
+		}
 	}
-	int index = 0;
-	const char *suffix = resource->id + prefixLength;
-	if (*suffix != '\0') {
-		index = PipelineAtoi(suffix);
+	return true;
+}
+
+/* 完全性チェックは作成時のみ行い、以降はキャッシュされた FBO を返す */
+static GLuint PipelineAcquireFramebuffer(
+	const PipelineFramebufferAttachment *attachments,
+	int numAttachments
+){
+	for (int entryIndex = 0; entryIndex < s_numPipelineFramebufferCacheEntries; ++entryIndex) {
+		const PipelineFramebufferCacheEntry *entry = &s_pipelineFramebufferCache[entryIndex];
+		bool match = (entry->numAttachments == numAttachments);
+		for (int attachmentIndex = 0; match && attachmentIndex < numAttachments; ++attachmentIndex) {
+			match =
+				entry->attachments[attachmentIndex].resourceIndex == attachments[attachmentIndex].resourceIndex
+			&&	entry->attachments[attachmentIndex].historySlot == attachments[attachmentIndex].historySlot
+			&&	entry->attachments[attachmentIndex].mipLevel == attachments[attachmentIndex].mipLevel;
+		}
+		if (match) {
+			return entry->complete? entry->framebufferId: 0;
+		}
 	}
-	if (outIndex) {
-		*outIndex = index;
+
+	if (s_numPipelineFramebufferCacheEntries >= PIPELINE_MAX_FRAMEBUFFER_CACHE_ENTRIES) {
+		PipelineInvalidateFramebuffers(-1);
 	}
-	return true;
+	PipelineFramebufferCacheEntry *entry = &s_pipelineFramebufferCache[s_numPipelineFramebufferCacheEntries++];
+	PipelineMemset(entry, 0, sizeof(PipelineFramebufferCacheEntry));
+	PipelineMemcpy(entry->attachments, attachments, sizeof(PipelineFramebufferAttachment) * numAttachments);
+	entry->numAttachments = numAttachments;
+
+	GLenum drawBuffers[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
+	glExtGenFramebuffers(1, &entry->framebufferId);
+	glExtBindFramebuffer(GL_FRAMEBUFFER, entry->framebufferId);
+	for (int attachmentIndex = 0; attachmentIndex < numAttachments; ++attachmentIndex) {
+		const PipelineFramebufferAttachment *attachment = &attachments[attachmentIndex];
+		glExtFramebufferTexture(
+			GL_FRAMEBUFFER,
+			GL_COLOR_ATTACHMENT0 + attachmentIndex,
+			s_pipelineRuntimeResources[attachment->resourceIndex].textureIds[attachment->historySlot],
+			attachment->mipLevel
+		);
+		drawBuffers[attachmentIndex] = GL_COLOR_ATTACHMENT0 + attachmentIndex;
+	}
+	glExtDrawBuffers(numAttachments, drawBuffers);
+	entry->complete = (glExtCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glExtBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return entry->complete? entry->framebufferId: 0;
 }
 
-static bool PipelineExecuteComputePass(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
+static bool PipelineExecuteComputeCommand(
+	const PipelinePlanCommand *command,
 	int frameCount,
 	int waveOutPos,
 	float timeInSeconds
 ){
-	if (pipeline == NULL || pass == NULL) return false;
-	if (s_graphicsComputeProgramId == 0) return false;
-
-	GLenum defaultInternalformat = GL_RGBA8;
-	PipelineGetPixelFormatInfo(PixelFormatUnorm8Rgba, &defaultInternalformat, NULL, NULL);
-
-	GLuint samplerUnitBase = COMPUTE_TEXTURE_START_INDEX;
-	GLuint samplerUnitCount = 0;
-	GLuint boundSamplerUnits[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numBoundSamplerUnits = 0;
-	GLenum imageFormats[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	GLuint boundImageUnits[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	GLenum boundImageAccess[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numBoundImageUnits = 0;
-
-	glExtUseProgram(s_graphicsComputeProgramId);
-	if (s_computePipelinePassUniformAvailable) {
-		glExtUniform1i(UNIFORM_LOCATION_PIPELINE_PASS_INDEX, s_activePipelinePassIndex);
+	if (command->executable == false) return false;
+	const PipelineProgramState *program = PipelineGetPassProgramState(command->passIndex, &s_computeProgram);
+	if (program->programId == 0) return false;
+	const PipelineRuntimeResourceState *target = &s_pipelineRuntimeResources[command->targetResourceIndex];
+	if (target->initialized == false) return false;
+
+	GLuint textureIds[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	int historySlots[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	if (PipelineResolveCommandTextures(command, frameCount, textureIds, historySlots) == false) {
+		return false;
 	}
 
-	for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
-		const PipelineResourceBinding *binding = &pass->inputs[inputIndex];
-		GLuint textureId = PipelineAcquireResourceTexture(binding->resourceIndex, frameCount, binding->historyOffset);
-		const PipelineResource *resource = &pipeline->resources[binding->resourceIndex];
-		if (textureId == 0 || resource == NULL) {
-			return false;
-		}
-		GLenum internalformat = defaultInternalformat;
-		PipelineGetPixelFormatInfo(resource->pixelFormat, &internalformat, NULL, NULL);
-		switch (binding->access) {
-			case PipelineResourceAccessSampled:
-			case PipelineResourceAccessHistoryRead: {
-				GLuint samplerUnit = samplerUnitBase + samplerUnitCount;
-				glExtActiveTexture(GL_TEXTURE0 + samplerUnit);
-				glBindTexture(GL_TEXTURE_2D, textureId);
-				PipelineSetTextureSampler(GL_TEXTURE_2D, resource->textureFilter, resource->textureWrap, false);
-				boundSamplerUnits[numBoundSamplerUnits++] = samplerUnit;
-				++samplerUnitCount;
-			} break;
-			case PipelineResourceAccessImageRead: {
-				GLenum format = internalformat;
-				glExtBindImageTexture(numBoundImageUnits, textureId, 0, GL_FALSE, 0, GL_READ_ONLY, format);
-				boundImageUnits[numBoundImageUnits] = numBoundImageUnits;
-				boundImageAccess[numBoundImageUnits] = GL_READ_ONLY;
-				imageFormats[numBoundImageUnits] = format;
-				++numBoundImageUnits;
-			} break;
-			default: {
-				return false;
-			} break;
-		}
+	glExtUseProgram(program->programId);
+	if (program->pipelinePassUniformAvailable) {
+		glExtUniform1i(UNIFORM_LOCATION_PIPELINE_PASS_INDEX, s_activePipelinePassIndex);
 	}
 
-	bool hasWritableOutput = false;
-	for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
-		const PipelineResourceBinding *binding = &pass->outputs[outputIndex];
-		GLuint textureId = PipelineAcquireResourceTexture(binding->resourceIndex, frameCount, binding->historyOffset);
-		const PipelineResource *resource = &pipeline->resources[binding->resourceIndex];
-		if (textureId == 0 || resource == NULL) {
-			return false;
-		}
-		GLenum internalformat = defaultInternalformat;
-		PipelineGetPixelFormatInfo(resource->pixelFormat, &internalformat, NULL, NULL);
-		switch (binding->access) {
-			case PipelineResourceAccessImageWrite: {
-				bool hasMatchingInput = false;
-				for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
-					const PipelineResourceBinding *inputBinding = &pass->inputs[inputIndex];
-					if (inputBinding->resourceIndex == binding->resourceIndex) {
-						hasMatchingInput = true;
-						break;
-					}
-				}
-				GLenum imageAccess = hasMatchingInput ? GL_WRITE_ONLY : GL_READ_WRITE;
-				int imageUnit = numBoundImageUnits;
-				glExtBindImageTexture(imageUnit, textureId, 0, GL_FALSE, 0, imageAccess, internalformat);
-				boundImageUnits[numBoundImageUnits] = imageUnit;
-				boundImageAccess[numBoundImageUnits] = imageAccess;
-				imageFormats[numBoundImageUnits] = internalformat;
-				++numBoundImageUnits;
-				hasWritableOutput = true;
-			} break;
-			default: {
-				return false;
-			} break;
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind == PipelinePlanBindingKindTexture) {
+			glExtActiveTexture(GL_TEXTURE0 + binding->unit);
+			glBindTexture(GL_TEXTURE_2D, textureIds[bindingIndex]);
+			PipelineSetTextureSampler(GL_TEXTURE_2D, binding->textureFilter, binding->textureWrap, binding->enableMipmap);
+		} else if (binding->kind == PipelinePlanBindingKindImage) {
+			glExtBindImageTexture(binding->unit, textureIds[bindingIndex], 0, GL_FALSE, 0, binding->imageAccess, binding->imageFormat);
 		}
 	}
 
-	if (hasWritableOutput == false) {
-		for (int i = 0; i < numBoundImageUnits; ++i) {
-			glExtBindImageTexture(boundImageUnits[i], 0, 0, GL_FALSE, 0, boundImageAccess[i], imageFormats[i]);
-		}
-		for (int i = 0; i < numBoundSamplerUnits; ++i) {
-			glExtActiveTexture(GL_TEXTURE0 + boundSamplerUnits[i]);
-			glBindTexture(GL_TEXTURE_2D, 0);
-		}
-		glExtActiveTexture(GL_TEXTURE0);
-		return false;
-	}
-
-	if (s_computeWaveOutUniformAvailable) {
+	if (program->waveOutUniformAvailable) {
 		glExtUniform1i(UNIFORM_LOCATION_WAVE_OUT_POS, waveOutPos);
 	}
-	if (s_computeFrameCountUniformAvailable) {
+	if (program->frameCountUniformAvailable) {
 		glExtUniform1i(UNIFORM_LOCATION_FRAME_COUNT, frameCount);
 	}
-	if (s_computeTimeUniformAvailable) {
+	if (program->timeUniformAvailable) {
 		glExtUniform1f(UNIFORM_LOCATION_TIME, timeInSeconds);
 	}
-	if (s_computeResolutionUniformAvailable) {
-		glExtUniform2f(UNIFORM_LOCATION_RESO, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT);
+	if (program->resolutionUniformAvailable) {
+		glExtUniform2f(UNIFORM_LOCATION_RESO, (float)target->width, (float)target->height);
 	}
-	if (s_computeMouseButtonsUniformAvailable) {
+	if (program->mouseButtonsUniformAvailable) {
 		glExtUniform3i(UNIFORM_LOCATION_MOUSE_BUTTONS, 0, 0, 0);
 	}
 
-	GLuint workGroupSizeX = s_graphicsComputeWorkGroupSize[0] > 0? (GLuint)s_graphicsComputeWorkGroupSize[0]: 1;
-	GLuint workGroupSizeY = s_graphicsComputeWorkGroupSize[1] > 0? (GLuint)s_graphicsComputeWorkGroupSize[1]: 1;
-	GLuint workGroupSizeZ = s_graphicsComputeWorkGroupSize[2] > 0? (GLuint)s_graphicsComputeWorkGroupSize[2]: 1;
-	if (pass->overrideWorkGroupSize) {
-		if (pass->workGroupSize[0] > 0) workGroupSizeX = pass->workGroupSize[0];
-		if (pass->workGroupSize[1] > 0) workGroupSizeY = pass->workGroupSize[1];
-		if (pass->workGroupSize[2] > 0) workGroupSizeZ = pass->workGroupSize[2];
-	}
-
-	GLuint targetWidth = SCREEN_WIDTH;
-	GLuint targetHeight = SCREEN_HEIGHT;
-	if (pass->numOutputs > 0) {
-		const PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[pass->outputs[0].resourceIndex];
-		if (state->initialized) {
-			targetWidth = (GLuint)state->width;
-			targetHeight = (GLuint)state->height;
-		}
+	GLuint workGroupSizeX = program->workGroupSize[0] > 0? (GLuint)program->workGroupSize[0]: 1;
+	GLuint workGroupSizeY = program->workGroupSize[1] > 0? (GLuint)program->workGroupSize[1]: 1;
+	GLuint workGroupSizeZ = program->workGroupSize[2] > 0? (GLuint)program->workGroupSize[2]: 1;
+	if (command->overrideWorkGroupSize) {
+		if (command->workGroupSize[0] > 0) workGroupSizeX = command->workGroupSize[0];
+		if (command->workGroupSize[1] > 0) workGroupSizeY = command->workGroupSize[1];
+		if (command->workGroupSize[2] > 0) workGroupSizeZ = command->workGroupSize[2];
 	}
 
-	GLuint numGroupsX = (targetWidth + workGroupSizeX - 1) / workGroupSizeX;
-	GLuint numGroupsY = (targetHeight + workGroupSizeY - 1) / workGroupSizeY;
+	GLuint numGroupsX = ((GLuint)target->width + workGroupSizeX - 1) / workGroupSizeX;
+	GLuint numGroupsY = ((GLuint)target->height + workGroupSizeY - 1) / workGroupSizeY;
 	GLuint numGroupsZ = (1 + workGroupSizeZ - 1) / workGroupSizeZ;
 	if (numGroupsX == 0) numGroupsX = 1;
 	if (numGroupsY == 0) numGroupsY = 1;
 	if (numGroupsZ == 0) numGroupsZ = 1;
 
+	/* バリアはプランに従い、消費側のコマンドの直前で発行される */
 	glExtDispatchCompute(numGroupsX, numGroupsY, numGroupsZ);
-	glExtMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-	for (int i = 0; i < numBoundImageUnits; ++i) {
-		glExtBindImageTexture(boundImageUnits[i], 0, 0, GL_FALSE, 0, boundImageAccess[i], imageFormats[i]);
-	}
-	for (int i = 0; i < numBoundSamplerUnits; ++i) {
-		glExtActiveTexture(GL_TEXTURE0 + boundSamplerUnits[i]);
-		glBindTexture(GL_TEXTURE_2D, 0);
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind == PipelinePlanBindingKindTexture) {
+			glExtActiveTexture(GL_TEXTURE0 + binding->unit);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		} else if (binding->kind == PipelinePlanBindingKindImage) {
+			glExtBindImageTexture(binding->unit, 0, 0, GL_FALSE, 0, binding->imageAccess, binding->imageFormat);
+		}
 	}
 	glExtActiveTexture(GL_TEXTURE0);
 	glExtUseProgram(0);
@@ -628,129 +759,87 @@ static bool PipelineExecuteComputePass(
 	return true;
 }
 
-static bool PipelineExecuteFragmentPass(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
+static bool PipelineExecuteFragmentCommand(
+	const PipelinePlanCommand *command,
 	int frameCount,
 	int waveOutPos,
 	float timeInSeconds,
-	GLuint fragmentProgramId,
 	bool enableFrameCountUniform
 ){
-	if (pipeline == NULL || pass == NULL) return false;
-	if (fragmentProgramId == 0) return false;
-
-	glExtUseProgram(fragmentProgramId);
-	if (s_fragmentPipelinePassUniformAvailable) {
-		glExtUniform1i(UNIFORM_LOCATION_PIPELINE_PASS_INDEX, s_activePipelinePassIndex);
+	if (command->executable == false) return false;
+	const PipelineProgramState *program = PipelineGetPassProgramState(command->passIndex, &s_fragmentProgram);
+	if (program->programId == 0) return false;
+	const PipelineRuntimeResourceState *target = &s_pipelineRuntimeResources[command->targetResourceIndex];
+	if (target->initialized == false) return false;
+
+	GLuint textureIds[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	int historySlots[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	if (PipelineResolveCommandTextures(command, frameCount, textureIds, historySlots) == false) {
+		return false;
 	}
 
-	GLuint framebuffer = 0;
-	glExtGenFramebuffers(1, &framebuffer);
-	glExtBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-
-	GLenum drawBuffers[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
+	/* カラーアタッチメントはアタッチメント番号順に並んでいる */
+	PipelineFramebufferAttachment colorAttachments[PIPELINE_MAX_BINDINGS_PER_PASS] = {{0}};
 	int numDrawBuffers = 0;
-	GLuint targetWidth = SCREEN_WIDTH;
-	GLuint targetHeight = SCREEN_HEIGHT;
-
-	for (int outputIndex = 0; outputIndex < pass->numOutputs; ++outputIndex) {
-		const PipelineResourceBinding *binding = &pass->outputs[outputIndex];
-		if (binding->access != PipelineResourceAccessColorAttachment) {
-			continue;
-		}
-		GLuint textureId = PipelineAcquireResourceTexture(binding->resourceIndex, frameCount, binding->historyOffset);
-		PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[binding->resourceIndex];
-		if (textureId == 0 || state->initialized == false) {
-			glExtBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glExtDeleteFramebuffers(1, &framebuffer);
-			return false;
-		}
-		if (numDrawBuffers == 0) {
-			targetWidth = (GLuint)state->width;
-			targetHeight = (GLuint)state->height;
-		}
-		GLenum attachment = GL_COLOR_ATTACHMENT0 + numDrawBuffers;
-		glExtFramebufferTexture(GL_FRAMEBUFFER, attachment, textureId, 0);
-		drawBuffers[numDrawBuffers] = attachment;
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind != PipelinePlanBindingKindColorAttachment) continue;
+		colorAttachments[numDrawBuffers].resourceIndex = binding->resourceIndex;
+		colorAttachments[numDrawBuffers].historySlot = historySlots[bindingIndex];
 		++numDrawBuffers;
 	}
-
-	if (numDrawBuffers == 0) {
-		glExtBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glExtDeleteFramebuffers(1, &framebuffer);
+	GLuint framebuffer = PipelineAcquireFramebuffer(colorAttachments, numDrawBuffers);
+	if (framebuffer == 0) {
 		return false;
 	}
 
-	glExtDrawBuffers(numDrawBuffers, drawBuffers);
-	if (glExtCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		glExtBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glExtDeleteFramebuffers(1, &framebuffer);
-		return false;
+	glExtUseProgram(program->programId);
+	if (program->pipelinePassUniformAvailable) {
+		glExtUniform1i(UNIFORM_LOCATION_PIPELINE_PASS_INDEX, s_activePipelinePassIndex);
 	}
 
-	glViewport(0, 0, targetWidth, targetHeight);
+	glExtBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	glViewport(0, 0, target->width, target->height);
 
-	if (pass->clear.enableColorClear) {
+	if (command->clear.enableColorClear) {
 		glClearColor(
-			pass->clear.clearColor[0],
-			pass->clear.clearColor[1],
-			pass->clear.clearColor[2],
-			pass->clear.clearColor[3]
+			command->clear.clearColor[0],
+			command->clear.clearColor[1],
+			command->clear.clearColor[2],
+			command->clear.clearColor[3]
 		);
 		glClear(GL_COLOR_BUFFER_BIT);
 	}
 
-	GLuint samplerUnits[PIPELINE_MAX_BINDINGS_PER_PASS] = {0};
-	int numBoundSamplerUnits = 0;
-	for (int inputIndex = 0; inputIndex < pass->numInputs; ++inputIndex) {
-		const PipelineResourceBinding *binding = &pass->inputs[inputIndex];
-		GLuint textureId = PipelineAcquireResourceTexture(binding->resourceIndex, frameCount, binding->historyOffset);
-		const PipelineResource *resource = &pipeline->resources[binding->resourceIndex];
-		if (textureId == 0 || resource == NULL) {
-			glExtBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glExtDeleteFramebuffers(1, &framebuffer);
-			return false;
-		}
-		if (binding->access != PipelineResourceAccessSampled && binding->access != PipelineResourceAccessHistoryRead) {
-			continue;
-		}
-		GLuint samplerUnit = numBoundSamplerUnits;
-		int legacyIndex = 0;
-		if (PipelineParseLegacyResourceIndex(resource, "legacy_mrt", &legacyIndex)) {
-			samplerUnit = (GLuint)legacyIndex;
-		}
-		else if (PipelineParseLegacyResourceIndex(resource, "legacy_compute", &legacyIndex)) {
-			samplerUnit = COMPUTE_TEXTURE_START_INDEX + (GLuint)legacyIndex;
-		}
-		else {
-			samplerUnit = (GLuint)(numBoundSamplerUnits);
-		}
-		if (samplerUnit >= PIPELINE_MAX_BINDINGS_PER_PASS) {
-			samplerUnit = (GLuint)(PIPELINE_MAX_BINDINGS_PER_PASS - 1);
-		}
-		glExtActiveTexture(GL_TEXTURE0 + samplerUnit);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-		PipelineSetTextureSampler(GL_TEXTURE_2D, resource->textureFilter, resource->textureWrap, false);
-		if (samplerUnit >= numBoundSamplerUnits) {
-			samplerUnits[numBoundSamplerUnits++] = samplerUnit;
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind != PipelinePlanBindingKindTexture) continue;
+		glExtActiveTexture(GL_TEXTURE0 + binding->unit);
+		glBindTexture(GL_TEXTURE_2D, textureIds[bindingIndex]);
+		/* downsample パスが構築したミップマップチェーンは再生成しない */
+		PipelineSetTextureSampler(GL_TEXTURE_2D, binding->textureFilter, binding->textureWrap, binding->enableMipmap);
+#if ENABLE_MIPMAP_GENERATION
+		if (binding->enableMipmap && binding->mipmapPrebuilt == false) {
+			glExtGenerateMipmap(GL_TEXTURE_2D);
 		}
+#endif
 	}
 	glExtActiveTexture(GL_TEXTURE0);
 
-	if (s_fragmentWaveOutUniformAvailable) {
+	if (program->waveOutUniformAvailable) {
 		glExtUniform1i(UNIFORM_LOCATION_WAVE_OUT_POS, waveOutPos);
 	}
-	if (s_fragmentFrameCountUniformAvailable) {
+	if (program->frameCountUniformAvailable) {
 		glExtUniform1i(UNIFORM_LOCATION_FRAME_COUNT, frameCount);
 	}
-	if (s_fragmentTimeUniformAvailable) {
+	if (program->timeUniformAvailable) {
 		glExtUniform1f(UNIFORM_LOCATION_TIME, timeInSeconds);
 	}
-	if (s_fragmentResolutionUniformAvailable) {
-		glExtUniform2f(UNIFORM_LOCATION_RESO, (float)targetWidth, (float)targetHeight);
+	if (program->resolutionUniformAvailable) {
+		glExtUniform2f(UNIFORM_LOCATION_RESO, (float)target->width, (float)target->height);
 	}
-	if (s_fragmentMouseButtonsUniformAvailable) {
+	if (program->mouseButtonsUniformAvailable) {
 		glExtUniform3i(UNIFORM_LOCATION_MOUSE_BUTTONS, 0, 0, 0);
 	}
 
@@ -766,11 +855,12 @@ static bool PipelineExecuteFragmentPass(
 	glExtDisableVertexAttribArray(0);
 
 	glExtBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glExtDeleteFramebuffers(1, &framebuffer);
 	glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-	for (int i = 0; i < numBoundSamplerUnits; ++i) {
-		glExtActiveTexture(GL_TEXTURE0 + samplerUnits[i]);
+	for (int bindingIndex = 0; bindingIndex < command->numBindings; ++bindingIndex) {
+		const PipelinePlanBinding *binding = &command->bindings[bindingIndex];
+		if (binding->kind != PipelinePlanBindingKindTexture) continue;
+		glExtActiveTexture(GL_TEXTURE0 + binding->unit);
 		glBindTexture(GL_TEXTURE_2D, 0);
 	}
 	glExtActiveTexture(GL_TEXTURE0);
@@ -782,27 +872,83 @@ static bool PipelineExecuteFragmentPass(
 	return true;
 }
 
-static bool PipelineExecutePresentPass(
-	const PipelineDescription *pipeline,
-	const PipelinePass *pass,
+/*
+	downsample パス（シェーダはエクスポート時にパス個別のシェーダとして埋め込まれる）
+	1 回のディスパッチで最大 PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH レベルを書き込む。
+	kawase フィルタはタイル境界を跨いでサンプリングするため 1 レベルずつ処理する。
+*/
+static bool PipelineExecuteDownsampleCommand(
+	const PipelinePlanCommand *command,
 	int frameCount
 ){
-	if (pipeline == NULL || pass == NULL) return false;
-	if (pass->numInputs <= 0) return false;
-	GLuint textureId = PipelineAcquireResourceTexture(pass->inputs[0].resourceIndex, frameCount, pass->inputs[0].historyOffset);
-	PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[pass->inputs[0].resourceIndex];
-	if (textureId == 0 || state->initialized == false) {
+	if (command->executable == false) return false;
+	const PipelineProgramState *program = PipelineGetPassProgramState(command->passIndex, &s_computeProgram);
+	if (program == &s_computeProgram) return false;
+	GLuint textureIds[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	int historySlots[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	if (PipelineResolveCommandTextures(command, frameCount, textureIds, historySlots) == false) {
 		return false;
 	}
-	GLuint readFramebuffer = 0;
-	glExtGenFramebuffers(1, &readFramebuffer);
-	glExtBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
-	glExtFramebufferTexture(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureId, 0);
-	if (glExtCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-		glExtBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-		glExtDeleteFramebuffers(1, &readFramebuffer);
+	const PipelinePlanBinding *srcBinding = &command->bindings[0];
+	const PipelinePlanBinding *dstBinding = &command->bindings[1];
+	const PipelineRuntimeResourceState *dst = &s_pipelineRuntimeResources[command->targetResourceIndex];
+
+	/* 同一リソースならレベル 0 から 1 以降を、別リソースなら入力から出力のレベル 0 以降を作る */
+	int firstDstLevel = (textureIds[0] == textureIds[1])? 1: 0;
+	int levelsPerDispatch = (command->downsampleFilter == PipelineDownsampleFilterKawase)? 1: PIPELINE_DOWNSAMPLE_LEVELS_PER_DISPATCH;
+
+	glExtUseProgram(program->programId);
+	glExtActiveTexture(GL_TEXTURE0 + srcBinding->unit);
+	for (int dstLevel = firstDstLevel; dstLevel < dst->numMipLevels; ) {
+		int numDstLevels = dst->numMipLevels - dstLevel;
+		if (numDstLevels > levelsPerDispatch) numDstLevels = levelsPerDispatch;
+		GLuint sourceTextureId = (dstLevel == firstDstLevel)? textureIds[0]: textureIds[1];
+		glBindTexture(GL_TEXTURE_2D, sourceTextureId);
+		PipelineSetTextureSampler(
+			GL_TEXTURE_2D,
+			(command->downsampleFilter == PipelineDownsampleFilterKawase)? TextureFilterLinear: TextureFilterNearest,
+			TextureWrapClampToEdge,
+			sourceTextureId == textureIds[1]
+		);
+		for (int levelIndex = 0; levelIndex < numDstLevels; ++levelIndex) {
+			glExtBindImageTexture(dstBinding->unit + levelIndex, textureIds[1], dstLevel + levelIndex, GL_FALSE, 0, GL_WRITE_ONLY, dstBinding->imageFormat);
+		}
+		glExtUniform1i(0, (dstLevel > 0)? dstLevel - 1: 0);	/* srcLevel */
+		glExtUniform1i(1, numDstLevels);						/* numDstLevels */
+		int dstWidth = (dst->width >> dstLevel > 0)? dst->width >> dstLevel: 1;
+		int dstHeight = (dst->height >> dstLevel > 0)? dst->height >> dstLevel: 1;
+		glExtDispatchCompute(
+			(GLuint)(dstWidth + PIPELINE_DOWNSAMPLE_TILE_SIZE - 1) / PIPELINE_DOWNSAMPLE_TILE_SIZE,
+			(GLuint)(dstHeight + PIPELINE_DOWNSAMPLE_TILE_SIZE - 1) / PIPELINE_DOWNSAMPLE_TILE_SIZE,
+			1
+		);
+		dstLevel += numDstLevels;
+		glExtMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glExtActiveTexture(GL_TEXTURE0);
+	glExtUseProgram(0);
+	return true;
+}
+
+static bool PipelineExecutePresentCommand(
+	const PipelinePlanCommand *command,
+	int frameCount
+){
+	if (command->executable == false) return false;
+	GLuint textureIds[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	int historySlots[PIPELINE_PLAN_MAX_BINDINGS] = {0};
+	if (PipelineResolveCommandTextures(command, frameCount, textureIds, historySlots) == false) {
 		return false;
 	}
+	PipelineFramebufferAttachment readAttachment = {0};
+	readAttachment.resourceIndex = command->bindings[0].resourceIndex;
+	readAttachment.historySlot = historySlots[0];
+	GLuint readFramebuffer = PipelineAcquireFramebuffer(&readAttachment, 1);
+	if (readFramebuffer == 0) {
+		return false;
+	}
+	const PipelineRuntimeResourceState *state = &s_pipelineRuntimeResources[command->targetResourceIndex];
 	glExtBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 	glExtBlitNamedFramebuffer(
 		readFramebuffer,
@@ -812,8 +958,6 @@ static bool PipelineExecutePresentPass(
 		GL_COLOR_BUFFER_BIT,
 		GL_NEAREST
 	);
-	glExtBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-	glExtDeleteFramebuffers(1, &readFramebuffer);
 	return true;
 }
 
@@ -1038,6 +1182,11 @@ entrypoint(
 	const char *soundShaderCode = p;
 	const char *soundShaderCodes[] = {soundShaderCode};
 
+	/* パイプラインパス個別のシェーダコードの開始位置を検索 */
+	while (*p != '\0') { p++; }
+	p++;
+	const char *passShaderCode = p;
+
 	/* サウンド出力バッファの作成 */
 	/*
 		glExtGenBuffers の実行は省略している。
@@ -1102,78 +1251,15 @@ entrypoint(
 	}
 
 	/* グラフィクス用コンピュートシェーダの作成 */
-	s_graphicsComputeProgramId = glExtCreateShaderProgramv(
-		/* GLenum type */		GL_COMPUTE_SHADER,
-		/* GLsizei count */		1,
-		/* const GLchar* const *strings */	graphicsComputeShaderCodes
-	);
-	glExtGetProgramiv(
-		/* GLuint program */		s_graphicsComputeProgramId,
-		/* GLenum pname */		GL_COMPUTE_WORK_GROUP_SIZE,
-		/* GLint *params */		s_graphicsComputeWorkGroupSize
-	);
-	for (int i = 0; i < 3; ++i) {
-		if (s_graphicsComputeWorkGroupSize[i] <= 0) {
-			s_graphicsComputeWorkGroupSize[i] = 1;
-		}
-	}
-
-	
-	/* グラフィクス用コンピュートシェーダの作成 */
-	s_graphicsComputeProgramId = glExtCreateShaderProgramv(
-		/* GLenum type */		GL_COMPUTE_SHADER,
-		/* GLsizei count */		1,
-		/* const GLchar* const *strings */	graphicsComputeShaderCodes
+	PipelineSetupProgramState(
+		&s_computeProgram,
+		glExtCreateShaderProgramv(
+			/* GLenum type */		GL_COMPUTE_SHADER,
+			/* GLsizei count */		1,
+			/* const GLchar* const *strings */	graphicsComputeShaderCodes
+		),
+		GL_COMPUTE_SHADER
 	);
-	glExtGetProgramiv(
-		/* GLuint program */		s_graphicsComputeProgramId,
-		/* GLenum pname */		GL_COMPUTE_WORK_GROUP_SIZE,
-		/* GLint *params */		s_graphicsComputeWorkGroupSize
-	);
-	for (int i = 0; i < 3; ++i) {
-		if (s_graphicsComputeWorkGroupSize[i] <= 0) {
-			s_graphicsComputeWorkGroupSize[i] = 1;
-		}
-	}
-	if (s_graphicsComputeProgramId != 0) {
-		s_computePipelinePassUniformAvailable = PipelineProgramHasUniform(
-			s_graphicsComputeProgramId,
-			UNIFORM_LOCATION_PIPELINE_PASS_INDEX,
-			GL_INT
-		);
-		s_computeFrameCountUniformAvailable = PipelineProgramHasUniform(
-			s_graphicsComputeProgramId,
-			UNIFORM_LOCATION_FRAME_COUNT,
-			GL_INT
-		);
-		s_computeWaveOutUniformAvailable = PipelineProgramHasUniform(
-			s_graphicsComputeProgramId,
-			UNIFORM_LOCATION_WAVE_OUT_POS,
-			GL_INT
-		);
-		s_computeTimeUniformAvailable = PipelineProgramHasUniform(
-			s_graphicsComputeProgramId,
-			UNIFORM_LOCATION_TIME,
-			GL_FLOAT
-		);
-		s_computeResolutionUniformAvailable = PipelineProgramHasUniform(
-			s_graphicsComputeProgramId,
-			UNIFORM_LOCATION_RESO,
-			GL_FLOAT_VEC2
-		);
-		s_computeMouseButtonsUniformAvailable = PipelineProgramHasUniform(
-			s_graphicsComputeProgramId,
-			UNIFORM_LOCATION_MOUSE_BUTTONS,
-			GL_INT_VEC3
-		);
-	} else {
-		s_computePipelinePassUniformAvailable = false;
-		s_computeFrameCountUniformAvailable = false;
-		s_computeWaveOutUniformAvailable = false;
-		s_computeTimeUniformAvailable = false;
-		s_computeResolutionUniformAvailable = false;
-		s_computeMouseButtonsUniformAvailable = false;
-	}
 
 	/* フラグメントシェーダの作成 */
 	int graphicsFsProgramId = glExtCreateShaderProgramv(
@@ -1186,44 +1272,26 @@ entrypoint(
 	glExtUseProgram(
 		/* GLuint program */	graphicsFsProgramId
 	);
-	if (graphicsFsProgramId != 0) {
-		s_fragmentPipelinePassUniformAvailable = PipelineProgramHasUniform(
-			graphicsFsProgramId,
-			UNIFORM_LOCATION_PIPELINE_PASS_INDEX,
-			GL_INT
-		);
-		s_fragmentWaveOutUniformAvailable = PipelineProgramHasUniform(
-			graphicsFsProgramId,
-			UNIFORM_LOCATION_WAVE_OUT_POS,
-			GL_INT
-		);
-		s_fragmentFrameCountUniformAvailable = PipelineProgramHasUniform(
-			graphicsFsProgramId,
-			UNIFORM_LOCATION_FRAME_COUNT,
-			GL_INT
-		);
-		s_fragmentTimeUniformAvailable = PipelineProgramHasUniform(
-			graphicsFsProgramId,
-			UNIFORM_LOCATION_TIME,
-			GL_FLOAT
-		);
-		s_fragmentResolutionUniformAvailable = PipelineProgramHasUniform(
-			graphicsFsProgramId,
-			UNIFORM_LOCATION_RESO,
-			GL_FLOAT_VEC2
-		);
-		s_fragmentMouseButtonsUniformAvailable = PipelineProgramHasUniform(
-			graphicsFsProgramId,
-			UNIFORM_LOCATION_MOUSE_BUTTONS,
-			GL_INT_VEC3
-		);
-	} else {
-		s_fragmentPipelinePassUniformAvailable = false;
-		s_fragmentWaveOutUniformAvailable = false;
-		s_fragmentFrameCountUniformAvailable = false;
-		s_fragmentTimeUniformAvailable = false;
-		s_fragmentResolutionUniformAvailable = false;
-		s_fragmentMouseButtonsUniformAvailable = false;
+	PipelineSetupProgramState(&s_fragmentProgram, graphicsFsProgramId, GL_FRAGMENT_SHADER);
+
+	/* パイプラインパス個別のシェーダの作成（空文字列のパスは共有シェーダを使う）*/
+	for (int passIndex = 0; passIndex < g_exportedPipelineDescription.numPasses; ++passIndex) {
+		const char *passShaderCodes[] = {passShaderCode};
+		if (*passShaderCode != '\0') {
+			GLenum type = (g_exportedPipelineDescription.passes[passIndex].type == PipelinePassTypeFragment)?
+				GL_FRAGMENT_SHADER: GL_COMPUTE_SHADER;
+			PipelineSetupProgramState(
+				&s_pipelinePassPrograms[passIndex],
+				glExtCreateShaderProgramv(
+					/* GLenum type */		type,
+					/* GLsizei count */		1,
+					/* const GLchar* const *strings */	passShaderCodes
+				),
+				type
+			);
+		}
+		while (*passShaderCode != '\0') { passShaderCode++; }
+		passShaderCode++;
 	}
 
 	PipelineMemcpy(&s_pipelineDescription, &g_exportedPipelineDescription, sizeof(PipelineDescription));
@@ -1262,37 +1330,47 @@ entrypoint(
 
 		PipelineEnsureResources(&s_pipelineDescription);
 
-		for (int passIndex = 0; passIndex < s_pipelineDescription.numPasses; ++passIndex) {
-			const PipelinePass *pass = &s_pipelineDescription.passes[passIndex];
+		for (int commandIndex = 0; commandIndex < g_exportedPipelinePlan.numCommands; ++commandIndex) {
+			const PipelinePlanCommand *command = &g_exportedPipelinePlan.commands[commandIndex];
 			bool executed = false;
-			s_activePipelinePassIndex = passIndex;
-			switch (pass->type) {
+			s_activePipelinePassIndex = command->passIndex;
+			if (command->barrierBits != 0) {
+				glExtMemoryBarrier(command->barrierBits);
+			}
+			switch (command->type) {
 				case PipelinePassTypeCompute: {
-					executed = PipelineExecuteComputePass(&s_pipelineDescription, pass, frameCount, waveOutPos, timeInSeconds);
+					executed = PipelineExecuteComputeCommand(command, frameCount, waveOutPos, timeInSeconds);
 				} break;
 				case PipelinePassTypeFragment: {
-					executed = PipelineExecuteFragmentPass(&s_pipelineDescription, pass, frameCount, waveOutPos, timeInSeconds, graphicsFsProgramId, enableFrameCountUniform);
+					executed = PipelineExecuteFragmentCommand(command, frameCount, waveOutPos, timeInSeconds, enableFrameCountUniform);
+				} break;
+				case PipelinePassTypeDownsample: {
+					executed = PipelineExecuteDownsampleCommand(command, frameCount);
+				} break;
+				case PipelinePassTypeUpsample: {
+					/* 組み込みシェーダを個別シェーダとして持つ compute パスとして実行する */
+					executed = PipelineExecuteComputeCommand(command, frameCount, waveOutPos, timeInSeconds);
 				} break;
 				case PipelinePassTypePresent: {
-					executed = PipelineExecutePresentPass(&s_pipelineDescription, pass, frameCount);
+					executed = PipelineExecutePresentCommand(command, frameCount);
 				} break;
 				default: {
 					executed = false;
 				} break;
 			}
-				if (!executed && s_loggedPipelineExecutionFailure == false) {
-					char debugMessage[256];
-					wsprintfA(
-						debugMessage,
-						"[Pipeline Warning] Pass \"%s\" (type %d) failed to execute.\n",
-						pass->name,
-						(int)pass->type
-					);
-					OutputDebugStringA(debugMessage);
-					s_loggedPipelineExecutionFailure = true;
-				}
-				s_activePipelinePassIndex = -1;
+			if (!executed && s_loggedPipelineExecutionFailure == false) {
+				char debugMessage[256];
+				wsprintfA(
+					debugMessage,
+					"[Pipeline Warning] Pass \"%s\" (type %d) failed to execute.\n",
+					s_pipelineDescription.passes[command->passIndex].name,
+					(int)command->type
+				);
+				OutputDebugStringA(debugMessage);
+				s_loggedPipelineExecutionFailure = true;
 			}
+			s_activePipelinePassIndex = -1;
+		}
 		s_activePipelinePassIndex = -1;
 
 		SwapBuffers(
@@ -1313,22 +1391,11 @@ entrypoint(
 		++frameCount;
 	} while (s_mmTime.u.sample < NUM_SOUND_BUFFER_AVAILABLE_SAMPLES);
 
-	if (s_graphicsComputeProgramId != 0) {
-		glExtDeleteProgram(s_graphicsComputeProgramId);
-		s_graphicsComputeProgramId = 0;
-		s_computePipelinePassUniformAvailable = false;
-		s_computeFrameCountUniformAvailable = false;
-		s_computeWaveOutUniformAvailable = false;
-		s_computeTimeUniformAvailable = false;
-		s_computeResolutionUniformAvailable = false;
-		s_computeMouseButtonsUniformAvailable = false;
+	for (int passIndex = 0; passIndex < PIPELINE_MAX_PASSES; ++passIndex) {
+		PipelineDeleteProgramState(&s_pipelinePassPrograms[passIndex]);
 	}
-	s_fragmentPipelinePassUniformAvailable = false;
-	s_fragmentWaveOutUniformAvailable = false;
-	s_fragmentFrameCountUniformAvailable = false;
-	s_fragmentTimeUniformAvailable = false;
-	s_fragmentResolutionUniformAvailable = false;
-	s_fragmentMouseButtonsUniformAvailable = false;
+	PipelineDeleteProgramState(&s_computeProgram);
+	PipelineMemset(&s_fragmentProgram, 0, sizeof(PipelineProgramState));
 	PipelineResetRuntimeResources();
 
 	/* デモを終了する */
@@ -79,6 +79,10 @@ char g_concatenatedString_align0[] =
 
 	/* サウンド用シェーダ */
 	#include "sound_compute_shader.inl"
+	"\0"			/* end mark */
+
+	/* パイプラインパス個別のシェーダ（パス毎に end mark で区切られる）*/
+	#include "pipeline_pass_shaders.inl"
 ;
 
 /* GL 拡張関数テーブルのインデクス */
@@ -19,6 +19,7 @@
 #define IDM_QUIT														0x20A
 #define IDM_OPEN_COMPUTE_SHADER										0x20B
 #define IDM_PIPELINE_MANAGEMENT											0x20C
+#define IDM_RECORD_TRACE												0x20D
 
 #define IDM_RENDER_SETTINGS												0x210
 #define IDM_PREFERENCE_SETTINGS											0x211
@@ -39,6 +40,7 @@
 
 #define IDM_TOGGLE_DISPLAY_CURRENT_STATUS								0x230
 #define IDM_TOGGLE_DISPLAY_CAMERA_SETTINGS								0x231
+#define IDM_TOGGLE_DISPLAY_PROFILER										0x232
 
 #define IDM_HELP_GRAPHICS_SHADER_UNIFORMS								0x240
 #define IDM_HELP_SOUND_SHADER_UNIFORMS									0x241
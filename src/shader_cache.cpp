@@ -0,0 +1,318 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include <string.h>
+#include <sys/utime.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "app.h"
+#include "config.h"
+#include "profiler.h"
+#include "shader_cache.h"
+
+
+#define SHADER_CACHE_FILE_MAGIC		(0x4250474D)	/* 'MGPB' */
+#define SHADER_CACHE_FILE_VERSION	(1)
+
+struct ShaderCacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binaryLength;
+};
+
+static bool s_enabled = false;
+static char s_cacheDirectoryName[MAX_PATH] = {0};
+static std::string s_driverString;
+
+/*
+	キャッシュファイルの一覧（ファイル名 → サイズと最終使用時刻）
+	ディレクトリの走査は初期化時の一度だけ行い、以降はここで総サイズを管理する。
+*/
+struct ShaderCacheFileInfo {
+	uint64_t sizeInBytes;
+	uint64_t lastUseTime;		/* FILETIME */
+};
+static std::unordered_map<std::string, ShaderCacheFileInfo> s_files;
+static uint64_t s_totalSizeInBytes = 0;
+
+
+/*=============================================================================
+▼	内部関数
+-----------------------------------------------------------------------------*/
+static void ShaderCacheGenerateFileName(
+	char *fileName,
+	size_t fileNameSizeInBytes,
+	uint64_t key
+){
+	snprintf(fileName, fileNameSizeInBytes, "%s\\%016llx.bin", s_cacheDirectoryName, (unsigned long long)key);
+}
+
+static bool ShaderCacheCreateDirectory(
+	const char *directoryName
+){
+	if (CreateDirectoryA(directoryName, NULL) == FALSE) {
+		if (GetLastError() != ERROR_ALREADY_EXISTS) return false;
+	}
+	return true;
+}
+
+static uint64_t ShaderCacheGetCurrentTime(
+){
+	FILETIME fileTime;
+	GetSystemTimeAsFileTime(&fileTime);
+	return ((uint64_t)fileTime.dwHighDateTime << 32) | fileTime.dwLowDateTime;
+}
+
+/* ファイル一覧の更新（sizeInBytes が 0 なら一覧から外す）*/
+static void ShaderCacheUpdateFileInfo(
+	const char *fileName,
+	uint64_t sizeInBytes,
+	uint64_t lastUseTime
+){
+	auto it = s_files.find(fileName);
+	if (it != s_files.end()) {
+		s_totalSizeInBytes -= it->second.sizeInBytes;
+		s_files.erase(it);
+	}
+	if (sizeInBytes != 0) {
+		ShaderCacheFileInfo info;
+		info.sizeInBytes = sizeInBytes;
+		info.lastUseTime = lastUseTime;
+		s_files[fileName] = info;
+		s_totalSizeInBytes += sizeInBytes;
+	}
+}
+
+/* キャッシュディレクトリを走査してファイル一覧を作る（初期化時のみ）*/
+static void ShaderCacheScanDirectory(
+){
+	s_files.clear();
+	s_totalSizeInBytes = 0;
+
+	char pattern[MAX_PATH];
+	snprintf(pattern, sizeof(pattern), "%s\\*.bin", s_cacheDirectoryName);
+	WIN32_FIND_DATAA findData;
+	HANDLE hFind = FindFirstFileA(pattern, &findData);
+	if (hFind == INVALID_HANDLE_VALUE) return;
+	do {
+		if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+		char fileName[MAX_PATH];
+		snprintf(fileName, sizeof(fileName), "%s\\%s", s_cacheDirectoryName, findData.cFileName);
+		ShaderCacheUpdateFileInfo(
+			fileName,
+			((uint64_t)findData.nFileSizeHigh << 32) | findData.nFileSizeLow,
+			((uint64_t)findData.ftLastWriteTime.dwHighDateTime << 32) | findData.ftLastWriteTime.dwLowDateTime
+		);
+	} while (FindNextFileA(hFind, &findData));
+	FindClose(hFind);
+}
+
+/* 総サイズが上限に収まるまで、最後に使われたのが古いものから削除する */
+static void ShaderCacheEvict(
+){
+	if (s_totalSizeInBytes <= DEFAULT_SHADER_CACHE_MAX_SIZE_IN_BYTES) return;
+
+	std::vector<std::pair<uint64_t, std::string> > entries;	/* (最終使用時刻, ファイル名) */
+	entries.reserve(s_files.size());
+	for (const auto &file : s_files) {
+		entries.push_back(std::make_pair(file.second.lastUseTime, file.first));
+	}
+	std::sort(entries.begin(), entries.end());
+	for (size_t entryIndex = 0; entryIndex < entries.size(); entryIndex++) {
+		if (s_totalSizeInBytes <= DEFAULT_SHADER_CACHE_MAX_SIZE_IN_BYTES) break;
+		const char *fileName = entries[entryIndex].second.c_str();
+		if (DeleteFileA(fileName) || GetLastError() == ERROR_FILE_NOT_FOUND) {
+			ShaderCacheUpdateFileInfo(fileName, 0, 0);
+		}
+	}
+}
+
+
+/*=============================================================================
+▼	キャッシュの参照と保存
+-----------------------------------------------------------------------------*/
+uint64_t ShaderCacheComputeKey(
+	GLenum type,
+	GLsizei count,
+	const GLchar* const *strings
+){
+	uint64_t hash = FNV1A_HASH64_INITIAL_VALUE;
+	uint32_t version = SHADER_CACHE_FILE_VERSION;
+	hash = Fnv1aHash64(hash, &version, sizeof(version));
+	hash = Fnv1aHash64(hash, &type, sizeof(type));
+	hash = Fnv1aHash64(hash, s_driverString.c_str(), s_driverString.size() + 1);
+	for (GLsizei i = 0; i < count; i++) {
+		hash = Fnv1aHash64(hash, strings[i], strlen(strings[i]));
+	}
+	return hash;
+}
+
+GLuint ShaderCacheLoadProgram(
+	uint64_t key
+){
+	if (s_enabled == false) return 0;
+	PROFILER_CPU_SCOPE("shader cache load");
+
+	char fileName[MAX_PATH];
+	ShaderCacheGenerateFileName(fileName, sizeof(fileName), key);
+	FILE *file = fopen(fileName, "rb");
+	if (file == NULL) return 0;
+
+	ShaderCacheFileHeader header;
+	void *binary = NULL;
+	bool valid = false;
+	if (fread(&header, sizeof(header), 1, file) == 1
+	&&	header.magic == SHADER_CACHE_FILE_MAGIC
+	&&	header.version == SHADER_CACHE_FILE_VERSION
+	&&	header.key == key
+	&&	header.binaryLength > 0
+	) {
+		binary = malloc(header.binaryLength);
+		if (binary != NULL) {
+			valid = (fread(binary, header.binaryLength, 1, file) == 1);
+		}
+	}
+	fclose(file);
+
+	GLuint programId = 0;
+	if (valid) {
+		programId = glCreateProgram();
+		glProgramParameteri(programId, GL_PROGRAM_SEPARABLE, GL_TRUE);
+		glProgramBinary(programId, header.binaryFormat, binary, header.binaryLength);
+		GLint status = GL_FALSE;
+		glGetProgramiv(programId, GL_LINK_STATUS, &status);
+		if (status == GL_FALSE) {
+			glDeleteProgram(programId);
+			programId = 0;
+		}
+	}
+	if (binary != NULL) free(binary);
+
+	if (programId == 0) {
+		/* 壊れているか、ドライバに拒否されたキャッシュは捨てる */
+		printf("shader cache %016llx is rejected.\n", (unsigned long long)key);
+		DeleteFileA(fileName);
+		ShaderCacheUpdateFileInfo(fileName, 0, 0);
+		return 0;
+	}
+
+	/* LRU 判定用に最終使用時刻を更新（次回起動時の走査用にファイルにも反映）*/
+	_utime(fileName, NULL);
+	auto it = s_files.find(fileName);
+	if (it != s_files.end()) it->second.lastUseTime = ShaderCacheGetCurrentTime();
+	printf("shader cache %016llx is loaded.\n", (unsigned long long)key);
+	return programId;
+}
+
+bool ShaderCacheStoreProgram(
+	uint64_t key,
+	GLuint programId
+){
+	if (s_enabled == false) return false;
+	PROFILER_CPU_SCOPE("shader cache store");
+
+	GLint binaryLength = 0;
+	glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0) return false;
+
+	void *binary = malloc(binaryLength);
+	if (binary == NULL) return false;
+	GLenum binaryFormat = 0;
+	GLsizei writtenLength = 0;
+	glGetProgramBinary(programId, binaryLength, &writtenLength, &binaryFormat, binary);
+	if (writtenLength <= 0) {
+		free(binary);
+		return false;
+	}
+
+	ShaderCacheFileHeader header;
+	header.magic		= SHADER_CACHE_FILE_MAGIC;
+	header.version		= SHADER_CACHE_FILE_VERSION;
+	header.key			= key;
+	header.binaryFormat	= binaryFormat;
+	header.binaryLength	= (uint32_t)writtenLength;
+
+	char fileName[MAX_PATH];
+	ShaderCacheGenerateFileName(fileName, sizeof(fileName), key);
+	FILE *file = fopen(fileName, "wb");
+	bool succeeded = false;
+	if (file != NULL) {
+		succeeded
+		=	fwrite(&header, sizeof(header), 1, file) == 1
+		&&	fwrite(binary, writtenLength, 1, file) == 1;
+		fclose(file);
+		if (succeeded == false) DeleteFileA(fileName);
+	}
+	free(binary);
+
+	/* 総サイズが上限を超えた時だけ削除する */
+	if (succeeded) {
+		ShaderCacheUpdateFileInfo(fileName, sizeof(header) + (uint64_t)writtenLength, ShaderCacheGetCurrentTime());
+		ShaderCacheEvict();
+	}
+	return succeeded;
+}
+
+
+/*=============================================================================
+▼	初期化 & 終了処理
+-----------------------------------------------------------------------------*/
+bool ShaderCacheInitialize(
+){
+	s_enabled = false;
+
+	/* ドライバが更新されたらキャッシュが無効になるよう、キーに含める */
+	const char *strings[] = {
+		(const char *)glGetString(GL_VENDOR),
+		(const char *)glGetString(GL_RENDERER),
+		(const char *)glGetString(GL_VERSION),
+	};
+	s_driverString.clear();
+	for (int i = 0; i < SIZE_OF_ARRAY(strings); i++) {
+		if (strings[i] != NULL) s_driverString += strings[i];
+		s_driverString += '\n';
+	}
+
+	/* バイナリ形式を一つも持たないドライバではキャッシュしない */
+	GLint numBinaryFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+	if (numBinaryFormats <= 0) {
+		printf("shader cache ... not available.\n");
+		return true;
+	}
+
+	/* %LOCALAPPDATA%\MinimalGL\shader_cache */
+	char localAppDataPath[MAX_PATH] = {0};
+	if (FAILED(SHGetFolderPathA(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, localAppDataPath))) {
+		printf("shader cache ... not available.\n");
+		return true;
+	}
+	char appDirectoryName[MAX_PATH];
+	snprintf(appDirectoryName, sizeof(appDirectoryName), "%s\\%s", localAppDataPath, APP_NAME);
+	snprintf(s_cacheDirectoryName, sizeof(s_cacheDirectoryName), "%s\\shader_cache", appDirectoryName);
+	if (ShaderCacheCreateDirectory(appDirectoryName) == false
+	||	ShaderCacheCreateDirectory(s_cacheDirectoryName) == false
+	) {
+		printf("shader cache ... failed to create %s.\n", s_cacheDirectoryName);
+		return true;
+	}
+
+	s_enabled = true;
+	ShaderCacheScanDirectory();
+	ShaderCacheEvict();
+	printf("shader cache ... %s.\n", s_cacheDirectoryName);
+	return true;
+}
+
+bool ShaderCacheTerminate(
+){
+	s_enabled = false;
+	s_driverString.clear();
+	s_files.clear();
+	s_totalSizeInBytes = 0;
+	return true;
+}
@@ -0,0 +1,47 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include "common.h"
+
+
+#ifndef _SHADER_CACHE_H_
+#define _SHADER_CACHE_H_
+
+
+/*
+	プログラムバイナリキャッシュ
+
+	リンク済みプログラムを glGetProgramBinary で取り出し、ローカルのキャッシュ
+	ディレクトリに保存する。キーは #include 展開済みのソース、プログラムの種類、
+	GL の vendor/renderer/version 文字列から求めたハッシュ値。
+	ドライバがバイナリを受け付けない場合（ドライバ更新後など）は、そのファイル
+	を削除してキャッシュミス扱いにする。
+	キャッシュの総サイズが上限を超えた場合は、最後に使われたのが古いものから
+	削除する。
+*/
+
+/* キャッシュのキーを求める */
+uint64_t ShaderCacheComputeKey(
+	GLenum type,
+	GLsizei count,
+	const GLchar* const *strings
+);
+
+/* キャッシュからプログラムを作成（キャッシュミスまたは読み込み失敗なら 0）*/
+GLuint ShaderCacheLoadProgram(
+	uint64_t key
+);
+
+/* リンク済みのプログラムをキャッシュに保存 */
+bool ShaderCacheStoreProgram(
+	uint64_t key,
+	GLuint programId
+);
+
+/* 初期化（GL コンテキスト作成後に呼ぶ）*/
+bool ShaderCacheInitialize();
+
+/* 終了処理 */
+bool ShaderCacheTerminate();
+
+
+#endif
@@ -0,0 +1,392 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include <string.h>
+#include <cctype>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "common.h"
+#include "profiler.h"
+#include "shader_include_cache.h"
+
+
+/* #include "..." 指令 */
+struct ShaderIncludeDirective {
+	size_t lineBegin;			/* 指令の行の先頭位置 */
+	size_t lineEnd;				/* 指令の行の次の行の先頭位置 */
+	bool hasNewline;			/* 行末に改行があるか？ */
+	std::string relativePath;	/* 記述されたままのパス */
+	std::string combinedPath;	/* インクルード元のディレクトリと連結したパス */
+	std::string resolvedPath;	/* 正規化されたパス */
+};
+
+/* キャッシュのエントリ（作成後は変更しないので、ロック無しで参照してよい）*/
+struct ShaderIncludeCacheEntry {
+	std::string fileName;		/* 正規化されたパス */
+	std::string content;
+	uint64_t lastWriteTime;
+	uint64_t sizeInBytes;
+	uint64_t contentHash;
+	std::vector<ShaderIncludeDirective> directives;
+};
+
+typedef std::shared_ptr<const ShaderIncludeCacheEntry> ShaderIncludeCacheEntryPtr;
+
+/* 以下は s_criticalSection で保護 */
+static CRITICAL_SECTION s_criticalSection;
+static std::unordered_map<std::string, ShaderIncludeCacheEntryPtr> s_entries;
+static std::unordered_map<std::string, std::unordered_set<std::string> > s_dependents;	/* #include されているファイル → #include しているファイル */
+
+
+/*=============================================================================
+▼	内部関数
+-----------------------------------------------------------------------------*/
+static bool ShaderIncludeCacheGetFileTime(
+	const char *fileName,
+	uint64_t *lastWriteTime,
+	uint64_t *sizeInBytes
+){
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (GetFileAttributesExA(fileName, GetFileExInfoStandard, &data) == FALSE) return false;
+	if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) return false;
+	*lastWriteTime = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	*sizeInBytes = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	return true;
+}
+
+static size_t ShaderIncludeCacheSkipSpaces(
+	const std::string &text,
+	size_t index,
+	size_t end
+){
+	while (index < end && std::isspace(static_cast<unsigned char>(text[index]))) {
+		++index;
+	}
+	return index;
+}
+
+/* #include "..." 指令の位置を列挙 */
+static void ShaderIncludeCacheTokenize(
+	ShaderIncludeCacheEntry *entry
+){
+	const std::string &content = entry->content;
+	char baseDirectory[MAX_PATH] = {0};
+	SplitDirectoryPathFromFilePath(baseDirectory, sizeof(baseDirectory), entry->fileName.c_str());
+
+	entry->directives.clear();
+	size_t position = 0;
+	while (position < content.size()) {
+		size_t lineBegin = position;
+		size_t newline = content.find('\n', position);
+		size_t lineEnd = (newline == std::string::npos)? content.size(): newline + 1;
+		position = lineEnd;
+
+		/* 行末の改行を除いた範囲 */
+		size_t end = lineEnd;
+		while (end > lineBegin && (content[end - 1] == '\n' || content[end - 1] == '\r')) {
+			--end;
+		}
+
+		size_t index = ShaderIncludeCacheSkipSpaces(content, lineBegin, end);
+		if (index >= end || content[index] != '#') continue;
+		index = ShaderIncludeCacheSkipSpaces(content, index + 1, end);
+		static const char s_includeToken[] = "include";
+		const size_t includeTokenLength = sizeof(s_includeToken) - 1;
+		if (end - index < includeTokenLength
+		||	content.compare(index, includeTokenLength, s_includeToken) != 0
+		) {
+			continue;
+		}
+		index = ShaderIncludeCacheSkipSpaces(content, index + includeTokenLength, end);
+		if (index >= end || content[index] != '"') continue;
+		++index;
+		size_t closing = content.find('"', index);
+		if (closing == std::string::npos || closing >= end) continue;
+
+		ShaderIncludeDirective directive;
+		directive.lineBegin = lineBegin;
+		directive.lineEnd = lineEnd;
+		directive.hasNewline = (newline != std::string::npos);
+		directive.relativePath = content.substr(index, closing - index);
+		char combinedPath[MAX_PATH] = {0};
+		GenerateCombinedPath(
+			combinedPath,
+			sizeof(combinedPath),
+			baseDirectory,
+			directive.relativePath.c_str()
+		);
+		directive.combinedPath = combinedPath;
+		directive.resolvedPath = NormalizeFilePath(combinedPath);
+		entry->directives.push_back(std::move(directive));
+	}
+}
+
+/* エントリの登録（逆引きの依存関係も更新）。entry が NULL なら削除 */
+static void ShaderIncludeCacheStoreEntry(
+	const std::string &fileName,
+	const ShaderIncludeCacheEntryPtr &entry
+){
+	EnterCriticalSection(&s_criticalSection);
+	auto it = s_entries.find(fileName);
+	if (it != s_entries.end()) {
+		for (const ShaderIncludeDirective &directive : it->second->directives) {
+			auto dependentsIt = s_dependents.find(directive.resolvedPath);
+			if (dependentsIt == s_dependents.end()) continue;
+			dependentsIt->second.erase(fileName);
+			if (dependentsIt->second.empty()) s_dependents.erase(dependentsIt);
+		}
+		s_entries.erase(it);
+	}
+	if (entry != NULL) {
+		for (const ShaderIncludeDirective &directive : entry->directives) {
+			s_dependents[directive.resolvedPath].insert(fileName);
+		}
+		s_entries[fileName] = entry;
+	}
+	LeaveCriticalSection(&s_criticalSection);
+}
+
+static ShaderIncludeCacheEntryPtr ShaderIncludeCacheFindEntry(
+	const std::string &fileName
+){
+	ShaderIncludeCacheEntryPtr entry;
+	EnterCriticalSection(&s_criticalSection);
+	auto it = s_entries.find(fileName);
+	if (it != s_entries.end()) entry = it->second;
+	LeaveCriticalSection(&s_criticalSection);
+	return entry;
+}
+
+/* 内容からエントリを作成（内容が前回と同一なら指令の列挙を省略）*/
+static ShaderIncludeCacheEntryPtr ShaderIncludeCacheCreateEntry(
+	const std::string &fileName,
+	const char *content,
+	uint64_t lastWriteTime,
+	uint64_t sizeInBytes,
+	const ShaderIncludeCacheEntryPtr &previousEntry
+){
+	std::shared_ptr<ShaderIncludeCacheEntry> entry = std::make_shared<ShaderIncludeCacheEntry>();
+	entry->fileName = fileName;
+	entry->content = SkipBomConst(content);	/* ファイルごとに BOM を除去 */
+	entry->lastWriteTime = lastWriteTime;
+	entry->sizeInBytes = sizeInBytes;
+	entry->contentHash = Fnv1aHash64(FNV1A_HASH64_INITIAL_VALUE, entry->content.data(), entry->content.size());
+	if (previousEntry != NULL
+	&&	previousEntry->contentHash == entry->contentHash
+	&&	previousEntry->content == entry->content
+	) {
+		entry->directives = previousEntry->directives;
+	} else {
+		ShaderIncludeCacheTokenize(entry.get());
+	}
+	return entry;
+}
+
+/*
+	最新のエントリを取得（更新されていれば読み直す）。読み込めなければ NULL
+	保存中のファイルは一時的に消えていたりロックされていたりするため、
+	読めなかった場合は既存のエントリをそのまま返す（ファイル監視スレッドからの
+	更新通知で後から反映される）。既存のエントリが無ければリトライしながら読む。
+*/
+static ShaderIncludeCacheEntryPtr ShaderIncludeCacheAcquireEntry(
+	const std::string &fileName
+){
+	ShaderIncludeCacheEntryPtr entry = ShaderIncludeCacheFindEntry(fileName);
+	uint64_t lastWriteTime = 0;
+	uint64_t sizeInBytes = 0;
+	if (ShaderIncludeCacheGetFileTime(fileName.c_str(), &lastWriteTime, &sizeInBytes) == false) {
+		return entry;
+	}
+	if (entry != NULL
+	&&	entry->lastWriteTime == lastWriteTime
+	&&	entry->sizeInBytes == sizeInBytes
+	) {
+		return entry;
+	}
+
+	char *content = NULL;
+	for (int retryCount = 0; retryCount < 10; retryCount++) {
+		content = MallocReadTextFile(fileName.c_str());
+		if (content != NULL || entry != NULL) break;
+		Sleep(100);
+	}
+	if (content == NULL) return entry;
+	entry = ShaderIncludeCacheCreateEntry(fileName, content, lastWriteTime, sizeInBytes, entry);
+	free(content);
+	ShaderIncludeCacheStoreEntry(fileName, entry);
+	return entry;
+}
+
+static bool ShaderIncludeCacheExpandEntry(
+	const ShaderIncludeCacheEntryPtr &entry,
+	std::unordered_set<std::string> &stack,
+	std::unordered_set<std::string> &included,
+	std::string &output,
+	std::string *errorMessage
+){
+	const std::string &content = entry->content;
+	const size_t outputBegin = output.size();
+	output.reserve(outputBegin + content.size());
+	stack.insert(entry->fileName);
+
+	size_t position = 0;
+	for (const ShaderIncludeDirective &directive : entry->directives) {
+		output.append(content, position, directive.lineBegin - position);
+		position = directive.lineEnd;
+
+		if (included.find(directive.resolvedPath) == included.end()) {
+			if (stack.find(directive.resolvedPath) != stack.end()) {
+				if (errorMessage != NULL) {
+					*errorMessage =
+						entry->fileName
+						+ ": error: detected circular #include involving \""
+						+ directive.relativePath
+						+ "\".";
+				}
+				stack.erase(entry->fileName);
+				return false;
+			}
+
+			ShaderIncludeCacheEntryPtr includedEntry = ShaderIncludeCacheAcquireEntry(directive.resolvedPath);
+			if (includedEntry == NULL) {
+				if (errorMessage != NULL) {
+					*errorMessage =
+						entry->fileName
+						+ ": error: cannot open include file \""
+						+ directive.relativePath
+						+ "\" (resolved path: "
+						+ directive.combinedPath
+						+ ").";
+				}
+				stack.erase(entry->fileName);
+				return false;
+			}
+			if (ShaderIncludeCacheExpandEntry(includedEntry, stack, included, output, errorMessage) == false) {
+				stack.erase(entry->fileName);
+				return false;
+			}
+		}
+
+		/* 行数が変わらないよう、指令の行の改行は残す */
+		if (directive.hasNewline && (output.size() == outputBegin || output.back() != '\n')) {
+			output.push_back('\n');
+		}
+	}
+	output.append(content, position, std::string::npos);
+
+	stack.erase(entry->fileName);
+	included.insert(entry->fileName);
+	return true;
+}
+
+
+/*=============================================================================
+▼	#include 展開
+-----------------------------------------------------------------------------*/
+bool ShaderIncludeCacheExpand(
+	const std::string &filePath,
+	std::unordered_set<std::string> &stack,
+	std::unordered_set<std::string> &included,
+	std::string &output,
+	std::string *errorMessage
+){
+	PROFILER_CPU_SCOPE("include expansion");
+	output.clear();
+
+	std::string normalizedPath = NormalizeFilePath(filePath);
+	if (included.find(normalizedPath) != included.end()) {
+		return true;
+	}
+	if (stack.find(normalizedPath) != stack.end()) {
+		if (errorMessage != NULL) {
+			*errorMessage = normalizedPath + ": error: detected circular #include directives.";
+		}
+		return false;
+	}
+
+	ShaderIncludeCacheEntryPtr entry = ShaderIncludeCacheAcquireEntry(normalizedPath);
+	if (entry == NULL) {
+		if (errorMessage != NULL) {
+			*errorMessage = normalizedPath + ": error: failed to read source file.";
+		}
+		return false;
+	}
+	return ShaderIncludeCacheExpandEntry(entry, stack, included, output, errorMessage);
+}
+
+
+/*=============================================================================
+▼	キャッシュの更新と依存関係の参照
+-----------------------------------------------------------------------------*/
+void ShaderIncludeCacheUpdateFile(
+	const char *fileName,
+	const char *content
+){
+	if (fileName == NULL || fileName[0] == '\0') return;
+	std::string normalizedPath = NormalizeFilePath(fileName);
+	if (content == NULL) {
+		ShaderIncludeCacheStoreEntry(normalizedPath, NULL);
+		return;
+	}
+
+	/*
+		読み込み後にファイルが再度更新されている可能性があるが、その場合は
+		次の更新通知で再度反映される。
+	*/
+	uint64_t lastWriteTime = 0;
+	uint64_t sizeInBytes = 0;
+	ShaderIncludeCacheGetFileTime(normalizedPath.c_str(), &lastWriteTime, &sizeInBytes);
+	ShaderIncludeCacheEntryPtr entry = ShaderIncludeCacheCreateEntry(
+		normalizedPath,
+		content,
+		lastWriteTime,
+		sizeInBytes,
+		ShaderIncludeCacheFindEntry(normalizedPath)
+	);
+	ShaderIncludeCacheStoreEntry(normalizedPath, entry);
+}
+
+void ShaderIncludeCacheCollectDependents(
+	const char *fileName,
+	std::unordered_set<std::string> &dependents
+){
+	if (fileName == NULL || fileName[0] == '\0') return;
+	std::vector<std::string> pending;
+	pending.push_back(NormalizeFilePath(fileName));
+
+	EnterCriticalSection(&s_criticalSection);
+	while (pending.empty() == false) {
+		std::string current = std::move(pending.back());
+		pending.pop_back();
+		auto it = s_dependents.find(current);
+		if (it == s_dependents.end()) continue;
+		for (const std::string &dependent : it->second) {
+			if (dependents.insert(dependent).second) {
+				pending.push_back(dependent);
+			}
+		}
+	}
+	LeaveCriticalSection(&s_criticalSection);
+}
+
+
+/*=============================================================================
+▼	初期化 & 終了処理
+-----------------------------------------------------------------------------*/
+bool ShaderIncludeCacheInitialize(
+){
+	InitializeCriticalSection(&s_criticalSection);
+	s_entries.clear();
+	s_dependents.clear();
+	return true;
+}
+
+bool ShaderIncludeCacheTerminate(
+){
+	s_entries.clear();
+	s_dependents.clear();
+	DeleteCriticalSection(&s_criticalSection);
+	return true;
+}
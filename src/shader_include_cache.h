@@ -0,0 +1,61 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include "common.h"
+#include <string>
+#include <unordered_set>
+
+
+#ifndef _SHADER_INCLUDE_CACHE_H_
+#define _SHADER_INCLUDE_CACHE_H_
+
+
+/*
+	シェーダの #include 展開用キャッシュ
+
+	正規化されたパスをキーに、ファイルの内容、最終修正時刻とサイズ、内容の
+	ハッシュ値、#include 指令の位置を保持する。展開時は最終修正時刻とサイズ
+	だけを確認し、変化が無ければファイルを読み直さない。展開結果は、指令の
+	間の区間を連結して組み立てる。
+	各ファイルが #include しているファイルから逆引きの依存関係を作っておき、
+	あるファイルが更新された時に、それを（間接的にでも）取り込んでいるファイル
+	の一覧を ShaderIncludeCacheCollectDependents で得られるようにする。
+	複数のスレッドから呼び出してよい。
+*/
+
+/*
+	#include 展開
+	stack は展開中のファイル（循環検出用）、included は展開済みのファイル
+	（同一ファイルは一度だけ展開する）。
+*/
+bool ShaderIncludeCacheExpand(
+	const std::string &filePath,
+	std::unordered_set<std::string> &stack,
+	std::unordered_set<std::string> &included,
+	std::string &output,
+	std::string *errorMessage
+);
+
+/*
+	ファイルの内容の更新
+	ファイル監視スレッドなどで読み込み済みの内容をキャッシュに反映する。
+	content が NULL ならキャッシュを破棄する。
+*/
+void ShaderIncludeCacheUpdateFile(
+	const char *fileName,
+	const char *content
+);
+
+/* fileName を直接または間接的に #include しているファイルの一覧（正規化されたパス）を dependents に追加 */
+void ShaderIncludeCacheCollectDependents(
+	const char *fileName,
+	std::unordered_set<std::string> &dependents
+);
+
+/* 初期化 */
+bool ShaderIncludeCacheInitialize();
+
+/* 終了処理 */
+bool ShaderIncludeCacheTerminate();
+
+
+#endif
@@ -0,0 +1,196 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include <process.h>
+#include <string.h>
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "common.h"
+#include "config.h"
+#include "profiler.h"
+#include "shader_include_cache.h"
+#include "shader_source_job.h"
+
+
+struct ShaderSourceJobRequest {
+	std::string fileName;
+	std::string fallbackSource;
+	bool finished;		/* ワーカースレッドでの処理が完了したか？ */
+	bool cancelled;		/* キャンセルされたか？（ワーカースレッドが破棄する）*/
+	bool succeeded;
+	ShaderSourceJobResult result;
+};
+
+/* 以下は s_criticalSection で保護 */
+static CRITICAL_SECTION s_criticalSection;
+static std::deque<ShaderSourceJobRequest *> s_requests;
+
+static HANDLE s_hSemaReadable = NULL;
+static HANDLE s_hThreads[SHADER_SOURCE_JOB_NUM_WORKER_THREADS] = {NULL};
+
+
+/*=============================================================================
+▼	ワーカースレッド
+-----------------------------------------------------------------------------*/
+static bool ShaderSourceJobProcess(
+	const ShaderSourceJobRequest *request,
+	ShaderSourceJobResult *result
+){
+	PROFILER_CPU_SCOPE("shader source preparation");
+
+	if (request->fileName.empty() == false) {
+		std::unordered_set<std::string> stack;
+		std::unordered_set<std::string> included;
+		if (ShaderIncludeCacheExpand(request->fileName, stack, included, result->source, &result->errorMessage) == false) {
+			if (result->errorMessage.empty()) {
+				result->errorMessage = request->fileName + ": error: failed to expand #include directives.";
+			}
+			return false;
+		}
+		result->includedFiles.assign(included.begin(), included.end());
+	} else {
+		result->source = SkipBomConst(request->fallbackSource.c_str());
+	}
+
+	result->sourceHash = Fnv1aHash64(FNV1A_HASH64_INITIAL_VALUE, result->source.data(), result->source.size());
+	return true;
+}
+
+static unsigned __stdcall ShaderSourceJobThreadProc(
+	void	*pWork_
+){
+	ProfilerSetThreadName("shader source worker");
+	for (;;) {
+		WaitForSingleObject(s_hSemaReadable, INFINITE);	/* take */
+		EnterCriticalSection(&s_criticalSection);
+		ShaderSourceJobRequest *request = s_requests.front();
+		s_requests.pop_front();
+		bool cancelled = (request != NULL && request->cancelled);
+		LeaveCriticalSection(&s_criticalSection);
+		if (request == NULL) break;	/* end mark 検出 */
+		if (cancelled) {
+			delete request;
+			continue;
+		}
+
+		/* 処理中はロックしない（キャンセルされても request は破棄されない）*/
+		ShaderSourceJobResult result;
+		bool succeeded = ShaderSourceJobProcess(request, &result);
+
+		EnterCriticalSection(&s_criticalSection);
+		cancelled = request->cancelled;
+		if (cancelled == false) {
+			request->result = std::move(result);
+			request->succeeded = succeeded;
+			request->finished = true;
+		}
+		LeaveCriticalSection(&s_criticalSection);
+		if (cancelled) delete request;
+	}
+	return 0;
+}
+
+static void ShaderSourceJobEnqueue(
+	ShaderSourceJobRequest *request
+){
+	EnterCriticalSection(&s_criticalSection);
+	s_requests.push_back(request);
+	LeaveCriticalSection(&s_criticalSection);
+	ReleaseSemaphore(s_hSemaReadable, 1, NULL);		/* post */
+}
+
+
+/*=============================================================================
+▼	ジョブの操作
+-----------------------------------------------------------------------------*/
+void ShaderSourceJobStart(
+	ShaderSourceJob *job,
+	const char *fileName,
+	const char *fallbackSource
+){
+	ShaderSourceJobCancel(job);
+
+	ShaderSourceJobRequest *request = new ShaderSourceJobRequest;
+	request->fileName = (fileName != NULL)? fileName: "";
+	request->fallbackSource = (fallbackSource != NULL)? fallbackSource: "";
+	request->finished = false;
+	request->cancelled = false;
+	request->succeeded = false;
+	job->request = request;
+	ShaderSourceJobEnqueue(request);
+}
+
+ShaderSourceJobStatus ShaderSourceJobPoll(
+	ShaderSourceJob *job,
+	ShaderSourceJobResult *result
+){
+	ShaderSourceJobRequest *request = job->request;
+	if (request == NULL) return ShaderSourceJobStatusIdle;
+
+	EnterCriticalSection(&s_criticalSection);
+	bool finished = request->finished;
+	LeaveCriticalSection(&s_criticalSection);
+	if (finished == false) return ShaderSourceJobStatusRunning;
+
+	/* 完了後はワーカースレッドから参照されない */
+	bool succeeded = request->succeeded;
+	*result = std::move(request->result);
+	delete request;
+	job->request = NULL;
+	return succeeded? ShaderSourceJobStatusSucceeded: ShaderSourceJobStatusFailed;
+}
+
+void ShaderSourceJobCancel(
+	ShaderSourceJob *job
+){
+	ShaderSourceJobRequest *request = job->request;
+	if (request == NULL) return;
+	job->request = NULL;
+
+	EnterCriticalSection(&s_criticalSection);
+	bool finished = request->finished;
+	if (finished == false) request->cancelled = true;	/* ワーカースレッドが破棄する */
+	LeaveCriticalSection(&s_criticalSection);
+	if (finished) delete request;
+}
+
+bool ShaderSourceJobIsActive(
+	const ShaderSourceJob *job
+){
+	return job->request != NULL;
+}
+
+
+/*=============================================================================
+▼	初期化 & 終了処理
+-----------------------------------------------------------------------------*/
+bool ShaderSourceJobInitialize(
+){
+	InitializeCriticalSection(&s_criticalSection);
+	s_hSemaReadable = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+	if (s_hSemaReadable == NULL) return false;
+	for (int i = 0; i < SHADER_SOURCE_JOB_NUM_WORKER_THREADS; i++) {
+		s_hThreads[i] = (HANDLE)_beginthreadex(NULL, 0, ShaderSourceJobThreadProc, NULL, 0, NULL);
+		if (s_hThreads[i] == NULL) return false;
+	}
+	return true;
+}
+
+bool ShaderSourceJobTerminate(
+){
+	/* 全てのジョブはキャンセル済みであること */
+	for (int i = 0; i < SHADER_SOURCE_JOB_NUM_WORKER_THREADS; i++) {
+		ShaderSourceJobEnqueue(NULL);	/* end mark */
+	}
+	for (int i = 0; i < SHADER_SOURCE_JOB_NUM_WORKER_THREADS; i++) {
+		if (WaitForSingleObject(s_hThreads[i], INFINITE) != WAIT_OBJECT_0) return false;
+		if (CloseHandle(s_hThreads[i]) == FALSE) return false;
+		s_hThreads[i] = NULL;
+	}
+	if (CloseHandle(s_hSemaReadable) == FALSE) return false;
+	s_hSemaReadable = NULL;
+	s_requests.clear();
+	DeleteCriticalSection(&s_criticalSection);
+	return true;
+}
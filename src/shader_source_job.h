@@ -0,0 +1,77 @@
+﻿/* Copyright (C) 2018 Yosshin(@yosshin4004) */
+
+#include "common.h"
+#include <string>
+#include <vector>
+
+
+#ifndef _SHADER_SOURCE_JOB_H_
+#define _SHADER_SOURCE_JOB_H_
+
+
+/*
+	シェーダソースの準備ジョブ
+
+	ワーカースレッドで、ファイルの読み込み（#include 展開用キャッシュ経由）、
+	BOM の除去、#include 展開、ハッシュ値の計算を行い、そのままコンパイルに
+	渡せるソースを作る。メインスレッドは ShaderSourceJobPoll で完了を確認し、
+	結果をコンパイルに渡す。
+	完了前に ShaderSourceJobStart や ShaderSourceJobCancel が呼ばれた場合、
+	実行中のジョブの結果は捨てられる。
+*/
+
+enum ShaderSourceJobStatus {
+	ShaderSourceJobStatusIdle,			/* ジョブ無し */
+	ShaderSourceJobStatusRunning,		/* 準備中 */
+	ShaderSourceJobStatusSucceeded,		/* 準備完了（結果は一度だけ返される）*/
+	ShaderSourceJobStatusFailed,		/* 準備失敗（結果は一度だけ返される）*/
+};
+
+struct ShaderSourceJobResult {
+	std::string source;							/* コンパイルに渡すソース（BOM 除去、#include 展開済み）*/
+	uint64_t sourceHash;						/* source のハッシュ値 */
+	std::vector<std::string> includedFiles;		/* 展開したファイル（正規化されたパス）*/
+	std::string errorMessage;					/* 失敗時のエラーメッセージ */
+	ShaderSourceJobResult() : sourceHash(0) {}
+};
+
+struct ShaderSourceJobRequest;
+struct ShaderSourceJob {
+	ShaderSourceJobRequest *request;
+	ShaderSourceJob() : request(NULL) {}
+};
+
+/*
+	ジョブの開始（実行中のジョブはキャンセルされる）
+	fileName が空でなければファイルを #include 展開する。空なら fallbackSource を使う。
+*/
+void ShaderSourceJobStart(
+	ShaderSourceJob *job,
+	const char *fileName,
+	const char *fallbackSource
+);
+
+/* ジョブの状態の確認（完了していれば result に結果を返す）*/
+ShaderSourceJobStatus ShaderSourceJobPoll(
+	ShaderSourceJob *job,
+	ShaderSourceJobResult *result
+);
+
+/* ジョブのキャンセル */
+void ShaderSourceJobCancel(
+	ShaderSourceJob *job
+);
+
+/* ジョブが実行中か？ */
+bool ShaderSourceJobIsActive(
+	const ShaderSourceJob *job
+);
+
+/* 初期化 */
+bool ShaderSourceJobInitialize();
+
+/* 終了処理 */
+bool ShaderSourceJobTerminate();
+
+
+#endif
@@ -4,6 +4,8 @@
 #include "app.h"
 #include "sound.h"
 #include "wav_util.h"
+#include "gl_state_cache.h"
+#include "profiler.h"
 
 
 #define BUFFER_INDEX_FOR_SOUND_OUTPUT			(0)
@@ -93,17 +95,21 @@ static void SoundSynthesizePartition(
 
 			/* シェーダをバインド */
 			assert(s_soundShaderId != 0);
-			glUseProgram(s_soundShaderId);
+			GlStateCacheUseProgram(s_soundShaderId);
 
 			/* 出力先バッファの指定 */
-			glBindBufferBase(
+			GlStateCacheBindBufferBase(
 				/* GLenum target */	GL_SHADER_STORAGE_BUFFER,
 				/* GLuint index */	BUFFER_INDEX_FOR_SOUND_OUTPUT,
 				/* GLuint buffer */	s_soundOutputSsbo
 			);
 
-			/* ユニフォームパラメータの設定 */
-			if (ExistsShaderUniform(s_soundShaderId, UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
+			/*
+				ユニフォームパラメータの設定
+				フレーム単位のパラメータは、グラフィクス側でバインドされた
+				uniform block（UNIFORM_BLOCK_BINDING_FRAME_PARAMS）から参照できる。
+			*/
+			if (ShaderReflectionHasUniform(GetShaderReflection(s_soundShaderId), UNIFORM_LOCATION_WAVE_OUT_POS, GL_INT)) {
 				glUniform1i(
 					UNIFORM_LOCATION_WAVE_OUT_POS,
 					NUM_SOUND_BUFFER_SAMPLES_PER_DISPATCH * partitionIndex
@@ -114,20 +120,22 @@ static void SoundSynthesizePartition(
 			CheckGlError("SoundUpdate : pre dispatch");
 
 			/* コンピュートシェーダによるサウンド生成 */
+			ProfilerGpuBegin("(sound partition)");
 			glDispatchCompute(NUM_SOUND_BUFFER_SAMPLES_PER_DISPATCH, 1, 1);
+			ProfilerGpuEnd();
 
 			/* エラーチェック */
 			CheckGlError("SoundUpdate : post dispatch");
 
 			/* アンバインド */
-			glBindBufferBase(
+			GlStateCacheBindBufferBase(
 				/* GLenum target */	GL_SHADER_STORAGE_BUFFER,
 				/* GLuint index */	BUFFER_INDEX_FOR_SOUND_OUTPUT,
 				/* GLuint buffer */	0	/* unbind */
 			);
 
 			/* シェーダをアンバインド */
-			glUseProgram(NULL);
+			GlStateCacheUseProgram(NULL);
 		}
 	}
 }
@@ -165,19 +173,20 @@ static void SoundGetSynthesizedPartitionResult(
 	}
 }
 
-bool SoundCreateShader(
-	const char *shaderCode
+bool SoundSetShader(
+	GLuint programId
 ){
-	printf("setup the sound shader ...\n");
-	const GLchar *(strings[]) = {
-		SkipBomConst(shaderCode)
-	};
-	assert(s_soundShaderId == 0);
-	s_soundShaderId = CreateShader(GL_COMPUTE_SHADER, SIZE_OF_ARRAY(strings), strings);
-	if (s_soundShaderId == 0) {
-		printf("setup the sound shader ... fialed.\n");
-		return false;
+	if (programId == 0) return false;
+
+	/*
+		実行中のプログラムを置き換える。
+		発行済みのコマンドが参照するプログラムは GL 側で完了まで保持されるので
+		glFinish は不要。
+	*/
+	if (s_soundShaderId != 0) {
+		DeleteShaderProgram(s_soundShaderId);
 	}
+	s_soundShaderId = programId;
 	DumpShaderInterfaces(s_soundShaderId);
 	printf("setup the sound shader ... done.\n");
 	return true;
@@ -186,7 +195,7 @@ bool SoundCreateShader(
 bool SoundDeleteShader(){
 	if (s_soundShaderId == 0) return false;
 	glFinish();
-	glDeleteProgram(s_soundShaderId);
+	DeleteShaderProgram(s_soundShaderId);
 	s_soundShaderId = 0;
 	return true;
 }
@@ -215,7 +224,7 @@ static bool SoundCreateSoundOutputBuffer(
 		/* GLsizei n */				1,
 		/* GLuint * buffers */		&s_soundOutputSsbo
 	);
-	glBindBuffer(
+	GlStateCacheBindBuffer(
 		/* GLenum target */			GL_SHADER_STORAGE_BUFFER,
 		/* GLuint buffer */			s_soundOutputSsbo
 	);
@@ -235,7 +244,7 @@ static bool SoundCreateSoundOutputBuffer(
 		/* GLenum access */			GL_READ_WRITE
 	);
 	assert(s_mappedSoundOutputSsbo != NULL);
-	glBindBuffer(
+	GlStateCacheBindBuffer(
 		/* GLenum target */			GL_SHADER_STORAGE_BUFFER,
 		/* GLuint buffer */			0	/* unbind */
 	);
@@ -244,7 +253,7 @@ static bool SoundCreateSoundOutputBuffer(
 
 static bool SoundDeleteSoundOutputBuffer(
 ){
-	glDeleteBuffers(
+	GlStateCacheDeleteBuffers(
 		/* GLsizei n */			1,
 		/* GLuint * buffers */	&s_soundOutputSsbo
 	);
@@ -373,6 +382,7 @@ int SoundGetWaveOutPos(
 void SoundUpdate(
 	uint32_t frameCount
 ){
+	PROFILER_CPU_SCOPE("SoundUpdate");
 	int waveOutPos = SoundGetWaveOutPos();
 	s_soundCurrentPartitionIndex = waveOutPos / NUM_SOUND_BUFFER_SAMPLES_PER_DISPATCH;
 
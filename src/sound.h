@@ -33,9 +33,9 @@ void SoundSeekWaveOut(uint32_t offset);
 /* 再生位置の取得 */
 int SoundGetWaveOutPos();
 
-/* サウンド用シェーダの作成 */
-bool SoundCreateShader(
-	const char *shaderCode
+/* サウンド用シェーダの設定（作成済みのプログラムで置き換え、所有権は sound 側に移る）*/
+bool SoundSetShader(
+	GLuint programId
 );
 
 